@@ -0,0 +1,134 @@
+#include "alloc_tracker.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+
+// The replacements of the global allocation functions for the benchmark target. Every allocation is prefixed by a
+// header storing its size so the deallocation functions (which are not always passed the size) can account for it.
+// The header is as large as the alignment of the allocation such that the returned pointer keeps its alignment.
+
+namespace
+{
+
+	std::atomic<size_t> g_current_bytes{ 0 };
+	std::atomic<size_t> g_peak_bytes{ 0 };
+	std::atomic<size_t> g_num_allocations{ 0 };
+	std::atomic<size_t> g_allocated_bytes{ 0 };
+
+
+	void record_allocation(size_t size) noexcept
+	{
+		g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+		g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+		const size_t current = g_current_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+		while (current > peak && !g_peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void record_deallocation(size_t size) noexcept
+	{
+		g_current_bytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+
+
+	void* tracked_alloc(size_t size, size_t alignment) noexcept
+	{
+		alignment = std::max(alignment, alignof(std::max_align_t));
+		const size_t total = size + alignment;
+#ifdef _WIN32
+		void* base = _aligned_malloc(total, alignment);
+#else
+		// aligned_alloc requires the size to be a multiple of the alignment.
+		void* base = std::aligned_alloc(alignment, (total + alignment - 1) / alignment * alignment);
+#endif
+		if (!base)
+		{
+			return nullptr;
+		}
+		auto* ptr = static_cast<std::byte*>(base) + alignment;
+		*reinterpret_cast<size_t*>(ptr - sizeof(size_t)) = size;
+		record_allocation(size);
+		return ptr;
+	}
+
+	void tracked_free(void* ptr, size_t alignment) noexcept
+	{
+		if (!ptr)
+		{
+			return;
+		}
+		alignment = std::max(alignment, alignof(std::max_align_t));
+		auto* bytes = static_cast<std::byte*>(ptr);
+		record_deallocation(*reinterpret_cast<size_t*>(bytes - sizeof(size_t)));
+#ifdef _WIN32
+		_aligned_free(bytes - alignment);
+#else
+		std::free(bytes - alignment);
+#endif
+	}
+
+	void* tracked_alloc_or_throw(size_t size, size_t alignment)
+	{
+		// operator new(0) must still return a unique pointer.
+		void* ptr = tracked_alloc(std::max<size_t>(size, 1), alignment);
+		if (!ptr)
+		{
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+
+} // anonymous namespace
+
+
+namespace bench_util
+{
+
+	namespace alloc_tracker
+	{
+
+		stats snapshot() noexcept
+		{
+			stats out;
+			out.current_bytes = g_current_bytes.load(std::memory_order_relaxed);
+			out.peak_bytes = g_peak_bytes.load(std::memory_order_relaxed);
+			out.num_allocations = g_num_allocations.load(std::memory_order_relaxed);
+			out.allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+			return out;
+		}
+
+		void reset_peak() noexcept
+		{
+			g_peak_bytes.store(g_current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+	} // alloc_tracker
+
+} // bench_util
+
+
+void* operator new(size_t size) { return tracked_alloc_or_throw(size, 0); }
+void* operator new[](size_t size) { return tracked_alloc_or_throw(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(std::max<size_t>(size, 1), 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(std::max<size_t>(size, 1), 0); }
+void* operator new(size_t size, std::align_val_t align) { return tracked_alloc_or_throw(size, static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return tracked_alloc_or_throw(size, static_cast<size_t>(align)); }
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return tracked_alloc(std::max<size_t>(size, 1), static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return tracked_alloc(std::max<size_t>(size, 1), static_cast<size_t>(align)); }
+
+void operator delete(void* ptr) noexcept { tracked_free(ptr, 0); }
+void operator delete[](void* ptr) noexcept { tracked_free(ptr, 0); }
+void operator delete(void* ptr, size_t) noexcept { tracked_free(ptr, 0); }
+void operator delete[](void* ptr, size_t) noexcept { tracked_free(ptr, 0); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr, 0); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr, 0); }
+void operator delete(void* ptr, std::align_val_t align) noexcept { tracked_free(ptr, static_cast<size_t>(align)); }
+void operator delete[](void* ptr, std::align_val_t align) noexcept { tracked_free(ptr, static_cast<size_t>(align)); }
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept { tracked_free(ptr, static_cast<size_t>(align)); }
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept { tracked_free(ptr, static_cast<size_t>(align)); }
+void operator delete(void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept { tracked_free(ptr, static_cast<size_t>(align)); }
+void operator delete[](void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept { tracked_free(ptr, static_cast<size_t>(align)); }
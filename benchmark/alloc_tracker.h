@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+
+#include <benchmark/benchmark.h>
+
+
+namespace bench_util
+{
+
+	/// \brief Exact heap allocation tracking for the benchmarks.
+	///
+	/// The benchmark target replaces the global `operator new` and `operator delete` (see alloc_tracker.cpp) which
+	/// record every allocation made through them, this includes all allocations of the standard library containers
+	/// and of the cryptomatte library itself. Allocations made directly via `malloc` (e.g. by blosc2 or OpenImageIO)
+	/// are not tracked. Unlike sampling the process memory this catches short lived spikes and is identical across
+	/// platforms.
+	namespace alloc_tracker
+	{
+
+		/// \brief The counters of all tracked allocations since the start of the process.
+		struct stats
+		{
+			/// The number of bytes currently allocated.
+			size_t current_bytes = 0;
+			/// The highest number of bytes allocated at once since the last call to `reset_peak`.
+			size_t peak_bytes = 0;
+			/// The total number of allocations made.
+			size_t num_allocations = 0;
+			/// The total number of bytes allocated (not accounting for any deallocations).
+			size_t allocated_bytes = 0;
+		};
+
+		/// \brief Retrieve a snapshot of the allocation counters, these may be updated concurrently so the individual
+		/// fields are only consistent with each other if no other thread is allocating.
+		stats snapshot() noexcept;
+
+		/// \brief Reset the peak to the number of bytes currently allocated.
+		void reset_peak() noexcept;
+
+
+		/// \brief Measure the allocations of the benchmark loop and report them as benchmark counters.
+		///
+		/// Construct this right before the benchmark loop (after any setup) and call `report` once the loop has
+		/// finished. The following counters are reported:
+		///
+		/// - `heap_peak_MB`: The peak heap usage above the usage at construction, i.e. the peak memory required by
+		///                   a single iteration.
+		/// - `allocs/iter`:  The number of allocations per iteration.
+		/// - `alloc_MB/iter`: The number of bytes allocated per iteration.
+		struct scope
+		{
+			scope() noexcept
+			{
+				reset_peak();
+				m_Start = snapshot();
+			}
+
+			void report(benchmark::State& state) const
+			{
+				const auto end = snapshot();
+				const auto iterations = static_cast<double>(std::max<benchmark::IterationCount>(state.iterations(), 1));
+				state.counters["heap_peak_MB"] = static_cast<double>(end.peak_bytes - std::min(end.peak_bytes, m_Start.current_bytes)) / 1024 / 1024;
+				state.counters["allocs/iter"] = static_cast<double>(end.num_allocations - m_Start.num_allocations) / iterations;
+				state.counters["alloc_MB/iter"] = static_cast<double>(end.allocated_bytes - m_Start.allocated_bytes) / iterations / 1024 / 1024;
+			}
+
+		private:
+			stats m_Start;
+		};
+
+	} // alloc_tracker
+
+
+	/// Run the benchmark loop for the given function, reporting its allocations, see `alloc_tracker::scope`.
+	template <typename Func>
+	void run_with_alloc_tracking(benchmark::State& state, Func&& func)
+	{
+		alloc_tracker::scope tracking;
+		for (auto _ : state)
+		{
+			func();
+		}
+		tracking.report(state);
+	}
+
+} // bench_util
@@ -0,0 +1,113 @@
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <span>
+#include <bit>
+
+#include <benchmark/benchmark.h>
+
+#include "cryptomatte/detail/decoding_impl.h"
+#include "cryptomatte/detail/chunk_accumulator.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+/// Generate a synthetic rank chunk of `num_elems` holding `num_ids` distinct ids laid out in runs of (on average)
+/// `avg_run_length` pixels with roughly a quarter of the runs being empty pixels. This roughly mirrors the first
+/// rank channel of a rendered cryptomatte.
+static std::vector<float32_t> generate_rank_chunk(size_t num_elems, uint32_t num_ids, uint32_t avg_run_length)
+{
+	std::vector<float32_t> rank_chunk;
+	rank_chunk.reserve(num_elems);
+	uint32_t state = 0x9E3779B9;
+	while (rank_chunk.size() < num_elems)
+	{
+		// xorshift32 as a cheap, deterministic pseudo-random generator
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		uint32_t id = (state % 4 == 0) ? 0 : (state % num_ids + 1) * 0x01000193u;
+		size_t run_length = std::min<size_t>(state % (avg_run_length * 2) + 1, num_elems - rank_chunk.size());
+		rank_chunk.insert(rank_chunk.end(), run_length, std::bit_cast<float32_t>(id));
+	}
+	return rank_chunk;
+}
+
+
+/// The previous implementation inserting every pixel into a std::unordered_set, kept as a baseline. The chunks
+/// are distributed over the workers so this (like the library) collects the ids of a single chunk on one thread.
+static std::unordered_set<float32_t> accumulate_ids_unordered_set(std::span<const float32_t> rank_chunk)
+{
+	std::unordered_set<float32_t> ids_in_chunk;
+	for (float32_t elem : rank_chunk)
+	{
+		if (elem != static_cast<float32_t>(0))
+		{
+			ids_in_chunk.insert(elem);
+		}
+	}
+	return ids_in_chunk;
+}
+
+
+/// Args: {num_elems, num_ids, avg_run_length}
+static void bench_accumulate_ids_unordered_set(benchmark::State& state)
+{
+	auto rank_chunk = generate_rank_chunk(state.range(0), static_cast<uint32_t>(state.range(1)), static_cast<uint32_t>(state.range(2)));
+	for (auto _ : state)
+	{
+		auto ids = accumulate_ids_unordered_set(std::span<const float32_t>(rank_chunk));
+		benchmark::DoNotOptimize(ids);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+/// The id collection of `cryptomatte::ids`.
+/// 
+/// Args: {num_elems, num_ids, avg_run_length}
+static void bench_accumulate_ids_in_range(benchmark::State& state)
+{
+	auto rank_chunk = generate_rank_chunk(state.range(0), static_cast<uint32_t>(state.range(1)), static_cast<uint32_t>(state.range(2)));
+	detail::flat_id_set ids;
+	for (auto _ : state)
+	{
+		ids.clear();
+		detail::accumulate_ids_in_range(std::span<const float32_t>(rank_chunk), ids);
+		benchmark::DoNotOptimize(ids);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+/// The id registration and accumulation of a single level as done by the mask extraction.
+/// 
+/// Args: {num_elems, num_ids, avg_run_length}
+static void bench_chunk_accumulator(benchmark::State& state)
+{
+	auto rank_chunk = generate_rank_chunk(state.range(0), static_cast<uint32_t>(state.range(1)), static_cast<uint32_t>(state.range(2)));
+	std::vector<float32_t> coverage_chunk(rank_chunk.size(), 0.5f);
+	detail::chunk_accumulator accumulator;
+	for (auto _ : state)
+	{
+		accumulator.reset(rank_chunk.size());
+		accumulator.register_ids(std::span<const float32_t>(rank_chunk), nullptr);
+		accumulator.accumulate(std::span<const float32_t>(rank_chunk), std::span<const float32_t>(coverage_chunk));
+		benchmark::DoNotOptimize(accumulator.mask(0).data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+// 1M elements is a default chunk (4MB) of float32_t, cover few/many ids and short/long runs.
+BENCHMARK(bench_accumulate_ids_unordered_set)
+	->ArgsProduct({ { 1 << 20 }, { 16, 4096 }, { 1, 32 } })
+	->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_accumulate_ids_in_range)
+	->ArgsProduct({ { 1 << 20 }, { 16, 4096 }, { 1, 32 } })
+	->Unit(benchmark::kMicrosecond);
+// Every id holds a mask of the full chunk (4096 ids at 1M elements would be 16GB), so use smaller chunks here.
+BENCHMARK(bench_chunk_accumulator)
+	->ArgsProduct({ { 1 << 16 }, { 16, 256 }, { 1, 32 } })
+	->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,106 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <benchmark/benchmark.h>
+
+#include "cryptomatte/cryptomatte.h"
+
+#include "synthetic.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+// The benchmark macros paste the fixture name into an identifier so it may not be qualified.
+using synthetic_fixture = bench_util::synthetic::fixture;
+
+
+namespace
+{
+
+	/// Select `count` of the names on the manifest of the synthetic cryptomatte, spread evenly across all ids.
+	std::vector<std::string> select_names(const bench_util::synthetic::options& opts, size_t count)
+	{
+		auto names = bench_util::synthetic::generate_names(opts);
+		names.resize(opts.num_ids);
+		count = std::min(count, names.size());
+		std::vector<std::string> out;
+		for (size_t i = 0; i < count; ++i)
+		{
+			out.push_back(names[i * names.size() / count]);
+		}
+		return out;
+	}
+
+	/// Register the default synthetic cryptomattes with a set of selection sizes as additional argument.
+	void selection_args(benchmark::internal::Benchmark* bench)
+	{
+		bench_util::synthetic::default_args(bench, { 1, 16, 128 }, "selected");
+	}
+
+} // anonymous namespace
+
+
+BENCHMARK_DEFINE_F(synthetic_fixture, mask_by_hash)(benchmark::State& state)
+{
+	const auto hash = hash_name(select_names(m_Options, 1).front());
+	run(state, [&]()
+		{
+			auto mask = m_Matte->mask(hash);
+			benchmark::DoNotOptimize(mask);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, mask_by_name)(benchmark::State& state)
+{
+	const auto name = select_names(m_Options, 1).front();
+	run(state, [&]()
+		{
+			auto mask = m_Matte->mask(name);
+			benchmark::DoNotOptimize(mask);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, mask_compressed)(benchmark::State& state)
+{
+	const auto hash = hash_name(select_names(m_Options, 1).front());
+	run(state, [&]()
+		{
+			auto mask = m_Matte->mask_compressed(hash);
+			benchmark::DoNotOptimize(mask);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, masks_by_hashes)(benchmark::State& state)
+{
+	const auto hashes = hash_names(select_names(m_Options, static_cast<size_t>(state.range(synthetic_fixture::s_num_args))));
+	run(state, [&]()
+		{
+			auto masks = m_Matte->masks(hashes);
+			benchmark::DoNotOptimize(masks);
+		});
+	state.counters["masks/s"] = benchmark::Counter(
+		static_cast<double>(state.iterations() * hashes.size()),
+		benchmark::Counter::kIsRate
+	);
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, masks_by_names)(benchmark::State& state)
+{
+	const auto names = select_names(m_Options, static_cast<size_t>(state.range(synthetic_fixture::s_num_args)));
+	run(state, [&]()
+		{
+			auto masks = m_Matte->masks(names);
+			benchmark::DoNotOptimize(masks);
+		});
+	state.counters["masks/s"] = benchmark::Counter(
+		static_cast<double>(state.iterations() * names.size()),
+		benchmark::Counter::kIsRate
+	);
+}
+
+
+BENCHMARK_REGISTER_F(synthetic_fixture, mask_by_hash)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, mask_by_name)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, mask_compressed)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, masks_by_hashes)->Apply(selection_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, masks_by_names)->Apply(selection_args)->Unit(benchmark::kMillisecond);
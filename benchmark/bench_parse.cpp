@@ -0,0 +1,171 @@
+#include <vector>
+#include <string>
+#include <format>
+#include <algorithm>
+#include <unordered_map>
+#include <bit>
+#include <array>
+#include <optional>
+
+#include <benchmark/benchmark.h>
+#include <OpenImageIO/imageio.h>
+
+#include "cryptomatte/manifest.h"
+#include "cryptomatte/metadata.h"
+#include "cryptomatte/hash.h"
+#include "cryptomatte/detail/channel_util.h"
+#include "cryptomatte/detail/decoding_impl.h"
+
+#include "synthetic.h"
+#include "alloc_tracker.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	/// Generate the json string of a manifest holding `num_entries` names, as stored on the image metadata.
+	std::string generate_manifest_str(size_t num_entries)
+	{
+		bench_util::synthetic::options opts;
+		opts.num_ids = num_entries;
+		auto names = bench_util::synthetic::generate_names(opts);
+		auto hashes = hash_names(names);
+		std::vector<std::pair<std::string, uint32_t>> mapping;
+		mapping.reserve(names.size());
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			mapping.emplace_back(names[i], hashes[i]);
+		}
+		return manifest(std::move(mapping)).to_json().dump();
+	}
+
+	/// Generate the channel names of a cryptomatte with `num_levels` levels in a scrambled (but deterministic) order.
+	std::vector<std::string> generate_channel_names(size_t num_levels)
+	{
+		const std::array<std::string, 4> extensions = { "r", "g", "b", "a" };
+		std::vector<std::string> names;
+		for (size_t level = 0; level < num_levels; ++level)
+		{
+			names.push_back(std::format("CryptoObject{:02}.{}", level / 2, extensions[(level % 2) * 2]));
+			names.push_back(std::format("CryptoObject{:02}.{}", level / 2, extensions[(level % 2) * 2 + 1]));
+		}
+		std::reverse(names.begin(), names.end());
+		for (size_t i = 0; i + 2 < names.size(); i += 3)
+		{
+			std::swap(names[i], names[i + 2]);
+		}
+		return names;
+	}
+
+	void set_items_processed(benchmark::State& state, size_t num_items, size_t num_bytes)
+	{
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_items));
+		if (num_bytes > 0)
+		{
+			state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(num_bytes));
+		}
+	}
+
+} // anonymous namespace
+
+
+/// Args: {num_entries}
+static void bench_manifest_from_str(benchmark::State& state)
+{
+	const auto json = generate_manifest_str(static_cast<size_t>(state.range(0)));
+	bench_util::run_with_alloc_tracking(state, [&]()
+		{
+			auto manif = manifest::from_str(json);
+			benchmark::DoNotOptimize(manif);
+		});
+	set_items_processed(state, static_cast<size_t>(state.range(0)), json.size());
+}
+
+
+/// Args: {num_entries}
+static void bench_manifest_load(benchmark::State& state)
+{
+	const auto json = generate_manifest_str(static_cast<size_t>(state.range(0)));
+	bench_util::run_with_alloc_tracking(state, [&]()
+		{
+			auto manif = manifest::load("cryptomatte/f834d0a/manifest", json, "");
+			benchmark::DoNotOptimize(manif);
+		});
+	set_items_processed(state, static_cast<size_t>(state.range(0)), json.size());
+}
+
+
+/// Args: {num_entries}
+static void bench_metadata_from_spec(benchmark::State& state)
+{
+	const auto json = generate_manifest_str(static_cast<size_t>(state.range(0)));
+	OIIO::ImageSpec spec(1920, 1080, 4, OIIO::TypeDesc::FLOAT);
+	spec.attribute("cryptomatte/f834d0a/name", "CryptoObject");
+	spec.attribute("cryptomatte/f834d0a/hash", "MurmurHash3_32");
+	spec.attribute("cryptomatte/f834d0a/conversion", "uint32_to_float32");
+	spec.attribute("cryptomatte/f834d0a/manifest", json);
+	bench_util::run_with_alloc_tracking(state, [&]()
+		{
+			auto metadatas = metadata::from_spec(spec, "");
+			benchmark::DoNotOptimize(metadatas);
+		});
+	set_items_processed(state, static_cast<size_t>(state.range(0)), json.size());
+}
+
+
+/// Args: {num_levels}
+static void bench_sort_and_validate_channels(benchmark::State& state)
+{
+	const auto channels = generate_channel_names(static_cast<size_t>(state.range(0)));
+	bench_util::run_with_alloc_tracking(state, [&]()
+		{
+			auto sorted = detail::sort_and_validate_channels(channels);
+			benchmark::DoNotOptimize(sorted);
+		});
+	set_items_processed(state, channels.size(), 0);
+}
+
+
+/// Args: {num_entries, with_manifest}
+static void bench_map_to_string(benchmark::State& state)
+{
+	const size_t num_entries = static_cast<size_t>(state.range(0));
+	const auto json = generate_manifest_str(num_entries);
+	const auto manif = state.range(1) ? std::optional<manifest>(manifest::from_str(json)) : std::nullopt;
+	const auto hashes = hash_names([&]()
+		{
+			bench_util::synthetic::options opts;
+			opts.num_ids = num_entries;
+			return bench_util::synthetic::generate_names(opts);
+		}());
+
+	for (auto _ : state)
+	{
+		// The input is consumed, so it has to be rebuilt outside of the timed region on every iteration. The
+		// mapped values are kept empty such that only the remapping itself is measured.
+		state.PauseTiming();
+		std::unordered_map<float32_t, std::vector<float32_t>> in;
+		in.reserve(hashes.size());
+		for (auto hash : hashes)
+		{
+			in[std::bit_cast<float32_t>(hash)] = {};
+		}
+		state.ResumeTiming();
+
+		auto out = detail::map_to_string(std::move(in), manif);
+		benchmark::DoNotOptimize(out);
+	}
+	set_items_processed(state, num_entries, 0);
+}
+
+
+BENCHMARK(bench_manifest_from_str)->RangeMultiplier(10)->Range(1'000, 100'000)->Arg(500'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(bench_manifest_load)->RangeMultiplier(10)->Range(1'000, 100'000)->Arg(500'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(bench_metadata_from_spec)->RangeMultiplier(10)->Range(1'000, 100'000)->Arg(500'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(bench_sort_and_validate_channels)->RangeMultiplier(4)->Range(2, 128)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_map_to_string)
+	->ArgsProduct({ { 1'000, 10'000, 100'000, 500'000 }, { 0, 1 } })
+	->ArgNames({ "entries", "manifest" })
+	->Unit(benchmark::kMillisecond);
@@ -0,0 +1,78 @@
+#include <vector>
+#include <string>
+#include <filesystem>
+
+#include <benchmark/benchmark.h>
+
+#include "cryptomatte/cryptomatte.h"
+
+#include "synthetic.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+// The benchmark macros paste the fixture name into an identifier so it may not be qualified.
+using synthetic_fixture = bench_util::synthetic::fixture;
+
+
+BENCHMARK_DEFINE_F(synthetic_fixture, masks)(benchmark::State& state)
+{
+	run(state, [&]()
+		{
+			auto masks = m_Matte->masks();
+			benchmark::DoNotOptimize(masks);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, masks_compressed)(benchmark::State& state)
+{
+	run(state, [&]()
+		{
+			auto masks = m_Matte->masks_compressed();
+			benchmark::DoNotOptimize(masks);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, id_map)(benchmark::State& state)
+{
+	run(state, [&]()
+		{
+			auto map = m_Matte->id_map();
+			benchmark::DoNotOptimize(map);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, generate_preview)(benchmark::State& state)
+{
+	run(state, [&]()
+		{
+			auto preview = m_Matte->generate_preview();
+			benchmark::DoNotOptimize(preview);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, statistics)(benchmark::State& state)
+{
+	run(state, [&]()
+		{
+			auto statistics = m_Matte->statistics();
+			benchmark::DoNotOptimize(statistics);
+		});
+}
+
+BENCHMARK_DEFINE_F(synthetic_fixture, load)(benchmark::State& state)
+{
+	auto file = bench_util::synthetic::get_file(m_Options);
+	run(state, [&]()
+		{
+			auto mattes = cryptomatte::load(file, false);
+			benchmark::DoNotOptimize(mattes);
+		});
+}
+
+
+BENCHMARK_REGISTER_F(synthetic_fixture, masks)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, masks_compressed)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, id_map)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, generate_preview)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, statistics)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(synthetic_fixture, load)->Apply(bench_util::synthetic::default_args)->Unit(benchmark::kMillisecond);
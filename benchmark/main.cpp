@@ -10,7 +10,7 @@
 // Macros enabled via compile definitions
 #include "cryptomatte/detail/scoped_timer.h"
 
-#include "memory_sampling.h"
+#include "alloc_tracker.h"
 
 using namespace NAMESPACE_CRYPTOMATTE_API;
 
@@ -71,7 +71,7 @@ void write_exr(const std::string& filename, const std::vector<float>& pixels, in
 
 void bench_cryptomatte_load(benchmark::State& state, const std::filesystem::path& image_path)
 {
-	bench_util::run_with_memory_sampling(state, [&]()
+	bench_util::run_with_alloc_tracking(state, [&]()
 		{
 			_CRYPTOMATTE_PROFILE_FUNCTION();
 			auto image = ::cryptomatte::load(image_path, false);
@@ -87,7 +87,7 @@ void bench_cryptomatte_masks_compressed(benchmark::State& state, const std::file
 	for (auto& matte : cmattes)
 	{
 		std::unordered_map<std::string, compressed::channel<float32_t>> all_masks;
-		bench_util::run_with_memory_sampling(state, [&]()
+		bench_util::run_with_alloc_tracking(state, [&]()
 			{
 				_CRYPTOMATTE_PROFILE_FUNCTION();
 				all_masks = matte.masks_compressed();
@@ -0,0 +1,531 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <format>
+#include <filesystem>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/encoder.h"
+#include "cryptomatte/hash.h"
+
+#include "alloc_tracker.h"
+
+
+namespace bench_util
+{
+
+	namespace synthetic
+	{
+
+		/// \brief How the ids are laid out spatially across the image.
+		enum class distribution
+		{
+			/// A grid of `feature_size` sized cells holding one id each, anti-aliased along the cell borders. This
+			/// produces long runs of identical ids and few levels per pixel, similar to a simple product render.
+			blocky,
+			/// Every pixel holds a random number (up to `num_levels`) of random ids with random coverage. There are
+			/// no runs at all, this is the worst case for the decoding.
+			noisy,
+			/// Overlapping discs (one per id) of up to `feature_size` radius in front of a background id, composited
+			/// front to back with anti-aliased edges. This resembles crowd or particle renders with many small ids
+			/// and deep overlaps.
+			crowd,
+		};
+
+		inline std::string to_string(distribution dist)
+		{
+			switch (dist)
+			{
+			case distribution::blocky: return "blocky";
+			case distribution::noisy: return "noisy";
+			case distribution::crowd: return "crowd";
+			}
+			return "unknown";
+		}
+
+		/// \brief The parameters of a synthetic cryptomatte, the same options always generate the same cryptomatte.
+		struct options
+		{
+			size_t width = 1920;
+			size_t height = 1080;
+			/// The number of rank-coverage levels to encode.
+			size_t num_levels = 6;
+			/// The number of distinct ids in the image.
+			size_t num_ids = 256;
+			distribution layout = distribution::blocky;
+			/// The size of the features in pixels, the cell size for `blocky` and the maximum disc radius for `crowd`.
+			size_t feature_size = 32;
+			/// The width of the anti-aliased edges in pixels, 0 produces hard edges.
+			float32_t edge_width = 1.5f;
+			/// The number of entries on the manifest. If this is smaller than `num_ids` only the first ids are named,
+			/// if it is larger the manifest additionally holds names which do not appear in the image. Defaults to
+			/// one entry per id, 0 produces a cryptomatte without a manifest.
+			std::optional<size_t> manifest_size = std::nullopt;
+			/// The seed of the pseudo-random generator.
+			uint32_t seed = 0x9E3779B9;
+			/// The name (typename) of the cryptomatte.
+			std::string name = "CryptoObject";
+
+			/// \brief A short, unique description of these options, used for naming benchmarks.
+			std::string label() const
+			{
+				return std::format(
+					"{}/{}x{}/levels:{}/ids:{}",
+					to_string(layout), width, height, num_levels, num_ids
+				);
+			}
+
+			auto as_tuple() const
+			{
+				return std::tie(width, height, num_levels, num_ids, layout, feature_size, edge_width, manifest_size, seed, name);
+			}
+
+			bool operator<(const options& other) const { return as_tuple() < other.as_tuple(); }
+		};
+
+
+		namespace detail
+		{
+
+			/// xorshift32 as a cheap, deterministic pseudo-random generator.
+			struct random
+			{
+				uint32_t state;
+
+				explicit random(uint32_t seed) : state(seed == 0 ? 0x9E3779B9 : seed) {}
+
+				uint32_t next() noexcept
+				{
+					state ^= state << 13;
+					state ^= state >> 17;
+					state ^= state << 5;
+					return state;
+				}
+
+				/// A uniformly distributed value in [0, 1).
+				float32_t next_float() noexcept
+				{
+					return static_cast<float32_t>(next() >> 8) / static_cast<float32_t>(1u << 24);
+				}
+			};
+
+			/// Stateless hash of a cell index (and seed) for deterministically assigning ids to cells.
+			inline uint32_t hash_cell(uint64_t cell, uint32_t seed) noexcept
+			{
+				uint64_t x = cell ^ (static_cast<uint64_t>(seed) << 32);
+				x ^= x >> 33;
+				x *= 0xff51afd7ed558ccdULL;
+				x ^= x >> 33;
+				x *= 0xc4ceb9fe1a85ec53ULL;
+				x ^= x >> 33;
+				return static_cast<uint32_t>(x);
+			}
+
+			/// The coverage of a feature at the given signed distance to its edge (positive inside).
+			inline float32_t edge_coverage(float32_t distance, float32_t edge_width) noexcept
+			{
+				if (edge_width <= 0.0f)
+				{
+					return distance >= 0.0f ? 1.0f : 0.0f;
+				}
+				return std::clamp(0.5f + distance / edge_width, 0.0f, 1.0f);
+			}
+
+			/// The per-pixel samples of an image alongside their offsets, as consumed by `NAMESPACE_CRYPTOMATTE_API::encode`.
+			struct samples
+			{
+				std::vector<NAMESPACE_CRYPTOMATTE_API::sample> data;
+				std::vector<size_t> offsets;
+			};
+
+			inline void generate_blocky(const options& opts, const std::vector<uint32_t>& ids, samples& out)
+			{
+				const size_t cell = std::max<size_t>(opts.feature_size, 1);
+				const size_t cells_x = (opts.width + cell - 1) / cell;
+				auto id_of = [&](size_t cx, size_t cy)
+					{
+						return ids[hash_cell(cy * cells_x + cx, opts.seed) % ids.size()];
+					};
+
+				for (size_t y = 0; y < opts.height; ++y)
+				{
+					for (size_t x = 0; x < opts.width; ++x)
+					{
+						out.offsets.push_back(out.data.size());
+						const size_t cx = x / cell;
+						const size_t cy = y / cell;
+						const uint32_t id = id_of(cx, cy);
+
+						// Distance from the pixel center to the closest cell border along with the cell on the
+						// other side of it, we only blend with the single closest neighbour.
+						const float32_t fx = static_cast<float32_t>(x % cell) + 0.5f;
+						const float32_t fy = static_cast<float32_t>(y % cell) + 0.5f;
+						const float32_t size = static_cast<float32_t>(cell);
+						std::tuple<float32_t, int64_t, int64_t> borders[] = {
+							{ fx, -1, 0 }, { size - fx, 1, 0 }, { fy, 0, -1 }, { size - fy, 0, 1 }
+						};
+						auto [distance, dx, dy] = *std::min_element(std::begin(borders), std::end(borders));
+						const int64_t nx = static_cast<int64_t>(cx) + dx;
+						const int64_t ny = static_cast<int64_t>(cy) + dy;
+
+						const float32_t coverage = edge_coverage(distance, opts.edge_width);
+						const bool has_neighbour = nx >= 0 && ny >= 0
+							&& static_cast<size_t>(nx) * cell < opts.width && static_cast<size_t>(ny) * cell < opts.height;
+						out.data.push_back({ id, has_neighbour ? coverage : 1.0f });
+						if (has_neighbour && coverage < 1.0f)
+						{
+							out.data.push_back({ id_of(static_cast<size_t>(nx), static_cast<size_t>(ny)), 1.0f - coverage });
+						}
+					}
+				}
+			}
+
+			inline void generate_noisy(const options& opts, const std::vector<uint32_t>& ids, samples& out)
+			{
+				random rng(opts.seed);
+				const size_t max_samples = std::max<size_t>(opts.num_levels, 1);
+				for (size_t i = 0; i < opts.width * opts.height; ++i)
+				{
+					out.offsets.push_back(out.data.size());
+					const size_t num_samples = rng.next() % max_samples + 1;
+					const size_t first = out.data.size();
+					float32_t total = 0.0f;
+					for (size_t s = 0; s < num_samples; ++s)
+					{
+						const float32_t weight = rng.next_float() + 0.01f;
+						out.data.push_back({ ids[rng.next() % ids.size()], weight });
+						total += weight;
+					}
+					for (size_t s = first; s < out.data.size(); ++s)
+					{
+						out.data[s].coverage /= total;
+					}
+				}
+			}
+
+			inline void generate_crowd(const options& opts, const std::vector<uint32_t>& ids, samples& out)
+			{
+				struct disc
+				{
+					float32_t x, y, radius;
+					uint32_t id;
+				};
+
+				// The first id is the background, every other id is a single disc at a random position and size.
+				random rng(opts.seed);
+				const float32_t max_radius = static_cast<float32_t>(std::max<size_t>(opts.feature_size, 1));
+				std::vector<disc> discs;
+				for (size_t i = 1; i < ids.size(); ++i)
+				{
+					discs.push_back({
+						rng.next_float() * static_cast<float32_t>(opts.width),
+						rng.next_float() * static_cast<float32_t>(opts.height),
+						max_radius * (0.25f + 0.75f * rng.next_float()),
+						ids[i]
+					});
+				}
+
+				// Bin the discs into a grid so every pixel only tests the discs close to it. The discs are stored in
+				// front-to-back order (their index) in every cell.
+				const size_t cell = static_cast<size_t>(max_radius) * 2;
+				const size_t cells_x = opts.width / cell + 1;
+				const size_t cells_y = opts.height / cell + 1;
+				std::vector<std::vector<size_t>> grid(cells_x * cells_y);
+				for (size_t i = 0; i < discs.size(); ++i)
+				{
+					const auto& d = discs[i];
+					const float32_t reach = d.radius + opts.edge_width;
+					const size_t min_cx = static_cast<size_t>(std::max(d.x - reach, 0.0f)) / cell;
+					const size_t min_cy = static_cast<size_t>(std::max(d.y - reach, 0.0f)) / cell;
+					const size_t max_cx = std::min(static_cast<size_t>(d.x + reach) / cell, cells_x - 1);
+					const size_t max_cy = std::min(static_cast<size_t>(d.y + reach) / cell, cells_y - 1);
+					for (size_t cy = min_cy; cy <= max_cy; ++cy)
+					{
+						for (size_t cx = min_cx; cx <= max_cx; ++cx)
+						{
+							grid[cy * cells_x + cx].push_back(i);
+						}
+					}
+				}
+
+				for (size_t y = 0; y < opts.height; ++y)
+				{
+					for (size_t x = 0; x < opts.width; ++x)
+					{
+						out.offsets.push_back(out.data.size());
+						const float32_t px = static_cast<float32_t>(x) + 0.5f;
+						const float32_t py = static_cast<float32_t>(y) + 0.5f;
+						float32_t remaining = 1.0f;
+						for (size_t i : grid[(y / cell) * cells_x + x / cell])
+						{
+							const auto& d = discs[i];
+							const float32_t distance = d.radius - std::hypot(px - d.x, py - d.y);
+							const float32_t alpha = edge_coverage(distance, opts.edge_width);
+							if (alpha <= 0.0f)
+							{
+								continue;
+							}
+							out.data.push_back({ d.id, alpha * remaining });
+							remaining *= 1.0f - alpha;
+							if (remaining <= 0.0f)
+							{
+								break;
+							}
+						}
+						if (remaining > 0.0f)
+						{
+							out.data.push_back({ ids.front(), remaining });
+						}
+					}
+				}
+			}
+
+		} // detail
+
+
+		/// \brief Generate the names of the objects of a synthetic cryptomatte, the first `opts.num_ids` of these
+		/// appear in the image.
+		inline std::vector<std::string> generate_names(const options& opts)
+		{
+			const size_t num_names = std::max(opts.num_ids, opts.manifest_size.value_or(opts.num_ids));
+			std::vector<std::string> names;
+			names.reserve(num_names);
+			for (size_t i = 0; i < num_names; ++i)
+			{
+				names.push_back(std::format("object_{:06}", i));
+			}
+			return names;
+		}
+
+		/// \brief Generate a synthetic cryptomatte in memory.
+		///
+		/// The pixels are generated as per-pixel samples and encoded via `NAMESPACE_CRYPTOMATTE_API::encode` so the
+		/// levels are sorted and filled exactly as a renderer would.
+		///
+		/// \throws std::invalid_argument if the resolution, number of levels or number of ids is 0.
+		inline NAMESPACE_CRYPTOMATTE_API::cryptomatte generate(const options& opts)
+		{
+			if (opts.width == 0 || opts.height == 0 || opts.num_levels == 0 || opts.num_ids == 0)
+			{
+				throw std::invalid_argument(
+					std::format("Unable to generate synthetic cryptomatte with the options '{}'", opts.label())
+				);
+			}
+
+			auto names = generate_names(opts);
+			auto hashes = NAMESPACE_CRYPTOMATTE_API::hash_names(names);
+			std::vector<uint32_t> ids(hashes.begin(), hashes.begin() + opts.num_ids);
+
+			detail::samples samples;
+			samples.offsets.reserve(opts.width * opts.height + 1);
+			switch (opts.layout)
+			{
+			case distribution::blocky: detail::generate_blocky(opts, ids, samples); break;
+			case distribution::noisy: detail::generate_noisy(opts, ids, samples); break;
+			case distribution::crowd: detail::generate_crowd(opts, ids, samples); break;
+			}
+			samples.offsets.push_back(samples.data.size());
+
+			NAMESPACE_CRYPTOMATTE_API::encode_options encode_opts;
+			encode_opts.name = opts.name;
+			encode_opts.num_levels = opts.num_levels;
+			const size_t manifest_size = opts.manifest_size.value_or(opts.num_ids);
+			if (manifest_size > 0)
+			{
+				std::vector<std::pair<std::string, uint32_t>> mapping;
+				mapping.reserve(manifest_size);
+				for (size_t i = 0; i < manifest_size; ++i)
+				{
+					mapping.emplace_back(names[i], hashes[i]);
+				}
+				encode_opts.manifest = NAMESPACE_CRYPTOMATTE_API::manifest(std::move(mapping));
+			}
+
+			return NAMESPACE_CRYPTOMATTE_API::encode(samples.data, samples.offsets, opts.width, opts.height, encode_opts);
+		}
+
+		/// \brief Generate a synthetic cryptomatte and write it to an exr file, e.g. to benchmark loading.
+		inline void write(const options& opts, const std::filesystem::path& file, const std::string& compression = "zip")
+		{
+			generate(opts).write(file, compression);
+		}
+
+		/// \brief Retrieve the (cached) synthetic cryptomatte for the given options.
+		///
+		/// Generating large cryptomattes takes considerably longer than decoding them, so these are generated once
+		/// and shared across all benchmarks using the same options for the duration of the process. The benchmarks
+		/// run one after another so it is safe for these to e.g. change the executor of the shared cryptomatte.
+		inline NAMESPACE_CRYPTOMATTE_API::cryptomatte& get(const options& opts)
+		{
+			static std::mutex s_mutex;
+			static std::map<options, std::unique_ptr<NAMESPACE_CRYPTOMATTE_API::cryptomatte>> s_cache;
+
+			std::lock_guard lock(s_mutex);
+			auto& matte = s_cache[opts];
+			if (!matte)
+			{
+				matte = std::make_unique<NAMESPACE_CRYPTOMATTE_API::cryptomatte>(generate(opts));
+			}
+			return *matte;
+		}
+
+		/// \brief Retrieve the (cached) executor running on the given number of threads, 0 returns the default
+		/// executor.
+		inline std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> get_executor(size_t num_threads)
+		{
+			static std::mutex s_mutex;
+			static std::map<size_t, std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor>> s_cache;
+
+			if (num_threads == 0)
+			{
+				return NAMESPACE_CRYPTOMATTE_API::get_default_executor();
+			}
+			std::lock_guard lock(s_mutex);
+			auto& exec = s_cache[num_threads];
+			if (!exec)
+			{
+				exec = std::make_shared<NAMESPACE_CRYPTOMATTE_API::thread_pool_executor>(num_threads);
+			}
+			return exec;
+		}
+
+		/// \brief Retrieve the path to an exr file holding the synthetic cryptomatte for the given options, writing
+		/// it into the temp directory on first access.
+		inline std::filesystem::path get_file(const options& opts)
+		{
+			static std::mutex s_mutex;
+			static std::map<options, std::filesystem::path> s_cache;
+
+			std::lock_guard lock(s_mutex);
+			auto it = s_cache.find(opts);
+			if (it != s_cache.end())
+			{
+				return it->second;
+			}
+			auto label = opts.label();
+			std::replace(label.begin(), label.end(), '/', '_');
+			std::replace(label.begin(), label.end(), ':', '-');
+			auto file = std::filesystem::temp_directory_path() / std::format("cryptomatte_synthetic_{}_{:08x}.exr", label, opts.seed);
+			write(opts, file);
+			s_cache[opts] = file;
+			return file;
+		}
+
+
+		/// \brief Google benchmark fixture providing a synthetic cryptomatte.
+		///
+		/// Benchmarks derived from this are parameterized via `Args({ width, height, num_levels, num_ids, layout, 
+		/// threads })` where a thread count of 0 runs on the default executor. All other options are left at their
+		/// defaults, any further arguments are free for use by the individual benchmarks.
+		struct fixture : public benchmark::Fixture
+		{
+			/// The number of arguments consumed by the fixture.
+			static constexpr size_t s_num_args = 6;
+
+			void SetUp(const benchmark::State& state) override
+			{
+				m_Options = options{};
+				m_Options.width = static_cast<size_t>(state.range(0));
+				m_Options.height = static_cast<size_t>(state.range(1));
+				m_Options.num_levels = static_cast<size_t>(state.range(2));
+				m_Options.num_ids = static_cast<size_t>(state.range(3));
+				m_Options.layout = static_cast<distribution>(state.range(4));
+				m_Matte = &get(m_Options);
+				m_Matte->set_executor(get_executor(static_cast<size_t>(state.range(5))));
+			}
+
+			void TearDown(const benchmark::State&) override
+			{
+				m_Matte->set_executor(nullptr);
+				m_Matte = nullptr;
+			}
+
+		protected:
+			/// \brief Run the benchmark loop for the given function, reporting its allocations (see 
+			/// `alloc_tracker::scope`) as well as its throughput as pixels/s (of the image) and bytes/s (of all the
+			/// uncompressed rank and coverage channels that had to be decoded).
+			template <typename Func>
+			void run(benchmark::State& state, Func&& func) const
+			{
+				run_with_alloc_tracking(state, std::forward<Func>(func));
+
+				const auto pixels = static_cast<int64_t>(m_Matte->width() * m_Matte->height());
+				state.SetBytesProcessed(state.iterations() * pixels * static_cast<int64_t>(m_Matte->num_levels() * 2 * sizeof(float32_t)));
+				state.counters["pixels/s"] = benchmark::Counter(
+					static_cast<double>(state.iterations() * pixels),
+					benchmark::Counter::kIsRate
+				);
+			}
+
+			options m_Options;
+			NAMESPACE_CRYPTOMATTE_API::cryptomatte* m_Matte = nullptr;
+		};
+
+		/// \brief Register the default set of synthetic cryptomattes on a benchmark derived from `fixture`, once for
+		/// every value of an additional benchmark specific argument.
+		///
+		/// This covers the different layouts at HD, a high and a low level count at UHD as well as multiple thread
+		/// counts.
+		///
+		/// \param bench      The benchmark to register the arguments on.
+		/// \param extra      The values of the additional argument, if empty no additional argument is registered.
+		/// \param extra_name The name of the additional argument.
+		inline void default_args(benchmark::internal::Benchmark* bench, const std::vector<int64_t>& extra, const std::string& extra_name)
+		{
+			std::vector<std::vector<int64_t>> configs;
+			for (auto layout : { distribution::blocky, distribution::noisy, distribution::crowd })
+			{
+				configs.push_back({ 1920, 1080, 6, 256, static_cast<int64_t>(layout), 0 });
+			}
+			for (int64_t levels : { 2, 12 })
+			{
+				configs.push_back({ 3840, 2160, levels, 4096, static_cast<int64_t>(distribution::crowd), 0 });
+			}
+			for (int64_t threads : { 1, 4 })
+			{
+				configs.push_back({ 3840, 2160, 6, 4096, static_cast<int64_t>(distribution::crowd), threads });
+			}
+
+			std::vector<std::string> names = { "width", "height", "levels", "ids", "layout", "threads" };
+			for (auto& config : configs)
+			{
+				if (extra.empty())
+				{
+					bench->Args(config);
+					continue;
+				}
+				for (auto value : extra)
+				{
+					auto args = config;
+					args.push_back(value);
+					bench->Args(args);
+				}
+			}
+			if (!extra.empty())
+			{
+				names.push_back(extra_name);
+			}
+			bench->ArgNames(names);
+		}
+
+		/// \brief Register the default set of synthetic cryptomattes on a benchmark derived from `fixture`, usable 
+		/// with `Apply`.
+		inline void default_args(benchmark::internal::Benchmark* bench)
+		{
+			default_args(bench, {}, {});
+		}
+
+	} // synthetic
+
+} // bench_util
@@ -2,11 +2,27 @@
 
 #include <string>
 #include <string_view>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <utility>
 
 #include "detail/macros.h"
 
+#include "detail/coverage_channel.h"
+#include "detail/rank_occupancy.h"
+#include "detail/chunk_accumulator.h"
+#include "detail/level_visitor.h"
+#include "detail/chunk_cache.h"
+#include "detail/channel_locks.h"
+
 #include "metadata.h"
 #include "manifest.h"
+#include "options.h"
+#include "executor.h"
+#include "id_map.h"
+#include "statistics.h"
+#include "mask_generator.h"
 
 #include <compressed/channel.h>
 #include <OpenImageIO/imageio.h>
@@ -25,8 +41,10 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \name default ctors, copy ctors etc.
 
 		cryptomatte() = default;
-		cryptomatte(cryptomatte&&) = default;
-		cryptomatte& operator=(cryptomatte&&) = default;
+		/// The channel locks and the pick cache are not moved along with the channels, both the moved-to and the 
+		/// moved-from cryptomatte are left with their own (empty) ones so either may still be used afterwards.
+		cryptomatte(cryptomatte&& other);
+		cryptomatte& operator=(cryptomatte&& other);
 		/// delete copy ctor and copy assignment operator as compressed::channel is not copyable.
 		cryptomatte(const cryptomatte&) = delete;
 		cryptomatte& operator=(const cryptomatte&) = delete;
@@ -48,13 +66,19 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		///                 Channels must conform to the encoding consistency required by cryptomatte.
 		/// \param metadata Metadata used to validate and classify the provided channels into cryptomatte 
 		///                 or legacy categories.
+		/// \param coverage The precision to store the coverage channels at, if this is not float32 the coverage
+		///                 channels will be re-encoded.
+		/// \param exec     The executor to run all parallel work of this cryptomatte on, if this is a nullptr
+		///                 the default executor (see `get_default_executor`) is used.
 		///
 		/// \throws std::invalid_argument if the channel map is empty or if any cryptomatte channel has inconsistent 
 		///         encoding parameters compared to the others.
 		///
 		cryptomatte(
 			std::unordered_map<std::string, compressed::channel<float32_t>> channels, 
-			const NAMESPACE_CRYPTOMATTE_API::metadata& metadata
+			const NAMESPACE_CRYPTOMATTE_API::metadata& metadata,
+			coverage_precision coverage = coverage_precision::float32,
+			std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec = nullptr
 		);
 
 		/// \brief Construct a cryptomatte from raw float32 image channel data and metadata.
@@ -69,14 +93,52 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \param height The height of the image in pixels.
 		/// \param metadata Metadata used to validate and classify the provided channels into cryptomatte 
 		///                 or legacy categories.
+		/// \param coverage The precision to store the coverage channels at.
+		/// \param exec     The executor to run all parallel work of this cryptomatte on, if this is a nullptr
+		///                 the default executor (see `get_default_executor`) is used.
+		/// \param compression The settings to compress the channels with, see `compression_options`.
 		/// 
-		/// \throws std::invalid_argument if the channel list is empty or if any cryptomatte channel has a mismatched size.
+		/// \throws std::invalid_argument if the channel list is empty, if any cryptomatte channel has a mismatched size
+		///		   or if the compression options are invalid.
 		///
 		cryptomatte(
 			std::unordered_map<std::string, std::vector<float32_t>> channels, 
 			size_t width,
 			size_t height,
-			const NAMESPACE_CRYPTOMATTE_API::metadata& metadata
+			const NAMESPACE_CRYPTOMATTE_API::metadata& metadata,
+			coverage_precision coverage = coverage_precision::float32,
+			std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec = nullptr,
+			const compression_options& compression = {}
+		);
+
+		/// \brief Construct a cryptomatte from non-owning views over raw float32 image channel data and metadata.
+		/// 
+		/// This behaves identical to the `std::vector` overload but does not require the data to be copied into
+		/// vectors first, allowing construction directly from e.g. renderer framebuffers or numpy arrays. The data
+		/// is only read during construction and may be released afterwards. All channels (including the legacy 
+		/// channels) are compressed in parallel.
+		/// 
+		/// \param channels A map of channel names to raw float32 data. The size of each span must match width × height.
+		/// \param width The width of the image in pixels.
+		/// \param height The height of the image in pixels.
+		/// \param metadata Metadata used to validate and classify the provided channels into cryptomatte 
+		///                 or legacy categories.
+		/// \param coverage The precision to store the coverage channels at.
+		/// \param exec     The executor to run all parallel work of this cryptomatte on, if this is a nullptr
+		///                 the default executor (see `get_default_executor`) is used.
+		/// \param compression The settings to compress the channels with, see `compression_options`.
+		/// 
+		/// \throws std::invalid_argument if the channel list is empty, if any cryptomatte channel has a mismatched size
+		///		   or if the compression options are invalid.
+		///
+		cryptomatte(
+			const std::unordered_map<std::string, std::span<const float32_t>>& channels, 
+			size_t width,
+			size_t height,
+			const NAMESPACE_CRYPTOMATTE_API::metadata& metadata,
+			coverage_precision coverage = coverage_precision::float32,
+			std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec = nullptr,
+			const compression_options& compression = {}
 		);
 
 		/// \brief Load a file containing cryptomattes into multiple cryptomattes.
@@ -92,6 +154,17 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \returns The detected and loaded cryptomattes, there may be multiple or none per-file.
 		static std::vector<cryptomatte> load(std::filesystem::path file, bool load_preview);
 
+		/// \brief Load a file containing cryptomattes into multiple cryptomattes.
+		/// 
+		/// These cryptomattes will be ordered by their name alphabetically.
+		/// 
+		/// \param file The file path to load the image from. This must be an exr file.
+		/// \param options The options controlling which channels to load and how to store them in-memory. 
+		///				   See `load_options` for more information.
+		/// 
+		/// \returns The detected and loaded cryptomattes, there may be multiple or none per-file.
+		static std::vector<cryptomatte> load(std::filesystem::path file, const load_options& options);
+
 		/// \}
 
 		size_t width() const;
@@ -135,6 +208,116 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \return The legacy/preview channels (if present)
 		std::unordered_map<std::string, compressed::channel<float32_t>> extract_preview_compressed();
 
+		/// \brief Retrieve all ids present on the pixel at `x`, `y` ordered by descending coverage.
+		/// 
+		/// This is intended for interactive picking, only the rank chunks of the levels holding the pixel are 
+		/// decompressed rather than decoding any masks. The coverage chunk of a level is only decompressed if the 
+		/// pixel holds an id on it and as the levels are sorted by coverage the decoding stops at the first level 
+		/// on which the pixel holds no id. If enabled via `set_pick_cache_capacity` the fully decoded chunks are 
+		/// kept in a small cache instead so repeated queries in the same region of the image, e.g. while hovering, 
+		/// only amount to a lookup.
+		/// 
+		/// \param x The x coordinate of the pixel, must be less than `width()`.
+		/// \param y The y coordinate of the pixel, must be less than `height()`.
+		/// 
+		/// \throws std::out_of_range if the pixel lies outside of the image.
+		/// 
+		/// \returns The ids on the pixel with their names and coverage, empty if the pixel holds no ids.
+		std::vector<pixel_id> ids_at(size_t x, size_t y) const;
+
+		/// \brief Retrieve all ids present on each of the given pixels ordered by descending coverage.
+		/// 
+		/// The points are grouped by the chunk they lie in such that every chunk is only decoded once, regardless
+		/// of the order of the points.
+		/// 
+		/// \param points The x, y coordinates of the pixels to query.
+		/// 
+		/// \throws std::out_of_range if any of the pixels lie outside of the image.
+		/// 
+		/// \returns The ids on each of the pixels in the same order as `points`.
+		std::vector<std::vector<pixel_id>> ids_at(std::span<const std::pair<size_t, size_t>> points) const;
+
+		/// \brief Compute the coverage statistics (pixel count, coverage sum and bounding box) of every id.
+		/// 
+		/// This is a single parallel scan over the rank-coverage levels where every worker reduces into its own
+		/// statistics, so unlike going through `masks` the memory usage only scales with the number of ids rather
+		/// than the number of ids times the number of pixels. 
+		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested on `control`.
+		/// 
+		/// \returns The statistics of all ids present in the image mapped by their hash, empty if the cryptomatte 
+		///          holds no levels.
+		std::unordered_map<uint32_t, id_statistics> statistics(const task_control& control = {}) const;
+
+		/// \brief Compute the coverage statistics (pixel count, coverage sum and bounding box) of the given ids.
+		/// 
+		/// Levels of chunks holding none of the requested ids are skipped without decompressing their coverage.
+		/// 
+		/// \param hashes  The hashes to compute the statistics for, hashes which do not appear in the image will
+		///                not be present in the output.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested on `control`.
+		/// 
+		/// \returns The statistics of the requested ids mapped by their hash, empty if the cryptomatte holds no 
+		///          levels.
+		std::unordered_map<uint32_t, id_statistics> statistics(std::vector<uint32_t> hashes, const task_control& control = {}) const;
+
+		/// \brief Compute the dominant (highest coverage) id of every pixel along with its coverage.
+		/// 
+		/// This is a label map of the cryptomatte as used for picking, segmentation or as ML labels. It is computed 
+		/// in a single pass over the levels without decoding any individual masks. Ties in coverage resolve to 
+		/// the lower level and pixels without any ids hold an id and coverage of 0.
+		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested on `control`.
+		/// 
+		/// \returns The dominant ids and their coverage, both empty if the cryptomatte holds no levels.
+		NAMESPACE_CRYPTOMATTE_API::id_map id_map(const task_control& control = {}) const;
+
+		/// \brief Compute the dominant (highest coverage) id of every pixel along with its coverage into compressed
+		/// buffers.
+		/// 
+		/// Identical to `id_map` but compresses the outputs as they are being generated using the same compression
+		/// settings as the rank channels.
+		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested on `control`.
+		/// 
+		/// \returns The dominant ids and their coverage, both default constructed if the cryptomatte holds no 
+		///          levels.
+		NAMESPACE_CRYPTOMATTE_API::id_map_compressed id_map_compressed(const task_control& control = {}) const;
+
+		/// \brief Generate the id-colour preview of the cryptomatte from its rank and coverage channels.
+		/// 
+		/// Unlike `preview` this does not depend on the (often missing or black) legacy channels but computes the 
+		/// standard visualization where every id gets a colour derived from its hash and each pixel is the coverage
+		/// weighted blend of the colours of all ids on it. All levels are processed in a single pass over the chunks
+		/// which are distributed across the executor.
+		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested on `control`.
+		/// 
+		/// \return The red, green and blue channels of the preview, empty if the cryptomatte holds no levels.
+		std::vector<std::vector<float32_t>> generate_preview(const task_control& control = {}) const;
+
+		/// \brief Generate the id-colour preview of the cryptomatte as compressed channels.
+		/// 
+		/// Identical to `generate_preview` but compresses the preview as it is being generated using the same 
+		/// compression settings as the rank channels, only ever holding a single chunk of it uncompressed.
+		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested on `control`.
+		/// 
+		/// \return The red, green and blue channels of the preview, empty if the cryptomatte holds no levels.
+		std::vector<compressed::channel<float32_t>> generate_preview_compressed(const task_control& control = {}) const;
+
 		/// \brief Extract the mask with the given name from the cryptomatte, computing the pixels as we go.
 		/// 
 		/// This function assumes that a valid cryptomatte manifest exists, if it doesn't/or the name is not known to us
@@ -160,9 +343,21 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// 
 		/// \param hash The hash of the mask
 		/// 
-		/// \returns The decoded cryptomatte mask
+		/// \returns The decoded cryptomatte mask, empty if the cryptomatte holds no levels.
 		std::vector<float32_t> mask(uint32_t hash) const;
 
+		/// \brief Extract the mask of the given name without requiring it to be on the manifest.
+		/// 
+		/// The name is hashed on the fly using 'MurmurHash3_32' with the 'uint32_to_float32' conversion which is
+		/// the only hashing scheme the specification defines. This allows for extracting masks of cryptomattes
+		/// with missing or incomplete manifests, e.g. when the names come from an external asset database. 
+		/// If no pixel carries the id of the name the mask will be empty (black).
+		/// 
+		/// \param name The name of the object, e.g. 'bunny1'
+		/// 
+		/// \returns The decoded cryptomatte mask
+		std::vector<float32_t> mask_by_name_unmanifested(std::string_view name) const;
+
 		/// \brief Extract the mask with the given name from the cryptomatte as compressed channel, computing on the fly.
 		/// 
 		/// This function assumes that a valid cryptomatte manifest exists, if it doesn't/or the name is not known to us
@@ -188,7 +383,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// 
 		/// \param hash The hash of the mask
 		/// 
-		/// \returns The decoded cryptomatte mask
+		/// \returns The decoded cryptomatte mask, default constructed if the cryptomatte holds no levels.
 		compressed::channel<float32_t> mask_compressed(uint32_t hash) const;
 
 		/// \brief Extract the masks with the given names from the cryptomatte, computing on the fly.
@@ -201,9 +396,11 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		///		than extracting them individually.
 		/// 
 		/// \param names The names to extract, could e.g. be {'bunny1', 'car', ...}
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
 		/// 
 		/// \returns The decoded cryptomattes mapped by their name
-		std::unordered_map<std::string, std::vector<float32_t>> masks(std::vector<std::string> names) const;
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		std::unordered_map<std::string, std::vector<float32_t>> masks(std::vector<std::string> names, const task_control& control = {}) const;
 
 		/// \brief Extract the masks with the given names from the cryptomatte, computing on the fly.
 		/// 
@@ -215,16 +412,21 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		///		than extracting them individually.
 		/// 
 		/// \param names The hashes to extract, any non-valid hashes will be skipped and will also not appear in the output
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
 		/// 
 		/// \returns The decoded cryptomattes mapped by their name (if the manifest exists) or by their hashes in std::string
-		///			 form.
-		std::unordered_map<std::string, std::vector<float32_t>> masks(std::vector<uint32_t> hashes) const;
+		///			 form, empty if the cryptomatte holds no levels.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		std::unordered_map<std::string, std::vector<float32_t>> masks(std::vector<uint32_t> hashes, const task_control& control = {}) const;
 
 		/// \brief Extract all of the cryptomatte masks computing them on the fly
 		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
 		/// \returns The decoded cryptomattes mapped by their name (if the manifest exists) or by their hashes in std::string
-		///			 form.
-		std::unordered_map<std::string, std::vector<float32_t>> masks() const;
+		///			 form, empty if the cryptomatte holds no levels.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		std::unordered_map<std::string, std::vector<float32_t>> masks(const task_control& control = {}) const;
 
 		/// \brief Extract the masks with the given names from the cryptomatte into compressed buffers, computing on the fly.
 		/// 
@@ -236,9 +438,11 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		///		than extracting them individually.
 		/// 
 		/// \param names The names to extract, could e.g. be {'bunny1', 'car', ...}
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
 		/// 
 		/// \returns The decoded cryptomattes mapped by their name
-		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed(std::vector<std::string> names) const;
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed(std::vector<std::string> names, const task_control& control = {}) const;
 
 		/// \brief Extract the masks with the given hashes from the cryptomatte into compressed buffers, computing on the fly.
 		/// 
@@ -250,21 +454,250 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		///		than extracting them individually.
 		/// 
 		/// \param names The hashes to extract, any non-valid hashes will be skipped and will also not appear in the output
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
 		/// 
 		/// \returns The decoded cryptomattes mapped by their name (if the manifest exists) or by their hashes in std::string
-		///			 form.
-		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed(std::vector<uint32_t> hashes) const;
+		///			 form, empty if the cryptomatte holds no levels.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed(std::vector<uint32_t> hashes, const task_control& control = {}) const;
 
 		/// \brief Extract all of the cryptomatte masks into compressed buffers, computing them on the fly
 		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
 		/// \returns The decoded cryptomattes mapped by their name (if the manifest exists) or by their hashes in std::string
-		///			 form.
-		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed() const;
+		///			 form, empty if the cryptomatte holds no levels.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed(const task_control& control = {}) const;
+
+		/// \brief Extract all masks whose names match the glob `pattern`, computing them on the fly.
+		/// 
+		/// The pattern is resolved to hashes through the manifest's name index (see `manifest::hashes_matching`) 
+		/// so this remains fast on large manifests. '*' matches any sequence of characters (including '/') and 
+		/// '?' any single character, e.g. '*/char_*/body*'.
+		/// 
+		/// \param pattern The glob pattern to match the names on the manifest against.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws std::invalid_argument if there is no manifest present on the cryptomatte.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The decoded cryptomatte masks mapped by their name, empty if no name matches.
+		std::unordered_map<std::string, std::vector<float32_t>> masks_matching(std::string_view pattern, const task_control& control = {}) const;
+
+		/// \brief Extract all masks whose names match the glob `pattern` into compressed buffers.
+		/// 
+		/// See `masks_matching` for the pattern syntax.
+		/// 
+		/// \param pattern The glob pattern to match the names on the manifest against.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws std::invalid_argument if there is no manifest present on the cryptomatte.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The decoded cryptomatte masks mapped by their name, empty if no name matches.
+		std::unordered_map<std::string, compressed::channel<float32_t>> masks_compressed_matching(std::string_view pattern, const task_control& control = {}) const;
+
+		/// \brief Extract the union (sum) of the masks of the given names as a single mask.
+		/// 
+		/// This is equivalent to summing up the masks returned by `masks` but only holds a single output buffer
+		/// and decodes all levels in a single pass, making it the preferred way of getting a single matte for a
+		/// group of objects.
+		/// 
+		/// \param names   The names as stored on the manifest.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws std::invalid_argument if there is no manifest or any of the names are not on it.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The combined mask of all the names.
+		std::vector<float32_t> mask_union(std::vector<std::string> names, const task_control& control = {}) const;
+
+		/// \brief Extract the union (sum) of the masks of the given hashes as a single mask.
+		/// 
+		/// \param hashes  The hashes of the masks, duplicates are only accounted for once and hashes which do not
+		///                 appear in the image do not contribute.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The combined mask of all the hashes, empty if the cryptomatte holds no levels.
+		std::vector<float32_t> mask_union(std::vector<uint32_t> hashes, const task_control& control = {}) const;
+
+		/// \brief Extract the union (sum) of the masks of the given names into a compressed buffer.
+		/// 
+		/// \param names   The names as stored on the manifest.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws std::invalid_argument if there is no manifest or any of the names are not on it.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The combined mask of all the names.
+		compressed::channel<float32_t> mask_union_compressed(std::vector<std::string> names, const task_control& control = {}) const;
+
+		/// \brief Extract the union (sum) of the masks of the given hashes into a compressed buffer.
+		/// 
+		/// \param hashes  The hashes of the masks, duplicates are only accounted for once.
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The combined mask of all the hashes, default constructed if the cryptomatte holds no levels.
+		compressed::channel<float32_t> mask_union_compressed(std::vector<uint32_t> hashes, const task_control& control = {}) const;
+
+		/// \brief Create a generator decoding all masks in the image incrementally, see `mask_generator`.
+		/// 
+		/// The ids present in the image are collected up-front from the rank channels alone, after which at most
+		/// `max_masks` decoded masks are held at once. The masks are returned in ascending order of their hashes.
+		/// 
+		/// \param max_masks The maximum number of decoded masks held at once, must be at least 1.
+		/// \param control   Optional cancellation and progress reporting, see `task_control`.
+		/// \param strategy  Whether to decode all masks in a single pass or every batch in its own pass, see 
+		///                  `incremental_strategy`.
+		/// 
+		/// \throws std::invalid_argument if `max_masks` is 0.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The generator, this references the cryptomatte which must outlive it.
+		NAMESPACE_CRYPTOMATTE_API::mask_generator masks_incremental(
+			size_t max_masks = 16, 
+			const task_control& control = {},
+			incremental_strategy strategy = incremental_strategy::single_pass
+		) const;
+
+		/// \brief Create a generator decoding the masks of the given names incrementally, see `mask_generator`.
+		/// 
+		/// \param names     The names as stored on the manifest, the masks are returned in this order.
+		/// \param max_masks The maximum number of decoded masks held at once, must be at least 1.
+		/// \param control   Optional cancellation and progress reporting, see `task_control`.
+		/// \param strategy  Whether to decode all masks in a single pass or every batch in its own pass, see 
+		///                  `incremental_strategy`.
+		/// 
+		/// \throws std::invalid_argument if there is no manifest, any of the names are not on it or `max_masks` is 0.
+		/// 
+		/// \returns The generator, this references the cryptomatte which must outlive it.
+		NAMESPACE_CRYPTOMATTE_API::mask_generator masks_incremental(
+			std::vector<std::string> names, 
+			size_t max_masks = 16, 
+			const task_control& control = {},
+			incremental_strategy strategy = incremental_strategy::single_pass
+		) const;
+
+		/// \brief Create a generator decoding the masks of the given hashes incrementally, see `mask_generator`.
+		/// 
+		/// \param hashes    The hashes of the masks, the masks are returned in this order. Hashes which do not 
+		///                  appear in the image yield empty masks.
+		/// \param max_masks The maximum number of decoded masks held at once, must be at least 1.
+		/// \param control   Optional cancellation and progress reporting, see `task_control`.
+		/// \param strategy  Whether to decode all masks in a single pass or every batch in its own pass, see 
+		///                  `incremental_strategy`.
+		/// 
+		/// \throws std::invalid_argument if `max_masks` is 0.
+		/// 
+		/// \returns The generator, this references the cryptomatte which must outlive it.
+		NAMESPACE_CRYPTOMATTE_API::mask_generator masks_incremental(
+			std::vector<uint32_t> hashes, 
+			size_t max_masks = 16, 
+			const task_control& control = {},
+			incremental_strategy strategy = incremental_strategy::single_pass
+		) const;
+
+		/// \brief Collect the unique ids present in the image.
+		/// 
+		/// Only the rank channels are decompressed for this, making it considerably cheaper than extracting any
+		/// masks or `statistics`.
+		/// 
+		/// \param control Optional cancellation and progress reporting, see `task_control`.
+		/// 
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The ids in ascending order.
+		std::vector<uint32_t> ids(const task_control& control = {}) const;
+
+		/// \brief Extract the masks with the given names and write them into an exr file.
+		/// 
+		/// Depending on `options.layout` the masks are either written as channels named after the masks or as 
+		/// separate parts named after the masks. As channels, the scanlines are written as soon as their chunk is 
+		/// decoded. As parts, every part has to be written in full so the masks are decoded into compressed buffers 
+		/// first, which are then streamed to disk chunk by chunk. Either way, at no point are all of the masks held 
+		/// in memory uncompressed.
+		/// 
+		/// \param file The path to write the exr file to, any existing file will be overwritten.
+		/// \param names The names to extract, these must exist on the manifest.
+		/// \param options The options controlling the layout and format of the written file.
+		/// 
+		/// \throws std::invalid_argument if there is no manifest, a name does not exist on it, `names` is empty or 
+		///         the cryptomatte holds no levels.
+		/// \throws std::runtime_error if the file could not be written.
+		/// \throws operation_cancelled if a stop was requested via `options.control.stop_token`.
+		void write_masks(std::filesystem::path file, std::vector<std::string> names, const write_options& options = {}) const;
+
+		/// \brief Extract the masks with the given hashes and write them into an exr file.
+		/// 
+		/// The masks are named after their names on the manifest (if available) or their hashes in hex form.
+		/// Hashes not present in the image are written as empty masks.
+		/// 
+		/// \param file The path to write the exr file to, any existing file will be overwritten.
+		/// \param hashes The hashes to extract.
+		/// \param options The options controlling the layout and format of the written file.
+		/// 
+		/// \throws std::invalid_argument if `hashes` is empty or the cryptomatte holds no levels.
+		/// \throws std::runtime_error if the file could not be written.
+		/// \throws operation_cancelled if a stop was requested via `options.control.stop_token`.
+		void write_masks(std::filesystem::path file, std::vector<uint32_t> hashes, const write_options& options = {}) const;
+
+		/// \brief Write the cryptomatte into an exr file alongside its metadata (including the manifest, if any).
+		/// 
+		/// The channels are streamed to disk chunk by chunk so at no point are they all held in memory 
+		/// uncompressed. All channels are written at full float32 precision, the rank channels must never be 
+		/// quantized while the coverage channels are converted back from their in-memory precision. The preview
+		/// channels are written as well if they were loaded.
+		/// 
+		/// \param file The path to write the exr file to, any existing file will be overwritten.
+		/// \param compression The exr compression to use, this may be any of the compression methods supported
+		///					   by OpenImageIO's exr writer (e.g. "none", "zip", "zips", "piz"). Lossy compression
+		///					   methods such as "dwaa" must not be used as they would corrupt the ids.
+		/// 
+		/// \throws std::invalid_argument if the cryptomatte holds no levels.
+		/// \throws std::runtime_error if the file could not be written.
+		void write(std::filesystem::path file, const std::string& compression = "zip") const;
 
 		/// Retrieve the number of levels (rank-coverage pairs) the cryptomatte was encoded with. This may not be the level
 		/// The cryptomatte was rendered with as sometimes DCCs will pad this number to the nearest multiple of two.
 		size_t num_levels() const noexcept;
 
+		/// Set the executor to run all parallel work of this cryptomatte on, passing a nullptr resets this to
+		/// the default executor (see `get_default_executor`).
+		void set_executor(std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec);
+
+		/// Get the executor explicitly set on this cryptomatte, this is a nullptr if the default executor is used.
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> executor() const noexcept;
+
+		/// Set the strategy to decode the masks of this cryptomatte with, see `decode_strategy` for more information.
+		void set_decode_strategy(NAMESPACE_CRYPTOMATTE_API::decode_strategy strategy) noexcept;
+
+		/// Get the strategy used for decoding the masks of this cryptomatte.
+		NAMESPACE_CRYPTOMATTE_API::decode_strategy decode_strategy() const noexcept;
+
+		/// Set the number of bytes the per-chunk masks of `decode_strategy::channel_parallel` may occupy while 
+		/// decoding. Every chunk in flight holds one chunk-sized mask per id found in it, fewer chunks are decoded
+		/// at once if these would exceed the budget. The peak scratch memory of a mask extraction is therefore
+		/// roughly `max(budget, largest chunk)` plus three chunks per level for the decompressed rank and coverage,
+		/// where the largest chunk is the number of ids in a single chunk times `chunk_size`. The output masks 
+		/// themselves are not part of this.
+		void set_decode_memory_budget(size_t bytes) noexcept;
+
+		/// Get the number of bytes the per-chunk masks may occupy while decoding, defaults to 1 GiB.
+		size_t decode_memory_budget() const noexcept;
+
+		/// Set the number of decoded chunks `ids_at` keeps cached, each of these holds the rank and coverage data 
+		/// of all occupied levels of the chunk, i.e. up to `2 * num_levels() * chunk_size` bytes per chunk. The 
+		/// cache is disabled (0) by default.
+		void set_pick_cache_capacity(size_t num_chunks);
+
+		/// Get the number of decoded chunks `ids_at` keeps cached.
+		size_t pick_cache_capacity() const;
+
 		/// Get the metadata associated with the cryptomatte file, this includes things such as the channel names,
 		/// the unique key identifier and the cryptomatte manifest (a mapping of human-readable names to their hashes).
 		NAMESPACE_CRYPTOMATTE_API::metadata& metadata();
@@ -283,8 +716,14 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// }
 		/// 
 		/// These are sorted and validated on construction, so it is safe to assume that we have multiple 
-		/// rank-coverage pairs in the correct order.
-		std::vector<std::pair<std::string, compressed::channel<float32_t>>> m_Channels;
+		/// rank-coverage pairs in the correct order. They are split into the rank channels (r and b) and coverage
+		/// channels (g and a) with each index into these referring to one level (rank-coverage pair).
+		std::vector<std::pair<std::string, compressed::channel<float32_t>>> m_RankChannels;
+		std::vector<std::pair<std::string, detail::coverage_channel>> m_CoverageChannels;
+
+		/// The per-level, per-chunk occupancy of the rank channels computed on construction. This allows us
+		/// to skip any levels and chunks that do not hold any ids without having to decompress them.
+		std::vector<detail::rank_occupancy> m_Occupancy;
 
 		/// The legacy channels related to this cryptomatte, these sometimes contain a filtered preview image but
 		/// have no effect on decoding.
@@ -300,6 +739,82 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 		/// The cryptomattes' metadata, this contains information on 
 		NAMESPACE_CRYPTOMATTE_API::metadata m_Metadata;
+
+		/// The executor to run any parallel work on, if this is a nullptr we fall back to the default executor.
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> m_Executor = nullptr;
+
+		/// The strategy used for decoding the masks, dispatched on in `decode_chunks`.
+		NAMESPACE_CRYPTOMATTE_API::decode_strategy m_DecodeStrategy = NAMESPACE_CRYPTOMATTE_API::decode_strategy::channel_parallel;
+
+		/// The number of bytes the visitors of `visit_levels` may hold on to at once, see `set_decode_memory_budget`.
+		size_t m_DecodeMemoryBudget = size_t{ 1 } << 30;
+
+		/// The locks guarding the decompression of the channels, shared across all calls such that a cryptomatte 
+		/// may be decoded from multiple threads at once. Held through a pointer as mutexes are not movable, this
+		/// is never null.
+		std::unique_ptr<detail::channel_locks> m_ChannelLocks = std::make_unique<detail::channel_locks>(0);
+
+		/// The most recently decoded chunks of `ids_at`. This only depends on the rank and coverage channels
+		/// which never change after construction so it never needs to be invalidated. Disabled by default.
+		std::unique_ptr<detail::chunk_cache> m_PickCache = std::make_unique<detail::chunk_cache>(0);
+
+		/// \brief Decode the masks chunk by chunk, accumulating all levels of a chunk before handing its masks out.
+		///
+		/// With `decode_strategy::channel_parallel` this goes through `visit_levels` using a `detail::mask_visitor`. 
+		/// `sink` is called once per id and chunk. The chunks are handed out in ascending order, all the calls for
+		/// a chunk returning before the first call for the next one, while the calls for the ids of a single chunk
+		/// may run concurrently so it must synchronize any access to shared state itself.
+		///
+		/// \param requested The ids to decode, if this is a nullptr all ids are decoded.
+		/// \param sink      The function receiving the chunk index, the id and its accumulated mask in that chunk.
+		/// \param control   The cancellation and progress reporting, checked and reported per chunk.
+		void decode_chunks(
+			const detail::flat_id_set* requested,
+			const detail::mask_visitor::sink_fn& sink,
+			const task_control& control
+		) const;
+
+		/// \brief Compute the per-id statistics of the `requested` ids or all ids if this is a nullptr.
+		std::unordered_map<uint32_t, id_statistics> compute_statistics(
+			const detail::flat_id_set* requested,
+			const task_control& control
+		) const;
+
+		/// \brief Decompress the rank and coverage chunks of all occupied levels at `chunk_idx`.
+		///
+		/// If `offsets` is not empty only the levels needed to resolve the ids at these offsets into the chunk
+		/// are decoded: the coverage of a level is only decompressed if any of the offsets hold an id on it and 
+		/// the decoding stops at the first level on which none of them do. Levels which are not decoded are 
+		/// left empty.
+		detail::decoded_chunk decode_levels(size_t chunk_idx, std::span<const size_t> offsets = {}) const;
+
+		/// \brief Resolve the names to their hashes via the manifest, throwing if there is no manifest or any of
+		/// the names are not on it.
+		std::vector<uint32_t> hashes_from_names(const std::vector<std::string>& names) const;
+
+		/// \brief Visit the rank-coverage levels chunk by chunk, distributing the channels across the executor.
+		///
+		/// Every rank and coverage channel is decompressed by its own stage with the chunks passing through the 
+		/// stages in level order, so up to two tasks per level plus the outputs of one chunk run at once. One
+		/// visitor is created per chunk in flight (at most `2 * num_levels() + 1`, fewer if the visitors' 
+		/// `memory_usage` exceeds the decode memory budget), see `detail::level_visitor` for the order of the calls.
+		///
+		/// \param make_visitor Creates a single visitor, these are all created on the calling thread. No visitors are
+		///                     created if the cryptomatte holds no levels.
+		/// \param control      The cancellation and progress reporting, checked and reported per chunk.
+		void visit_levels(
+			const std::function<std::unique_ptr<detail::level_visitor>()>& make_visitor,
+			const task_control& control
+		) const;
+
+		/// \brief The `decode_strategy::pipelined` implementation of `decode_chunks`.
+		///
+		/// `sink` is only ever called from a single (background) thread.
+		void decode_chunks_pipelined(
+			const detail::flat_id_set* requested,
+			const detail::mask_visitor::sink_fn& sink,
+			const task_control& control
+		) const;
 	};
 
 } // NAMESPACE_CRYPTOMATTE_API
\ No newline at end of file
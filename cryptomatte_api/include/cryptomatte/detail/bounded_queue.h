@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <condition_variable>
+
+#include "macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief A blocking multi-producer, multi-consumer queue holding at most `capacity` elements.
+		///
+		/// This is used to connect the stages of the decoding pipeline, pushing onto a full queue blocks the producer
+		/// until the consumer catches up which bounds the amount of memory in flight. Closing the queue wakes up
+		/// all waiting threads, any remaining elements may still be popped after closing.
+		template <typename T>
+		struct bounded_queue
+		{
+			explicit bounded_queue(size_t capacity) : m_Capacity(capacity) {}
+
+			bounded_queue(const bounded_queue&) = delete;
+			bounded_queue& operator=(const bounded_queue&) = delete;
+
+			/// \brief Push an element onto the queue, blocking while the queue is full.
+			///
+			/// \returns false if the queue was closed in which case the element is discarded.
+			bool push(T value)
+			{
+				std::unique_lock lock(m_Mutex);
+				m_NotFull.wait(lock, [&]() { return m_Closed || m_Queue.size() < m_Capacity; });
+				if (m_Closed)
+				{
+					return false;
+				}
+				m_Queue.push_back(std::move(value));
+				lock.unlock();
+				m_NotEmpty.notify_one();
+				return true;
+			}
+
+			/// \brief Pop an element from the queue, blocking while the queue is empty.
+			///
+			/// \returns The front element or std::nullopt if the queue is both closed and empty.
+			std::optional<T> pop()
+			{
+				std::unique_lock lock(m_Mutex);
+				m_NotEmpty.wait(lock, [&]() { return m_Closed || !m_Queue.empty(); });
+				if (m_Queue.empty())
+				{
+					return std::nullopt;
+				}
+				T value = std::move(m_Queue.front());
+				m_Queue.pop_front();
+				lock.unlock();
+				m_NotFull.notify_one();
+				return value;
+			}
+
+			/// \brief Close the queue, no more elements may be pushed after this.
+			void close()
+			{
+				{
+					std::lock_guard lock(m_Mutex);
+					m_Closed = true;
+				}
+				m_NotEmpty.notify_all();
+				m_NotFull.notify_all();
+			}
+
+		private:
+			size_t m_Capacity = 0;
+			bool m_Closed = false;
+			std::deque<T> m_Queue;
+			std::mutex m_Mutex;
+			std::condition_variable m_NotEmpty;
+			std::condition_variable m_NotFull;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+
+#include "macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief The locks guarding the decompression of the channels of a cryptomatte.
+		///
+		/// A single compressed channel may not be decompressed from multiple threads at once. These locks are
+		/// owned by the cryptomatte (rather than by the individual decode calls) such that multiple decode calls
+		/// may run on the same cryptomatte at the same time, e.g. from multiple python threads with the GIL
+		/// released. Every lock must only ever be held for the decompression of a single chunk so they can never
+		/// deadlock.
+		struct channel_locks
+		{
+			explicit channel_locks(size_t num_levels)
+				: rank(num_levels), coverage(num_levels)
+			{
+			}
+
+			/// One lock per rank channel (level).
+			std::vector<std::mutex> rank;
+			/// One lock per coverage channel (level).
+			std::vector<std::mutex> coverage;
+			/// A single lock shared across all the legacy channels, these are rarely accessed.
+			std::mutex legacy;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -6,6 +6,9 @@
 #include <string_view>
 #include <string>
 #include <format>
+#include <vector>
+#include <span>
+#include <unordered_map>
 
 namespace NAMESPACE_CRYPTOMATTE_API
 {
@@ -107,6 +110,22 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \throws std::runtime_error If any channel string is malformed or cannot be parsed.
 		std::vector<std::string> sort_and_validate_channels(const std::vector<std::string>& input_channels);
 
+		/// \brief Create non-owning views over all of the given channels.
+		///
+		/// \param channels The channels to view, these must outlive the returned spans.
+		/// \return The spans mapped by the same channel names.
+		template <typename T>
+		std::unordered_map<std::string, std::span<const T>> as_spans(const std::unordered_map<std::string, std::vector<T>>& channels)
+		{
+			std::unordered_map<std::string, std::span<const T>> out;
+			out.reserve(channels.size());
+			for (const auto& [name, channel] : channels)
+			{
+				out.emplace(name, std::span<const T>(channel));
+			}
+			return out;
+		}
+
 
 	} // detail
 
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <array>
+#include <mutex>
+#include <limits>
+
+#include "macros.h"
+#include "flat_id_set.h"
+
+#include <compressed/util.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Accumulates the masks of a single chunk across all of the rank-coverage levels.
+		///
+		/// This holds one mask chunk per id that was found in that chunk. It is meant to be reused across the chunks
+		/// it processes so the masks are only reallocated if a chunk holds more ids than any chunk before it.
+		///
+		/// Usage is as follows:
+		///		1. `reset` with the number of elements in the chunk.
+		///		2. For each level: call `register_ids` with the decompressed rank chunk and only if that returns
+		///		   true decompress the coverage chunk and call `accumulate`.
+		///		3. Retrieve the accumulated masks via `ids` and `mask`.
+		struct chunk_accumulator
+		{
+			/// \brief Clear all of the accumulated ids and masks and prepare for a chunk of `chunk_num_elems`.
+			void reset(size_t chunk_num_elems);
+
+			/// \brief Register all of the ids in the given rank chunk, allocating a (zero-initialized) mask for any 
+			/// id that we haven't encountered in this chunk yet.
+			///
+			/// \param rank      The decompressed rank chunk, must hold `chunk_num_elems` elements.
+			/// \param requested The ids we are interested in, if this is a nullptr all ids are accumulated.
+			///
+			/// \returns Whether the rank chunk contains any of the requested ids, if this is false there is no need
+			///			 to decompress the coverage or call `accumulate` for this level.
+			bool register_ids(std::span<const float32_t> rank, const flat_id_set* requested);
+
+			/// \brief Accumulate the given coverage chunk into the masks of the ids in the given rank chunk.
+			///
+			/// `register_ids` must have been called for the same rank chunk beforehand.
+			void accumulate(std::span<const float32_t> rank, std::span<const float32_t> coverage);
+
+			/// \brief The ids that have been accumulated so far in the order they were encountered.
+			const std::vector<float32_t>& ids() const noexcept;
+
+			/// \brief Retrieve the accumulated mask of the id at `id_idx` (indexing into `ids`).
+			std::span<float32_t> mask(size_t id_idx) noexcept;
+			std::span<const float32_t> mask(size_t id_idx) const noexcept;
+
+			/// \brief The number of elements in the current chunk.
+			size_t chunk_num_elems() const noexcept;
+
+			/// \brief The number of bytes allocated for the masks, this is retained across chunks.
+			size_t memory_usage() const noexcept;
+
+			/// \brief Free the memory allocated for the masks, only valid in between chunks (before `reset`).
+			void release_memory();
+
+		private:
+			/// Marks an id that was encountered but not requested.
+			static constexpr uint32_t s_Ignored = std::numeric_limits<uint32_t>::max();
+
+			size_t m_ChunkNumElems = 0;
+			/// The masks for all ids, `m_Ids.size()` consecutive chunks of `m_ChunkNumElems`.
+			compressed::util::default_init_vector<float32_t> m_Masks;
+
+			std::vector<float32_t> m_Ids;
+			/// Mapping of the id bit-patterns to their index in `m_Ids` or s_Ignored if the id was not requested.
+			flat_id_map<uint32_t> m_Slots;
+		};
+
+
+		/// \brief A fixed set of mutexes indexed by an id, used to serialize access to the compressed mask channels.
+		///
+		/// A single compressed channel is not safe to access concurrently so when multiple workers write different
+		/// chunks of the same mask they need to lock it first. Rather than keeping a mutex per mask (of which there
+		/// may be thousands) we stripe the ids over a small fixed number of mutexes.
+		struct striped_mutex
+		{
+			std::mutex& get(uint32_t key) noexcept
+			{
+				return m_Mutexes[(key * 0x9E3779B1u) >> (32 - s_NumBits)];
+			}
+
+		private:
+			static constexpr size_t s_NumBits = 6;
+			std::array<std::mutex, size_t{ 1 } << s_NumBits> m_Mutexes;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
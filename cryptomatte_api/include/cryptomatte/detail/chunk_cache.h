@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+#include "macros.h"
+
+#include <compressed/util.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief The decompressed rank and coverage data of all levels of a single chunk.
+		///
+		/// Levels which are not occupied in the chunk are left empty rather than being decompressed.
+		struct decoded_chunk
+		{
+			std::vector<compressed::util::default_init_vector<float32_t>> rank;
+			std::vector<compressed::util::default_init_vector<float32_t>> coverage;
+		};
+
+
+		/// \brief A small least-recently-used cache of decoded chunks.
+		///
+		/// Point queries such as `cryptomatte::ids_at` only touch a handful of pixels but have to decompress the
+		/// whole chunk of every level these lie in. Interactive picking queries the same few chunks over and over
+		/// so keeping the most recently decoded ones around turns these into plain lookups. The capacity is
+		/// expected to be small (a couple of chunks) so the entries are kept in a list ordered by recency.
+		///
+		/// All functions are safe to call from multiple threads.
+		struct chunk_cache
+		{
+			using load_fn = std::function<decoded_chunk(size_t chunk_idx)>;
+
+			explicit chunk_cache(size_t capacity);
+
+			/// \brief Retrieve the chunk at `chunk_idx`, decoding it via `load` if it is not cached.
+			///
+			/// If the capacity is 0 the chunk is loaded on every call and never stored. `load` is called while
+			/// holding the lock of the cache so it never runs concurrently for the same cache.
+			///
+			/// \param chunk_idx The index of the chunk to retrieve.
+			/// \param load      The function decoding the chunk if it is not cached.
+			///
+			/// \returns The decoded chunk, this remains valid even if it gets evicted afterwards.
+			std::shared_ptr<const decoded_chunk> get(size_t chunk_idx, const load_fn& load);
+
+			/// \brief Set the maximum number of chunks to keep, evicting the least recently used ones if needed.
+			void set_capacity(size_t capacity);
+
+			size_t capacity() const;
+
+			/// \brief The number of chunks currently cached.
+			size_t size() const;
+
+			void clear();
+
+		private:
+			mutable std::mutex m_Mutex;
+			size_t m_Capacity = 0;
+			/// The cached chunks ordered by recency, the most recently used one being at the front.
+			std::list<std::pair<size_t, std::shared_ptr<const decoded_chunk>>> m_Entries;
+
+			/// Evict the least recently used entries until we are within capacity, must hold `m_Mutex`.
+			void evict();
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
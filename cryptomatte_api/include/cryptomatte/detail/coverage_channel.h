@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <bit>
+#include <span>
+#include <algorithm>
+#include <execution>
+
+#include "macros.h"
+#include "cryptomatte/options.h"
+
+#include <compressed/channel.h>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Convert a float32 into the bit-pattern of a IEEE 754 half, rounding to nearest-even.
+		///
+		/// This is written branch-free (all paths get computed and selected) so that the compiler is able to
+		/// auto-vectorize loops calling this function. Values outside of the representable range of a half
+		/// will be converted to +-inf, NaNs are preserved as quiet NaNs.
+		inline uint16_t float32_to_float16(float32_t value) noexcept
+		{
+			constexpr uint32_t f32_infinity = 255u << 23;
+			constexpr uint32_t f16_max = (127u + 16u) << 23;
+			constexpr uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+			constexpr uint32_t min_normal = 113u << 23;
+
+			uint32_t bits = std::bit_cast<uint32_t>(value);
+			const uint32_t sign = bits & 0x80000000u;
+			bits ^= sign;
+
+			// Overflow -> inf, NaN -> quiet NaN
+			const uint32_t overflow_result = bits > f32_infinity ? 0x7e00u : 0x7c00u;
+
+			// Denormals, let the FPU do the rounding for us by adding a magic number.
+			const float32_t denorm_sum = std::bit_cast<float32_t>(bits) + std::bit_cast<float32_t>(denorm_magic);
+			const uint32_t denorm_result = std::bit_cast<uint32_t>(denorm_sum) - denorm_magic;
+
+			// Normals, rebias the exponent and round to nearest-even.
+			const uint32_t mantissa_odd = (bits >> 13) & 1u;
+			const uint32_t normal_result = (bits + ((15u - 127u) << 23) + 0xfffu + mantissa_odd) >> 13;
+
+			uint32_t result = bits >= f16_max ? overflow_result : (bits < min_normal ? denorm_result : normal_result);
+			return static_cast<uint16_t>(result | (sign >> 16));
+		}
+
+		/// \brief Convert the bit-pattern of a IEEE 754 half into a float32.
+		///
+		/// This is written branch-free (all paths get computed and selected) so that the compiler is able to
+		/// auto-vectorize loops calling this function.
+		inline float32_t float16_to_float32(uint16_t value) noexcept
+		{
+			constexpr uint32_t shifted_exponent = 0x7c00u << 13;
+			constexpr uint32_t magic = 113u << 23;
+
+			const uint32_t value_32 = value;
+			uint32_t bits = (value_32 & 0x7fffu) << 13;
+			const uint32_t exponent = shifted_exponent & bits;
+			bits += (127u - 15u) << 23;
+
+			// Inf/NaN -> adjust the exponent further
+			const uint32_t infnan_result = bits + ((128u - 16u) << 23);
+			// Zero/Denormal -> renormalize via the FPU.
+			const uint32_t denorm_result = std::bit_cast<uint32_t>(
+				std::bit_cast<float32_t>(bits + (1u << 23)) - std::bit_cast<float32_t>(magic)
+			);
+
+			uint32_t result = exponent == shifted_exponent ? infnan_result : (exponent == 0 ? denorm_result : bits);
+			return std::bit_cast<float32_t>(result | ((value_32 & 0x8000u) << 16));
+		}
+
+		/// \brief Convert a float32 into a normalized uint16_t, values outside of [0, 1] are clamped.
+		inline uint16_t float32_to_unorm16(float32_t value) noexcept
+		{
+			return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+		}
+
+		/// \brief Convert a normalized uint16_t into a float32 in the range [0, 1].
+		inline float32_t unorm16_to_float32(uint16_t value) noexcept
+		{
+			return static_cast<float32_t>(value) * (1.0f / 65535.0f);
+		}
+
+		/// \brief Encode the float32 coverage values into the given reduced `precision`.
+		///
+		/// \param input The input float32 coverage values.
+		/// \param output The output buffer, must be the same size as `input`.
+		/// \param precision The precision to encode to, may not be `coverage_precision::float32`.
+		void encode_coverage(std::span<const float32_t> input, std::span<uint16_t> output, coverage_precision precision);
+
+		/// \brief Decode the reduced precision coverage values back into float32.
+		///
+		/// \param input The input encoded coverage values.
+		/// \param output The output buffer, must be the same size as `input`.
+		/// \param precision The precision the input was encoded with, may not be `coverage_precision::float32`.
+		void decode_coverage(std::span<const uint16_t> input, std::span<float32_t> output, coverage_precision precision);
+
+
+		/// \brief A compressed coverage channel which may be stored at reduced precision.
+		///
+		/// Regardless of the storage precision this will always decode into float32 values and has the same chunk
+		/// layout (in number of elements per chunk) as the float32 channel it was created from. This means it may
+		/// be iterated in lockstep with the rank channels.
+		struct coverage_channel
+		{
+			coverage_channel() = default;
+			coverage_channel(coverage_channel&&) = default;
+			coverage_channel& operator=(coverage_channel&&) = default;
+			coverage_channel(const coverage_channel&) = delete;
+			coverage_channel& operator=(const coverage_channel&) = delete;
+
+			/// \brief Create the coverage channel from a float32 channel, re-encoding it if `precision` is not
+			/// `coverage_precision::float32`.
+			///
+			/// \param channel The float32 coverage channel, will be consumed.
+			/// \param precision The precision to store the channel at.
+			coverage_channel(compressed::channel<float32_t> channel, coverage_precision precision);
+
+			/// \brief Create the coverage channel from raw float32 coverage, compressing it straight at `precision`.
+			///
+			/// Unlike the constructor taking a float32 channel, reduced precision coverage is never compressed at 
+			/// float32 first. The chunk layout is the same as that of a float32 channel created with `compression`.
+			///
+			/// \param data The float32 coverage values, must hold `width * height` values.
+			/// \param width The width of the channel.
+			/// \param height The height of the channel.
+			/// \param precision The precision to store the channel at.
+			/// \param compression The codec, level, block and chunk size (in float32 bytes) to compress with.
+			/// 
+			/// \throws std::invalid_argument if `data` does not hold `width * height` values.
+			coverage_channel(
+				std::span<const float32_t> data,
+				size_t width,
+				size_t height,
+				coverage_precision precision,
+				const compression_options& compression
+			);
+
+			/// \brief Decompress the chunk at `chunk_idx` into the float32 `buffer`.
+			///
+			/// \param buffer The buffer to decompress into, must be at least the number of elements in the chunk.
+			/// \param chunk_idx The chunk to decompress.
+			void get_chunk(std::span<float32_t> buffer, size_t chunk_idx) const;
+
+			/// \brief Retrieve the fully decompressed channel as float32.
+			std::vector<float32_t> get_decompressed() const;
+
+			/// \brief The precision the channel is stored at.
+			coverage_precision precision() const noexcept;
+
+			size_t num_chunks() const noexcept;
+
+			/// \brief The number of elements (pixels) in the chunk at `chunk_idx`.
+			size_t chunk_elems(size_t chunk_idx) const;
+
+			size_t width() const noexcept;
+			size_t height() const noexcept;
+
+		private:
+			coverage_precision m_Precision = coverage_precision::float32;
+
+			/// Only populated if m_Precision is coverage_precision::float32.
+			compressed::channel<float32_t> m_Channel;
+			/// Only populated if m_Precision is not coverage_precision::float32.
+			compressed::channel<uint16_t> m_ReducedChannel;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -5,6 +5,7 @@
 #include <string_view>
 #include <cstdint>
 #include <string>
+#include <span>
 
 namespace NAMESPACE_CRYPTOMATTE_API
 {
@@ -26,6 +27,39 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 		std::string uint32_t_to_hex_str(uint32_t value);
 
+		/// Compute the 32-bit MurmurHash3 (x86 variant) of the given bytes. This is the hashing method mandated by 
+		/// the cryptomatte specification for both the mask ids and the cryptomatte keys.
+		/// 
+		/// \param data The bytes to hash, for names this is their utf-8 representation.
+		/// \param seed The seed to initialize the hash with, the specification uses 0.
+		/// 
+		/// \returns The raw hash, this is not yet converted into a valid float32 representation.
+		uint32_t murmurhash3_32(std::string_view data, uint32_t seed = 0) noexcept;
+
+		/// Compute the 32-bit MurmurHash3 of many inputs at once.
+		/// 
+		/// The inputs are hashed in groups of lanes which advance in lockstep over the blocks all lanes have in 
+		/// common, this is written such that the compiler is able to vectorize the mixing across the lanes. The 
+		/// remaining blocks and tails of each lane are finished individually so groups of similarly sized inputs 
+		/// benefit the most.
+		/// 
+		/// \param data The inputs to hash.
+		/// \param out  The output hashes, must be the same size as `data`.
+		/// \param seed The seed to initialize the hashes with, the specification uses 0.
+		void murmurhash3_32(std::span<const std::string_view> data, std::span<uint32_t> out, uint32_t seed = 0) noexcept;
+
+		/// Apply the 'uint32_to_float32' conversion of the cryptomatte specification to a raw hash.
+		/// 
+		/// Hashes whose exponent bits are all zeros or all ones would be denormals, infinities or NaNs when 
+		/// interpreted as a float32 which do not survive many image pipelines. The specification therefore flips
+		/// the lowest exponent bit of those. This is branch-free to allow for vectorization.
+		inline constexpr uint32_t to_float32_hash(uint32_t hash) noexcept
+		{
+			const uint32_t exponent = (hash >> 23) & 0xffu;
+			const uint32_t needs_adjusting = static_cast<uint32_t>(exponent == 0u) | static_cast<uint32_t>(exponent == 0xffu);
+			return hash ^ (needs_adjusting << 23);
+		}
+
 	} // detail
 
 } // NAMESPACE_CRYPTOMATTE_API
\ No newline at end of file
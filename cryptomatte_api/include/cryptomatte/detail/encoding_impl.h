@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <functional>
+#include <unordered_map>
+
+#include "macros.h"
+#include "cryptomatte/encoder.h"
+#include "cryptomatte/executor.h"
+
+#include <compressed/channel.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Merges the samples of a single pixel by their id and selects the ids with the highest coverage.
+		///
+		/// This is meant to be owned by a single worker and reused across all the pixels it encodes so the scratch
+		/// memory is only allocated once.
+		struct top_k_selector
+		{
+			/// \brief Construct the selector keeping at most `k` ids per pixel.
+			explicit top_k_selector(size_t k);
+
+			/// \brief Merge the samples by their id and select the `k` ids with the highest coverage.
+			///
+			/// Empty ids and ids with a total coverage of zero are dropped. Ties in coverage are resolved by the
+			/// order the ids first appear in `pixel_samples` so the encoding is deterministic.
+			///
+			/// \param pixel_samples The samples of a single pixel, these may hold the same id multiple times.
+			///
+			/// \returns The selected samples, sorted by descending coverage. This is valid until the next call.
+			std::span<const sample> select(std::span<const sample> pixel_samples);
+
+		private:
+			size_t m_K = 0;
+			std::vector<sample> m_Merged;
+			std::vector<sample> m_Selected;
+		};
+
+
+		/// \brief Retrieve the name of the rank or coverage channel of the given level, e.g. 'CryptoObject00.b'.
+		std::string encoded_channel_name(const std::string& name, size_t level, bool is_rank);
+
+
+		/// \brief Encode the rank and coverage channels of a cryptomatte chunk by chunk.
+		///
+		/// The chunks (bands of scanlines) are encoded in parallel across the executor with each worker ranking
+		/// the samples of its pixels into scratch buffers and compressing those straight into the channels.
+		///
+		/// \param width         The width of the cryptomatte.
+		/// \param height        The height of the cryptomatte.
+		/// \param options       The options holding the name, number of levels and compression of the channels.
+		/// \param pixel_samples The function retrieving the samples of the pixel at the given index, the given
+		///						 scratch vector may be used to hold the samples but the returned span may also point
+		///						 elsewhere. This is called concurrently from multiple threads.
+		/// \param exec          The executor to encode on.
+		///
+		/// \returns The channels mapped by their name.
+		std::unordered_map<std::string, compressed::channel<float32_t>> encode_channels(
+			size_t width,
+			size_t height,
+			const encode_options& options,
+			const std::function<std::span<const sample>(size_t pixel_idx, std::vector<sample>& scratch)>& pixel_samples,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec
+		);
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <bit>
+#include <span>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+
+#include "macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief The probing hash of the flat id tables (`flat_id_set` and `flat_id_map`).
+		/// 
+		/// The ids are already MurmurHash3 outputs and therefore well distributed, we still mix them with a single
+		/// multiply to avoid clustering on ids that only differ in their upper bits.
+		constexpr size_t flat_id_hash(uint32_t id) noexcept
+		{
+			return static_cast<size_t>((id * 0x9E3779B1u) ^ (id >> 16));
+		}
+
+
+		/// \brief A small open-addressing hash set of cryptomatte ids, specialized for accumulating the distinct ids
+		/// in a rank chunk.
+		///
+		/// The ids are stored by their uint32_t bit-pattern using linear probing in a power-of-two table. The value
+		/// 0 is used as the empty-slot sentinel which we get for free as an id of 0 (or -0) marks an empty pixel in
+		/// the rank channels and is never inserted. Since a rank chunk usually only holds a handful to a few
+		/// thousand distinct ids this stays cache resident and is an order of magnitude faster than inserting into
+		/// a `std::unordered_set<float32_t>`.
+		struct flat_id_set
+		{
+			/// \brief Construct the set with room for at least `expected_size` ids before having to grow.
+			explicit flat_id_set(size_t expected_size = 64)
+			{
+				size_t capacity = std::bit_ceil(std::max<size_t>(expected_size * 2, 16));
+				m_Slots.resize(capacity, s_Empty);
+				m_Mask = capacity - 1;
+			}
+
+			/// \brief Insert the given id into the set, zero ids (empty pixels) are ignored.
+			///
+			/// \param id The bit-pattern of the id to insert.
+			///
+			/// \returns Whether the id was newly inserted.
+			inline bool insert(uint32_t id)
+			{
+				if (is_empty_id(id))
+				{
+					return false;
+				}
+
+				size_t slot = hash(id) & m_Mask;
+				while (true)
+				{
+					uint32_t current = m_Slots[slot];
+					if (current == id)
+					{
+						return false;
+					}
+					if (current == s_Empty)
+					{
+						m_Slots[slot] = id;
+						++m_Size;
+						// Keep the load factor below 0.5 to keep the probe sequences short.
+						if (m_Size * 2 > m_Slots.size())
+						{
+							grow();
+						}
+						return true;
+					}
+					slot = (slot + 1) & m_Mask;
+				}
+			}
+
+			/// \brief Insert the given float32_t id into the set, zero ids (empty pixels) are ignored.
+			inline bool insert(float32_t id)
+			{
+				return insert(std::bit_cast<uint32_t>(id));
+			}
+
+			/// \brief Check whether the set contains the given id.
+			inline bool contains(uint32_t id) const
+			{
+				if (is_empty_id(id))
+				{
+					return false;
+				}
+
+				size_t slot = hash(id) & m_Mask;
+				while (true)
+				{
+					uint32_t current = m_Slots[slot];
+					if (current == id)
+					{
+						return true;
+					}
+					if (current == s_Empty)
+					{
+						return false;
+					}
+					slot = (slot + 1) & m_Mask;
+				}
+			}
+
+			/// \brief Check whether the set contains the given float32_t id.
+			inline bool contains(float32_t id) const
+			{
+				return contains(std::bit_cast<uint32_t>(id));
+			}
+
+			/// \brief Merge all the ids from `other` into this set.
+			void merge(const flat_id_set& other)
+			{
+				for (uint32_t id : other.m_Slots)
+				{
+					if (id != s_Empty)
+					{
+						insert(id);
+					}
+				}
+			}
+
+			/// \brief Append all of the ids in the set as float32_t to `out`, the order is unspecified.
+			void append_to(std::vector<float32_t>& out) const
+			{
+				out.reserve(out.size() + m_Size);
+				for (uint32_t id : m_Slots)
+				{
+					if (id != s_Empty)
+					{
+						out.push_back(std::bit_cast<float32_t>(id));
+					}
+				}
+			}
+
+			/// \brief Remove all the ids from the set, retaining the allocated capacity.
+			void clear() noexcept
+			{
+				std::fill(m_Slots.begin(), m_Slots.end(), s_Empty);
+				m_Size = 0;
+			}
+
+			size_t size() const noexcept { return m_Size; }
+			bool empty() const noexcept { return m_Size == 0; }
+
+			/// \brief Whether the given id bit-pattern represents an empty pixel (0.0f or -0.0f).
+			static constexpr bool is_empty_id(uint32_t id) noexcept
+			{
+				return (id & 0x7fffffffu) == 0;
+			}
+
+		private:
+			static constexpr uint32_t s_Empty = 0;
+
+			std::vector<uint32_t> m_Slots;
+			size_t m_Mask = 0;
+			size_t m_Size = 0;
+
+			static constexpr size_t hash(uint32_t id) noexcept
+			{
+				return flat_id_hash(id);
+			}
+
+			void grow()
+			{
+				std::vector<uint32_t> old_slots(m_Slots.size() * 2, s_Empty);
+				std::swap(old_slots, m_Slots);
+				m_Mask = m_Slots.size() - 1;
+				m_Size = 0;
+				for (uint32_t id : old_slots)
+				{
+					if (id != s_Empty)
+					{
+						insert(id);
+					}
+				}
+			}
+		};
+
+
+		/// \brief A small open-addressing hash map from cryptomatte ids to `Value`.
+		///
+		/// This is the map counterpart to `flat_id_set` using the same layout: the ids are stored by their 
+		/// uint32_t bit-pattern with linear probing in a power-of-two table where 0 marks an empty slot, the
+		/// values are kept in a parallel array. Empty ids (0 or -0) can therefore never be inserted.
+		template <typename Value>
+		struct flat_id_map
+		{
+			/// \brief Construct the map with room for at least `expected_size` ids before having to grow.
+			explicit flat_id_map(size_t expected_size = 64)
+			{
+				size_t capacity = std::bit_ceil(std::max<size_t>(expected_size * 2, 16));
+				m_Keys.resize(capacity, s_Empty);
+				m_Values.resize(capacity);
+				m_Mask = capacity - 1;
+			}
+
+			/// \brief Look up the value of `id`, inserting `value` if the id is not in the map yet.
+			///
+			/// \param id    The bit-pattern of the id, must not be an empty id.
+			/// \param value The value to insert if the id is not present.
+			///
+			/// \returns A pointer to the value of the id (valid until the next insertion) and whether it was 
+			///			 newly inserted.
+			std::pair<Value*, bool> try_emplace(uint32_t id, Value value)
+			{
+				assert(!flat_id_set::is_empty_id(id));
+				size_t slot = flat_id_hash(id) & m_Mask;
+				while (true)
+				{
+					uint32_t current = m_Keys[slot];
+					if (current == id)
+					{
+						return { &m_Values[slot], false };
+					}
+					if (current == s_Empty)
+					{
+						// Keep the load factor below 0.5 to keep the probe sequences short.
+						if ((m_Size + 1) * 2 > m_Keys.size())
+						{
+							grow();
+							return try_emplace(id, std::move(value));
+						}
+						m_Keys[slot] = id;
+						m_Values[slot] = std::move(value);
+						++m_Size;
+						return { &m_Values[slot], true };
+					}
+					slot = (slot + 1) & m_Mask;
+				}
+			}
+
+			/// \brief Find the value of `id`, returning a nullptr if it is not in the map.
+			const Value* find(uint32_t id) const
+			{
+				if (flat_id_set::is_empty_id(id))
+				{
+					return nullptr;
+				}
+
+				size_t slot = flat_id_hash(id) & m_Mask;
+				while (true)
+				{
+					uint32_t current = m_Keys[slot];
+					if (current == id)
+					{
+						return &m_Values[slot];
+					}
+					if (current == s_Empty)
+					{
+						return nullptr;
+					}
+					slot = (slot + 1) & m_Mask;
+				}
+			}
+
+			/// \brief Remove all the ids from the map, retaining the allocated capacity.
+			void clear() noexcept
+			{
+				std::fill(m_Keys.begin(), m_Keys.end(), s_Empty);
+				m_Size = 0;
+			}
+
+			size_t size() const noexcept { return m_Size; }
+			bool empty() const noexcept { return m_Size == 0; }
+
+		private:
+			static constexpr uint32_t s_Empty = 0;
+
+			std::vector<uint32_t> m_Keys;
+			std::vector<Value> m_Values;
+			size_t m_Mask = 0;
+			size_t m_Size = 0;
+
+			void grow()
+			{
+				std::vector<uint32_t> old_keys(m_Keys.size() * 2, s_Empty);
+				std::vector<Value> old_values(m_Values.size() * 2);
+				std::swap(old_keys, m_Keys);
+				std::swap(old_values, m_Values);
+				m_Mask = m_Keys.size() - 1;
+				m_Size = 0;
+				for (size_t i = 0; i < old_keys.size(); ++i)
+				{
+					if (old_keys[i] != s_Empty)
+					{
+						try_emplace(old_keys[i], std::move(old_values[i]));
+					}
+				}
+			}
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
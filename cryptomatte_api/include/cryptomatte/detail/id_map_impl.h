@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <bit>
+#include <cassert>
+
+#include "macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Update the dominant ids and their coverage with a single rank-coverage level of a chunk.
+		///
+		/// A pixel takes the id of the level if its coverage is strictly greater than the current dominant coverage
+		/// so ties resolve to the earlier level, empty ids are never taken. The per-pixel selection is branch-free
+		/// so the compiler is able to vectorize it.
+		///
+		/// \param rank          The rank chunk of the level.
+		/// \param coverage      The coverage chunk of the level, must be the same size as `rank`.
+		/// \param ids           The dominant ids to update, must be at least the size of `rank`.
+		/// \param best_coverage The coverage of the dominant ids to update, must be at least the size of `rank`.
+		inline void accumulate_dominant_id(
+			std::span<const float32_t> rank,
+			std::span<const float32_t> coverage,
+			std::span<uint32_t> ids,
+			std::span<float32_t> best_coverage
+		) noexcept
+		{
+			assert(rank.size() == coverage.size());
+			assert(ids.size() >= rank.size() && best_coverage.size() >= rank.size());
+			const float32_t* rank_ptr = rank.data();
+			const float32_t* coverage_ptr = coverage.data();
+			uint32_t* ids_ptr = ids.data();
+			float32_t* best_ptr = best_coverage.data();
+			for (size_t i = 0; i < rank.size(); ++i)
+			{
+				const uint32_t id = std::bit_cast<uint32_t>(rank_ptr[i]);
+				const bool take = (coverage_ptr[i] > best_ptr[i]) & ((id & 0x7fffffffu) != 0u);
+				ids_ptr[i] = take ? id : ids_ptr[i];
+				best_ptr[i] = take ? coverage_ptr[i] : best_ptr[i];
+			}
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <bit>
+#include <span>
+#include <cassert>
+#include <algorithm>
+
+#include "macros.h"
+#include "flat_id_set.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief A set of ids to test the pixels of rank chunks against, used for extracting the union of many masks.
+		///
+		/// Small sets are tested by comparing every pixel against each of the ids which is branch-free and gets 
+		/// vectorized by the compiler, for larger sets this becomes too expensive and we instead look up runs of 
+		/// equal ids in a `flat_id_set`.
+		struct id_membership
+		{
+			/// Up to this many ids are compared directly rather than going through the hash set.
+			static constexpr size_t s_SmallSetSize = 16;
+
+			/// \brief Construct the membership test for the given ids, empty ids and duplicates are ignored.
+			explicit id_membership(std::span<const uint32_t> ids)
+				: m_Large(ids.size())
+			{
+				for (auto id : ids)
+				{
+					if (m_Large.insert(id))
+					{
+						m_Small.push_back(id);
+					}
+				}
+				m_UseSmall = m_Small.size() <= s_SmallSetSize;
+			}
+
+			/// \brief The number of distinct ids in the set.
+			size_t size() const noexcept
+			{
+				return m_Small.size();
+			}
+
+			/// \brief Compute the membership of every pixel of the rank chunk.
+			///
+			/// \param rank    The rank chunk to test.
+			/// \param weights The output weights which get set to 1.0f for pixels whose id is part of the set and 
+			///                0.0f otherwise. Must be at least the size of `rank`.
+			///
+			/// \returns Whether any of the pixels are part of the set.
+			bool match(std::span<const float32_t> rank, std::span<float32_t> weights) const noexcept
+			{
+				assert(weights.size() >= rank.size());
+				const float32_t* rank_ptr = rank.data();
+				float32_t* weights_ptr = weights.data();
+				std::fill(weights_ptr, weights_ptr + rank.size(), 0.0f);
+
+				if (m_UseSmall)
+				{
+					// The ids are unique so at most one of them matches and the weights stay within [0, 1].
+					for (uint32_t id : m_Small)
+					{
+						for (size_t i = 0; i < rank.size(); ++i)
+						{
+							weights_ptr[i] += static_cast<float32_t>(std::bit_cast<uint32_t>(rank_ptr[i]) == id);
+						}
+					}
+				}
+				else
+				{
+					// Neighbouring pixels very frequently hold the same id so we only probe the set on changes.
+					uint32_t previous = 0;
+					float32_t previous_weight = 0.0f;
+					for (size_t i = 0; i < rank.size(); ++i)
+					{
+						uint32_t id = std::bit_cast<uint32_t>(rank_ptr[i]);
+						if (id != previous)
+						{
+							previous = id;
+							previous_weight = static_cast<float32_t>(m_Large.contains(id));
+						}
+						weights_ptr[i] = previous_weight;
+					}
+				}
+
+				return std::any_of(weights_ptr, weights_ptr + rank.size(), [](float32_t weight) { return weight != 0.0f; });
+			}
+
+		private:
+			/// The distinct ids in order of insertion.
+			std::vector<uint32_t> m_Small;
+			flat_id_set m_Large;
+			bool m_UseSmall = true;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
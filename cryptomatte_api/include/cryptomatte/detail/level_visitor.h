@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <span>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include "macros.h"
+#include "id_membership.h"
+#include "flat_id_set.h"
+#include "chunk_accumulator.h"
+
+#include "cryptomatte/statistics.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Receives the decompressed rank-coverage levels of the chunks in `cryptomatte::visit_levels`.
+		///
+		/// This is the extension point for any computation which reduces all levels of a chunk into a number of
+		/// outputs (e.g. the preview, a union mask or the per-id masks). A visitor only ever processes one chunk 
+		/// at a time so it may hold scratch buffers without any synchronization. For every chunk `begin_chunk` is
+		/// called first, followed by `wants_coverage` and (if that returned true) `visit` for all the occupied 
+		/// levels in order and finally `end_chunk`. The calls for a single chunk may happen on different threads
+		/// but never concurrently. After `end_chunk` the outputs of the chunk (see `num_outputs`) are handed out
+		/// via `emit`, once all chunks are done `finish` is called.
+		struct level_visitor
+		{
+			virtual ~level_visitor() = default;
+
+			/// \brief Called before visiting the levels of the chunk at `chunk_idx` holding `chunk_num_elems` pixels.
+			virtual void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) = 0;
+
+			/// \brief Called with the rank chunk of every occupied level, returning false skips decompressing the 
+			/// coverage as well as the call to `visit` for this level.
+			virtual bool wants_coverage(std::span<const float32_t> rank);
+
+			/// \brief Called with the rank and coverage chunk of a level.
+			virtual void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) = 0;
+
+			/// \brief Called once all levels of the chunk at `chunk_idx` were visited.
+			virtual void end_chunk(size_t chunk_idx) = 0;
+
+			/// \brief The number of independent outputs of the current chunk, queried after `end_chunk`.
+			virtual size_t num_outputs() const;
+
+			/// \brief Hand out the output at `output_idx` of the current chunk. This is called concurrently for the
+			/// different outputs of a chunk so it is meant for sinks that are expensive but independent per output
+			/// (such as recompressing the per-id masks).
+			virtual void emit(size_t output_idx);
+
+			/// \brief The number of bytes of scratch memory the visitor holds on to, this limits the number of 
+			/// chunks in flight (see `cryptomatte::set_decode_memory_budget`). Only needs to be reported by visitors
+			/// whose memory depends on the contents of the chunks.
+			virtual size_t memory_usage() const;
+
+			/// \brief Release the scratch memory reported by `memory_usage`, called in between chunks.
+			virtual void release_memory();
+
+			/// \brief Called once all chunks were visited, this is where any per-visitor results may be reduced 
+			/// into the final output.
+			virtual void finish();
+		};
+
+
+		/// \brief Accumulates the id-colour preview (see `accumulate_preview`) of every chunk.
+		struct preview_visitor : public level_visitor
+		{
+			using sink_fn = std::function<void(size_t chunk_idx, std::span<float32_t> red, std::span<float32_t> green, std::span<float32_t> blue)>;
+
+			/// \param max_chunk_elems The maximum number of elements in a chunk.
+			/// \param sink            Receives the preview of every chunk holding any ids, may be called concurrently 
+			///                        from multiple visitors.
+			preview_visitor(size_t max_chunk_elems, const sink_fn& sink);
+
+			void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) override;
+			void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) override;
+			void end_chunk(size_t chunk_idx) override;
+
+		private:
+			const sink_fn& m_Sink;
+			std::array<std::vector<float32_t>, 3> m_Colors;
+			size_t m_ChunkNumElems = 0;
+			bool m_HasData = false;
+		};
+
+
+		/// \brief Accumulates the union (sum) of the masks of a set of ids for every chunk.
+		struct union_visitor : public level_visitor
+		{
+			using sink_fn = std::function<void(size_t chunk_idx, std::span<float32_t> mask)>;
+
+			/// \param max_chunk_elems The maximum number of elements in a chunk.
+			/// \param membership      The ids to accumulate, shared across all visitors.
+			/// \param sink            Receives the union mask of every chunk holding any of the ids, may be called 
+			///                        concurrently from multiple visitors.
+			union_visitor(size_t max_chunk_elems, const id_membership& membership, const sink_fn& sink);
+
+			void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) override;
+			bool wants_coverage(std::span<const float32_t> rank) override;
+			void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) override;
+			void end_chunk(size_t chunk_idx) override;
+
+		private:
+			const id_membership& m_Membership;
+			const sink_fn& m_Sink;
+			std::vector<float32_t> m_Weights;
+			std::vector<float32_t> m_Mask;
+			size_t m_ChunkNumElems = 0;
+			bool m_HasData = false;
+		};
+
+
+		/// \brief Computes the dominant (highest coverage) id and its coverage of every chunk.
+		struct id_map_visitor : public level_visitor
+		{
+			using sink_fn = std::function<void(size_t chunk_idx, std::span<uint32_t> ids, std::span<float32_t> coverage)>;
+
+			/// \param max_chunk_elems The maximum number of elements in a chunk.
+			/// \param sink            Receives the dominant ids and coverage of every chunk holding any ids, may be 
+			///                        called concurrently from multiple visitors.
+			id_map_visitor(size_t max_chunk_elems, const sink_fn& sink);
+
+			void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) override;
+			void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) override;
+			void end_chunk(size_t chunk_idx) override;
+
+		private:
+			const sink_fn& m_Sink;
+			std::vector<uint32_t> m_Ids;
+			std::vector<float32_t> m_Coverage;
+			size_t m_ChunkNumElems = 0;
+			bool m_HasData = false;
+		};
+
+
+
+		/// \brief Accumulates the per-id coverage statistics (see `id_statistics`) of all the chunks of a worker.
+		/// 
+		/// The statistics are collected into a per-visitor map which is handed to the sink once in `finish`, such
+		/// that the workers never contend on shared state while scanning the levels.
+		struct statistics_visitor : public level_visitor
+		{
+			using statistics_map = std::unordered_map<uint32_t, id_statistics>;
+			using sink_fn = std::function<void(const statistics_map& statistics)>;
+
+			/// \param width           The width of the image, used for computing the pixel coordinates.
+			/// \param max_chunk_elems The maximum number of elements in a chunk.
+			/// \param requested       The ids to compute the statistics for, if this is a nullptr all ids are 
+			///                        accounted for.
+			/// \param sink            Receives the statistics of this visitor, may be called concurrently from
+			///                        multiple visitors.
+			statistics_visitor(size_t width, size_t max_chunk_elems, const flat_id_set* requested, const sink_fn& sink);
+
+			void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) override;
+			bool wants_coverage(std::span<const float32_t> rank) override;
+			void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) override;
+			void end_chunk(size_t chunk_idx) override;
+			void finish() override;
+
+		private:
+			size_t m_Width = 0;
+			size_t m_MaxChunkElems = 0;
+			const flat_id_set* m_Requested = nullptr;
+			const sink_fn& m_Sink;
+			statistics_map m_Statistics;
+			/// The index of the first pixel of the current chunk.
+			size_t m_ElemBegin = 0;
+		};
+
+
+
+		/// \brief Collects the unique ids present in the chunks of a worker from the rank channels alone.
+		/// 
+		/// This never requests the coverage so only the rank channels are decompressed, the ids are handed to the
+		/// sink once in `finish`.
+		struct id_collector_visitor : public level_visitor
+		{
+			using sink_fn = std::function<void(const flat_id_set& ids)>;
+
+			/// \param sink Receives the ids found by this visitor, may be called concurrently from multiple visitors.
+			explicit id_collector_visitor(const sink_fn& sink);
+
+			void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) override;
+			bool wants_coverage(std::span<const float32_t> rank) override;
+			void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) override;
+			void end_chunk(size_t chunk_idx) override;
+			void finish() override;
+
+		private:
+			const sink_fn& m_Sink;
+			flat_id_set m_Ids;
+		};
+
+
+
+		/// \brief Accumulates the masks of the ids in every chunk (see `chunk_accumulator`).
+		///
+		/// Every id found in the chunk is one output, so the masks of a chunk are handed to the sink in parallel.
+		struct mask_visitor : public level_visitor
+		{
+			using sink_fn = std::function<void(size_t chunk_idx, float32_t id, std::span<float32_t> mask)>;
+
+			/// \param requested The ids to accumulate, if this is a nullptr all ids are accumulated.
+			/// \param sink      Receives the mask of every id in every chunk, may be called concurrently.
+			mask_visitor(const flat_id_set* requested, const sink_fn& sink);
+
+			void begin_chunk(size_t chunk_idx, size_t chunk_num_elems) override;
+			bool wants_coverage(std::span<const float32_t> rank) override;
+			void visit(std::span<const float32_t> rank, std::span<const float32_t> coverage) override;
+			void end_chunk(size_t chunk_idx) override;
+			size_t num_outputs() const override;
+			void emit(size_t output_idx) override;
+			size_t memory_usage() const override;
+			void release_memory() override;
+
+		private:
+			const flat_id_set* m_Requested = nullptr;
+			const sink_fn& m_Sink;
+			chunk_accumulator m_Accumulator;
+			size_t m_ChunkIdx = 0;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
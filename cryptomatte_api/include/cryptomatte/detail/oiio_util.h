@@ -1,8 +1,21 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <span>
+#include <functional>
+#include <filesystem>
+
 #include "macros.h"
+#include "cryptomatte/executor.h"
+#include "cryptomatte/task_control.h"
+#include "cryptomatte/options.h"
 
 #include <OpenImageIO/imageio.h>
+#include <compressed/channel.h>
+#include <compressed/enums.h>
+#include <compressed/util.h>
 
 
 namespace NAMESPACE_CRYPTOMATTE_API
@@ -37,6 +50,209 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			OIIO::TypeDesc compare
 		);
 
+
+		/// \brief Read the given channels of the (first subimage of the) image into compressed channels.
+		///
+		/// The channels are read chunk by chunk: for each chunk we read the scanlines it covers, split them up into
+		/// the individual channels and compress those in parallel. This way we never hold more than one chunk of
+		/// uncompressed data per channel in memory and can check for cancellation and report progress per chunk.
+		///
+		/// \param input             The image to read from, must be opened on the first subimage.
+		/// \param channel_names     The names of the channels to read.
+		/// \param codec             The compression codec of the resulting channels.
+		/// \param compression_level The compression level of the resulting channels.
+		/// \param block_size        The block size of the resulting channels.
+		/// \param chunk_size        The chunk size of the resulting channels.
+		/// \param exec              The executor to compress the channels on.
+		/// \param control           The cancellation and progress reporting.
+		///
+		/// \throws std::invalid_argument if any of the channels do not exist on the image.
+		/// \throws std::runtime_error if reading from the image fails.
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		///
+		/// \returns The compressed channels mapped by their names.
+		std::unordered_map<std::string, compressed::channel<float32_t>> read_channels(
+			OIIO::ImageInput& input,
+			const std::vector<std::string>& channel_names,
+			compressed::enums::codec codec,
+			uint8_t compression_level,
+			size_t block_size,
+			size_t chunk_size,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control
+		);
+
+
+		/// \brief Decompresses the chunk at `chunk_idx` of a channel into the given buffer. This allows channels of
+		/// different storage types to be streamed to disk alongside each other.
+		using chunk_reader = std::function<void(std::span<float32_t> buffer, size_t chunk_idx)>;
+
+		/// \brief Receives the first and one-past-last scanline as well as the interleaved pixels of those scanlines.
+		using scanline_writer = std::function<void(size_t y_begin, size_t y_end, std::span<const float32_t> pixels)>;
+
+		/// \brief Interleaves the chunks of multiple channels into scanlines, handing these out as soon as they are
+		/// complete.
+		///
+		/// The chunks are filled one after the other in chunk order, after which all the scanlines which are 
+		/// complete are handed to the writer. A partially filled scanline at the end of a chunk is held back until 
+		/// the next chunk completes it. This way we never hold more than a chunk (plus a scanline) of each channel 
+		/// in memory.
+		struct scanline_interleaver
+		{
+			/// \param num_channels    The number of channels to interleave.
+			/// \param width           The width of the channels.
+			/// \param height          The height of the channels.
+			/// \param max_chunk_elems The number of elements in all but the last chunk.
+			/// \param write           The function receiving the completed scanlines.
+			scanline_interleaver(size_t num_channels, size_t width, size_t height, size_t max_chunk_elems, scanline_writer write);
+
+			/// \brief The index of the chunk currently being filled, this is `num_chunks()` once all are written.
+			size_t chunk_idx() const noexcept { return m_ChunkIdx; }
+
+			size_t num_chunks() const noexcept { return m_NumChunks; }
+
+			/// \brief The number of elements in the chunk currently being filled.
+			size_t chunk_num_elems() const noexcept;
+
+			/// \brief Interleave the current chunk of the given channel. This may be called concurrently for 
+			/// different channels.
+			///
+			/// \param channel_idx The index of the channel to fill.
+			/// \param chunk       The data of the current chunk, must hold `chunk_num_elems()` elements.
+			void set(size_t channel_idx, std::span<const float32_t> chunk);
+
+			/// \brief Fill the current chunk of all channels with zeros.
+			void clear();
+
+			/// \brief Hand all the scanlines completed by the current chunk to the writer and advance to the next
+			/// chunk.
+			void finish_chunk();
+
+		private:
+			size_t m_NumChannels = 0;
+			size_t m_Width = 0;
+			size_t m_NumElems = 0;
+			size_t m_MaxChunkElems = 0;
+			size_t m_NumChunks = 0;
+			size_t m_ChunkIdx = 0;
+			/// The first scanline held in `m_Scanlines`.
+			size_t m_YBegin = 0;
+			/// Holds the interleaved pixels starting at scanline `m_YBegin`, that is the partially filled scanline
+			/// carried over from the previous chunk followed by the current chunk.
+			compressed::util::default_init_vector<float32_t> m_Scanlines;
+			scanline_writer m_Write;
+
+			/// The offset of the current chunk into `m_Scanlines` in pixels.
+			size_t chunk_offset() const noexcept;
+		};
+
+		/// \brief Stream the given channels as interleaved scanlines, chunk by chunk.
+		///
+		/// This is the type-erased version of `stream_interleaved_scanlines`, the channels are accessed via 
+		/// `chunk_reader` which must all share the same chunk layout described by `max_chunk_elems`.
+		///
+		/// \param channels        The readers of the channels to interleave.
+		/// \param width           The width of the channels.
+		/// \param height          The height of the channels.
+		/// \param max_chunk_elems The number of elements in all but the last chunk.
+		/// \param exec            The executor to decompress the channels on.
+		/// \param control         The cancellation, checked once per chunk.
+		/// \param write           The function receiving the first and one-past-last scanline as well as the 
+		///                        interleaved pixels of those scanlines.
+		void stream_interleaved_scanlines(
+			std::span<const chunk_reader> channels,
+			size_t width,
+			size_t height,
+			size_t max_chunk_elems,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control,
+			const scanline_writer& write
+		);
+
+		/// \brief Stream the given channels as interleaved scanlines, chunk by chunk.
+		///
+		/// Each chunk of all the channels is decompressed (in parallel across the channels) and interleaved via a 
+		/// `scanline_interleaver` which hands the completed scanlines to `write`.
+		///
+		/// \param channels The channels to interleave, these must all have the same dimensions and chunk size.
+		/// \param exec     The executor to decompress the channels on.
+		/// \param control  The cancellation, checked once per chunk.
+		/// \param write    The function receiving the first and one-past-last scanline as well as the interleaved
+		///                 pixels of those scanlines.
+		void stream_interleaved_scanlines(
+			std::span<const compressed::channel<float32_t>* const> channels,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control,
+			const scanline_writer& write
+		);
+
+		/// \brief Write the given channels into a single-part image on disk.
+		///
+		/// \param file            The file path to write to, any existing file is overwritten.
+		/// \param spec            The spec to write the image with, this must hold one channel per reader.
+		/// \param channels        The readers of the channels to write, see `stream_interleaved_scanlines`.
+		/// \param max_chunk_elems The number of elements in all but the last chunk.
+		/// \param exec            The executor to decompress the channels on, its concurrency is also used for the 
+		///                        compression threads of the writer.
+		/// \param control         The cancellation, checked once per chunk.
+		///
+		/// \throws std::runtime_error if the file could not be opened or written.
+		void write_image(
+			const std::filesystem::path& file,
+			const OIIO::ImageSpec& spec,
+			std::span<const chunk_reader> channels,
+			size_t max_chunk_elems,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control
+		);
+
+		/// \brief Write the given channels into an exr file on disk.
+		///
+		/// \param file     The file path to write to, any existing file is overwritten.
+		/// \param channels The channels to write, paired with their names. These must all have the same dimensions
+		///                 and chunk size.
+		/// \param options  The options controlling the layout and format of the file.
+		/// \param exec     The executor to decompress the channels on, its concurrency is also used for the 
+		///                 compression threads of the writer.
+		///
+		/// \throws std::invalid_argument if no channels are given.
+		/// \throws std::runtime_error if the file could not be opened or written.
+		/// \throws operation_cancelled if a stop was requested via `options.control.stop_token`.
+		void write_channels(
+			const std::filesystem::path& file,
+			const std::vector<std::pair<std::string, const compressed::channel<float32_t>*>>& channels,
+			const write_options& options,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec
+		);
+
+		/// \brief Write channels produced on the fly into a single-part exr file on disk, ignoring `options.layout`.
+		///
+		/// Rather than requiring the channels up-front `produce` fills them chunk by chunk into the given 
+		/// interleaver which streams the completed scanlines straight to disk. `produce` must finish all the 
+		/// chunks of the interleaver.
+		///
+		/// \param file            The file path to write to, any existing file is overwritten.
+		/// \param names           The names of the channels, in the order of the interleaved channels.
+		/// \param width           The width of the channels.
+		/// \param height          The height of the channels.
+		/// \param max_chunk_elems The number of elements in all but the last chunk.
+		/// \param options         The options controlling the format of the file.
+		/// \param exec            The executor whose concurrency is used for the compression threads of the writer.
+		/// \param produce         The function filling the chunks of the channels.
+		///
+		/// \throws std::invalid_argument if no names are given.
+		/// \throws std::runtime_error if the file could not be opened or written, or not all chunks were produced.
+		void write_channels_streamed(
+			const std::filesystem::path& file,
+			const std::vector<std::string>& names,
+			size_t width,
+			size_t height,
+			size_t max_chunk_elems,
+			const write_options& options,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const std::function<void(scanline_interleaver& interleaver)>& produce
+		);
+
 	} // detail
 
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <bit>
+#include <cstdint>
+#include <cassert>
+
+#include "macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Compute the preview colour of an id.
+		///
+		/// This follows the visualization of the reference implementation: the red channel is the mantissa of the
+		/// id while green and blue are the id shifted left by 8 and 16 bits, normalized to [0, 1]. Empty ids 
+		/// (0 and -0) are black.
+		///
+		/// \param id The id as stored in the rank channels.
+		///
+		/// \returns The rgb colour of the id.
+		inline std::array<float32_t, 3> id_to_rgb(uint32_t id) noexcept
+		{
+			constexpr float32_t mantissa_scale = 1.0f / static_cast<float32_t>(1u << 23);
+			constexpr float32_t uint32_scale = 1.0f / static_cast<float32_t>(0xffffffffu);
+			// Multiplying by 0 or 1 instead of branching keeps the callers' loops vectorizable.
+			const float32_t is_set = static_cast<float32_t>((id & 0x7fffffffu) != 0u);
+			return {
+				static_cast<float32_t>(id & 0x007fffffu) * mantissa_scale * is_set,
+				static_cast<float32_t>(static_cast<uint32_t>(id << 8)) * uint32_scale * is_set,
+				static_cast<float32_t>(static_cast<uint32_t>(id << 16)) * uint32_scale * is_set
+			};
+		}
+
+
+		/// \brief Accumulate a single rank-coverage level of a chunk into the preview.
+		///
+		/// Every pixel adds the colour of its id weighted by its coverage, so summing all levels gives the 
+		/// coverage-weighted blend of all ids on that pixel. This is branch-free so the compiler is able to 
+		/// vectorize it.
+		///
+		/// \param rank     The rank chunk of the level.
+		/// \param coverage The coverage chunk of the level, must be the same size as `rank`.
+		/// \param red      The red preview chunk to accumulate into.
+		/// \param green    The green preview chunk to accumulate into.
+		/// \param blue     The blue preview chunk to accumulate into.
+		inline void accumulate_preview(
+			std::span<const float32_t> rank,
+			std::span<const float32_t> coverage,
+			std::span<float32_t> red,
+			std::span<float32_t> green,
+			std::span<float32_t> blue
+		) noexcept
+		{
+			assert(rank.size() == coverage.size());
+			assert(red.size() >= rank.size() && green.size() >= rank.size() && blue.size() >= rank.size());
+			const float32_t* rank_ptr = rank.data();
+			const float32_t* coverage_ptr = coverage.data();
+			float32_t* red_ptr = red.data();
+			float32_t* green_ptr = green.data();
+			float32_t* blue_ptr = blue.data();
+			for (size_t i = 0; i < rank.size(); ++i)
+			{
+				const auto color = id_to_rgb(std::bit_cast<uint32_t>(rank_ptr[i]));
+				red_ptr[i] += color[0] * coverage_ptr[i];
+				green_ptr[i] += color[1] * coverage_ptr[i];
+				blue_ptr[i] += color[2] * coverage_ptr[i];
+			}
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <bit>
+#include <algorithm>
+
+#include "macros.h"
+#include "flat_id_set.h"
+
+#include <compressed/channel.h>
+#include <compressed/util.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		/// \brief Per-chunk occupancy of a single rank channel (level).
+		///
+		/// A chunk is considered occupied if any of its pixels hold a non-zero id. Renderers usually pad the
+		/// cryptomatte to a fixed number of levels with most of the higher levels (and large parts of the lower
+		/// ones) being entirely empty, this allows us to skip those without decompressing them.
+		struct rank_occupancy
+		{
+			/// One entry per chunk, non-zero if the chunk holds any ids.
+			std::vector<uint8_t> chunks;
+			/// Whether any of the chunks hold ids.
+			bool occupied = false;
+
+			bool chunk_occupied(size_t chunk_idx) const noexcept
+			{
+				return chunks[chunk_idx] != 0;
+			}
+		};
+
+
+		/// \brief Check whether the given rank chunk (or a subrange of it) holds any ids.
+		inline bool rank_chunk_occupied(std::span<const float32_t> rank_chunk)
+		{
+			return std::any_of(rank_chunk.begin(), rank_chunk.end(), [](float32_t elem)
+				{
+					return !flat_id_set::is_empty_id(std::bit_cast<uint32_t>(elem));
+				});
+		}
+
+
+		/// \brief Check whether the given rank chunk holds any of the requested ids.
+		///
+		/// \param rank_chunk The decompressed rank chunk.
+		/// \param requested  The ids to look for, if this is a nullptr any non-empty id counts.
+		inline bool rank_chunk_contains_any(std::span<const float32_t> rank_chunk, const flat_id_set* requested)
+		{
+			if (!requested)
+			{
+				return rank_chunk_occupied(rank_chunk);
+			}
+
+			// Neighbouring pixels very frequently hold the same id so we only look up the id on changes.
+			uint32_t previous = 0;
+			for (float32_t elem : rank_chunk)
+			{
+				uint32_t id = std::bit_cast<uint32_t>(elem);
+				if (id == previous)
+				{
+					continue;
+				}
+				previous = id;
+				if (requested->contains(id))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+
+		/// \brief Compute the per-chunk occupancy of the given rank channel.
+		/// 
+		/// \param rank_channel The rank channel to compute the occupancy for, will be fully decompressed once.
+		inline rank_occupancy compute_rank_occupancy(const compressed::channel<float32_t>& rank_channel)
+		{
+			rank_occupancy result;
+			result.chunks.resize(rank_channel.num_chunks());
+
+			compressed::util::default_init_vector<float32_t> rank_chunk(rank_channel.chunk_size() / sizeof(float32_t));
+			for (size_t chunk_idx = 0; chunk_idx < rank_channel.num_chunks(); ++chunk_idx)
+			{
+				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
+				auto rank_span = std::span<float32_t>(rank_chunk.data(), chunk_num_elems);
+				rank_channel.get_chunk(rank_span, chunk_idx);
+
+				result.chunks[chunk_idx] = static_cast<uint8_t>(rank_chunk_occupied(rank_span));
+				result.occupied |= result.chunks[chunk_idx] != 0;
+			}
+			return result;
+		}
+
+
+		/// \brief Compute the per-chunk occupancy of the given rank channel from its uncompressed data.
+		/// 
+		/// \param rank_data    The uncompressed rank channel, must be the same size as `rank_channel`.
+		/// \param rank_channel The compressed rank channel, only used for its chunk layout.
+		inline rank_occupancy compute_rank_occupancy(
+			std::span<const float32_t> rank_data,
+			const compressed::channel<float32_t>& rank_channel
+		)
+		{
+			rank_occupancy result;
+			result.chunks.resize(rank_channel.num_chunks());
+
+			size_t offset = 0;
+			for (size_t chunk_idx = 0; chunk_idx < rank_channel.num_chunks(); ++chunk_idx)
+			{
+				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
+				result.chunks[chunk_idx] = static_cast<uint8_t>(rank_chunk_occupied(rank_data.subspan(offset, chunk_num_elems)));
+				result.occupied |= result.chunks[chunk_idx] != 0;
+				offset += chunk_num_elems;
+			}
+			return result;
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -1,22 +1,37 @@
 //
-// Basic instrumentation profiler by Cherno to be used for chrome://tracing
+// Basic instrumentation profiler based on the one by Cherno to be used for chrome://tracing or https://ui.perfetto.dev
 
 // Usage: include this header file somewhere in your code (eg. precompiled header), and then use like:
 //
-// Instrumentor::Get().BeginSession("Session Name");        // Begin session 
+// Instrumentor::Get().BeginSession("Session Name");        // Begin session
 // {
 //     _CRYPTOMATTE_PROFILE_FUNCTION();   // Place code like this in scopes you'd like to include in profiling
 //     // Code
 // }
 // Instrumentor::Get().EndSession();                        // End Session
+//
+// Recording a profile does not take any locks or perform any I/O: every thread records into its own fixed-size ring
+// buffer which are only collected and written out once the session ends. If a thread records more profiles than
+// fit into its buffer the oldest ones are overwritten (and counted as dropped). Sessions may additionally only be
+// recorded for a fraction of the runs via the `sample_rate` passed to `BeginSession`, unrecorded sessions only cost
+// a single atomic load per profiled scope.
+//
+// The buffer of a thread is released once the thread exits and its profiles have been written out, it is then
+// handed to the next thread that starts recording so short-lived threads do not accumulate buffers.
 #pragma once
 
 #include "cryptomatte/detail/macros.h"
 
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <algorithm>
 #include <fstream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <random>
+#include <cstdint>
 
 #include <mutex>
 #include <thread>
@@ -48,78 +63,189 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
         struct ProfileResult
         {
-            std::string Name;
-            long long Start, End;
-            uint32_t ThreadID;
+            /// The name of the profiled scope, this must be a string literal (or otherwise have static storage
+            /// duration) as it is only read once the session ends.
+            const char* Name;
+            /// The start and end of the scope in nanoseconds of the steady clock.
+            int64_t Start, End;
         };
 
         struct InstrumentationSession
         {
             std::string Name;
+            std::string Filepath;
+            /// The start of the session in nanoseconds of the steady clock, all timestamps are written relative to this.
+            int64_t Start;
+        };
+
+        /// The output format of the profiles.
+        enum class TraceFormat
+        {
+            /// The chrome trace event json format, this is understood by chrome://tracing as well as by Perfetto
+            /// (https://ui.perfetto.dev) and Speedscope.
+            ChromeJson,
+            /// The bare json array variant of the same format with one event per line which is easier to diff and
+            /// grep, this is also accepted by chrome://tracing and Perfetto.
+            ChromeJsonArray,
+        };
+
+        /// A single-producer ring buffer holding the profiles of a single thread.
+        struct ThreadProfileBuffer
+        {
+            explicit ThreadProfileBuffer(uint32_t thread_id)
+                : ThreadID(thread_id)
+            {
+            }
+
+            /// Record a profile, this is only ever called from the owning thread.
+            void Push(const ProfileResult& result) noexcept
+            {
+                const uint64_t count = Count.load(std::memory_order_relaxed);
+                Results[count % Results.size()] = result;
+                Count.store(count + 1, std::memory_order_release);
+            }
+
+            std::vector<ProfileResult> Results;
+            /// The total number of profiles pushed during the current session, may exceed `Results.size()`.
+            std::atomic<uint64_t> Count{ 0 };
+            /// Set while the owning thread is recording a profile, the session waits for this to be cleared before
+            /// reading the buffer.
+            std::atomic<bool> Busy{ false };
+            /// Set once the owning thread has exited, the buffer may be reused after its profiles were written.
+            std::atomic<bool> Released{ false };
+            uint32_t ThreadID;
+        };
+
+        /// Owns the buffer of a single thread, marking it as released once the thread exits.
+        struct ThreadProfileBufferOwner
+        {
+            std::shared_ptr<ThreadProfileBuffer> Buffer;
+
+            ~ThreadProfileBufferOwner()
+            {
+                if (Buffer)
+                {
+                    Buffer->Released.store(true, std::memory_order_release);
+                }
+            }
         };
 
         class Instrumentor
         {
         private:
-            InstrumentationSession* m_CurrentSession;
-            std::ofstream m_OutputStream;
-            int m_ProfileCount;
+            std::unique_ptr<InstrumentationSession> m_CurrentSession;
+            std::atomic<bool> m_Active{ false };
+            /// Incremented on every recorded session, profiles are only recorded into the session they started in.
+            std::atomic<uint64_t> m_Generation{ 0 };
+            TraceFormat m_Format = TraceFormat::ChromeJson;
+            size_t m_BufferCapacity = 1 << 16;
+            std::mt19937_64 m_Random{ std::random_device{}() };
+
+            /// Guards the registration of the thread buffers as well as the beginning and end of sessions, this is
+            /// never taken while recording profiles (apart from the first profile of every thread).
             std::mutex m_lock;
+            /// The buffers of all threads that are alive or whose profiles have not been written yet.
+            std::vector<std::shared_ptr<ThreadProfileBuffer>> m_Buffers;
+            /// The buffers of exited threads which were written out and may be handed to new threads.
+            std::vector<std::shared_ptr<ThreadProfileBuffer>> m_FreeBuffers;
+            uint32_t m_NextThreadID = 0;
         public:
-            Instrumentor()
-                : m_CurrentSession(nullptr), m_ProfileCount(0)
-            {
-            }
+            Instrumentor() = default;
 
-            void BeginSession(const std::string& name, const std::string& filepath = "results.json")
+            /// Begin a profiling session which is written to `filepath` once ended.
+            ///
+            /// \param name        The name of the session.
+            /// \param filepath    The file to write the profiles to.
+            /// \param sample_rate The probability in [0, 1] of this session being recorded at all, this allows
+            ///                    leaving the profiling enabled while only recording a fraction of the runs.
+            ///                    Sessions which are not recorded do not write any file.
+            void BeginSession(const std::string& name, const std::string& filepath = "results.json", double sample_rate = 1.0)
             {
-                m_OutputStream.open(filepath);
-                WriteHeader();
-                m_CurrentSession = new InstrumentationSession{ name };
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_CurrentSession)
+                {
+                    EndSessionLocked();
+                }
+
+                if (sample_rate < 1.0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_Random) >= sample_rate)
+                {
+                    return;
+                }
+
+                // No thread is recording at this point, so the buffers may be reset.
+                ReleaseBuffersLocked();
+                for (auto& buffer : m_Buffers)
+                {
+                    buffer->Results.resize(m_BufferCapacity);
+                    buffer->Count.store(0, std::memory_order_relaxed);
+                }
+                m_CurrentSession = std::make_unique<InstrumentationSession>(InstrumentationSession{ name, filepath, Now() });
+                m_Generation.fetch_add(1, std::memory_order_seq_cst);
+                m_Active.store(true, std::memory_order_seq_cst);
             }
 
+            /// End the current session (if any), writing all the recorded profiles to disk.
             void EndSession()
             {
-                WriteFooter();
-                m_OutputStream.close();
-                delete m_CurrentSession;
-                m_CurrentSession = nullptr;
-                m_ProfileCount = 0;
+                std::lock_guard<std::mutex> lock(m_lock);
+                EndSessionLocked();
             }
 
-            void WriteProfile(const ProfileResult& result)
+            /// Set the output format of the following sessions.
+            void SetFormat(TraceFormat format)
             {
                 std::lock_guard<std::mutex> lock(m_lock);
+                m_Format = format;
+            }
 
-                if (m_ProfileCount++ > 0)
-                    m_OutputStream << ",";
+            /// Set the number of profiles every thread holds per session, this takes effect on the next session.
+            void SetBufferCapacity(size_t capacity)
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_BufferCapacity = std::max<size_t>(capacity, 1);
+            }
 
-                std::string name = result.Name;
-                std::replace(name.begin(), name.end(), '"', '\'');
+            /// Whether a session is currently being recorded.
+            bool IsActive() const noexcept
+            {
+                return m_Active.load(std::memory_order_relaxed);
+            }
 
-                m_OutputStream << "{";
-                m_OutputStream << "\"cat\":\"function\",";
-                m_OutputStream << "\"dur\":" << (result.End - result.Start) << ',';
-                m_OutputStream << "\"name\":\"" << name << "\",";
-                m_OutputStream << "\"ph\":\"X\",";
-                m_OutputStream << "\"pid\":0,";
-                m_OutputStream << "\"tid\":" << result.ThreadID << ",";
-                m_OutputStream << "\"ts\":" << result.Start;
-                m_OutputStream << "}";
+            /// The generation of the most recently begun session, pass this to `WriteProfile` along with profiles
+            /// started while `IsActive()`. This must be read before `IsActive()`.
+            uint64_t Generation() const noexcept
+            {
+                return m_Generation.load(std::memory_order_seq_cst);
+            }
 
-                m_OutputStream.flush();
+            /// The number of thread buffers currently allocated, either in use or waiting to be reused.
+            size_t NumThreadBuffers()
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                return m_Buffers.size() + m_FreeBuffers.size();
             }
 
-            void WriteHeader()
+            /// Record a profile started during the session of the given `generation`, profiles of a different
+            /// session than the current one are discarded.
+            void WriteProfile(const ProfileResult& result, uint64_t generation)
             {
-                m_OutputStream << "{\"otherData\": {},\"traceEvents\":[";
-                m_OutputStream.flush();
+                auto& buffer = GetThreadBuffer();
+                // The busy flag and the active flag form a handshake with `EndSessionLocked`: either we observe
+                // the session as ended and skip recording, or the session observes us as busy and waits for the
+                // push to finish before reading the buffer.
+                buffer.Busy.store(true, std::memory_order_seq_cst);
+                if (m_Active.load(std::memory_order_seq_cst) && m_Generation.load(std::memory_order_seq_cst) == generation)
+                {
+                    buffer.Push(result);
+                }
+                buffer.Busy.store(false, std::memory_order_release);
             }
 
-            void WriteFooter()
+            static int64_t Now() noexcept
             {
-                m_OutputStream << "]}";
-                m_OutputStream.flush();
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()
+                ).count();
             }
 
             static Instrumentor& Get()
@@ -127,15 +253,159 @@ namespace NAMESPACE_CRYPTOMATTE_API
                 static Instrumentor instance;
                 return instance;
             }
+
+        private:
+            /// Retrieve the buffer of the calling thread, registering it on first use. As the buffer is thread_local
+            /// this assumes the instrumentor is only used through `Get()`.
+            ThreadProfileBuffer& GetThreadBuffer()
+            {
+                // The buffer is shared with the instrumentor so the profiles of threads that exited before the end
+                // of the session are retained.
+                thread_local ThreadProfileBufferOwner t_owner{ AcquireBuffer() };
+                return *t_owner.Buffer;
+            }
+
+            /// Hand out a buffer for a new thread, reusing the buffer of an exited thread if possible.
+            std::shared_ptr<ThreadProfileBuffer> AcquireBuffer()
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                ReleaseBuffersLocked();
+
+                std::shared_ptr<ThreadProfileBuffer> buffer;
+                if (!m_FreeBuffers.empty())
+                {
+                    buffer = std::move(m_FreeBuffers.back());
+                    m_FreeBuffers.pop_back();
+                    buffer->Count.store(0, std::memory_order_relaxed);
+                    buffer->Released.store(false, std::memory_order_relaxed);
+                }
+                else
+                {
+                    buffer = std::make_shared<ThreadProfileBuffer>(m_NextThreadID++);
+                }
+                buffer->Results.resize(m_BufferCapacity);
+                m_Buffers.push_back(buffer);
+                return buffer;
+            }
+
+            /// Move the buffers of exited threads which hold no unwritten profiles to the free list, must hold
+            /// `m_lock`. While no session is active all profiles have been written (or discarded) already.
+            void ReleaseBuffersLocked()
+            {
+                const bool active = m_CurrentSession != nullptr;
+                std::erase_if(m_Buffers, [&](std::shared_ptr<ThreadProfileBuffer>& buffer)
+                    {
+                        if (!buffer->Released.load(std::memory_order_acquire))
+                        {
+                            return false;
+                        }
+                        if (active && buffer->Count.load(std::memory_order_acquire) != 0)
+                        {
+                            return false;
+                        }
+                        m_FreeBuffers.push_back(std::move(buffer));
+                        return true;
+                    });
+            }
+
+            void EndSessionLocked()
+            {
+                if (!m_CurrentSession)
+                {
+                    return;
+                }
+                m_Active.store(false, std::memory_order_seq_cst);
+                for (const auto& buffer : m_Buffers)
+                {
+                    while (buffer->Busy.load(std::memory_order_acquire))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+
+                WriteSession();
+                m_CurrentSession.reset();
+                ReleaseBuffersLocked();
+            }
+
+            static void WriteEscaped(std::ofstream& stream, std::string_view str)
+            {
+                for (char c : str)
+                {
+                    if (c == '"' || c == '\\')
+                    {
+                        stream << '\\';
+                    }
+                    stream << c;
+                }
+            }
+
+            void WriteSession()
+            {
+                std::ofstream stream(m_CurrentSession->Filepath);
+                const bool as_object = m_Format == TraceFormat::ChromeJson;
+                const char* separator = as_object ? "," : ",\n";
+
+                uint64_t dropped = 0;
+                stream << (as_object ? "{\"traceEvents\":[" : "[\n");
+
+                // Metadata events naming the process and threads so they are labelled in the trace viewers.
+                stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"";
+                WriteEscaped(stream, m_CurrentSession->Name);
+                stream << "\"}}";
+                for (const auto& buffer : m_Buffers)
+                {
+                    const uint64_t count = buffer->Count.load(std::memory_order_acquire);
+                    if (count == 0)
+                    {
+                        continue;
+                    }
+                    stream << separator;
+                    stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->ThreadID;
+                    stream << ",\"args\":{\"name\":\"thread " << buffer->ThreadID << "\"}}";
+
+                    // If the ring buffer wrapped around only the most recent profiles are retained.
+                    const uint64_t capacity = buffer->Results.size();
+                    const uint64_t begin = count > capacity ? count - capacity : 0;
+                    dropped += begin;
+                    for (uint64_t i = begin; i < count; ++i)
+                    {
+                        const auto& result = buffer->Results[i % capacity];
+                        stream << separator;
+                        stream << "{\"cat\":\"function\",";
+                        stream << "\"dur\":" << static_cast<double>(result.End - result.Start) / 1000.0 << ',';
+                        stream << "\"name\":\"";
+                        WriteEscaped(stream, result.Name);
+                        stream << "\",";
+                        stream << "\"ph\":\"X\",";
+                        stream << "\"pid\":0,";
+                        stream << "\"tid\":" << buffer->ThreadID << ",";
+                        stream << "\"ts\":" << static_cast<double>(result.Start - m_CurrentSession->Start) / 1000.0;
+                        stream << "}";
+                    }
+                }
+
+                if (as_object)
+                {
+                    stream << "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":" << dropped << "}}";
+                }
+                else
+                {
+                    stream << "\n]\n";
+                }
+            }
         };
 
         class InstrumentationTimer
         {
         public:
             InstrumentationTimer(const char* name)
-                : m_Name(name), m_Stopped(false)
+                : m_Name(name), m_Generation(Instrumentor::Get().Generation()), m_Stopped(!Instrumentor::Get().IsActive())
             {
-                m_StartTimepoint = std::chrono::high_resolution_clock::now();
+                if (!m_Stopped)
+                {
+                    m_Start = Instrumentor::Now();
+                }
             }
 
             ~InstrumentationTimer()
@@ -146,19 +416,14 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
             void Stop()
             {
-                auto endTimepoint = std::chrono::high_resolution_clock::now();
-
-                long long start = std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTimepoint).time_since_epoch().count();
-                long long end = std::chrono::time_point_cast<std::chrono::microseconds>(endTimepoint).time_since_epoch().count();
-
-                uint32_t threadID = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
-                Instrumentor::Get().WriteProfile({ m_Name, start, end, threadID });
-
+                Instrumentor::Get().WriteProfile({ m_Name, m_Start, Instrumentor::Now() }, m_Generation);
                 m_Stopped = true;
             }
         private:
-            const std::string m_Name{};
-            std::chrono::time_point<std::chrono::high_resolution_clock> m_StartTimepoint;
+            const char* m_Name = nullptr;
+            /// The session the timer was started in, see `Instrumentor::Generation`.
+            uint64_t m_Generation = 0;
+            int64_t m_Start = 0;
             bool m_Stopped = false;
         };
 
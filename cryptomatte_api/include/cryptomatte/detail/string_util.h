@@ -119,6 +119,59 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		}
 
 
+		/// Checks whether the string `s` matches the glob `pattern` where '*' matches any (possibly empty) sequence of
+		/// characters, including '/', and '?' matches exactly one character. All other characters match literally.
+		/// 
+		/// This runs in O(len(s) * len(pattern)) worst case but only backtracks to the last '*' so typical patterns
+		/// are matched in linear time.
+		inline bool glob_match(std::string_view s, std::string_view pattern) noexcept
+		{
+			size_t s_pos = 0;
+			size_t p_pos = 0;
+			// The position of the last '*' in the pattern and the position in `s` it is currently matched up to.
+			size_t star_pos = std::string_view::npos;
+			size_t star_match = 0;
+
+			while (s_pos < s.size())
+			{
+				// A '*' is always a wildcard, even where `s` holds a literal '*'.
+				if (p_pos < pattern.size() && pattern[p_pos] == '*')
+				{
+					star_pos = p_pos++;
+					star_match = s_pos;
+				}
+				else if (p_pos < pattern.size() && (pattern[p_pos] == '?' || pattern[p_pos] == s[s_pos]))
+				{
+					++s_pos;
+					++p_pos;
+				}
+				else if (star_pos != std::string_view::npos)
+				{
+					// Let the last '*' consume one more character and retry from there.
+					p_pos = star_pos + 1;
+					s_pos = ++star_match;
+				}
+				else
+				{
+					return false;
+				}
+			}
+
+			// Any trailing '*' match the empty remainder.
+			while (p_pos < pattern.size() && pattern[p_pos] == '*')
+			{
+				++p_pos;
+			}
+			return p_pos == pattern.size();
+		}
+
+		/// Retrieve the literal prefix of the glob `pattern`, i.e. everything up to the first '*' or '?'. Any string 
+		/// matching the pattern must start with this prefix.
+		inline std::string_view glob_literal_prefix(std::string_view pattern) noexcept
+		{
+			return pattern.substr(0, std::min(pattern.find_first_of("*?"), pattern.size()));
+		}
+
 	} // str
 
 } // NAMESPACE_CRYPTOMATTE_API
\ No newline at end of file
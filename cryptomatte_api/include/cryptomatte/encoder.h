@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <optional>
+
+#include "detail/macros.h"
+
+#include "cryptomatte.h"
+#include "manifest.h"
+#include "options.h"
+#include "executor.h"
+
+#include <compressed/enums.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief A single (id, coverage) sample contributing to a pixel of a cryptomatte.
+	struct sample
+	{
+		/// The id of the object, this must already be converted into its float32 compatible form (as stored on
+		/// the manifest). Samples with an id of 0 are treated as empty and ignored.
+		uint32_t hash = 0;
+		/// The coverage of the object in this pixel.
+		float32_t coverage = 0.0f;
+	};
+
+
+	/// \brief Options for controlling how a cryptomatte is encoded via `encode`.
+	struct encode_options
+	{
+		/// The name (or typename) of the cryptomatte, this determines the channel names, e.g. 'CryptoObject00.r'.
+		std::string name = "CryptoObject";
+
+		/// The number of rank-coverage pairs to encode, any pixel covered by more ids than this only keeps the ids
+		/// with the highest coverage. An odd number of levels only writes the red and green channels of the
+		/// last set.
+		size_t num_levels = 6;
+
+		/// The manifest to store on the metadata, if this is not set the cryptomatte will not have a manifest.
+		std::optional<NAMESPACE_CRYPTOMATTE_API::manifest> manifest = std::nullopt;
+
+		/// The precision to store the coverage channels at in-memory. Writing the cryptomatte always stores
+		/// them at full precision.
+		coverage_precision coverage = coverage_precision::float32;
+
+		/// The codec and compression level to compress the encoded channels with.
+		compressed::enums::codec codec = compressed::enums::codec::lz4;
+		uint8_t compression_level = 9;
+
+		/// The executor to encode on (and to set on the resulting cryptomatte), if this is a nullptr the default
+		/// executor is used.
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec = nullptr;
+	};
+
+
+	/// \brief Encode a cryptomatte from per-pixel sample lists.
+	///
+	/// The samples of each pixel are merged by their id (summing their coverage) after which the ids with the
+	/// highest coverage are ranked into the levels of the cryptomatte, highest coverage first. The pixels are
+	/// encoded in parallel, one chunk of scanlines at a time, compressing straight into the rank and coverage
+	/// channels so the uncompressed channels are never held in memory all at once.
+	///
+	/// \code{.cpp}
+	/// // Pixel 0 is covered by two objects, pixel 1 by one and pixel 2 by none.
+	/// std::vector<cmatte::sample> samples = { { 0x13851a76, 0.75f }, { 0x42c9679f, 0.25f }, { 0x42c9679f, 1.0f } };
+	/// std::vector<size_t> offsets = { 0, 2, 3, 3 };
+	/// auto matte = cmatte::encode(samples, offsets, 3, 1);
+	/// matte.write("out.exr");
+	/// \endcode
+	///
+	/// \param samples The samples of all pixels, stored contiguously per pixel in scanline order.
+	/// \param offsets The offsets into `samples` where the samples of each pixel start, the samples of pixel `i`
+	///				   are `samples[offsets[i]]` to `samples[offsets[i + 1]]`. This must hold `width * height + 1`
+	///				   non-decreasing values with the last being at most `samples.size()`.
+	/// \param width   The width of the cryptomatte.
+	/// \param height  The height of the cryptomatte.
+	/// \param options The options controlling the encoding, see `encode_options`.
+	///
+	/// \throws std::invalid_argument if the dimensions are zero, `options.num_levels` is zero or the offsets are
+	///								  not valid.
+	///
+	/// \returns The encoded cryptomatte.
+	cryptomatte encode(
+		std::span<const sample> samples,
+		std::span<const size_t> offsets,
+		size_t width,
+		size_t height,
+		const encode_options& options = {}
+	);
+
+	/// \brief Encode a cryptomatte from per-object coverage masks.
+	///
+	/// This is equivalent to the sample-based `encode` where every pixel holds one sample per mask that is
+	/// non-zero in that pixel.
+	///
+	/// \param masks   The ids paired with their coverage masks, each mask must hold `width * height` values.
+	/// \param width   The width of the cryptomatte.
+	/// \param height  The height of the cryptomatte.
+	/// \param options The options controlling the encoding, see `encode_options`.
+	///
+	/// \throws std::invalid_argument if the dimensions are zero, `options.num_levels` is zero or any of the masks
+	///								  does not hold `width * height` values.
+	///
+	/// \returns The encoded cryptomatte.
+	cryptomatte encode(
+		const std::vector<std::pair<uint32_t, std::span<const float32_t>>>& masks,
+		size_t width,
+		size_t height,
+		const encode_options& options = {}
+	);
+
+	/// \brief Encode a cryptomatte from per-object coverage masks keyed by the names of the objects.
+	///
+	/// The names are hashed with 'MurmurHash3_32' and the 'uint32_to_float32' conversion (see `hash_name`) and
+	/// the manifest is built from these, replacing any `options.manifest`. Masks sharing a name are summed.
+	///
+	/// \code{.cpp}
+	/// std::vector<float32_t> bunny = { 0.75f, 1.0f, 0.0f };
+	/// std::vector<float32_t> teapot = { 0.25f, 0.0f, 0.0f };
+	/// auto matte = cmatte::encode({ { "bunny", bunny }, { "teapot", teapot } }, 3, 1);
+	/// auto mask = matte.mask("bunny");
+	/// \endcode
+	///
+	/// \param masks   The names of the objects paired with their coverage masks, each mask must hold 
+	///				   `width * height` values.
+	/// \param width   The width of the cryptomatte.
+	/// \param height  The height of the cryptomatte.
+	/// \param options The options controlling the encoding, see `encode_options`.
+	///
+	/// \throws std::invalid_argument if the dimensions are zero, `options.num_levels` is zero or any of the masks
+	///								  does not hold `width * height` values.
+	///
+	/// \returns The encoded cryptomatte.
+	cryptomatte encode(
+		const std::vector<std::pair<std::string, std::span<const float32_t>>>& masks,
+		size_t width,
+		size_t height,
+		const encode_options& options = {}
+	);
+
+} // NAMESPACE_CRYPTOMATTE_API
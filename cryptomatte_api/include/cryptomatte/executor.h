@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "detail/macros.h"
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief Interface for the executor that runs all of the parallel work of the cryptomatte-api.
+	///
+	/// By default all work gets dispatched via the standard parallel algorithms (`std::execution::par`) which on
+	/// most platforms maps to a global thread pool sized to the number of hardware threads. This is not always
+	/// desirable, e.g. when running multiple jobs on a host with cgroup CPU quotas or when integrating into an
+	/// application that already owns a thread pool. In that case you can provide your own executor, either
+	/// globally via `set_default_executor` or per-cryptomatte via `cryptomatte::set_executor`.
+	///
+	/// Wrapping a TBB task_arena for example could look as follows:
+	///
+	/// \code{.cpp}
+	/// struct arena_executor : cmatte::executor
+	/// {
+	///		tbb::task_arena arena{ 4 };
+	///
+	///		void parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) override
+	///		{
+	///			arena.execute([&]()
+	///				{
+	///					tbb::parallel_for(tbb::blocked_range<size_t>(0, count, grain_size), [&](const auto& range)
+	///						{
+	///							func(range.begin(), range.end());
+	///						});
+	///				});
+	///		}
+	///
+	///		size_t concurrency() const noexcept override { return arena.max_concurrency(); }
+	/// };
+	/// \endcode
+	struct executor
+	{
+		virtual ~executor() = default;
+
+		/// \brief Invoke `func` over disjoint subranges [begin, end) which together cover [0, count), blocking until
+		/// all of them have completed.
+		///
+		/// Implementations are free to choose how to split up the range but should not produce ranges smaller
+		/// than `grain_size` (other than the last one). `func` may be invoked concurrently from multiple threads
+		/// and may itself call `parallel_for` again (nested parallelism) so implementations must not deadlock in
+		/// that case. If any of the invocations throws, the exception must be propagated to the caller.
+		///
+		/// \param count      The number of items to iterate.
+		/// \param grain_size The minimum number of items per invocation of `func`.
+		/// \param func       The function to invoke with the begin and end index of each subrange.
+		virtual void parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) = 0;
+
+		/// \brief The maximum number of threads this executor will run work on concurrently.
+		///
+		/// This is used to size the per-thread working sets (e.g. when accumulating ids) so should reflect the
+		/// actual available parallelism rather than the number of hardware threads.
+		virtual size_t concurrency() const noexcept = 0;
+	};
+
+
+	/// \brief The default executor dispatching through the standard parallel algorithms (`std::execution::par`).
+	struct std_executor : public executor
+	{
+		void parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) override;
+		size_t concurrency() const noexcept override;
+	};
+
+
+	/// \brief An executor running all work serially on the calling thread.
+	struct sequential_executor : public executor
+	{
+		void parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) override;
+		size_t concurrency() const noexcept override;
+	};
+
+
+	/// \brief An executor backed by a fixed-size thread pool owned by the executor.
+	///
+	/// The thread calling `parallel_for` participates in the work, so a pool of `num_threads` will spawn
+	/// `num_threads - 1` worker threads. This also means nested calls to `parallel_for` can never deadlock as
+	/// the calling thread will work through the range itself if all workers are busy.
+	struct thread_pool_executor : public executor
+	{
+		/// \brief Construct the thread pool with the given number of threads.
+		///
+		/// \param num_threads The total number of threads to run work on (including the calling thread).
+		///					   Must be at least 1.
+		///
+		/// \throws std::invalid_argument if `num_threads` is 0.
+		explicit thread_pool_executor(size_t num_threads);
+		~thread_pool_executor() override;
+
+		thread_pool_executor(const thread_pool_executor&) = delete;
+		thread_pool_executor& operator=(const thread_pool_executor&) = delete;
+
+		void parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) override;
+		size_t concurrency() const noexcept override;
+
+	private:
+		struct job;
+
+		size_t m_NumThreads = 1;
+		std::vector<std::thread> m_Workers;
+		std::deque<std::shared_ptr<job>> m_Jobs;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Stop = false;
+
+		void worker_loop();
+	};
+
+
+	/// \brief Set the executor used by all cryptomattes that were not given an explicit executor.
+	///
+	/// \param exec The executor to use, passing a nullptr resets to the `std_executor`.
+	void set_default_executor(std::shared_ptr<executor> exec);
+
+	/// \brief Retrieve the executor used by all cryptomattes that were not given an explicit executor.
+	///
+	/// If no executor has previously been set via `set_default_executor` this returns a `std_executor`.
+	std::shared_ptr<executor> get_default_executor();
+
+
+	namespace detail
+	{
+
+		/// \brief Resolve the given (optional) executor, falling back to the default executor if it is a nullptr.
+		inline std::shared_ptr<executor> resolve_executor(const std::shared_ptr<executor>& exec)
+		{
+			if (exec)
+			{
+				return exec;
+			}
+			return get_default_executor();
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "detail/macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief Compute the cryptomatte id of a name as it would be stored on the manifest and in the rank channels.
+	/// 
+	/// This is the 'MurmurHash3_32' hash of the name (with a seed of 0) followed by the 'uint32_to_float32' 
+	/// conversion of the specification which ensures that the id is never a denormal, infinity or NaN when 
+	/// interpreted as a float32.
+	/// 
+	/// \param name The name of the object, e.g. 'bunny' which hashes to 0x13851a76.
+	/// 
+	/// \returns The float32 compatible id of the name.
+	uint32_t hash_name(std::string_view name) noexcept;
+
+	/// \brief Compute the cryptomatte ids of many names at once.
+	/// 
+	/// Equivalent to calling `hash_name` on each of the names but hashes multiple names in lockstep which is 
+	/// considerably faster when validating or generating large manifests.
+	/// 
+	/// \param names The names to hash.
+	/// 
+	/// \returns The float32 compatible ids in the same order as `names`.
+	std::vector<uint32_t> hash_names(const std::vector<std::string>& names);
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "detail/macros.h"
+
+#include <compressed/channel.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief The dominant (highest coverage) id of every pixel along with its coverage, see `cryptomatte::id_map`.
+	/// 
+	/// Both buffers are stored in scanline order and hold `width * height` elements. Pixels without any id hold
+	/// an id and coverage of 0.
+	struct id_map
+	{
+		/// The dominant id of every pixel as uint32_t hash, these can be mapped to names via `manifest::name`.
+		std::vector<uint32_t> ids;
+		/// The coverage of the dominant id of every pixel.
+		std::vector<float32_t> coverage;
+	};
+
+	/// \brief The compressed version of `id_map`, see `cryptomatte::id_map_compressed`.
+	struct id_map_compressed
+	{
+		/// The dominant id of every pixel as uint32_t hash, these can be mapped to names via `manifest::name`.
+		compressed::channel<uint32_t> ids;
+		/// The coverage of the dominant id of every pixel.
+		compressed::channel<float32_t> coverage;
+	};
+
+	/// \brief A single id present on a pixel, see `cryptomatte::ids_at`.
+	struct pixel_id
+	{
+		/// The id as uint32_t hash.
+		uint32_t hash = 0;
+		/// The name of the id on the manifest, or the hash in hex form if it is not on the manifest (or there is
+		/// no manifest).
+		std::string name;
+		/// The coverage of the id on the pixel.
+		float32_t coverage = 0.0f;
+	};
+
+} // NAMESPACE_CRYPTOMATTE_API
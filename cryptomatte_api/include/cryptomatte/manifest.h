@@ -10,6 +10,9 @@
 #include <vector>
 #include <bit>
 #include <variant>
+#include <span>
+#include <string_view>
+#include <functional>
 
 #include "detail/macros.h"
 #include "detail/json_alias.h"
@@ -30,6 +33,12 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \param json The json to load from.
 		explicit manifest(json_ordered json);
 
+		/// Construct a manifest from an already decoded mapping of names to their hashes.
+		/// 
+		/// \param mapping The name-hash pairs, the hashes must already be converted into their float32 compatible
+		///				   form (as they appear in the rank channels).
+		explicit manifest(std::vector<std::pair<std::string, uint32_t>> mapping);
+
 		/// Load and decode a manifest from a json string (this would be the cryptomatte/<hash>/manifest or 
 		/// cryptomatte/<hash>/manif_file).
 		/// 
@@ -61,7 +70,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		/// \param name The name to check for existence within the manifest.
 		/// 
 		/// \return True if the name exists in the manifest, false otherwise.
-		bool contains(std::string_view name);
+		bool contains(std::string_view name) const;
 
 		/// \{
 		/// \name retrieving the mapping
@@ -154,22 +163,19 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			requires std::is_same_v<T, float32_t> || std::is_same_v<T, std::string> || std::is_same_v<T, uint32_t>
 		T hash(std::string_view name) const
 		{
-			for (const auto& [key, value] : m_Mapping)
+			if (const auto* item = this->find(name))
 			{
-				if (key == name)
+				if constexpr (std::is_same_v<T, uint32_t>)
 				{
-					if constexpr (std::is_same_v<T, uint32_t>)
-					{
-						return value;
-					}
-					else if constexpr (std::is_same_v<T, float32_t>)
-					{
-						return std::bit_cast<float32_t>(value);
-					}
-					else
-					{
-						return std::format("{:08x}", value);
-					}
+					return item->second;
+				}
+				else if constexpr (std::is_same_v<T, float32_t>)
+				{
+					return std::bit_cast<float32_t>(item->second);
+				}
+				else
+				{
+					return std::format("{:08x}", item->second);
 				}
 			}
 
@@ -182,15 +188,87 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 		/// @}
 
+		/// \{
+		/// \name querying the manifest
+		/// 
+		/// These are backed by indices built on construction so they remain fast on large (e.g. crowd) manifests 
+		/// and do not copy any of the names.
+
+		/// \brief Get the name associated with the given hash.
+		/// 
+		/// \param hash The hash to look up, as stored in the rank channels.
+		/// 
+		/// \returns The name if the hash is on the manifest, the view remains valid for the lifetime of the manifest.
+		std::optional<std::string_view> name(uint32_t hash) const noexcept;
+
+		/// \brief Get the hashes of all names starting with `prefix`, e.g. '/crowd/char_01/' to select a hierarchy.
+		/// 
+		/// \param prefix The prefix to match, an empty prefix matches all names.
+		/// 
+		/// \returns The matching hashes ordered by their names.
+		std::vector<uint32_t> hashes_with_prefix(std::string_view prefix) const;
+
+		/// \brief Get the hashes of all names matching the glob `pattern`, e.g. '*/char_*/body*'.
+		/// 
+		/// '*' matches any (possibly empty) sequence of characters, including '/', while '?' matches exactly one
+		/// character. The literal prefix of the pattern (up to the first wildcard) is resolved through the name 
+		/// index so only the names sharing it are matched against the full pattern.
+		/// 
+		/// \param pattern The glob pattern to match.
+		/// 
+		/// \returns The matching hashes ordered by their names.
+		std::vector<uint32_t> hashes_matching(std::string_view pattern) const;
+
+		/// \brief Get all names matching the glob `pattern`, see `hashes_matching` for the supported syntax.
+		/// 
+		/// \param pattern The glob pattern to match.
+		/// 
+		/// \returns The matching names in sorted order, these remain valid for the lifetime of the manifest.
+		std::vector<std::string_view> names_matching(std::string_view pattern) const;
+
+		/// \}
+
+		/// \brief Serialize the manifest into a json object as it would be embedded in the file, 
+		/// e.g. {"bunny":"13851a76", "default" : "42c9679f"}.
+		json_ordered to_json() const;
+
 		/// \brief Get the size of the manifest, i.e. how many items are in the mapping.
 		size_t size() const noexcept;
 
+		/// \brief Verify the hashes of the manifest against its names.
+		/// 
+		/// Recomputes the 'MurmurHash3_32' id (with the 'uint32_to_float32' conversion) of every name and compares
+		/// it to the stored hash. The names are hashed in batches so this is suitable for large manifests.
+		/// 
+		/// \returns The names whose stored hash does not match their computed hash, in manifest order. An empty
+		///			 vector means the manifest is consistent.
+		std::vector<std::string> verify() const;
+
 	private:
 		// The mapping of names into their respective hashes. On-disk these would be stored as e.g.
 		// {"bunny":"13851a76", "default" : "42c9679f"}
 		// We store these already decoded into uint32_t and provide the mapping() and hash() functions to 
 		// allow us to convert it into what is needed at runtime.
 		std::vector<std::pair<std::string, uint32_t>> m_Mapping;
+
+		/// Indices into `m_Mapping` sorted by name, ties are kept in manifest order. This allows for logarithmic
+		/// name lookups as well as resolving prefixes to a contiguous range of names.
+		std::vector<uint32_t> m_NameIndex;
+
+		/// Indices into `m_Mapping` sorted by hash for the reverse lookup of names.
+		std::vector<uint32_t> m_HashIndex;
+
+		/// Build `m_NameIndex` and `m_HashIndex` from `m_Mapping`.
+		void build_index();
+
+		/// Find the first item with the given name, returning a nullptr if it does not exist.
+		const std::pair<std::string, uint32_t>* find(std::string_view name) const noexcept;
+
+		/// Get the range of `m_NameIndex` whose names start with `prefix`.
+		std::span<const uint32_t> prefix_range(std::string_view prefix) const noexcept;
+
+		/// Invoke `fn` with the index into `m_Mapping` of every name matching the glob `pattern` in sorted order.
+		void for_each_match(std::string_view pattern, const std::function<void(size_t idx)>& fn) const;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <deque>
+#include <utility>
+#include <optional>
+#include <unordered_map>
+
+#include "detail/macros.h"
+
+#include "options.h"
+#include "task_control.h"
+
+#include <compressed/channel.h>
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	struct cryptomatte;
+
+	/// \brief Incrementally decodes the masks of a cryptomatte, handing them out one at a time.
+	/// 
+	/// Rather than returning all decoded masks at once (as `cryptomatte::masks` does) the masks are handed out one
+	/// at a time with no more than `max_masks` decoded masks ever held by the generator. By default all masks are 
+	/// decoded in a single pass and held compressed until they are handed out, see `incremental_strategy` for 
+	/// the alternative of decoding every batch with its own pass. This pairs naturally with writing the masks to
+	/// disk or feeding them into a dataset loader one after another.
+	/// 
+	/// \code{.cpp}
+	/// auto generator = matte.masks_incremental(32);
+	/// while (auto mask = generator.next())
+	/// {
+	///		write_to_disk(mask->first, mask->second);
+	/// }
+	/// \endcode
+	/// 
+	/// The generator references the cryptomatte it was created from which must outlive it.
+	struct mask_generator
+	{
+		/// \brief Create a generator decoding the masks of the given hashes in order.
+		/// 
+		/// \param matte     The cryptomatte to decode the masks from, must outlive the generator.
+		/// \param hashes    The hashes of the masks to decode, in the order they should be returned in.
+		/// \param max_masks The maximum number of decoded masks held at once, must be at least 1.
+		/// \param control   Optional cancellation and progress reporting, the progress is reported per pass.
+		/// \param strategy  Whether to decode all masks in a single pass or every batch in its own pass.
+		/// 
+		/// \throws std::invalid_argument if `max_masks` is 0.
+		mask_generator(
+			const cryptomatte& matte, 
+			std::vector<uint32_t> hashes, 
+			size_t max_masks, 
+			task_control control = {},
+			incremental_strategy strategy = incremental_strategy::single_pass
+		);
+
+		/// \brief Retrieve the next mask, decoding the next batch of masks if required.
+		/// 
+		/// With `incremental_strategy::single_pass` the first call decodes all of the masks.
+		/// 
+		/// \throws operation_cancelled if a stop was requested via `control.stop_token`.
+		/// 
+		/// \returns The name (as on the manifest, or the hash in hex form) and the decoded mask, or std::nullopt
+		///			 once all masks were returned.
+		std::optional<std::pair<std::string, std::vector<float32_t>>> next();
+
+		/// \brief The total number of masks the generator returns.
+		size_t size() const noexcept;
+
+		/// \brief The number of masks that have not been returned yet.
+		size_t remaining() const noexcept;
+
+		/// \brief The width of the masks returned by the generator.
+		size_t width() const;
+
+		/// \brief The height of the masks returned by the generator.
+		size_t height() const;
+
+	private:
+		const cryptomatte* m_Matte = nullptr;
+		std::vector<uint32_t> m_Hashes;
+		size_t m_MaxMasks = 0;
+		task_control m_Control;
+		incremental_strategy m_Strategy = incremental_strategy::single_pass;
+
+		/// Whether the single pass over the levels already ran, only used for `incremental_strategy::single_pass`.
+		bool m_Decoded = false;
+		/// The compressed masks of the single pass which were not decompressed yet, mapped by their names.
+		std::unordered_map<std::string, compressed::channel<float32_t>> m_Compressed;
+
+		/// The index into `m_Hashes` of the first mask of the next batch.
+		size_t m_NextBatch = 0;
+		/// The decoded masks of the current batch which were not returned yet.
+		std::deque<std::pair<std::string, std::vector<float32_t>>> m_Batch;
+	};
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -103,6 +103,11 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 		/// \}
 
+		/// Serialize the cryptomattes' metadata into the json representation of the image metadata, this is the
+		/// inverse of `from_json`. This holds the 'cryptomatte/<key>/<attribute>' entries for the name, hash, 
+		/// conversion and (if present) the embedded manifest, the latter stored as a json string.
+		json_ordered to_json() const;
+
 		/// Retrieve all the cryptomatte channel names for the given list of channelnames in the order they came in.
 		/// Filters all of them according to `is_valid_channel_name` and returns all the channel names matching this.
 		std::vector<std::string> channel_names(const std::vector<std::string>& channelnames) const;
@@ -161,7 +166,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 		/// Retrieve the manifest (if present) from the metadata, this may be empty and should not be relied
 		/// upon for decoding the cryptomatte masks.
-		std::optional<NAMESPACE_CRYPTOMATTE_API::manifest> manifest() const;
+		const std::optional<NAMESPACE_CRYPTOMATTE_API::manifest>& manifest() const;
 
 		/// \{
 		/// \name attribute name constants
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "detail/macros.h"
+#include "executor.h"
+#include "task_control.h"
+
+#include <compressed/channel.h>
+#include <compressed/enums.h>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief The in-memory storage precision of the coverage channels.
+	///
+	/// The cryptomatte specification requires all rank and coverage channels to be 32-bit float on disk. The rank
+	/// channels have to be kept at that precision as they hold the bit-cast hashes, the coverage channels however
+	/// only hold values in the range [0, 1] which rarely need more than 12-16 bits of precision. Storing these at
+	/// reduced precision halves their compressed memory footprint as well as the bandwidth needed for decompressing
+	/// them. Decoding is unaffected by this, all the mask functions still produce float32 masks.
+	enum class coverage_precision : uint8_t
+	{
+		/// Store the coverage channels as-is, this is lossless.
+		float32,
+		/// Store the coverage channels as IEEE 754 half-precision floats (stored as their uint16_t bit-pattern).
+		/// This retains values outside of [0, 1] at a precision of 11 significant bits.
+		float16,
+		/// Store the coverage channels as normalized uint16_t values, mapping [0, 1] to [0, 65535]. This gives
+		/// a uniform precision of 1/65535 but clamps any values outside of the [0, 1] range.
+		unorm16,
+	};
+
+
+	/// \brief The strategy used for decoding the masks of a cryptomatte.
+	enum class decode_strategy : uint8_t
+	{
+		/// Distribute the work across the executor with every rank and coverage channel being decompressed by 
+		/// its own task while the chunks pass through the channels in level order, the finished masks of a chunk
+		/// are then recompressed in parallel per id. As a single channel cannot be decompressed from multiple 
+		/// threads this scales with the number of levels (and ids) rather than with the number of chunks: at most
+		/// `2 * num_levels` channels are decompressed at once, e.g. 4 for a cryptomatte with 2 levels regardless
+		/// of the number of cores. The number of chunks in flight is bounded by 
+		/// `cryptomatte::set_decode_memory_budget`. This is the default.
+		channel_parallel,
+		/// Decode the chunks in order through a three-stage pipeline: a background thread decompresses the 
+		/// rank-coverage pairs ahead of the calling thread which accumulates them while another background thread
+		/// recompresses (or copies out) the finished masks. The stages are connected via bounded queues so only a
+		/// few chunks are in flight at once. This keeps the memory usage low and gives good throughput when only a
+		/// few (2-4) cores are available for decoding. This always runs on its own threads, ignoring the executor.
+		pipelined,
+	};
+
+
+	/// \brief How a `mask_generator` (see `cryptomatte::masks_incremental`) decodes its masks.
+	enum class incremental_strategy : uint8_t
+	{
+		/// Decode all of the requested masks in a single pass over the levels on the first call to `next`, holding
+		/// them compressed, and decompress at most `max_masks` of these at once (in parallel) as they are handed
+		/// out. A mask is only complete once the last chunk was decoded so the finished masks have to be held
+		/// somewhere, keeping them compressed bounds the decoded masks held to `max_masks` while only requiring
+		/// a single pass. This is the default.
+		single_pass,
+		/// Decode the masks in batches of `max_masks` with every batch running its own full pass over the levels,
+		/// requiring ceil(num_masks / max_masks) passes in total. Nothing beyond the current batch is held so
+		/// this has the lowest memory usage but is considerably slower for small batches.
+		batched,
+	};
+
+
+	/// \brief The settings the channels of a cryptomatte are compressed with in-memory.
+	///
+	/// Every channel is split into chunks which are compressed (and later decompressed) independently, these are
+	/// also the unit of work all of the decoding is parallelized over. Smaller chunks therefore parallelize better
+	/// on small images at the cost of a slightly worse compression ratio.
+	struct compression_options
+	{
+		/// The codec to compress the channels with.
+		compressed::enums::codec codec = compressed::enums::codec::lz4;
+
+		/// The compression level of the codec, higher levels compress better but slower.
+		uint8_t compression_level = 9;
+
+		/// The size (in bytes) of the blocks within a chunk, must not exceed `chunk_size`.
+		size_t block_size = compressed::s_default_blocksize;
+
+		/// The size (in bytes) of each chunk, must be a non-zero multiple of 4 (the size of a float32_t).
+		size_t chunk_size = compressed::s_default_chunksize;
+	};
+
+
+	/// \brief Options for controlling how cryptomattes are loaded via `cryptomatte::load`.
+	struct load_options
+	{
+		/// Whether to load the legacy preview channels: {typename}.r, {typename}.g, {typename}.b which may store a
+		/// preview channel (but don't have to). If this is set to false we will never load these channels speeding
+		/// up loading.
+		bool load_preview = false;
+
+		/// The precision to store the coverage channels at in-memory, see `coverage_precision` for more information.
+		coverage_precision coverage = coverage_precision::float32;
+
+		/// The executor to run all parallel work of the loaded cryptomattes on, this is stored on the cryptomattes
+		/// and used for all subsequent mask extraction. If this is a nullptr the default executor is used, see
+		/// `set_default_executor`.
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> executor = nullptr;
+
+		/// The strategy to decode the masks of the loaded cryptomattes with, see `decode_strategy` for more
+		/// information.
+		decode_strategy decoding = decode_strategy::channel_parallel;
+
+		/// The settings to compress the channels with in-memory. The chunk size is reduced to the size of a 
+		/// single channel on small images, such that these are not over-allocated.
+		compression_options compression;
+
+		/// Cancellation and progress reporting while reading the channels from disk. The progress is reported per
+		/// chunk of scanlines read and compressed.
+		task_control control;
+	};
+
+
+	/// \brief How the masks are laid out in the exr file written by `cryptomatte::write_masks`.
+	enum class mask_layout : uint8_t
+	{
+		/// Write all masks into a single-part exr with one channel per mask, the channels are named after the masks.
+		channels,
+		/// Write every mask into its own part of a multi-part exr holding a single 'Y' channel, the parts are named
+		/// after the masks.
+		parts,
+	};
+
+
+	/// \brief The pixel format of the masks written by `cryptomatte::write_masks`.
+	enum class mask_format : uint8_t
+	{
+		float32,
+		float16,
+	};
+
+
+	/// \brief Options for controlling how masks are written to disk via `cryptomatte::write_masks`.
+	struct write_options
+	{
+		/// Whether to write the masks as channels of a single part or as separate parts.
+		mask_layout layout = mask_layout::channels;
+
+		/// The pixel format to store the masks in, the masks are always decoded at full precision and only 
+		/// converted on write.
+		mask_format format = mask_format::float32;
+
+		/// The exr compression to use, this is passed on to OpenImageIO so can be any of the compression methods
+		/// supported by the exr writer (e.g. "none", "zip", "zips", "piz", "dwaa").
+		std::string compression = "zip";
+
+		/// Cancellation and progress reporting, the progress is reported while decoding the masks while the 
+		/// cancellation is additionally checked while writing.
+		task_control control;
+	};
+
+} // NAMESPACE_CRYPTOMATTE_API
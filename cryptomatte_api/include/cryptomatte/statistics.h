@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "detail/macros.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief The coverage statistics of a single id across the whole image, see `cryptomatte::statistics`.
+	struct id_statistics
+	{
+		/// The number of pixels on which the id has a non-zero coverage.
+		size_t pixel_count = 0;
+		/// The sum of the coverage of the id across all pixels, i.e. the area of the id in pixels. This is
+		/// accumulated in double precision to avoid losing precision on large images.
+		double coverage_sum = 0.0;
+
+		/// The inclusive bounding box of all pixels with a non-zero coverage of the id.
+		size_t min_x = std::numeric_limits<size_t>::max();
+		size_t min_y = std::numeric_limits<size_t>::max();
+		size_t max_x = 0;
+		size_t max_y = 0;
+
+		/// \brief Combine the statistics of the same id computed over different regions of the image.
+		void merge(const id_statistics& other) noexcept
+		{
+			pixel_count += other.pixel_count;
+			coverage_sum += other.coverage_sum;
+			min_x = std::min(min_x, other.min_x);
+			min_y = std::min(min_y, other.min_y);
+			max_x = std::max(max_x, other.max_x);
+			max_y = std::max(max_y, other.max_y);
+		}
+	};
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <stop_token>
+
+#include "detail/macros.h"
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	/// \brief The progress of a long-running decode or load.
+	struct progress
+	{
+		/// The number of chunks that have been fully processed.
+		size_t chunks_done = 0;
+		/// The total number of chunks that will be processed.
+		size_t chunks_total = 0;
+		/// The number of (uncompressed) bytes decompressed or read so far.
+		size_t bytes_decompressed = 0;
+	};
+
+
+	/// \brief Cooperative cancellation and progress reporting for long-running operations such as `cryptomatte::load`
+	/// or `cryptomatte::masks`.
+	///
+	/// The stop token is checked before processing each chunk, once a stop was requested the operation abandons
+	/// any remaining work and throws `operation_cancelled`. A common pattern is to keep a `std::stop_source` per
+	/// request and call `request_stop()` on it once the request becomes stale:
+	///
+	/// \code{.cpp}
+	/// std::stop_source source;
+	/// cmatte::task_control control;
+	/// control.stop_token = source.get_token();
+	/// control.on_progress = [](const cmatte::progress& p) { update_progress_bar(p.chunks_done, p.chunks_total); };
+	///
+	/// // On another thread, e.g. when the selection changes
+	/// source.request_stop();
+	/// \endcode
+	struct task_control
+	{
+		/// The token to check for cancellation, a default-constructed token can never be stopped.
+		std::stop_token stop_token;
+
+		/// The callback invoked after each processed chunk. This may be called from any of the worker threads but
+		/// calls are serialized so it never runs concurrently with itself. It should return quickly as it blocks
+		/// the worker calling it.
+		std::function<void(const progress&)> on_progress;
+	};
+
+
+	/// \brief The exception thrown when an operation was cancelled via its `task_control::stop_token`.
+	struct operation_cancelled : public std::runtime_error
+	{
+		using std::runtime_error::runtime_error;
+	};
+
+
+	namespace detail
+	{
+
+		/// \brief Thread-safe tracking of the progress of a single operation, reporting to the `task_control`.
+		struct progress_tracker
+		{
+			progress_tracker(const task_control& control, size_t chunks_total)
+				: m_Control(control), m_ChunksTotal(chunks_total) {}
+
+			/// \brief Throw `operation_cancelled` if a stop was requested on the task control.
+			void throw_if_cancelled() const
+			{
+				if (m_Control.stop_token.stop_requested())
+				{
+					throw operation_cancelled("cryptomatte: operation was cancelled");
+				}
+			}
+
+			/// \brief Record the given number of decompressed bytes without reporting.
+			void add_bytes(size_t bytes) noexcept
+			{
+				m_BytesDecompressed.fetch_add(bytes, std::memory_order_relaxed);
+			}
+
+			/// \brief Record a number of finished chunks and report the progress to the callback (if any).
+			void finish_chunks(size_t num_chunks)
+			{
+				size_t chunks_done = m_ChunksDone.fetch_add(num_chunks, std::memory_order_relaxed) + num_chunks;
+				if (!m_Control.on_progress)
+				{
+					return;
+				}
+
+				std::lock_guard lock(m_CallbackMutex);
+				// Due to the relaxed ordering reports may arrive out of order, we never report going backwards.
+				m_LastReported = std::max(m_LastReported, chunks_done);
+				m_Control.on_progress(progress{
+					m_LastReported,
+					m_ChunksTotal,
+					m_BytesDecompressed.load(std::memory_order_relaxed)
+				});
+			}
+
+		private:
+			const task_control& m_Control;
+			size_t m_ChunksTotal = 0;
+			std::atomic<size_t> m_ChunksDone = 0;
+			std::atomic<size_t> m_BytesDecompressed = 0;
+			std::mutex m_CallbackMutex;
+			size_t m_LastReported = 0;
+		};
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -4,14 +4,22 @@
 #include <ranges>
 #include <algorithm>
 #include <unordered_map>
-#include <unordered_set>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <array>
+#include <limits>
+#include <optional>
 
 #include "metadata.h"
+#include "hash.h"
 #include "detail/channel_util.h"
 #include "detail/oiio_util.h"
 #include "detail/decoding_impl.h"
+#include "detail/level_visitor.h"
 #include "detail/detail.h"
 #include "detail/scoped_timer.h"
+#include "detail/bounded_queue.h"
 
 #include <compressed/image.h>
 #include <compressed/blosc2/lazyschunk.h>
@@ -19,12 +27,62 @@
 namespace NAMESPACE_CRYPTOMATTE_API
 {
 
+	/// The number of rank-coverage pairs the decompression stage of the pipeline may run ahead of the 
+	/// accumulation stage.
+	static constexpr size_t s_pipeline_level_slots = 4;
+	/// The number of chunk accumulators in flight in the pipeline, one being accumulated while the other one 
+	/// is recompressed.
+	static constexpr size_t s_pipeline_accumulators = 2;
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	cryptomatte::cryptomatte(cryptomatte&& other)
+	{
+		*this = std::move(other);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	cryptomatte& cryptomatte::operator=(cryptomatte&& other)
+	{
+		if (this == &other)
+		{
+			return *this;
+		}
+
+		m_RankChannels = std::move(other.m_RankChannels);
+		m_CoverageChannels = std::move(other.m_CoverageChannels);
+		m_Occupancy = std::move(other.m_Occupancy);
+		m_LegacyChannels = std::move(other.m_LegacyChannels);
+		m_Metadata = std::move(other.m_Metadata);
+		m_Executor = std::move(other.m_Executor);
+		m_DecodeStrategy = other.m_DecodeStrategy;
+		m_DecodeMemoryBudget = other.m_DecodeMemoryBudget;
+
+		// Moving out of the containers leaves them in a valid but unspecified state, clear them so the
+		// moved-from cryptomatte is empty and consistent with its locks.
+		other.m_RankChannels.clear();
+		other.m_CoverageChannels.clear();
+		other.m_Occupancy.clear();
+		other.m_LegacyChannels.clear();
+
+		// Both sides keep a lock per level of their own channels and neither may return chunks of the other.
+		m_ChannelLocks = std::make_unique<detail::channel_locks>(m_RankChannels.size());
+		other.m_ChannelLocks = std::make_unique<detail::channel_locks>(0);
+		m_PickCache->set_capacity(other.m_PickCache->capacity());
+		m_PickCache->clear();
+		other.m_PickCache->clear();
+		return *this;
+	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
 	cryptomatte::cryptomatte(
 		std::unordered_map<std::string, compressed::channel<float32_t>> channels, 
-		const NAMESPACE_CRYPTOMATTE_API::metadata& metadata
+		const NAMESPACE_CRYPTOMATTE_API::metadata& metadata,
+		coverage_precision coverage /* = coverage_precision::float32 */,
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec /* = nullptr */
 	)
 	{
 		if (channels.empty())
@@ -33,6 +91,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		}
 
 		m_Metadata = metadata;
+		m_Executor = std::move(exec);
 
 		std::vector<std::string> cryptomatte_channels;
 		std::vector<std::string> legacy_channels;
@@ -102,15 +161,38 @@ namespace NAMESPACE_CRYPTOMATTE_API
 					)
 				);
 			}
+		}
 
-
-			m_Channels.emplace_back(name, std::move(channels.at(name)));
+		// Split the channels up into the rank and coverage channels, these are guaranteed to be ordered
+		// as alternating rank-coverage pairs.
+		for (size_t i = 0; i + 1 < cryptomatte_channels.size(); i += 2)
+		{
+			const auto& rank_name = cryptomatte_channels[i];
+			const auto& covr_name = cryptomatte_channels[i + 1];
+			m_RankChannels.emplace_back(rank_name, std::move(channels.at(rank_name)));
+			m_CoverageChannels.emplace_back(covr_name, detail::coverage_channel{});
 		}
+
+		// Re-encode the coverage channels (if requested) and compute which chunks of the rank channels hold any
+		// ids, we do this in parallel as these are all independent.
+		m_Occupancy.resize(m_RankChannels.size());
+		detail::resolve_executor(m_Executor)->parallel_for(m_CoverageChannels.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t level = begin; level < end; ++level)
+				{
+					auto& [covr_name, covr_channel] = m_CoverageChannels[level];
+					covr_channel = detail::coverage_channel(std::move(channels.at(covr_name)), coverage);
+					m_Occupancy[level] = detail::compute_rank_occupancy(m_RankChannels[level].second);
+				}
+			});
+
 		// Push them back in any order, doesn't matter.
 		for (const auto& name : legacy_channels)
 		{
 			m_LegacyChannels[name] = std::move(channels.at(name));
 		}
+
+		m_ChannelLocks = std::make_unique<detail::channel_locks>(m_RankChannels.size());
 	}
 
 	
@@ -120,15 +202,54 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		std::unordered_map<std::string, std::vector<float32_t>> channels,
 		size_t width,
 		size_t height,
-		const NAMESPACE_CRYPTOMATTE_API::metadata& metadata
+		const NAMESPACE_CRYPTOMATTE_API::metadata& metadata,
+		coverage_precision coverage /* = coverage_precision::float32 */,
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec /* = nullptr */,
+		const compression_options& compression /* = {} */
+	)
+		: cryptomatte(detail::as_spans(channels), width, height, metadata, coverage, std::move(exec), compression)
+	{
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	cryptomatte::cryptomatte(
+		const std::unordered_map<std::string, std::span<const float32_t>>& channels,
+		size_t width,
+		size_t height,
+		const NAMESPACE_CRYPTOMATTE_API::metadata& metadata,
+		coverage_precision coverage /* = coverage_precision::float32 */,
+		std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec /* = nullptr */,
+		const compression_options& compression /* = {} */
 	)
 	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
 		if (channels.empty())
 		{
 			throw std::invalid_argument("Unable to construct cryptomatte with empty channel list");
 		}
+		if (compression.chunk_size == 0 || compression.chunk_size % sizeof(float32_t) != 0)
+		{
+			throw std::invalid_argument(
+				std::format(
+					"Unable to construct cryptomatte with a chunk size of {} bytes, this must be a non-zero multiple of {}",
+					compression.chunk_size, sizeof(float32_t)
+				)
+			);
+		}
+		if (compression.block_size == 0 || compression.block_size > compression.chunk_size)
+		{
+			throw std::invalid_argument(
+				std::format(
+					"Unable to construct cryptomatte with a block size of {} bytes, this must be non-zero and may not"
+					" exceed the chunk size of {} bytes",
+					compression.block_size, compression.chunk_size
+				)
+			);
+		}
 
 		m_Metadata = metadata;
+		m_Executor = std::move(exec);
 
 		std::vector<std::string> cryptomatte_channels;
 		std::vector<std::string> legacy_channels;
@@ -145,42 +266,95 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			}
 		}
 
-
-		size_t vec_size = channels.begin()->second.size();
-
 		// Validate these and ensure they are ordered for later access.
 		cryptomatte_channels = detail::sort_and_validate_channels(cryptomatte_channels);
 		for (const auto& name : cryptomatte_channels)
 		{
-			auto& channel_vec = channels.at(name);
-			if (channel_vec.size() != vec_size)
+			const auto& channel_span = channels.at(name);
+			if (channel_span.size() != width * height)
 			{
 				throw std::invalid_argument(
 					std::format(
 						"Invalid channel '{}' provided to cryptomatte constructor. "
-						"All channels must have the same chunk size: expected {}, got {}.",
-						name, vec_size, channel_vec.size()
+						"All channels must hold width * height elements: expected {}, got {}.",
+						name, width * height, channel_span.size()
 					)
 				);
 			}
-
-			auto span = std::span<const float32_t>(channel_vec);
-			// Will throw if the vec size is not that of width * height
-			auto channel = compressed::channel<float32_t>(span, width, height);
-			m_Channels.emplace_back(name, std::move(channel));
 		}
-		// Push them back in any order, doesn't matter.
-		for (const auto& name : legacy_channels)
+
+		// Compress the channels and split them into the rank and coverage channels, these are guaranteed to be
+		// ordered as alternating rank-coverage pairs. Every channel is compressed independently so rather than
+		// parallelizing over the levels we parallelize over all channels (including the legacy ones), this keeps
+		// all workers busy on cryptomattes with only a handful of levels.
+		const size_t num_levels = cryptomatte_channels.size() / 2;
+		const size_t num_channels = num_levels * 2 + legacy_channels.size();
+		m_RankChannels.resize(num_levels);
+		m_CoverageChannels.resize(num_levels);
+		m_Occupancy.resize(num_levels);
+		std::vector<compressed::channel<float32_t>> compressed_legacy(legacy_channels.size());
+		auto compress = [&](std::span<const float32_t> data)
+			{
+				return compressed::channel<float32_t>(
+					data,
+					width,
+					height,
+					compression.codec,
+					compression.compression_level,
+					compression.block_size,
+					compression.chunk_size
+				);
+			};
+		detail::resolve_executor(m_Executor)->parallel_for(num_channels, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					if (i >= num_levels * 2)
+					{
+						// Will throw if the span size is not that of width * height
+						const auto& name = legacy_channels[i - num_levels * 2];
+						compressed_legacy[i - num_levels * 2] = compress(channels.at(name));
+						continue;
+					}
+
+					const size_t level = i / 2;
+					const auto& name = cryptomatte_channels[i];
+					const auto channel_span = channels.at(name);
+					if (i % 2 == 0)
+					{
+						m_RankChannels[level] = { name, compress(channel_span) };
+						m_Occupancy[level] = detail::compute_rank_occupancy(channel_span, m_RankChannels[level].second);
+					}
+					else
+					{
+						// Reduced precision coverage is compressed at its target precision right away.
+						m_CoverageChannels[level] = {
+							name,
+							detail::coverage_channel(channel_span, width, height, coverage, compression)
+						};
+					}
+				}
+			});
+		for (size_t i = 0; i < legacy_channels.size(); ++i)
 		{
-			auto& channel_vec = channels.at(name);
-			auto span = std::span<const float32_t>(channel_vec.begin(), channel_vec.end());
-			m_LegacyChannels[name] = compressed::channel<float32_t>(span, width, height);
+			m_LegacyChannels[legacy_channels[i]] = std::move(compressed_legacy[i]);
 		}
+
+		m_ChannelLocks = std::make_unique<detail::channel_locks>(m_RankChannels.size());
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
 	std::vector<cryptomatte> cryptomatte::load(std::filesystem::path file, bool load_preview)
+	{
+		load_options options;
+		options.load_preview = load_preview;
+		return cryptomatte::load(std::move(file), options);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<cryptomatte> cryptomatte::load(std::filesystem::path file, const load_options& options)
 	{
 		// Load the OIIO image, mostly for reading the spec. compressed::image will take 
 		// care of loading the pixels.
@@ -238,7 +412,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 				);
 			}
 
-			if (load_preview)
+			if (options.load_preview)
 			{
 				auto preview_channelnames = meta.legacy_channel_names(input_ptr->spec().channelnames);
 				channelnames.insert(channelnames.end(), preview_channelnames.begin(), preview_channelnames.end());
@@ -249,18 +423,20 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		}
 
 		// Load all the channels in one go, we split these up later. Lower the chunk size so we don't over-allocate
-		// for small images.
+		// for small images. The channels are read chunk by chunk so we can abandon the load if requested.
 		const auto& spec = input_ptr->spec();
-		auto chunk_size = std::min(compressed::s_default_chunksize, static_cast<size_t>(spec.width) * spec.height * sizeof(float32_t));
-		auto block_size = std::min(chunk_size / 128, compressed::s_default_blocksize);
-		auto image = compressed::image<float32_t>::read(
-			std::move(input_ptr), 
-			all_channel_names, 
-			0, 
-			compressed::enums::codec::lz4, 
-			9, 
-			block_size, 
-			chunk_size
+		auto chunk_size = std::min(options.compression.chunk_size, static_cast<size_t>(spec.width) * spec.height * sizeof(float32_t));
+		auto block_size = std::min(chunk_size / 128, options.compression.block_size);
+		auto exec = detail::resolve_executor(options.executor);
+		auto all_channels = detail::read_channels(
+			*input_ptr,
+			all_channel_names,
+			options.compression.codec,
+			options.compression.compression_level,
+			block_size,
+			chunk_size,
+			*exec,
+			options.control
 		);
 
 		// Split up the cryptomattes and load them into their own instances.
@@ -270,10 +446,11 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			std::unordered_map<std::string, compressed::channel<float32_t>> channels;
 			for (const auto& chname : chnames)
 			{
-				channels[chname] = image.extract_channel(chname);
+				channels[chname] = std::move(all_channels.at(chname));
 			}
 
-			out.push_back(cryptomatte(std::move(channels), metadatas[idx]));
+			out.push_back(cryptomatte(std::move(channels), metadatas[idx], options.coverage, options.executor));
+			out.back().set_decode_strategy(options.decoding);
 			++idx;
 		}
 
@@ -284,9 +461,9 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	// -----------------------------------------------------------------------------------
 	size_t cryptomatte::width() const
 	{
-		if (!m_Channels.empty())
+		if (!m_RankChannels.empty())
 		{
-			return m_Channels.begin()->second.width();
+			return m_RankChannels.begin()->second.width();
 		}
 		return {};
 	}
@@ -295,9 +472,9 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	// -----------------------------------------------------------------------------------
 	size_t cryptomatte::height() const
 	{
-		if (!m_Channels.empty())
+		if (!m_RankChannels.empty())
 		{
-			return m_Channels.begin()->second.height();
+			return m_RankChannels.begin()->second.height();
 		}
 		return {};
 	}
@@ -315,6 +492,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	{
 		std::vector<std::vector<float32_t>> out;
 
+		std::lock_guard lock(m_ChannelLocks->legacy);
 		for (const auto& [name, channel] : m_LegacyChannels)
 		{
 			out.push_back(channel.get_decompressed());
@@ -331,6 +509,330 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	}
 
 
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<pixel_id> cryptomatte::ids_at(size_t x, size_t y) const
+	{
+		std::array<std::pair<size_t, size_t>, 1> points = { std::pair<size_t, size_t>{ x, y } };
+		return std::move(this->ids_at(std::span<const std::pair<size_t, size_t>>(points)).front());
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<std::vector<pixel_id>> cryptomatte::ids_at(std::span<const std::pair<size_t, size_t>> points) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		const size_t width = this->width();
+		const size_t height = this->height();
+
+		// Sort the points by their pixel index so that all points of a chunk are resolved back to back and every
+		// chunk is only fetched once.
+		std::vector<std::pair<size_t, size_t>> order; // pixel index, point index
+		order.reserve(points.size());
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			const auto [x, y] = points[i];
+			if (x >= width || y >= height)
+			{
+				throw std::out_of_range(
+					std::format("Unable to query the ids at pixel ({}, {}), the cryptomatte is only {}x{} pixels", x, y, width, height)
+				);
+			}
+			order.push_back({ y * width + x, i });
+		}
+		std::sort(order.begin(), order.end());
+
+		// An empty cryptomatte has no pixels so any point would have been out of range.
+		std::vector<std::vector<pixel_id>> out(points.size());
+		if (order.empty())
+		{
+			return out;
+		}
+		const size_t max_chunk_elems = m_RankChannels.begin()->second.chunk_size() / sizeof(float32_t);
+		const auto& manifest = m_Metadata.manifest();
+
+		// The same id should not appear on multiple levels of a pixel, but we merge them regardless in case
+		// the renderer did not.
+		auto resolve_ids = [&](const detail::decoded_chunk& chunk, size_t offset, std::vector<pixel_id>& ids)
+			{
+				for (size_t level = 0; level < chunk.coverage.size(); ++level)
+				{
+					if (chunk.coverage[level].empty())
+					{
+						continue;
+					}
+					const uint32_t hash = std::bit_cast<uint32_t>(chunk.rank[level][offset]);
+					const float32_t coverage = chunk.coverage[level][offset];
+					if (detail::flat_id_set::is_empty_id(hash) || coverage == 0.0f)
+					{
+						continue;
+					}
+
+					auto it = std::find_if(ids.begin(), ids.end(), [&](const pixel_id& id) { return id.hash == hash; });
+					if (it != ids.end())
+					{
+						it->coverage += coverage;
+						continue;
+					}
+
+					ids.push_back({ hash, detail::mask_name(hash, manifest), coverage });
+				}
+				std::stable_sort(ids.begin(), ids.end(), [](const pixel_id& a, const pixel_id& b) { return a.coverage > b.coverage; });
+			};
+
+		std::vector<size_t> offsets;
+		for (size_t begin = 0; begin < order.size();)
+		{
+			const size_t chunk_idx = order[begin].first / max_chunk_elems;
+			size_t end = begin;
+			offsets.clear();
+			for (; end < order.size() && order[end].first / max_chunk_elems == chunk_idx; ++end)
+			{
+				offsets.push_back(order[end].first % max_chunk_elems);
+			}
+
+			// Without a cache we only decode as much as is needed for the queried pixels, the cache on the 
+			// other hand has to hold the full chunk for any later queries.
+			std::shared_ptr<const detail::decoded_chunk> chunk = nullptr;
+			if (m_PickCache->capacity() == 0)
+			{
+				chunk = std::make_shared<const detail::decoded_chunk>(this->decode_levels(chunk_idx, offsets));
+			}
+			else
+			{
+				chunk = m_PickCache->get(chunk_idx, [this](size_t idx) { return this->decode_levels(idx); });
+			}
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				resolve_ids(*chunk, offsets[i - begin], out[order[i].second]);
+			}
+			begin = end;
+		}
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	NAMESPACE_CRYPTOMATTE_API::mask_generator cryptomatte::masks_incremental(
+		size_t max_masks /* = 16 */, 
+		const task_control& control /* = {} */,
+		incremental_strategy strategy /* = incremental_strategy::single_pass */
+	) const
+	{
+		return NAMESPACE_CRYPTOMATTE_API::mask_generator(*this, this->ids(control), max_masks, control, strategy);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	NAMESPACE_CRYPTOMATTE_API::mask_generator cryptomatte::masks_incremental(
+		std::vector<std::string> names, 
+		size_t max_masks /* = 16 */, 
+		const task_control& control /* = {} */,
+		incremental_strategy strategy /* = incremental_strategy::single_pass */
+	) const
+	{
+		return NAMESPACE_CRYPTOMATTE_API::mask_generator(*this, this->hashes_from_names(names), max_masks, control, strategy);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	NAMESPACE_CRYPTOMATTE_API::mask_generator cryptomatte::masks_incremental(
+		std::vector<uint32_t> hashes, 
+		size_t max_masks /* = 16 */, 
+		const task_control& control /* = {} */,
+		incremental_strategy strategy /* = incremental_strategy::single_pass */
+	) const
+	{
+		return NAMESPACE_CRYPTOMATTE_API::mask_generator(*this, std::move(hashes), max_masks, control, strategy);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<uint32_t> cryptomatte::ids(const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		detail::flat_id_set all_ids;
+		std::mutex ids_mutex;
+		detail::id_collector_visitor::sink_fn sink = [&](const detail::flat_id_set& ids)
+			{
+				std::lock_guard lock(ids_mutex);
+				all_ids.merge(ids);
+			};
+		this->visit_levels([&]() { return std::make_unique<detail::id_collector_visitor>(sink); }, control);
+
+		std::vector<float32_t> ids_as_float;
+		all_ids.append_to(ids_as_float);
+		std::vector<uint32_t> out;
+		out.reserve(ids_as_float.size());
+		for (auto id : ids_as_float)
+		{
+			out.push_back(std::bit_cast<uint32_t>(id));
+		}
+		std::sort(out.begin(), out.end());
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::unordered_map<uint32_t, id_statistics> cryptomatte::statistics(const task_control& control /* = {} */) const
+	{
+		return this->compute_statistics(nullptr, control);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::unordered_map<uint32_t, id_statistics> cryptomatte::statistics(std::vector<uint32_t> hashes, const task_control& control /* = {} */) const
+	{
+		detail::flat_id_set requested(hashes.size());
+		for (auto hash : hashes)
+		{
+			requested.insert(hash);
+		}
+		return this->compute_statistics(&requested, control);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	NAMESPACE_CRYPTOMATTE_API::id_map cryptomatte::id_map(const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		NAMESPACE_CRYPTOMATTE_API::id_map out;
+		if (m_RankChannels.empty())
+		{
+			return out;
+		}
+		out.ids.resize(this->width() * this->height());
+		out.coverage.resize(this->width() * this->height());
+		const size_t max_chunk_elems = m_RankChannels.begin()->second.chunk_size() / sizeof(float32_t);
+
+		// Every chunk only writes to its own region of the output so no synchronization is needed here.
+		detail::id_map_visitor::sink_fn sink = [&](size_t chunk_idx, std::span<uint32_t> ids, std::span<float32_t> coverage)
+			{
+				std::copy(ids.begin(), ids.end(), out.ids.begin() + chunk_idx * max_chunk_elems);
+				std::copy(coverage.begin(), coverage.end(), out.coverage.begin() + chunk_idx * max_chunk_elems);
+			};
+		this->visit_levels([&]() { return std::make_unique<detail::id_map_visitor>(max_chunk_elems, sink); }, control);
+
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	NAMESPACE_CRYPTOMATTE_API::id_map_compressed cryptomatte::id_map_compressed(const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		const auto& first_channel = this->m_RankChannels.begin()->second;
+		const size_t max_chunk_elems = first_channel.chunk_size() / sizeof(float32_t);
+
+		// uint32_t and float32_t have the same size so passing the same sizes gives us the same chunk layout.
+		NAMESPACE_CRYPTOMATTE_API::id_map_compressed out{
+			compressed::channel<uint32_t>::zeros(
+				this->width(),
+				this->height(),
+				first_channel.compression(),
+				static_cast<uint8_t>(first_channel.compression_level()),
+				first_channel.block_size(),
+				first_channel.chunk_size()
+			),
+			compressed::channel<float32_t>::zeros(
+				this->width(),
+				this->height(),
+				first_channel.compression(),
+				static_cast<uint8_t>(first_channel.compression_level()),
+				first_channel.block_size(),
+				first_channel.chunk_size()
+			)
+		};
+		out.ids.update_nthreads(1, first_channel.block_size());
+		out.coverage.update_nthreads(1, first_channel.block_size());
+
+		std::mutex ids_mutex;
+		std::mutex coverage_mutex;
+		detail::id_map_visitor::sink_fn sink = [&](size_t chunk_idx, std::span<uint32_t> ids, std::span<float32_t> coverage)
+			{
+				{
+					std::lock_guard lock(ids_mutex);
+					out.ids.set_chunk(ids, chunk_idx);
+				}
+				std::lock_guard lock(coverage_mutex);
+				out.coverage.set_chunk(coverage, chunk_idx);
+			};
+		this->visit_levels([&]() { return std::make_unique<detail::id_map_visitor>(max_chunk_elems, sink); }, control);
+
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<std::vector<float32_t>> cryptomatte::generate_preview(const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		std::vector<std::vector<float32_t>> out(3, std::vector<float32_t>(this->width() * this->height()));
+		const size_t max_chunk_elems = m_RankChannels.begin()->second.chunk_size() / sizeof(float32_t);
+
+		// Every chunk only writes to its own region of the output so no synchronization is needed here.
+		detail::preview_visitor::sink_fn sink = [&](size_t chunk_idx, std::span<float32_t> red, std::span<float32_t> green, std::span<float32_t> blue)
+			{
+				std::copy(red.begin(), red.end(), out[0].begin() + chunk_idx * max_chunk_elems);
+				std::copy(green.begin(), green.end(), out[1].begin() + chunk_idx * max_chunk_elems);
+				std::copy(blue.begin(), blue.end(), out[2].begin() + chunk_idx * max_chunk_elems);
+			};
+		this->visit_levels([&]() { return std::make_unique<detail::preview_visitor>(max_chunk_elems, sink); }, control);
+
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<compressed::channel<float32_t>> cryptomatte::generate_preview_compressed(const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		const auto& first_channel = this->m_RankChannels.begin()->second;
+		std::vector<compressed::channel<float32_t>> out;
+		for (size_t i = 0; i < 3; ++i)
+		{
+			auto channel = compressed::channel<float32_t>::zeros(
+				this->width(),
+				this->height(),
+				first_channel.compression(),
+				static_cast<uint8_t>(first_channel.compression_level()),
+				first_channel.block_size(),
+				first_channel.chunk_size()
+			);
+			channel.update_nthreads(1, first_channel.block_size());
+			out.push_back(std::move(channel));
+		}
+
+		std::array<std::mutex, 3> channel_mutexes;
+		detail::preview_visitor::sink_fn sink = [&](size_t chunk_idx, std::span<float32_t> red, std::span<float32_t> green, std::span<float32_t> blue)
+			{
+				std::array<std::span<float32_t>, 3> colors = { red, green, blue };
+				for (size_t i = 0; i < colors.size(); ++i)
+				{
+					std::lock_guard lock(channel_mutexes[i]);
+					out[i].set_chunk(colors[i], chunk_idx);
+				}
+			};
+		const size_t max_chunk_elems = first_channel.chunk_size() / sizeof(float32_t);
+		this->visit_levels([&]() { return std::make_unique<detail::preview_visitor>(max_chunk_elems, sink); }, control);
+
+		return out;
+	}
+
+
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
 	std::vector<float32_t> cryptomatte::mask(std::string name) const
@@ -358,48 +860,32 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	// -----------------------------------------------------------------------------------
 	std::vector<float32_t> cryptomatte::mask(uint32_t hash) const
 	{
-		std::vector<float32_t> out(this->width() * this->height());
-		// Get the hash as float32_t, this way we don't have to do this in the hot loop.
-		float32_t hash_val = std::bit_cast<float32_t>(hash);
-
-		// Iterate rank and coverage channels together
-		for (size_t i = 0; i + 1 < m_Channels.size(); i += 2)
+		if (m_RankChannels.empty())
 		{
-			// Our ctor performs validation that all of these are identical for purposes of iteration.
-			const auto& rank_channel = m_Channels[i].second;
-			const auto& covr_channel = m_Channels[i + 1].second;
-
-			size_t chunk_size_elems = rank_channel.chunk_size() / sizeof(float32_t);
+			return {};
+		}
+		std::vector<float32_t> out(this->width() * this->height());
+		const size_t max_chunk_elems = m_RankChannels.begin()->second.chunk_size() / sizeof(float32_t);
 
-			std::vector<float32_t> rank_chunk(chunk_size_elems);
-			std::vector<float32_t> covr_chunk(chunk_size_elems);
+		detail::flat_id_set requested;
+		requested.insert(hash);
 
-			// Iterate the chunks, decompressing on the fly
-			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, rank_channel.num_chunks()))
+		// Every chunk only writes to its own region of `out` so no synchronization is needed here.
+		this->decode_chunks(&requested, [&](size_t chunk_idx, float32_t, std::span<float32_t> mask)
 			{
-				size_t base_idx = chunk_size_elems * chunk_idx;
-				rank_channel.get_chunk(std::span<float32_t>(rank_chunk), chunk_idx);
-				covr_channel.get_chunk(std::span<float32_t>(covr_chunk), chunk_idx);
-
-				// Since the last chunk may hold less than `chunk_size` elements, we must account for this and ensure
-				// we are only at most going to the end of the `out` vector.
-				size_t num_elements = std::min<size_t>(out.size() - base_idx, chunk_size_elems);
-
-				// Accumulate the output pixel from all of the coverage channels.
-				auto pixel_iota = std::views::iota(size_t{ 0 }, num_elements);
-				std::for_each(std::execution::par_unseq, pixel_iota.begin(), pixel_iota.end(), [&](size_t idx)
-					{
-						if (rank_chunk[idx] == hash_val)
-						{
-							out[base_idx + idx] += covr_chunk[idx];
-						}
-					});
-			}
-		}
+				std::copy(mask.begin(), mask.end(), out.begin() + chunk_idx * max_chunk_elems);
+			}, task_control{});
 
 		return out;
 	}
 
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<float32_t> cryptomatte::mask_by_name_unmanifested(std::string_view name) const
+	{
+		return this->mask(hash_name(name));
+	}
+
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
@@ -428,7 +914,11 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	// -----------------------------------------------------------------------------------
 	compressed::channel<float32_t> cryptomatte::mask_compressed(uint32_t hash) const
 	{
-		const auto& first_channel = this->m_Channels.begin()->second;
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		const auto& first_channel = this->m_RankChannels.begin()->second;
 
 		// Generate a lazy channel that we will use to fill, using a lazy channel allows us to 
 		// not pay any memory allocation cost beyond a single chunk which will be reused. 
@@ -442,50 +932,21 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			first_channel.block_size(),
 			first_channel.chunk_size()
 		);
-		// Use a vector that doesn't default initialize, as compressed::channel::get_chunk will internally use
-		// std::fill on the buffer.
-		compressed::util::default_init_vector<float32_t> chunk_buffer(out.chunk_size());
+		out.update_nthreads(1, first_channel.block_size());
 
 		assert(out.chunk_size() == first_channel.chunk_size());
 		assert(out.num_chunks() == first_channel.num_chunks());
 
-		// Get the hash as float32_t, this way we don't have to do this in the hot loop.
-		float32_t hash_val = std::bit_cast<float32_t>(hash);
+		detail::flat_id_set requested;
+		requested.insert(hash);
 
-		// Iterate rank and coverage channels together
-		for (size_t i = 0; i + 1 < m_Channels.size(); i += 2)
-		{
-			const auto& rank_channel = m_Channels[i].second;
-			const auto& covr_channel = m_Channels[i + 1].second;
-
-			std::vector<float32_t> rank_chunk(rank_channel.chunk_size() / sizeof(float32_t));
-			std::vector<float32_t> covr_chunk(covr_channel.chunk_size() / sizeof(float32_t));
-
-			// Iterate the chunks, decompressing on the fly
-			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, rank_channel.num_chunks()))
+		std::mutex out_mutex;
+		this->decode_chunks(&requested, [&](size_t chunk_idx, float32_t, std::span<float32_t> mask)
 			{
-				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
-
-				// Will std::fill into the chunk_buffer (since its a lazy schunk).
-				out.get_chunk(std::span<float32_t>(chunk_buffer.data(), chunk_num_elems), chunk_idx);
-
-				rank_channel.get_chunk(std::span<float32_t>(rank_chunk.data(), chunk_num_elems), chunk_idx);
-				covr_channel.get_chunk(std::span<float32_t>(covr_chunk.data(), chunk_num_elems), chunk_idx);
-
-				// Accumulate the output pixel from all of the coverage channels.
-				auto pixel_iota = std::views::iota(size_t{ 0 }, chunk_num_elems);
-				std::for_each(std::execution::par_unseq, pixel_iota.begin(), pixel_iota.end(), [&](size_t idx)
-					{
-						if (rank_chunk[idx] == hash_val)
-						{
-							chunk_buffer[idx] += covr_chunk[idx];
-						}
-					});
-
-				// Set the chunk again (will recompress).
-				out.set_chunk(std::span<float32_t>(chunk_buffer.data(), chunk_num_elems), chunk_idx);
-			}
-		}
+				_CRYPTOMATTE_PROFILE_SCOPE("recompress mask chunks");
+				std::lock_guard lock(out_mutex);
+				out.set_chunk(mask, chunk_idx);
+			}, task_control{});
 
 		return out;
 	}
@@ -493,277 +954,139 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks(std::vector<std::string> names) const
+	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks(std::vector<std::string> names, const task_control& control /* = {} */) const
 	{
-		if (!m_Metadata.manifest().has_value())
-		{
-			throw std::invalid_argument(
-				"Unable to extract the masks by their names if there is no manifest present on the cryptomatte."
-			);
-		}
-
-		auto manif = m_Metadata.manifest().value();
-		std::vector<uint32_t> hashes;
-		for (const auto& name : names)
-		{
-			// This will throw std::invalid_argument on failure to find the name.
-			hashes.push_back(manif.hash(name));
-		}
-		return masks(std::move(hashes));
+		return masks(this->hashes_from_names(names), control);
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks(std::vector<uint32_t> hashes) const
+	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks(std::vector<uint32_t> hashes, const task_control& control /* = {} */) const
 	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+
 		// Set up the output map mapped by float32_t at first since that is the storage type, we remap later outside
 		// of the hot loop.
 		std::unordered_map<float32_t, std::vector<float32_t>> out;
-		std::unordered_set<float32_t> requested_hashes;
-		const auto& first_channel = this->m_Channels.begin()->second;
+		detail::flat_id_set requested;
+		const auto& first_channel = this->m_RankChannels.begin()->second;
 		const auto _first_chunk_num_elems = first_channel.chunk_size() / sizeof(float32_t);
 		const auto _width = this->width();
 		const auto _height = this->height();
 		for (const auto& hash : hashes)
 		{
-			requested_hashes.insert(std::bit_cast<float32_t>(hash));
+			requested.insert(hash);
 			out[std::bit_cast<float32_t>(hash)] = {};
 		}
-		std::for_each(std::execution::par_unseq, out.begin(), out.end(), [&](auto& pair)
-			{
-				pair.second = std::vector<float32_t>(_width * _height);
-			});
-
-		compressed::util::default_init_vector<float32_t> rank_chunk(first_channel.chunk_size() / sizeof(float32_t));
-		compressed::util::default_init_vector<float32_t> covr_chunk(first_channel.chunk_size() / sizeof(float32_t));
 
-		// Iterate rank and coverage channels together
-		for (size_t i = 0; i + 1 < m_Channels.size(); i += 2)
+		// Allocate the masks in parallel, this is usually faster as it zero-initializes the memory.
+		auto exec = detail::resolve_executor(m_Executor);
+		std::vector<float32_t> out_keys;
+		for (const auto& [key, _] : out)
 		{
-			_CRYPTOMATTE_PROFILE_SCOPE("iter rank-coverage pairs");
-			const auto& rank_channel = m_Channels[i].second;
-			const auto& covr_channel = m_Channels[i + 1].second;
-
-			std::unordered_set<float32_t> hashes_in_rank_channel;
-
-			// Iterate the chunks, decompressing on the fly
-			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, rank_channel.num_chunks()))
+			out_keys.push_back(key);
+		}
+		exec->parallel_for(out_keys.size(), 1, [&](size_t begin, size_t end)
 			{
-				_CRYPTOMATTE_PROFILE_SCOPE("iter chunks");
-
-				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress rank chunk");
-					rank_channel.get_chunk(std::span<float32_t>(rank_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				const size_t thread_count = std::thread::hardware_concurrency();
-				auto _ids_in_chunk = detail::accumulate_ids_in_rank_chunk(std::span<float32_t>(rank_chunk), thread_count);
-				hashes_in_rank_channel.insert(_ids_in_chunk.begin(), _ids_in_chunk.end());
-
-				// Since we only care about the hashes we were asked about, we take the intersection of the ids requested
-				// and the ids in the chunk.
-				std::unordered_set<float32_t> ids_in_chunk_isection;
-				for (const auto& id : _ids_in_chunk) 
-				{
-					if (requested_hashes.count(id)) 
-					{
-						ids_in_chunk_isection.insert(id);
-					}
-				}
-
-
-				// No ids in chunk -> skip
-				if (ids_in_chunk_isection.empty())
+				for (size_t i = begin; i < end; ++i)
 				{
-					continue;
-				}
-
-				// Only now decompress the coverage channel, once we know there's data to get.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress coverage chunk");
-					covr_channel.get_chunk(std::span<float32_t>(covr_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				// First set up the spans correctly
-				std::unordered_map<float32_t, std::span<float32_t>> mask_spans;
-				for (auto id : ids_in_chunk_isection)
-				{
-					size_t base_offset = chunk_idx * _first_chunk_num_elems;
-					mask_spans[id] = std::span<float32_t>(out.at(id).data() + base_offset, chunk_num_elems);
-				}
-
-
-				// Accumulate the output pixel from all of the coverage channels.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("accumulate masks");
-					auto pixel_iota = std::views::iota(size_t{ 0 }, chunk_num_elems);
-					std::for_each(std::execution::par_unseq, pixel_iota.begin(), pixel_iota.end(), [&](size_t idx)
-						{
-							// Skip any zero rank-channels, accumulate the rest, 
-							if (rank_chunk[idx] != static_cast<float32_t>(0))
-							{
-								if (ids_in_chunk_isection.contains(rank_chunk[idx]))
-								{
-									auto& it = mask_spans.at(rank_chunk[idx]);
-									it[idx] += covr_chunk[idx];
-								}
-							}
-						});
+					out.at(out_keys[i]) = std::vector<float32_t>(_width * _height);
 				}
+			});
 
-				// Once we have zero hashes in the whole rank channel, we can be pretty confident 
-				// that there will be no more hashes in subsequent rank-coverage pairs due to the 
-				// cascading nature of hashes, therefore we can safely exit out of the loop saving
-				// us iteration and decompression/compression costs.
-				if (hashes_in_rank_channel.empty())
-				{
-					break;
-				}
-			}
-		}
+		// The map is not modified anymore so it is safe to read from multiple threads, and every chunk only writes 
+		// to its own region of the masks.
+		this->decode_chunks(&requested, [&](size_t chunk_idx, float32_t id, std::span<float32_t> mask)
+			{
+				_CRYPTOMATTE_PROFILE_SCOPE("copy mask chunks");
+				std::copy(mask.begin(), mask.end(), out.at(id).begin() + chunk_idx * _first_chunk_num_elems);
+			}, control);
 
 		// Now convert the floating point values into strings for the output mapping.
 		return detail::map_to_string(
 			std::move(out),
-			m_Metadata.manifest().value_or(NAMESPACE_CRYPTOMATTE_API::manifest())
+			m_Metadata.manifest()
 		);
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks() const
+	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks(const task_control& control /* = {} */) const
 	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+
 		// Set up the output map mapped by float32_t at first since that is the storage type, we remap later outside
 		// of the hot loop.
 		std::unordered_map<float32_t, std::vector<float32_t>> out;
-		const auto& first_channel = this->m_Channels.begin()->second;
+		std::mutex out_mutex;
+		const auto& first_channel = this->m_RankChannels.begin()->second;
 		const auto _first_chunk_num_elems = first_channel.chunk_size() / sizeof(float32_t);
 		const auto _width = this->width();
 		const auto _height = this->height();
 
-		compressed::util::default_init_vector<float32_t> rank_chunk(first_channel.chunk_size() / sizeof(float32_t));
-		compressed::util::default_init_vector<float32_t> covr_chunk(first_channel.chunk_size() / sizeof(float32_t));
-
-		// Iterate rank and coverage channels together
-		for (size_t i = 0; i + 1 < m_Channels.size(); i += 2)
-		{
-			_CRYPTOMATTE_PROFILE_SCOPE("iter rank-coverage pairs");
-			const auto& rank_channel = m_Channels[i].second;
-			const auto& covr_channel = m_Channels[i + 1].second;
-
-			std::unordered_set<float32_t> hashes_in_rank_channel;
-
-			// Iterate the chunks, decompressing on the fly
-			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, rank_channel.num_chunks()))
+		this->decode_chunks(nullptr, [&](size_t chunk_idx, float32_t id, std::span<float32_t> mask)
 			{
-				_CRYPTOMATTE_PROFILE_SCOPE("iter chunks");
-
-				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress rank chunk");
-					rank_channel.get_chunk(std::span<float32_t>(rank_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				const size_t thread_count = std::thread::hardware_concurrency();
-				auto _ids_in_chunk = detail::accumulate_ids_in_rank_chunk(std::span<float32_t>(rank_chunk), thread_count);
-				hashes_in_rank_channel.insert(_ids_in_chunk.begin(), _ids_in_chunk.end());
-
-				// No ids in chunk -> skip
-				if (_ids_in_chunk.empty())
-				{
-					continue;
-				}
-
-				// Allocate all the memory for any masks that are not yet initialized.
-				for (const auto& hash : _ids_in_chunk)
+				_CRYPTOMATTE_PROFILE_SCOPE("copy mask chunks");
+				// Lazily allocate the masks as we encounter them, the allocation itself happens outside of 
+				// the lock so multiple workers can zero-initialize their masks concurrently.
+				float32_t* mask_data = nullptr;
 				{
-					if (!out.contains(hash))
+					std::lock_guard lock(out_mutex);
+					auto it = out.find(id);
+					if (it != out.end())
 					{
-						out[std::bit_cast<float32_t>(hash)] = std::vector<float32_t>(_width * _height);
+						mask_data = it->second.data();
 					}
 				}
-
-				// Only now decompress the coverage channel, once we know there's data to get.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress coverage chunk");
-					covr_channel.get_chunk(std::span<float32_t>(covr_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				// First set up the spans correctly
-				std::unordered_map<float32_t, std::span<float32_t>> mask_spans;
-				for (auto id : _ids_in_chunk)
-				{
-					size_t base_offset = chunk_idx * _first_chunk_num_elems;
-					mask_spans[id] = std::span<float32_t>(out.at(id).data() + base_offset, chunk_num_elems);
-				}
-
-
-				// Accumulate the output pixel from all of the coverage channels.
+				if (!mask_data)
 				{
-					_CRYPTOMATTE_PROFILE_SCOPE("accumulate masks");
-					auto pixel_iota = std::views::iota(size_t{ 0 }, chunk_num_elems);
-					std::for_each(std::execution::par_unseq, pixel_iota.begin(), pixel_iota.end(), [&](size_t idx)
-						{
-							// Skip any zero rank-channels, accumulate the rest, 
-							if (rank_chunk[idx] != static_cast<float32_t>(0))
-							{
-								auto& it = mask_spans.at(rank_chunk[idx]);
-								it[idx] += covr_chunk[idx];
-							}
-						});
+					std::vector<float32_t> mask_buffer(_width * _height);
+					std::lock_guard lock(out_mutex);
+					// Another worker may have inserted the same mask in the meantime in which case this is a no-op.
+					auto [it, _] = out.try_emplace(id, std::move(mask_buffer));
+					mask_data = it->second.data();
 				}
 
-				// Once we have zero hashes in the whole rank channel, we can be pretty confident 
-				// that there will be no more hashes in subsequent rank-coverage pairs due to the 
-				// cascading nature of hashes, therefore we can safely exit out of the loop saving
-				// us iteration and decompression/compression costs.
-				if (hashes_in_rank_channel.empty())
-				{
-					break;
-				}
-			}
-		}
+				std::copy(mask.begin(), mask.end(), mask_data + chunk_idx * _first_chunk_num_elems);
+			}, control);
 
 		// Now convert the floating point values into strings for the output mapping.
 		return detail::map_to_string(
 			std::move(out),
-			m_Metadata.manifest().value_or(NAMESPACE_CRYPTOMATTE_API::manifest())
+			m_Metadata.manifest()
 		);
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed(std::vector<std::string> names) const
+	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed(std::vector<std::string> names, const task_control& control /* = {} */) const
 	{
-		if (!m_Metadata.manifest().has_value())
-		{
-			throw std::invalid_argument(
-				"Unable to extract the masks by their names if there is no manifest present on the cryptomatte."
-			);
-		}
-
-		auto manif = m_Metadata.manifest().value();
-		std::vector<uint32_t> hashes;
-		for (const auto& name : names)
-		{
-			// This will throw std::invalid_argument on failure to find the name.
-			hashes.push_back(manif.hash(name));
-		}
-		return masks_compressed(std::move(hashes));
+		return masks_compressed(this->hashes_from_names(names), control);
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed(std::vector<uint32_t> hashes) const
+	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed(std::vector<uint32_t> hashes, const task_control& control /* = {} */) const
 	{
 		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
 
 		// Set up the output map mapped by float32_t at first since that is the storage type, we remap later outside
 		// of the hot loop.
 		std::unordered_map<float32_t, compressed::channel<float32_t>> out;
-		std::unordered_set<float32_t> requested_hashes;
-		const auto& first_channel = this->m_Channels.begin()->second;
+		detail::flat_id_set requested;
+		const auto& first_channel = this->m_RankChannels.begin()->second;
 		const auto _width = this->width();
 		const auto _height = this->height();
 		for (const auto& hash : hashes)
@@ -782,134 +1105,39 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			);
 			channel.update_nthreads(1, first_channel.block_size());
 			out[std::bit_cast<float32_t>(hash)] = std::move(channel);
-			requested_hashes.insert(std::bit_cast<float32_t>(hash));
+			requested.insert(hash);
 		}
 
-		// Allocate a contiguous memory chunk and generate an index into it based off the ids request. 
-		// This allows us to fill the memory to zeros in parallel (which is usually faster)
-		// while also being a contiguous chunk for better data locality.
-		compressed::util::default_init_vector<float32_t> _mask_buffer;
-
-		compressed::util::default_init_vector<float32_t> rank_chunk(first_channel.chunk_size() / sizeof(float32_t));
-		compressed::util::default_init_vector<float32_t> covr_chunk(first_channel.chunk_size() / sizeof(float32_t));
-
-		// Iterate rank and coverage channels together
-		for (size_t i = 0; i + 1 < m_Channels.size(); i += 2)
-		{
-			_CRYPTOMATTE_PROFILE_SCOPE("iter rank-coverage pairs");
-			const auto& rank_channel = m_Channels[i].second;
-			const auto& covr_channel = m_Channels[i + 1].second;
-
-			std::unordered_set<float32_t> hashes_in_rank_channel;
-
-			// Iterate the chunks, decompressing on the fly
-			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, rank_channel.num_chunks()))
-			{
-				_CRYPTOMATTE_PROFILE_SCOPE("iter chunks");
-
-				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress rank chunk");
-					rank_channel.get_chunk(std::span<float32_t>(rank_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				const size_t thread_count = std::thread::hardware_concurrency();
-				auto _ids_in_chunk = detail::accumulate_ids_in_rank_chunk(std::span<float32_t>(rank_chunk), thread_count);
-				hashes_in_rank_channel.insert(_ids_in_chunk.begin(), _ids_in_chunk.end());
-
-				// Since we only care about the hashes we were asked about, we take the intersection of the ids requested
-				// and the ids in the chunk.
-				std::unordered_set<float32_t> ids_in_chunk_isection;
-				for (const auto& id : _ids_in_chunk) 
-				{
-					if (requested_hashes.count(id)) 
-					{
-						ids_in_chunk_isection.insert(id);
-					}
-				}
-
-
-				// No ids in chunk -> skip
-				if (ids_in_chunk_isection.empty())
-				{
-					continue;
-				}
-
-				// Only now decompress the coverage channel, once we know there's data to get.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress coverage chunk");
-					covr_channel.get_chunk(std::span<float32_t>(covr_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				// Resize the vector only if we need a larger size, avoids having to realloc this data every iteration.
-				// gives us back a mapping of ids to spans to use for mask decoding.
-				auto mask_spans = detail::realloc_mask_buffer_if_necessary(_mask_buffer, ids_in_chunk_isection, chunk_num_elems);
-
-				// Now fill them in parallel, note that this doesn't std::fill 0 into the vector but instead
-				// uses get_chunk in case any of the previous rank-coverage pairs already included this mask.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress mask chunks");
-					std::for_each(std::execution::par_unseq, mask_spans.begin(), mask_spans.end(), [&](auto pair)
-						{
-							auto key = pair.first;
-							out.at(key).get_chunk(pair.second, chunk_idx);
-						});
-				}
-
-				// Accumulate the output pixel from all of the coverage channels.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("accumulate masks");
-					auto pixel_iota = std::views::iota(size_t{ 0 }, chunk_num_elems);
-					std::for_each(std::execution::par_unseq, pixel_iota.begin(), pixel_iota.end(), [&](size_t idx)
-						{
-							// Skip any zero rank-channels, accumulate the rest, 
-							if (rank_chunk[idx] != static_cast<float32_t>(0))
-							{
-								if (ids_in_chunk_isection.contains(rank_chunk[idx]))
-								{
-									auto& it = mask_spans.at(rank_chunk[idx]);
-									it[idx] += covr_chunk[idx];
-								}
-							}
-						});
-				}
-
-				// Set the data again, will recompress
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("recompress mask chunks");
-					std::for_each(std::execution::par_unseq, mask_spans.begin(), mask_spans.end(), [&](auto pair)
-						{
-							auto key = pair.first;
-							out.at(key).set_chunk(pair.second, chunk_idx);
-						});
-				}
-			}
-
-			// Once we have zero hashes in the whole rank channel, we can be pretty confident 
-			// that there will be no more hashes in subsequent rank-coverage pairs due to the 
-			// cascading nature of hashes, therefore we can safely exit out of the loop saving
-			// us iteration and decompression/compression costs.
-			if (hashes_in_rank_channel.empty())
+		// The map itself is not modified anymore so it is safe to read from multiple threads, the channels however
+		// need to be locked as multiple workers may write different chunks of the same mask.
+		detail::striped_mutex channel_mutexes;
+		this->decode_chunks(&requested, [&](size_t chunk_idx, float32_t id, std::span<float32_t> mask)
 			{
-				break;
-			}
-		}
+				_CRYPTOMATTE_PROFILE_SCOPE("recompress mask chunks");
+				std::lock_guard lock(channel_mutexes.get(std::bit_cast<uint32_t>(id)));
+				out.at(id).set_chunk(mask, chunk_idx);
+			}, control);
 
 		// Now convert the floating point values into strings for the output mapping.
 		return detail::map_to_string(
 			std::move(out),
-			m_Metadata.manifest().value_or(NAMESPACE_CRYPTOMATTE_API::manifest())
+			m_Metadata.manifest()
 		);
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed() const
+	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed(const task_control& control /* = {} */) const
 	{
 		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
 		// Generate this as a float32_t and then remap later since the pixels store it as float32_t so we don't have
 		// to do this in the hot loop
 		std::unordered_map<float32_t, compressed::channel<float32_t>> out;
+		std::mutex out_mutex;
 		if (m_Metadata.manifest())
 		{
 			out.reserve(m_Metadata.manifest().value().size());
@@ -917,7 +1145,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 		// Lambda for generating a new lazy channel on demand. This way we only
 		// create the channels when we encounter them.
-		const auto& first_channel = this->m_Channels.begin()->second;
+		const auto& first_channel = this->m_RankChannels.begin()->second;
 		const auto _width = this->width();
 		const auto _height = this->height();
 		auto generate_lazy_channel = [&]()
@@ -939,123 +1167,965 @@ namespace NAMESPACE_CRYPTOMATTE_API
 				return channel;
 			};
 
-
-		// Allocate a contiguous memory chunk and generate an index into it based off all the ids in the 
-		// current chunk. This allows us to fill the memory to zeros in parallel (which is usually faster)
-		// while also being a contiguous chunk for better data locality.
-		compressed::util::default_init_vector<float32_t> _mask_buffer;
-
-		compressed::util::default_init_vector<float32_t> rank_chunk(first_channel.chunk_size() / sizeof(float32_t));
-		compressed::util::default_init_vector<float32_t> covr_chunk(first_channel.chunk_size() / sizeof(float32_t));
-
-		// Iterate rank and coverage channels together
-		for (size_t i = 0; i + 1 < m_Channels.size(); i += 2)
-		{
-			_CRYPTOMATTE_PROFILE_SCOPE("iter rank-coverage pairs");
-			const auto& rank_channel = m_Channels[i].second;
-			const auto& covr_channel = m_Channels[i + 1].second;
-
-			std::unordered_set<float32_t> hashes_in_rank_channel;
-
-			// Iterate the chunks, decompressing on the fly
-			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, rank_channel.num_chunks()))
+		// Multiple workers may write different chunks of the same mask so the channels need to be locked 
+		// individually, the map itself is guarded by `out_mutex`.
+		detail::striped_mutex channel_mutexes;
+		this->decode_chunks(nullptr, [&](size_t chunk_idx, float32_t id, std::span<float32_t> mask)
 			{
-				_CRYPTOMATTE_PROFILE_SCOPE("iter chunks");
-
-				size_t chunk_num_elems = rank_channel.chunk_size(chunk_idx) / sizeof(float32_t);
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress rank chunk");
-					rank_channel.get_chunk(std::span<float32_t>(rank_chunk.data(), chunk_num_elems), chunk_idx);
-				}
-
-				const size_t thread_count = std::thread::hardware_concurrency();
-				auto ids_in_chunk = detail::accumulate_ids_in_rank_chunk(std::span<float32_t>(rank_chunk), thread_count);
-				hashes_in_rank_channel.insert(ids_in_chunk.begin(), ids_in_chunk.end());
+				_CRYPTOMATTE_PROFILE_SCOPE("recompress mask chunks");
+				compressed::channel<float32_t>* channel = nullptr;
 				{
-					_CRYPTOMATTE_PROFILE_SCOPE("generate_lazy_channel");
-					for (float32_t id : ids_in_chunk)
+					std::lock_guard lock(out_mutex);
+					auto it = out.find(id);
+					if (it == out.end())
 					{
-						if (!out.contains(id))
-						{
-							out[id] = generate_lazy_channel();
-						}
+						it = out.emplace(id, generate_lazy_channel()).first;
 					}
+					channel = &it->second;
 				}
 
-				// No ids in chunk -> skip
-				if (ids_in_chunk.empty())
-				{
-					continue;
-				}
+				std::lock_guard lock(channel_mutexes.get(std::bit_cast<uint32_t>(id)));
+				channel->set_chunk(mask, chunk_idx);
+			}, control);
 
-				// Only now decompress the coverage channel, once we know there's data to get.
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress coverage chunk");
-					covr_channel.get_chunk(std::span<float32_t>(covr_chunk.data(), chunk_num_elems), chunk_idx);
-				}
+		// Now convert the floating point values into strings for the output mapping.
+		return detail::map_to_string(
+			std::move(out), 
+			m_Metadata.manifest()
+		);
+	}
 
-				// Resize the vector only if we need a larger size, avoids having to realloc this data every iteration.
-				auto mask_spans = detail::realloc_mask_buffer_if_necessary(_mask_buffer, ids_in_chunk, chunk_num_elems);
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::unordered_map<std::string, std::vector<float32_t>> cryptomatte::masks_matching(std::string_view pattern, const task_control& control /* = {} */) const
+	{
+		if (!m_Metadata.manifest().has_value())
+		{
+			throw std::invalid_argument(
+				std::format("Unable to extract the masks matching '{}' if there is no manifest present on the cryptomatte.", pattern)
+			);
+		}
 
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("decompress mask chunks");
-					// Now fill them in parallel, note that this doesn't std::fill 0 into the vector but instead
-					// uses get_chunk in case any of the previous rank-coverage pairs already included this mask.
-					std::for_each(std::execution::par_unseq, mask_spans.begin(), mask_spans.end(), [&](auto pair)
-						{
-							auto key = pair.first;
-							out.at(key).get_chunk(pair.second, chunk_idx);
-						});
-				}
+		auto hashes = m_Metadata.manifest().value().hashes_matching(pattern);
+		if (hashes.empty())
+		{
+			return {};
+		}
+		return this->masks(std::move(hashes), control);
+	}
 
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("accumulate masks");
-					// Accumulate the output pixel from all of the coverage channels.
-					auto pixel_iota = std::views::iota(size_t{ 0 }, chunk_num_elems);
-					std::for_each(std::execution::par_unseq, pixel_iota.begin(), pixel_iota.end(), [&](size_t idx)
-						{
-							// Skip any zero rank-channels, accumulate the rest, 
-							if (rank_chunk[idx] != static_cast<float32_t>(0))
-							{
-								auto& it = mask_spans.at(rank_chunk[idx]);
-								it[idx] += covr_chunk[idx];
-							}
-						});
-				}
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::unordered_map<std::string, compressed::channel<float32_t>> cryptomatte::masks_compressed_matching(std::string_view pattern, const task_control& control /* = {} */) const
+	{
+		if (!m_Metadata.manifest().has_value())
+		{
+			throw std::invalid_argument(
+				std::format("Unable to extract the masks matching '{}' if there is no manifest present on the cryptomatte.", pattern)
+			);
+		}
 
-				{
-					_CRYPTOMATTE_PROFILE_SCOPE("recompress mask chunks");
-					// Set the data again, will recompress
-					std::for_each(std::execution::par_unseq, mask_spans.begin(), mask_spans.end(), [&](auto pair)
-						{
-							auto key = pair.first;
-							out.at(key).set_chunk(pair.second, chunk_idx);
-						});
-				}
-			}
-		
-			// Once we have zero hashes in the whole rank channel, we can be pretty confident 
-			// that there will be no more hashes in subsequent rank-coverage pairs due to the 
-			// cascading nature of hashes, therefore we can safely exit out of the loop saving
-			// us iteration and decompression/compression costs.
-			if (hashes_in_rank_channel.empty())
-			{
-				break;
-			}
+		auto hashes = m_Metadata.manifest().value().hashes_matching(pattern);
+		if (hashes.empty())
+		{
+			return {};
 		}
+		return this->masks_compressed(std::move(hashes), control);
+	}
 
-		// Now convert the floating point values into strings for the output mapping.
-		return detail::map_to_string(
-			std::move(out), 
-			m_Metadata.manifest().value_or(NAMESPACE_CRYPTOMATTE_API::manifest())
-		);
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<float32_t> cryptomatte::mask_union(std::vector<std::string> names, const task_control& control /* = {} */) const
+	{
+		return this->mask_union(this->hashes_from_names(names), control);
 	}
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	size_t cryptomatte::num_levels() const noexcept
+	std::vector<float32_t> cryptomatte::mask_union(std::vector<uint32_t> hashes, const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		std::vector<float32_t> out(this->width() * this->height());
+		const size_t max_chunk_elems = m_RankChannels.begin()->second.chunk_size() / sizeof(float32_t);
+
+		// Every chunk only writes to its own region of `out` so no synchronization is needed here.
+		const detail::id_membership membership(hashes);
+		detail::union_visitor::sink_fn sink = [&](size_t chunk_idx, std::span<float32_t> mask)
+			{
+				std::copy(mask.begin(), mask.end(), out.begin() + chunk_idx * max_chunk_elems);
+			};
+		this->visit_levels([&]() { return std::make_unique<detail::union_visitor>(max_chunk_elems, membership, sink); }, control);
+
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	compressed::channel<float32_t> cryptomatte::mask_union_compressed(std::vector<std::string> names, const task_control& control /* = {} */) const
+	{
+		return this->mask_union_compressed(this->hashes_from_names(names), control);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	compressed::channel<float32_t> cryptomatte::mask_union_compressed(std::vector<uint32_t> hashes, const task_control& control /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		const auto& first_channel = this->m_RankChannels.begin()->second;
+		auto out = compressed::channel<float32_t>::zeros(
+			this->width(),
+			this->height(),
+			first_channel.compression(),
+			static_cast<uint8_t>(first_channel.compression_level()),
+			first_channel.block_size(),
+			first_channel.chunk_size()
+		);
+		out.update_nthreads(1, first_channel.block_size());
+
+		std::mutex out_mutex;
+		const detail::id_membership membership(hashes);
+		detail::union_visitor::sink_fn sink = [&](size_t chunk_idx, std::span<float32_t> mask)
+			{
+				_CRYPTOMATTE_PROFILE_SCOPE("recompress mask chunks");
+				std::lock_guard lock(out_mutex);
+				out.set_chunk(mask, chunk_idx);
+			};
+		const size_t max_chunk_elems = first_channel.chunk_size() / sizeof(float32_t);
+		this->visit_levels([&]() { return std::make_unique<detail::union_visitor>(max_chunk_elems, membership, sink); }, control);
+
+		return out;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::write_masks(std::filesystem::path file, std::vector<std::string> names, const write_options& options /* = {} */) const
+	{
+		this->write_masks(std::move(file), this->hashes_from_names(names), options);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::write_masks(std::filesystem::path file, std::vector<uint32_t> hashes, const write_options& options /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (hashes.empty())
+		{
+			throw std::invalid_argument(
+				std::format("Unable to write masks to '{}' as no masks were requested", file.string())
+			);
+		}
+		if (m_RankChannels.empty())
+		{
+			throw std::invalid_argument(
+				std::format("Unable to write masks to '{}' as the cryptomatte holds no levels", file.string())
+			);
+		}
+
+		// Drop any duplicates while retaining the requested order, as the names of the channels (or parts) must
+		// be unique. Empty ids cannot be held by the set but are never present in the image either, so these
+		// are simply checked against the ones already taken.
+		std::vector<uint32_t> unique_hashes;
+		detail::flat_id_set seen(hashes.size());
+		for (auto hash : hashes)
+		{
+			const bool is_new = detail::flat_id_set::is_empty_id(hash)
+				? std::find(unique_hashes.begin(), unique_hashes.end(), hash) == unique_hashes.end()
+				: seen.insert(hash);
+			if (is_new)
+			{
+				unique_hashes.push_back(hash);
+			}
+		}
+
+		// Resolve the names the same way as `masks_compressed` maps them.
+		const auto& manif = m_Metadata.manifest();
+		std::vector<std::string> names;
+		for (auto hash : unique_hashes)
+		{
+			auto manifest_name = manif ? manif->name(hash) : std::nullopt;
+			names.push_back(manifest_name ? std::string(*manifest_name) : detail::uint32_t_to_hex_str(hash));
+		}
+
+		auto exec = detail::resolve_executor(m_Executor);
+		if (options.layout == mask_layout::parts)
+		{
+			// Every part has to be written in full before the next one, so the masks are decoded into compressed
+			// buffers first which are then streamed out part by part. This keeps the memory usage bounded by the 
+			// compressed size of the masks (which are mostly empty) rather than their uncompressed size.
+			auto masks = this->masks_compressed(unique_hashes, options.control);
+			std::vector<std::pair<std::string, const compressed::channel<float32_t>*>> channels;
+			for (auto& name : names)
+			{
+				const auto* channel = &masks.at(name);
+				channels.push_back({ std::move(name), channel });
+			}
+			detail::write_channels(file, channels, options, *exec);
+			return;
+		}
+
+		// With all masks in a single part we can write the scanlines as soon as their chunk is decoded, only ever
+		// holding the masks of the chunks in flight in memory.
+		detail::flat_id_map<uint32_t> channel_indices(unique_hashes.size());
+		detail::flat_id_set requested(unique_hashes.size());
+		for (size_t i = 0; i < unique_hashes.size(); ++i)
+		{
+			if (!detail::flat_id_set::is_empty_id(unique_hashes[i]))
+			{
+				channel_indices.try_emplace(unique_hashes[i], static_cast<uint32_t>(i));
+				requested.insert(unique_hashes[i]);
+			}
+		}
+
+		const auto& first_channel = m_RankChannels.begin()->second;
+		detail::write_channels_streamed(
+			file,
+			names,
+			this->width(),
+			this->height(),
+			first_channel.chunk_size() / sizeof(float32_t),
+			options,
+			*exec,
+			[&](detail::scanline_interleaver& interleaver)
+			{
+				// The chunks are handed to the sink in order so once a later chunk arrives all the previous ones
+				// are complete. Chunks (and masks) the sink is never called for are left empty.
+				std::mutex advance_mutex;
+				auto advance_to = [&](size_t chunk_idx)
+					{
+						while (interleaver.chunk_idx() < chunk_idx)
+						{
+							interleaver.finish_chunk();
+							interleaver.clear();
+						}
+					};
+
+				interleaver.clear();
+				this->decode_chunks(&requested, [&](size_t chunk_idx, float32_t id, std::span<float32_t> mask)
+					{
+						{
+							std::lock_guard lock(advance_mutex);
+							advance_to(chunk_idx);
+						}
+						interleaver.set(*channel_indices.find(std::bit_cast<uint32_t>(id)), mask);
+					}, options.control);
+				advance_to(interleaver.num_chunks());
+			});
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::write(std::filesystem::path file, const std::string& compression /* = "zip" */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			throw std::invalid_argument(
+				std::format("Unable to write the cryptomatte to '{}' as it holds no levels", file.string())
+			);
+		}
+		const auto& first_channel = m_RankChannels.front().second;
+		const size_t max_chunk_elems = first_channel.chunk_size() / sizeof(float32_t);
+
+		std::vector<std::string> channel_names;
+		std::vector<detail::chunk_reader> readers;
+
+		// The preview channels are not validated against the cryptomatte channels on construction so they may
+		// have a different chunk layout, in which case we cannot stream them in lockstep. As these are only ever
+		// up to 3 channels we simply decompress those up-front.
+		std::vector<std::string> legacy_names;
+		for (const auto& [name, _] : m_LegacyChannels)
+		{
+			legacy_names.push_back(name);
+		}
+		std::sort(legacy_names.begin(), legacy_names.end());
+		std::vector<std::vector<float32_t>> decompressed_legacy;
+		decompressed_legacy.reserve(legacy_names.size());
+		for (const auto& name : legacy_names)
+		{
+			const auto& channel = m_LegacyChannels.at(name);
+			channel_names.push_back(name);
+			if (channel.chunk_size() == first_channel.chunk_size() && channel.num_chunks() == first_channel.num_chunks())
+			{
+				readers.push_back([this, &channel](std::span<float32_t> buffer, size_t chunk_idx)
+					{
+						std::lock_guard lock(m_ChannelLocks->legacy);
+						channel.get_chunk(buffer, chunk_idx);
+					});
+			}
+			else
+			{
+				std::unique_lock lock(m_ChannelLocks->legacy);
+				const auto& data = decompressed_legacy.emplace_back(channel.get_decompressed());
+				lock.unlock();
+				readers.push_back([&data, max_chunk_elems](std::span<float32_t> buffer, size_t chunk_idx)
+					{
+						std::copy_n(data.begin() + chunk_idx * max_chunk_elems, buffer.size(), buffer.begin());
+					});
+			}
+		}
+
+		// Rank and coverage channels are interleaved per level which gives us the sorted channel order.
+		for (size_t level = 0; level < m_RankChannels.size(); ++level)
+		{
+			const auto& [rank_name, rank_channel] = m_RankChannels[level];
+			const auto& [coverage_name, covr_channel] = m_CoverageChannels[level];
+			channel_names.push_back(rank_name);
+			readers.push_back([this, level, &rank_channel](std::span<float32_t> buffer, size_t chunk_idx)
+				{
+					std::lock_guard lock(m_ChannelLocks->rank[level]);
+					rank_channel.get_chunk(buffer, chunk_idx);
+				});
+			channel_names.push_back(coverage_name);
+			readers.push_back([this, level, &covr_channel](std::span<float32_t> buffer, size_t chunk_idx)
+				{
+					std::lock_guard lock(m_ChannelLocks->coverage[level]);
+					covr_channel.get_chunk(buffer, chunk_idx);
+				});
+		}
+
+		OIIO::ImageSpec spec(
+			static_cast<int>(this->width()),
+			static_cast<int>(this->height()),
+			static_cast<int>(channel_names.size()),
+			OIIO::TypeDesc::FLOAT
+		);
+		spec.channelnames = std::move(channel_names);
+		spec.attribute("compression", compression);
+		auto metadata_json = m_Metadata.to_json();
+		for (const auto& [key, value] : metadata_json.items())
+		{
+			spec.attribute(key, value.template get<std::string>());
+		}
+
+		auto exec = detail::resolve_executor(m_Executor);
+		detail::write_image(file, spec, readers, max_chunk_elems, *exec, {});
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::decode_chunks(
+		const detail::flat_id_set* requested,
+		const detail::mask_visitor::sink_fn& sink,
+		const task_control& control
+	) const
+	{
+		if (m_DecodeStrategy == NAMESPACE_CRYPTOMATTE_API::decode_strategy::pipelined)
+		{
+			this->decode_chunks_pipelined(requested, sink, control);
+			return;
+		}
+
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		this->visit_levels([&]() { return std::make_unique<detail::mask_visitor>(requested, sink); }, control);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::unordered_map<uint32_t, id_statistics> cryptomatte::compute_statistics(
+		const detail::flat_id_set* requested,
+		const task_control& control
+	) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return {};
+		}
+		const size_t max_chunk_elems = m_RankChannels.begin()->second.chunk_size() / sizeof(float32_t);
+
+		// Every worker reduces into its own map, these are only merged once per worker.
+		std::unordered_map<uint32_t, id_statistics> out;
+		std::mutex out_mutex;
+		detail::statistics_visitor::sink_fn sink = [&](const detail::statistics_visitor::statistics_map& statistics)
+			{
+				std::lock_guard lock(out_mutex);
+				for (const auto& [hash, id_stats] : statistics)
+				{
+					out[hash].merge(id_stats);
+				}
+			};
+		this->visit_levels(
+			[&]() { return std::make_unique<detail::statistics_visitor>(this->width(), max_chunk_elems, requested, sink); },
+			control
+		);
+
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	detail::decoded_chunk cryptomatte::decode_levels(size_t chunk_idx, std::span<const size_t> offsets /* = {} */) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		const size_t chunk_num_elems = m_RankChannels.begin()->second.chunk_size(chunk_idx) / sizeof(float32_t);
+
+		detail::decoded_chunk chunk;
+		chunk.rank.resize(this->num_levels());
+		chunk.coverage.resize(this->num_levels());
+		for (size_t level = 0; level < this->num_levels(); ++level)
+		{
+			// Empty chunks hold no ids so there is no need to decompress them.
+			if (!m_Occupancy[level].chunk_occupied(chunk_idx))
+			{
+				if (!offsets.empty())
+				{
+					break;
+				}
+				continue;
+			}
+
+			chunk.rank[level].resize(chunk_num_elems);
+			{
+				std::lock_guard lock(m_ChannelLocks->rank[level]);
+				m_RankChannels[level].second.get_chunk(std::span<float32_t>(chunk.rank[level]), chunk_idx);
+			}
+
+			// The levels are sorted by coverage so once none of the queried pixels hold an id neither will any 
+			// of the following levels.
+			const auto& rank = chunk.rank[level];
+			if (!offsets.empty() && std::none_of(offsets.begin(), offsets.end(), [&](size_t offset)
+				{
+					return !detail::flat_id_set::is_empty_id(std::bit_cast<uint32_t>(rank[offset]));
+				}))
+			{
+				chunk.rank[level] = {};
+				break;
+			}
+
+			chunk.coverage[level].resize(chunk_num_elems);
+			std::lock_guard lock(m_ChannelLocks->coverage[level]);
+			m_CoverageChannels[level].second.get_chunk(std::span<float32_t>(chunk.coverage[level]), chunk_idx);
+		}
+		return chunk;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<uint32_t> cryptomatte::hashes_from_names(const std::vector<std::string>& names) const
+	{
+		if (!m_Metadata.manifest().has_value())
+		{
+			throw std::invalid_argument(
+				"Unable to extract the masks by their names if there is no manifest present on the cryptomatte."
+			);
+		}
+
+		const auto& manif = m_Metadata.manifest().value();
+		std::vector<uint32_t> hashes;
+		hashes.reserve(names.size());
+		for (const auto& name : names)
+		{
+			// This will throw std::invalid_argument on failure to find the name.
+			hashes.push_back(manif.hash(name));
+		}
+		return hashes;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::visit_levels(
+		const std::function<std::unique_ptr<detail::level_visitor>()>& make_visitor,
+		const task_control& control
+	) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_RankChannels.empty())
+		{
+			return;
+		}
+
+		const auto& first_channel = this->m_RankChannels.begin()->second;
+		const size_t max_chunk_elems = first_channel.chunk_size() / sizeof(float32_t);
+		const size_t num_chunks = first_channel.num_chunks();
+		const size_t num_levels = this->num_levels();
+
+		// A single compressed channel may not be decompressed from multiple threads at once, so rather than having 
+		// every worker decompress all the levels of its chunks (and wait on the other workers doing the same) every 
+		// rank and coverage channel is owned by its own stage. The chunks pass through the stages in level order,
+		// one step per stage, and at most one chunk enters per step such that all stages run in parallel without 
+		// ever touching the same channel or chunk. The channel locks therefore only guard against other calls on
+		// this cryptomatte.
+		const size_t num_stages = num_levels * 2;
+
+		// A chunk enters the first stage at its `entry_step` and is in flight for one step per stage plus the step
+		// emitting its outputs, so at most `num_stages + 1` chunks (and visitors) are in flight at once.
+		struct in_flight_chunk
+		{
+			size_t chunk_idx = 0;
+			size_t entry_step = 0;
+			detail::level_visitor* visitor = nullptr;
+		};
+		std::vector<in_flight_chunk> in_flight;
+		std::vector<std::unique_ptr<detail::level_visitor>> visitors;
+		std::vector<detail::level_visitor*> free_visitors;
+
+		// Visitors holding large scratch buffers (i.e. the masks of all ids in a chunk) report these via 
+		// `memory_usage`, new chunks are only let in while the chunks in flight plus the largest chunk seen so far
+		// fit into the memory budget. At least one chunk is always in flight so a single chunk may exceed it.
+		size_t max_chunk_memory = 0;
+		auto memory_usage = [&]()
+			{
+				size_t total = 0;
+				for (const auto& visitor : visitors)
+				{
+					total += visitor->memory_usage();
+				}
+				return total;
+			};
+
+		// The coverage stage of a level reads the rank chunk its rank stage decompressed in the previous step, so 
+		// the rank buffers (and whether the coverage is wanted) are double-buffered by the chunk index.
+		std::vector<compressed::util::default_init_vector<float32_t>> rank_buffers(num_levels * 2);
+		std::vector<compressed::util::default_init_vector<float32_t>> coverage_buffers(num_levels);
+		std::vector<uint8_t> coverage_wanted(num_levels * 2, false);
+		for (auto& buffer : rank_buffers)
+		{
+			buffer.resize(max_chunk_elems);
+		}
+		for (auto& buffer : coverage_buffers)
+		{
+			buffer.resize(max_chunk_elems);
+		}
+
+		detail::progress_tracker tracker(control, num_chunks);
+		tracker.throw_if_cancelled();
+
+		auto run_stage = [&](const in_flight_chunk& chunk, size_t stage)
+			{
+				const size_t chunk_idx = chunk.chunk_idx;
+				const size_t level = stage / 2;
+				const size_t chunk_num_elems = first_channel.chunk_size(chunk_idx) / sizeof(float32_t);
+				auto& visitor = *chunk.visitor;
+				auto rank = std::span<float32_t>(rank_buffers[level * 2 + chunk_idx % 2].data(), chunk_num_elems);
+				auto& wanted = coverage_wanted[level * 2 + chunk_idx % 2];
+
+				if (stage % 2 == 0)
+				{
+					if (level == 0)
+					{
+						visitor.begin_chunk(chunk_idx, chunk_num_elems);
+					}
+
+					// Empty chunks hold no ids so there is no need to decompress them.
+					wanted = false;
+					if (!m_Occupancy[level].chunk_occupied(chunk_idx))
+					{
+						return;
+					}
+
+					{
+						_CRYPTOMATTE_PROFILE_SCOPE("decompress rank chunk");
+						std::lock_guard lock(m_ChannelLocks->rank[level]);
+						m_RankChannels[level].second.get_chunk(rank, chunk_idx);
+					}
+					tracker.add_bytes(rank.size_bytes());
+					wanted = visitor.wants_coverage(rank);
+				}
+				else
+				{
+					if (wanted)
+					{
+						auto coverage = std::span<float32_t>(coverage_buffers[level].data(), chunk_num_elems);
+						{
+							_CRYPTOMATTE_PROFILE_SCOPE("decompress coverage chunk");
+							std::lock_guard lock(m_ChannelLocks->coverage[level]);
+							m_CoverageChannels[level].second.get_chunk(coverage, chunk_idx);
+						}
+						tracker.add_bytes(coverage.size_bytes());
+						visitor.visit(rank, coverage);
+					}
+
+					if (level == num_levels - 1)
+					{
+						visitor.end_chunk(chunk_idx);
+					}
+				}
+			};
+
+		auto exec = detail::resolve_executor(m_Executor);
+		size_t next_chunk = 0;
+		for (size_t step = 0; next_chunk < num_chunks || !in_flight.empty(); ++step)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("iter stages");
+			tracker.throw_if_cancelled();
+
+			const bool fits_budget = memory_usage() + max_chunk_memory <= m_DecodeMemoryBudget;
+			if (next_chunk < num_chunks && (in_flight.empty() || fits_budget))
+			{
+				if (free_visitors.empty())
+				{
+					visitors.push_back(make_visitor());
+					free_visitors.push_back(visitors.back().get());
+				}
+				in_flight.push_back({ next_chunk++, step, free_visitors.back() });
+				free_visitors.pop_back();
+			}
+
+			// The outputs of the chunk that left the last stage in the previous step are emitted alongside the
+			// stages, this is always the oldest chunk in flight.
+			in_flight_chunk* emitting = nullptr;
+			if (step - in_flight.front().entry_step == num_stages)
+			{
+				emitting = &in_flight.front();
+			}
+			const size_t num_outputs = emitting ? emitting->visitor->num_outputs() : 0;
+			const size_t first_staged = emitting ? 1 : 0;
+			const size_t num_staged = in_flight.size() - first_staged;
+
+			exec->parallel_for(num_staged + num_outputs, 1, [&](size_t begin, size_t end)
+				{
+					for (size_t task = begin; task < end; ++task)
+					{
+						if (task < num_staged)
+						{
+							const auto& chunk = in_flight[first_staged + task];
+							run_stage(chunk, step - chunk.entry_step);
+						}
+						else
+						{
+							emitting->visitor->emit(task - num_staged);
+						}
+					}
+				});
+
+			if (emitting)
+			{
+				max_chunk_memory = std::max(max_chunk_memory, emitting->visitor->memory_usage());
+				free_visitors.push_back(emitting->visitor);
+				in_flight.erase(in_flight.begin());
+				tracker.finish_chunks(1);
+
+				// Idle visitors must not hold on to more than the budget allows either.
+				for (auto* visitor : free_visitors)
+				{
+					if (memory_usage() <= m_DecodeMemoryBudget)
+					{
+						break;
+					}
+					visitor->release_memory();
+				}
+			}
+		}
+
+		for (auto& visitor : visitors)
+		{
+			visitor->finish();
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::decode_chunks_pipelined(
+		const detail::flat_id_set* requested,
+		const detail::mask_visitor::sink_fn& sink,
+		const task_control& control
+	) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+
+		const auto& first_channel = this->m_RankChannels.begin()->second;
+		const size_t max_chunk_elems = first_channel.chunk_size() / sizeof(float32_t);
+		const size_t num_chunks = first_channel.num_chunks();
+
+		/// A single decompressed rank-coverage pair of one chunk, handed from the decompression to the 
+		/// accumulation stage.
+		struct level_slot
+		{
+			size_t chunk_idx = 0;
+			size_t chunk_num_elems = 0;
+			/// Whether the coverage was decompressed, this is false if the rank chunk holds no requested ids.
+			bool has_coverage = false;
+			/// Whether this is the last (occupied) level of the chunk.
+			bool last_level = false;
+			compressed::util::default_init_vector<float32_t> rank;
+			compressed::util::default_init_vector<float32_t> coverage;
+		};
+
+		// The ring buffers between the stages, the free queues hold the indices of the slots available to the 
+		// producer while the ready queues hold the ones handed to the consumer.
+		std::vector<level_slot> level_slots(s_pipeline_level_slots);
+		std::vector<detail::chunk_accumulator> accumulators;
+		accumulators.resize(s_pipeline_accumulators);
+		detail::bounded_queue<size_t> free_levels(level_slots.size());
+		detail::bounded_queue<size_t> ready_levels(level_slots.size());
+		detail::bounded_queue<size_t> free_accumulators(accumulators.size());
+		detail::bounded_queue<std::pair<size_t, size_t>> ready_accumulators(accumulators.size());
+		for (size_t i = 0; i < level_slots.size(); ++i)
+		{
+			level_slots[i].rank.resize(max_chunk_elems);
+			level_slots[i].coverage.resize(max_chunk_elems);
+			free_levels.push(i);
+		}
+		for (size_t i = 0; i < accumulators.size(); ++i)
+		{
+			free_accumulators.push(i);
+		}
+
+		detail::progress_tracker tracker(control, num_chunks);
+		tracker.throw_if_cancelled();
+
+		// If any of the stages fails (or the operation is cancelled) we close all the queues so the other stages stop, the first exception is 
+		// rethrown on the calling thread.
+		std::mutex exception_mutex;
+		std::exception_ptr exception = nullptr;
+		auto fail = [&]()
+			{
+				{
+					std::lock_guard lock(exception_mutex);
+					if (!exception)
+					{
+						exception = std::current_exception();
+					}
+				}
+				free_levels.close();
+				ready_levels.close();
+				free_accumulators.close();
+				ready_accumulators.close();
+			};
+
+		// Stage 1: decompress the rank-coverage pairs of all the occupied levels in chunk order.
+		std::thread decompress_thread([&]()
+			{
+				try
+				{
+					for (size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+					{
+						tracker.throw_if_cancelled();
+						std::vector<size_t> levels;
+						for (size_t level = 0; level < this->num_levels(); ++level)
+						{
+							if (m_Occupancy[level].chunk_occupied(chunk_idx))
+							{
+								levels.push_back(level);
+							}
+						}
+
+						// Chunks without any ids never reach the accumulation stage so are done right away.
+						if (levels.empty())
+						{
+							tracker.finish_chunks(1);
+							continue;
+						}
+
+						for (size_t i = 0; i < levels.size(); ++i)
+						{
+							auto slot_idx = free_levels.pop();
+							if (!slot_idx)
+							{
+								return;
+							}
+
+							_CRYPTOMATTE_PROFILE_SCOPE("pipeline: decompress");
+							auto& slot = level_slots[*slot_idx];
+							slot.chunk_idx = chunk_idx;
+							slot.chunk_num_elems = first_channel.chunk_size(chunk_idx) / sizeof(float32_t);
+							slot.last_level = i == levels.size() - 1;
+
+							// The pipeline only decompresses from this thread but other calls on this cryptomatte may 
+							// be decompressing at the same time.
+							auto rank = std::span<float32_t>(slot.rank.data(), slot.chunk_num_elems);
+							{
+								std::lock_guard lock(m_ChannelLocks->rank[levels[i]]);
+								m_RankChannels[levels[i]].second.get_chunk(rank, chunk_idx);
+							}
+							tracker.add_bytes(rank.size_bytes());
+
+							// Only decompress the coverage channel once we know there's data to get.
+							slot.has_coverage = detail::rank_chunk_contains_any(rank, requested);
+							if (slot.has_coverage)
+							{
+								auto coverage = std::span<float32_t>(slot.coverage.data(), slot.chunk_num_elems);
+								std::lock_guard lock(m_ChannelLocks->coverage[levels[i]]);
+								m_CoverageChannels[levels[i]].second.get_chunk(coverage, chunk_idx);
+								tracker.add_bytes(coverage.size_bytes());
+							}
+
+							if (!ready_levels.push(*slot_idx))
+							{
+								return;
+							}
+						}
+					}
+					ready_levels.close();
+				}
+				catch (...)
+				{
+					fail();
+				}
+			});
+
+		// Stage 3: hand the finished masks to the sink, recompressing (or copying) them.
+		std::thread recompress_thread([&]()
+			{
+				try
+				{
+					while (auto item = ready_accumulators.pop())
+					{
+						auto [accumulator_idx, chunk_idx] = *item;
+						{
+							_CRYPTOMATTE_PROFILE_SCOPE("pipeline: recompress");
+							auto& accumulator = accumulators[accumulator_idx];
+							for (size_t i = 0; i < accumulator.ids().size(); ++i)
+							{
+								sink(chunk_idx, accumulator.ids()[i], accumulator.mask(i));
+							}
+						}
+						tracker.finish_chunks(1);
+						if (!free_accumulators.push(accumulator_idx))
+						{
+							return;
+						}
+					}
+				}
+				catch (...)
+				{
+					fail();
+				}
+			});
+
+		// Stage 2: accumulate the levels of each chunk on the calling thread.
+		try
+		{
+			// The accumulator of the chunk currently being accumulated, only valid if `has_accumulator` is true.
+			size_t accumulator_idx = 0;
+			bool has_accumulator = false;
+			while (auto slot_idx = ready_levels.pop())
+			{
+				_CRYPTOMATTE_PROFILE_SCOPE("pipeline: accumulate");
+				tracker.throw_if_cancelled();
+				auto& slot = level_slots[*slot_idx];
+				if (!has_accumulator)
+				{
+					auto free_idx = free_accumulators.pop();
+					if (!free_idx)
+					{
+						break;
+					}
+					accumulator_idx = *free_idx;
+					has_accumulator = true;
+					accumulators[accumulator_idx].reset(slot.chunk_num_elems);
+				}
+
+				auto& accumulator = accumulators[accumulator_idx];
+				if (slot.has_coverage)
+				{
+					auto rank = std::span<const float32_t>(slot.rank.data(), slot.chunk_num_elems);
+					auto coverage = std::span<const float32_t>(slot.coverage.data(), slot.chunk_num_elems);
+					if (accumulator.register_ids(rank, requested))
+					{
+						accumulator.accumulate(rank, coverage);
+					}
+				}
+
+				const size_t chunk_idx = slot.chunk_idx;
+				const bool last_level = slot.last_level;
+				if (!free_levels.push(*slot_idx))
+				{
+					break;
+				}
+
+				if (last_level)
+				{
+					// Chunks without any of the requested ids are not passed on, we can simply reuse the accumulator.
+					if (accumulator.ids().empty())
+					{
+						tracker.finish_chunks(1);
+						free_accumulators.push(accumulator_idx);
+					}
+					else if (!ready_accumulators.push({ accumulator_idx, chunk_idx }))
+					{
+						break;
+					}
+					has_accumulator = false;
+				}
+			}
+			ready_accumulators.close();
+		}
+		catch (...)
+		{
+			fail();
+		}
+
+		decompress_thread.join();
+		recompress_thread.join();
+
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t cryptomatte::num_levels() const noexcept
+	{
+		return m_RankChannels.size();
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::set_executor(std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> exec)
+	{
+		m_Executor = std::move(exec);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::shared_ptr<NAMESPACE_CRYPTOMATTE_API::executor> cryptomatte::executor() const noexcept
+	{
+		return m_Executor;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::set_decode_strategy(NAMESPACE_CRYPTOMATTE_API::decode_strategy strategy) noexcept
+	{
+		m_DecodeStrategy = strategy;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	NAMESPACE_CRYPTOMATTE_API::decode_strategy cryptomatte::decode_strategy() const noexcept
+	{
+		return m_DecodeStrategy;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::set_decode_memory_budget(size_t bytes) noexcept
+	{
+		m_DecodeMemoryBudget = bytes;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t cryptomatte::decode_memory_budget() const noexcept
+	{
+		return m_DecodeMemoryBudget;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void cryptomatte::set_pick_cache_capacity(size_t num_chunks)
+	{
+		m_PickCache->set_capacity(num_chunks);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t cryptomatte::pick_cache_capacity() const
 	{
-		return m_Channels.size() / 2;
+		return m_PickCache->capacity();
 	}
 
 	// -----------------------------------------------------------------------------------
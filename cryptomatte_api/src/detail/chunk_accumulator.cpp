@@ -0,0 +1,143 @@
+#include "detail/chunk_accumulator.h"
+
+#include <bit>
+#include <cassert>
+#include <algorithm>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void chunk_accumulator::reset(size_t chunk_num_elems)
+		{
+			m_ChunkNumElems = chunk_num_elems;
+			m_Ids.clear();
+			m_Slots.clear();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		bool chunk_accumulator::register_ids(std::span<const float32_t> rank, const flat_id_set* requested)
+		{
+			assert(rank.size() == m_ChunkNumElems);
+			bool has_requested_ids = false;
+			const size_t previous_num_ids = m_Ids.size();
+
+			// Neighbouring pixels very frequently hold the same id so we only look up the id on changes.
+			uint32_t previous = 0;
+			for (size_t idx = 0; idx < m_ChunkNumElems; ++idx)
+			{
+				uint32_t id = std::bit_cast<uint32_t>(rank[idx]);
+				if (id == previous || flat_id_set::is_empty_id(id))
+				{
+					continue;
+				}
+				previous = id;
+
+				auto [slot, inserted] = m_Slots.try_emplace(id, s_Ignored);
+				if (inserted && (requested == nullptr || requested->contains(id)))
+				{
+					*slot = static_cast<uint32_t>(m_Ids.size());
+					m_Ids.push_back(std::bit_cast<float32_t>(id));
+				}
+				has_requested_ids |= *slot != s_Ignored;
+			}
+
+			// Allocate (and zero) the masks for the newly found ids, the existing masks are retained. The buffer
+			// is reused across chunks so we only grow it if necessary.
+			size_t required_size = m_Ids.size() * m_ChunkNumElems;
+			if (m_Masks.size() < required_size)
+			{
+				m_Masks.resize(std::max(required_size, m_Masks.size() * 2));
+			}
+			std::fill(
+				m_Masks.begin() + previous_num_ids * m_ChunkNumElems,
+				m_Masks.begin() + required_size,
+				0.0f
+			);
+			return has_requested_ids;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void chunk_accumulator::accumulate(std::span<const float32_t> rank, std::span<const float32_t> coverage)
+		{
+			assert(rank.size() == m_ChunkNumElems && coverage.size() == m_ChunkNumElems);
+			uint32_t previous = 0;
+			float32_t* mask = nullptr;
+			for (size_t idx = 0; idx < m_ChunkNumElems; ++idx)
+			{
+				uint32_t id = std::bit_cast<uint32_t>(rank[idx]);
+				if (id != previous)
+				{
+					previous = id;
+					mask = nullptr;
+					if (!flat_id_set::is_empty_id(id))
+					{
+						const uint32_t* slot = m_Slots.find(id);
+						assert(slot != nullptr);
+						if (*slot != s_Ignored)
+						{
+							mask = m_Masks.data() + static_cast<size_t>(*slot) * m_ChunkNumElems;
+						}
+					}
+				}
+
+				if (mask)
+				{
+					mask[idx] += coverage[idx];
+				}
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		const std::vector<float32_t>& chunk_accumulator::ids() const noexcept
+		{
+			return m_Ids;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::span<float32_t> chunk_accumulator::mask(size_t id_idx) noexcept
+		{
+			return std::span<float32_t>(m_Masks.data() + id_idx * m_ChunkNumElems, m_ChunkNumElems);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::span<const float32_t> chunk_accumulator::mask(size_t id_idx) const noexcept
+		{
+			return std::span<const float32_t>(m_Masks.data() + id_idx * m_ChunkNumElems, m_ChunkNumElems);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t chunk_accumulator::chunk_num_elems() const noexcept
+		{
+			return m_ChunkNumElems;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t chunk_accumulator::memory_usage() const noexcept
+		{
+			return m_Masks.capacity() * sizeof(float32_t);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void chunk_accumulator::release_memory()
+		{
+			m_Masks = {};
+			m_Ids.clear();
+			m_Slots.clear();
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,88 @@
+#include "detail/chunk_cache.h"
+
+#include <algorithm>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		chunk_cache::chunk_cache(size_t capacity)
+		{
+			m_Capacity = capacity;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::shared_ptr<const decoded_chunk> chunk_cache::get(size_t chunk_idx, const load_fn& load)
+		{
+			std::lock_guard lock(m_Mutex);
+			auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [&](const auto& entry)
+				{
+					return entry.first == chunk_idx;
+				});
+			if (it != m_Entries.end())
+			{
+				// Move the entry to the front marking it as most recently used.
+				m_Entries.splice(m_Entries.begin(), m_Entries, it);
+				return m_Entries.front().second;
+			}
+
+			auto chunk = std::make_shared<const decoded_chunk>(load(chunk_idx));
+			if (m_Capacity > 0)
+			{
+				m_Entries.emplace_front(chunk_idx, chunk);
+				this->evict();
+			}
+			return chunk;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void chunk_cache::set_capacity(size_t capacity)
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Capacity = capacity;
+			this->evict();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t chunk_cache::capacity() const
+		{
+			std::lock_guard lock(m_Mutex);
+			return m_Capacity;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t chunk_cache::size() const
+		{
+			std::lock_guard lock(m_Mutex);
+			return m_Entries.size();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void chunk_cache::clear()
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Entries.clear();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void chunk_cache::evict()
+		{
+			while (m_Entries.size() > m_Capacity)
+			{
+				m_Entries.pop_back();
+			}
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,258 @@
+#include "detail/coverage_channel.h"
+
+#include <stdexcept>
+#include <ranges>
+#include <format>
+
+#include <compressed/util.h>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void encode_coverage(std::span<const float32_t> input, std::span<uint16_t> output, coverage_precision precision)
+		{
+			if (input.size() != output.size())
+			{
+				throw std::invalid_argument(
+					std::format(
+						"Unable to encode coverage, input and output must have the same size. Got {} and {}",
+						input.size(), output.size()
+					)
+				);
+			}
+
+			if (precision == coverage_precision::float16)
+			{
+				std::transform(std::execution::unseq, input.begin(), input.end(), output.begin(), float32_to_float16);
+			}
+			else if (precision == coverage_precision::unorm16)
+			{
+				std::transform(std::execution::unseq, input.begin(), input.end(), output.begin(), float32_to_unorm16);
+			}
+			else
+			{
+				throw std::invalid_argument("Unable to encode coverage to float32, this is not a reduced precision type");
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void decode_coverage(std::span<const uint16_t> input, std::span<float32_t> output, coverage_precision precision)
+		{
+			if (input.size() != output.size())
+			{
+				throw std::invalid_argument(
+					std::format(
+						"Unable to decode coverage, input and output must have the same size. Got {} and {}",
+						input.size(), output.size()
+					)
+				);
+			}
+
+			if (precision == coverage_precision::float16)
+			{
+				std::transform(std::execution::unseq, input.begin(), input.end(), output.begin(), float16_to_float32);
+			}
+			else if (precision == coverage_precision::unorm16)
+			{
+				std::transform(std::execution::unseq, input.begin(), input.end(), output.begin(), unorm16_to_float32);
+			}
+			else
+			{
+				throw std::invalid_argument("Unable to decode coverage from float32, this is not a reduced precision type");
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		coverage_channel::coverage_channel(compressed::channel<float32_t> channel, coverage_precision precision)
+		{
+			m_Precision = precision;
+			if (precision == coverage_precision::float32)
+			{
+				m_Channel = std::move(channel);
+				return;
+			}
+
+			// Create a channel with half the chunk and block size (in bytes) of the input channel, that way we
+			// have the exact same number of elements per-chunk and can iterate this in lockstep with the rank
+			// channels.
+			m_ReducedChannel = compressed::channel<uint16_t>::zeros(
+				channel.width(),
+				channel.height(),
+				channel.compression(),
+				static_cast<uint8_t>(channel.compression_level()),
+				channel.block_size() / 2,
+				channel.chunk_size() / 2
+			);
+
+			compressed::util::default_init_vector<float32_t> float_chunk(channel.chunk_size() / sizeof(float32_t));
+			compressed::util::default_init_vector<uint16_t> reduced_chunk(channel.chunk_size() / sizeof(float32_t));
+			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, channel.num_chunks()))
+			{
+				size_t chunk_num_elems = channel.chunk_size(chunk_idx) / sizeof(float32_t);
+				auto float_span = std::span<float32_t>(float_chunk.data(), chunk_num_elems);
+				auto reduced_span = std::span<uint16_t>(reduced_chunk.data(), chunk_num_elems);
+
+				channel.get_chunk(float_span, chunk_idx);
+				encode_coverage(float_span, reduced_span, precision);
+				m_ReducedChannel.set_chunk(reduced_span, chunk_idx);
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		coverage_channel::coverage_channel(
+			std::span<const float32_t> data,
+			size_t width,
+			size_t height,
+			coverage_precision precision,
+			const compression_options& compression
+		)
+		{
+			if (data.size() != width * height)
+			{
+				throw std::invalid_argument(
+					std::format(
+						"Unable to create coverage channel, expected {} values ({}x{}) but got {}",
+						width * height, width, height, data.size()
+					)
+				);
+			}
+
+			m_Precision = precision;
+			if (precision == coverage_precision::float32)
+			{
+				m_Channel = compressed::channel<float32_t>(
+					data,
+					width,
+					height,
+					compression.codec,
+					compression.compression_level,
+					compression.block_size,
+					compression.chunk_size
+				);
+				return;
+			}
+
+			// Half the chunk and block size (in bytes) of a float32 channel gives the same number of elements 
+			// per-chunk, so this may be iterated in lockstep with the rank channels.
+			m_ReducedChannel = compressed::channel<uint16_t>::zeros(
+				width,
+				height,
+				compression.codec,
+				compression.compression_level,
+				compression.block_size / 2,
+				compression.chunk_size / 2
+			);
+
+			const size_t max_chunk_elems = compression.chunk_size / sizeof(float32_t);
+			compressed::util::default_init_vector<uint16_t> reduced_chunk(max_chunk_elems);
+			for (size_t chunk_idx : std::views::iota(size_t{ 0 }, m_ReducedChannel.num_chunks()))
+			{
+				size_t chunk_num_elems = m_ReducedChannel.chunk_size(chunk_idx) / sizeof(uint16_t);
+				auto reduced_span = std::span<uint16_t>(reduced_chunk.data(), chunk_num_elems);
+
+				encode_coverage(data.subspan(chunk_idx * max_chunk_elems, chunk_num_elems), reduced_span, precision);
+				m_ReducedChannel.set_chunk(reduced_span, chunk_idx);
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void coverage_channel::get_chunk(std::span<float32_t> buffer, size_t chunk_idx) const
+		{
+			if (m_Precision == coverage_precision::float32)
+			{
+				m_Channel.get_chunk(buffer, chunk_idx);
+				return;
+			}
+
+			// Decompress into a scratch buffer that is reused across calls on the same thread, the chunk size is
+			// constant for a given channel so this will only allocate once.
+			thread_local compressed::util::default_init_vector<uint16_t> reduced_chunk;
+			size_t chunk_num_elems = this->chunk_elems(chunk_idx);
+			if (reduced_chunk.size() < chunk_num_elems)
+			{
+				reduced_chunk.resize(chunk_num_elems);
+			}
+			auto reduced_span = std::span<uint16_t>(reduced_chunk.data(), chunk_num_elems);
+
+			m_ReducedChannel.get_chunk(reduced_span, chunk_idx);
+			decode_coverage(reduced_span, buffer.subspan(0, chunk_num_elems), m_Precision);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::vector<float32_t> coverage_channel::get_decompressed() const
+		{
+			if (m_Precision == coverage_precision::float32)
+			{
+				return m_Channel.get_decompressed();
+			}
+
+			auto reduced = m_ReducedChannel.get_decompressed();
+			std::vector<float32_t> out(reduced.size());
+			decode_coverage(std::span<const uint16_t>(reduced), std::span<float32_t>(out), m_Precision);
+			return out;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		coverage_precision coverage_channel::precision() const noexcept
+		{
+			return m_Precision;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t coverage_channel::num_chunks() const noexcept
+		{
+			if (m_Precision == coverage_precision::float32)
+			{
+				return m_Channel.num_chunks();
+			}
+			return m_ReducedChannel.num_chunks();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t coverage_channel::chunk_elems(size_t chunk_idx) const
+		{
+			if (m_Precision == coverage_precision::float32)
+			{
+				return m_Channel.chunk_size(chunk_idx) / sizeof(float32_t);
+			}
+			return m_ReducedChannel.chunk_size(chunk_idx) / sizeof(uint16_t);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t coverage_channel::width() const noexcept
+		{
+			if (m_Precision == coverage_precision::float32)
+			{
+				return m_Channel.width();
+			}
+			return m_ReducedChannel.width();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t coverage_channel::height() const noexcept
+		{
+			if (m_Precision == coverage_precision::float32)
+			{
+				return m_Channel.height();
+			}
+			return m_ReducedChannel.height();
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -1,6 +1,11 @@
 #include "detail/detail.h"
 
 #include <format>
+#include <bit>
+#include <array>
+#include <limits>
+#include <cassert>
+#include <algorithm>
 #include <cstdint>
 #include <string>
 
@@ -59,6 +64,129 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			return std::format("{:08x}", value);
 		}
 
+		namespace
+		{
+
+			constexpr uint32_t s_MurmurC1 = 0xcc9e2d51;
+			constexpr uint32_t s_MurmurC2 = 0x1b873593;
+
+			/// The number of inputs hashed in lockstep by the batched murmurhash, chosen to fill a 256-bit register.
+			constexpr size_t s_MurmurLanes = 8;
+
+			inline uint32_t murmur_mix_block(uint32_t block) noexcept
+			{
+				block *= s_MurmurC1;
+				block = std::rotl(block, 15);
+				return block * s_MurmurC2;
+			}
+
+			inline uint32_t murmur_mix_state(uint32_t hash, uint32_t block) noexcept
+			{
+				hash ^= murmur_mix_block(block);
+				hash = std::rotl(hash, 13);
+				return hash * 5 + 0xe6546b64;
+			}
+
+			/// Read the block at `block_idx` as little-endian regardless of the platform so the hashes are portable.
+			inline uint32_t murmur_load_block(const uint8_t* bytes, size_t block_idx) noexcept
+			{
+				const uint8_t* block_bytes = bytes + block_idx * 4;
+				return static_cast<uint32_t>(block_bytes[0])
+					| static_cast<uint32_t>(block_bytes[1]) << 8
+					| static_cast<uint32_t>(block_bytes[2]) << 16
+					| static_cast<uint32_t>(block_bytes[3]) << 24;
+			}
+
+			/// Continue hashing `data` from the block at `first_block` with the intermediate `hash`, finishing off 
+			/// the tail and the final avalanche.
+			uint32_t murmur_finish(uint32_t hash, std::string_view data, size_t first_block) noexcept
+			{
+				const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+				const size_t num_blocks = data.size() / 4;
+				for (size_t i = first_block; i < num_blocks; ++i)
+				{
+					hash = murmur_mix_state(hash, murmur_load_block(bytes, i));
+				}
+
+				const uint8_t* tail = bytes + num_blocks * 4;
+				uint32_t remainder = 0;
+				switch (data.size() & 3)
+				{
+				case 3:
+					remainder ^= static_cast<uint32_t>(tail[2]) << 16;
+					[[fallthrough]];
+				case 2:
+					remainder ^= static_cast<uint32_t>(tail[1]) << 8;
+					[[fallthrough]];
+				case 1:
+					remainder ^= static_cast<uint32_t>(tail[0]);
+					hash ^= murmur_mix_block(remainder);
+				}
+
+				// Final avalanche
+				hash ^= static_cast<uint32_t>(data.size());
+				hash ^= hash >> 16;
+				hash *= 0x85ebca6b;
+				hash ^= hash >> 13;
+				hash *= 0xc2b2ae35;
+				hash ^= hash >> 16;
+				return hash;
+			}
+
+		} // anonymous namespace
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		uint32_t murmurhash3_32(std::string_view data, uint32_t seed /* = 0 */) noexcept
+		{
+			return murmur_finish(seed, data, 0);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void murmurhash3_32(std::span<const std::string_view> data, std::span<uint32_t> out, uint32_t seed /* = 0 */) noexcept
+		{
+			assert(data.size() == out.size());
+			size_t idx = 0;
+			for (; idx + s_MurmurLanes <= data.size(); idx += s_MurmurLanes)
+			{
+				std::array<const uint8_t*, s_MurmurLanes> bytes{};
+				size_t common_blocks = std::numeric_limits<size_t>::max();
+				for (size_t lane = 0; lane < s_MurmurLanes; ++lane)
+				{
+					bytes[lane] = reinterpret_cast<const uint8_t*>(data[idx + lane].data());
+					common_blocks = std::min(common_blocks, data[idx + lane].size() / 4);
+				}
+
+				// Gather one block per lane and mix all lanes at once, the loads are scalar but the mixing maps
+				// directly onto vector multiplies, rotates and xors.
+				std::array<uint32_t, s_MurmurLanes> hashes;
+				hashes.fill(seed);
+				std::array<uint32_t, s_MurmurLanes> blocks{};
+				for (size_t block_idx = 0; block_idx < common_blocks; ++block_idx)
+				{
+					for (size_t lane = 0; lane < s_MurmurLanes; ++lane)
+					{
+						blocks[lane] = murmur_load_block(bytes[lane], block_idx);
+					}
+					for (size_t lane = 0; lane < s_MurmurLanes; ++lane)
+					{
+						hashes[lane] = murmur_mix_state(hashes[lane], blocks[lane]);
+					}
+				}
+
+				for (size_t lane = 0; lane < s_MurmurLanes; ++lane)
+				{
+					out[idx + lane] = murmur_finish(hashes[lane], data[idx + lane], common_blocks);
+				}
+			}
+
+			for (; idx < data.size(); ++idx)
+			{
+				out[idx] = murmurhash3_32(data[idx], seed);
+			}
+		}
+
 	} // detail
 
 } // NAMESPACE_CRYPTOMATTE_API
\ No newline at end of file
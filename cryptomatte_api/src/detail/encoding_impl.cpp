@@ -0,0 +1,190 @@
+#include "detail/encoding_impl.h"
+
+#include <bit>
+#include <array>
+#include <mutex>
+#include <format>
+#include <algorithm>
+
+#include "detail/flat_id_set.h"
+#include "detail/scoped_timer.h"
+
+#include <compressed/util.h>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		top_k_selector::top_k_selector(size_t k)
+		{
+			m_K = k;
+			m_Selected.reserve(k);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::span<const sample> top_k_selector::select(std::span<const sample> pixel_samples)
+		{
+			// Pixels are usually covered by a handful of ids so a linear search beats any hashing here.
+			m_Merged.clear();
+			for (const auto& pixel_sample : pixel_samples)
+			{
+				if (flat_id_set::is_empty_id(pixel_sample.hash))
+				{
+					continue;
+				}
+
+				auto it = std::find_if(m_Merged.begin(), m_Merged.end(), [&](const sample& merged)
+					{
+						return merged.hash == pixel_sample.hash;
+					});
+				if (it != m_Merged.end())
+				{
+					it->coverage += pixel_sample.coverage;
+				}
+				else
+				{
+					m_Merged.push_back(pixel_sample);
+				}
+			}
+
+			// Insert into the fixed-size selection which is kept sorted by descending coverage. Inserting behind
+			// any equal coverage keeps ties in the order of first appearance.
+			m_Selected.clear();
+			for (const auto& merged : m_Merged)
+			{
+				if (merged.coverage == 0.0f)
+				{
+					continue;
+				}
+				if (m_Selected.size() == m_K)
+				{
+					if (m_K == 0 || !(merged.coverage > m_Selected.back().coverage))
+					{
+						continue;
+					}
+					m_Selected.pop_back();
+				}
+
+				auto position = std::find_if(m_Selected.begin(), m_Selected.end(), [&](const sample& selected)
+					{
+						return selected.coverage < merged.coverage;
+					});
+				m_Selected.insert(position, merged);
+			}
+			return m_Selected;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::string encoded_channel_name(const std::string& name, size_t level, bool is_rank)
+		{
+			// Every channel set (e.g. CryptoObject00) holds two levels, the first as r-g and the second as b-a.
+			constexpr std::array<const char*, 4> extensions = { "r", "g", "b", "a" };
+			return std::format("{}{:02}.{}", name, level / 2, extensions[(level % 2) * 2 + (is_rank ? 0 : 1)]);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::unordered_map<std::string, compressed::channel<float32_t>> encode_channels(
+			size_t width,
+			size_t height,
+			const encode_options& options,
+			const std::function<std::span<const sample>(size_t pixel_idx, std::vector<sample>& scratch)>& pixel_samples,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec
+		)
+		{
+			_CRYPTOMATTE_PROFILE_FUNCTION();
+			const size_t num_levels = options.num_levels;
+			auto make_channel = [&]()
+				{
+					auto channel = compressed::channel<float32_t>::zeros(width, height, options.codec, options.compression_level);
+					// We already parallelize over the chunks so there is no point in compressing on multiple threads.
+					channel.update_nthreads(1, channel.block_size());
+					return channel;
+				};
+
+			std::vector<compressed::channel<float32_t>> rank_channels;
+			std::vector<compressed::channel<float32_t>> coverage_channels;
+			for (size_t level = 0; level < num_levels; ++level)
+			{
+				rank_channels.push_back(make_channel());
+				coverage_channels.push_back(make_channel());
+			}
+
+			const size_t num_elems = width * height;
+			const size_t num_chunks = rank_channels.front().num_chunks();
+			const size_t max_chunk_elems = rank_channels.front().chunk_size() / sizeof(float32_t);
+
+			// A single channel may not be written from multiple threads at once, so we need a lock per channel.
+			std::vector<std::mutex> rank_mutexes(num_levels);
+			std::vector<std::mutex> coverage_mutexes(num_levels);
+
+			exec.parallel_for(num_chunks, 1, [&](size_t begin, size_t end)
+				{
+					top_k_selector selector(num_levels);
+					std::vector<sample> scratch;
+					compressed::util::default_init_vector<float32_t> rank(num_levels * max_chunk_elems);
+					compressed::util::default_init_vector<float32_t> coverage(num_levels * max_chunk_elems);
+
+					for (size_t chunk_idx = begin; chunk_idx < end; ++chunk_idx)
+					{
+						const size_t elem_begin = chunk_idx * max_chunk_elems;
+						const size_t chunk_num_elems = std::min(max_chunk_elems, num_elems - elem_begin);
+						std::fill(rank.begin(), rank.begin() + num_levels * chunk_num_elems, 0.0f);
+						std::fill(coverage.begin(), coverage.begin() + num_levels * chunk_num_elems, 0.0f);
+
+						// Rank the samples of every pixel into the levels, the levels are laid out back to back.
+						size_t num_used_levels = 0;
+						{
+							_CRYPTOMATTE_PROFILE_SCOPE("rank samples");
+							for (size_t idx = 0; idx < chunk_num_elems; ++idx)
+							{
+								auto selected = selector.select(pixel_samples(elem_begin + idx, scratch));
+								for (size_t level = 0; level < selected.size(); ++level)
+								{
+									rank[level * chunk_num_elems + idx] = std::bit_cast<float32_t>(selected[level].hash);
+									coverage[level * chunk_num_elems + idx] = selected[level].coverage;
+								}
+								num_used_levels = std::max(num_used_levels, selected.size());
+							}
+						}
+
+						// The channels are initialized to zero so any levels not used by this chunk can be skipped.
+						_CRYPTOMATTE_PROFILE_SCOPE("compress levels");
+						for (size_t level = 0; level < num_used_levels; ++level)
+						{
+							{
+								std::lock_guard lock(rank_mutexes[level]);
+								rank_channels[level].set_chunk(
+									std::span<float32_t>(rank.data() + level * chunk_num_elems, chunk_num_elems),
+									chunk_idx
+								);
+							}
+							{
+								std::lock_guard lock(coverage_mutexes[level]);
+								coverage_channels[level].set_chunk(
+									std::span<float32_t>(coverage.data() + level * chunk_num_elems, chunk_num_elems),
+									chunk_idx
+								);
+							}
+						}
+					}
+				});
+
+			std::unordered_map<std::string, compressed::channel<float32_t>> out;
+			for (size_t level = 0; level < num_levels; ++level)
+			{
+				out[encoded_channel_name(options.name, level, true)] = std::move(rank_channels[level]);
+				out[encoded_channel_name(options.name, level, false)] = std::move(coverage_channels[level]);
+			}
+			return out;
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,405 @@
+#include "detail/level_visitor.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "detail/decoding_impl.h"
+#include "detail/preview_impl.h"
+#include "detail/id_map_impl.h"
+#include "detail/rank_occupancy.h"
+#include "detail/scoped_timer.h"
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace detail
+	{
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		bool level_visitor::wants_coverage(std::span<const float32_t>)
+		{
+			return true;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t level_visitor::num_outputs() const
+		{
+			return 0;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void level_visitor::emit(size_t)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t level_visitor::memory_usage() const
+		{
+			return 0;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void level_visitor::release_memory()
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void level_visitor::finish()
+		{
+		}
+
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		preview_visitor::preview_visitor(size_t max_chunk_elems, const sink_fn& sink)
+			: m_Sink(sink)
+		{
+			for (auto& color : m_Colors)
+			{
+				color.resize(max_chunk_elems);
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void preview_visitor::begin_chunk(size_t, size_t chunk_num_elems)
+		{
+			m_ChunkNumElems = chunk_num_elems;
+			m_HasData = false;
+			for (auto& color : m_Colors)
+			{
+				std::fill(color.begin(), color.begin() + chunk_num_elems, 0.0f);
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void preview_visitor::visit(std::span<const float32_t> rank, std::span<const float32_t> coverage)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("accumulate preview");
+			accumulate_preview(
+				rank,
+				coverage,
+				std::span<float32_t>(m_Colors[0].data(), m_ChunkNumElems),
+				std::span<float32_t>(m_Colors[1].data(), m_ChunkNumElems),
+				std::span<float32_t>(m_Colors[2].data(), m_ChunkNumElems)
+			);
+			m_HasData = true;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void preview_visitor::end_chunk(size_t chunk_idx)
+		{
+			// The outputs are zero-initialized so chunks without any ids can be skipped.
+			if (m_HasData)
+			{
+				m_Sink(
+					chunk_idx,
+					std::span<float32_t>(m_Colors[0].data(), m_ChunkNumElems),
+					std::span<float32_t>(m_Colors[1].data(), m_ChunkNumElems),
+					std::span<float32_t>(m_Colors[2].data(), m_ChunkNumElems)
+				);
+			}
+		}
+
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		union_visitor::union_visitor(size_t max_chunk_elems, const id_membership& membership, const sink_fn& sink)
+			: m_Membership(membership), m_Sink(sink)
+		{
+			m_Weights.resize(max_chunk_elems);
+			m_Mask.resize(max_chunk_elems);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void union_visitor::begin_chunk(size_t, size_t chunk_num_elems)
+		{
+			m_ChunkNumElems = chunk_num_elems;
+			m_HasData = false;
+			std::fill(m_Mask.begin(), m_Mask.begin() + chunk_num_elems, 0.0f);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		bool union_visitor::wants_coverage(std::span<const float32_t> rank)
+		{
+			// Only decompress the coverage channel once we know any of the pixels are part of the union.
+			_CRYPTOMATTE_PROFILE_SCOPE("match ids");
+			return m_Membership.size() > 0 && m_Membership.match(rank, std::span<float32_t>(m_Weights.data(), rank.size()));
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void union_visitor::visit(std::span<const float32_t>, std::span<const float32_t> coverage)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("accumulate union");
+			const float32_t* coverage_ptr = coverage.data();
+			const float32_t* weights_ptr = m_Weights.data();
+			float32_t* mask_ptr = m_Mask.data();
+			for (size_t i = 0; i < coverage.size(); ++i)
+			{
+				mask_ptr[i] += coverage_ptr[i] * weights_ptr[i];
+			}
+			m_HasData = true;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void union_visitor::end_chunk(size_t chunk_idx)
+		{
+			if (m_HasData)
+			{
+				m_Sink(chunk_idx, std::span<float32_t>(m_Mask.data(), m_ChunkNumElems));
+			}
+		}
+
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		id_map_visitor::id_map_visitor(size_t max_chunk_elems, const sink_fn& sink)
+			: m_Sink(sink)
+		{
+			m_Ids.resize(max_chunk_elems);
+			m_Coverage.resize(max_chunk_elems);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_map_visitor::begin_chunk(size_t, size_t chunk_num_elems)
+		{
+			m_ChunkNumElems = chunk_num_elems;
+			m_HasData = false;
+			std::fill(m_Ids.begin(), m_Ids.begin() + chunk_num_elems, 0u);
+			std::fill(m_Coverage.begin(), m_Coverage.begin() + chunk_num_elems, 0.0f);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_map_visitor::visit(std::span<const float32_t> rank, std::span<const float32_t> coverage)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("accumulate dominant ids");
+			accumulate_dominant_id(
+				rank,
+				coverage,
+				std::span<uint32_t>(m_Ids.data(), m_ChunkNumElems),
+				std::span<float32_t>(m_Coverage.data(), m_ChunkNumElems)
+			);
+			m_HasData = true;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_map_visitor::end_chunk(size_t chunk_idx)
+		{
+			if (m_HasData)
+			{
+				m_Sink(
+					chunk_idx,
+					std::span<uint32_t>(m_Ids.data(), m_ChunkNumElems),
+					std::span<float32_t>(m_Coverage.data(), m_ChunkNumElems)
+				);
+			}
+		}
+
+
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		statistics_visitor::statistics_visitor(size_t width, size_t max_chunk_elems, const flat_id_set* requested, const sink_fn& sink)
+			: m_Width(width), m_MaxChunkElems(max_chunk_elems), m_Requested(requested), m_Sink(sink)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void statistics_visitor::begin_chunk(size_t chunk_idx, size_t)
+		{
+			m_ElemBegin = chunk_idx * m_MaxChunkElems;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		bool statistics_visitor::wants_coverage(std::span<const float32_t> rank)
+		{
+			// Levels holding none of the requested ids do not contribute so we can skip their coverage.
+			return m_Requested == nullptr || rank_chunk_contains_any(rank, m_Requested);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void statistics_visitor::visit(std::span<const float32_t> rank, std::span<const float32_t> coverage)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("accumulate statistics");
+			// Neighbouring pixels very frequently hold the same id so we only look up the entry on changes, 
+			// references into an unordered_map stay valid on insertion so this is safe to hold on to.
+			uint32_t previous = 0;
+			id_statistics* statistics = nullptr;
+
+			size_t x = m_ElemBegin % m_Width;
+			size_t y = m_ElemBegin / m_Width;
+			for (size_t i = 0; i < rank.size(); ++i)
+			{
+				const uint32_t id = std::bit_cast<uint32_t>(rank[i]);
+				const float32_t pixel_coverage = coverage[i];
+				if (id != previous)
+				{
+					previous = id;
+					const bool wanted = !flat_id_set::is_empty_id(id) && (m_Requested == nullptr || m_Requested->contains(id));
+					statistics = wanted ? &m_Statistics[id] : nullptr;
+				}
+
+				if (statistics && pixel_coverage != 0.0f)
+				{
+					statistics->pixel_count += 1;
+					statistics->coverage_sum += pixel_coverage;
+					statistics->min_x = std::min(statistics->min_x, x);
+					statistics->min_y = std::min(statistics->min_y, y);
+					statistics->max_x = std::max(statistics->max_x, x);
+					statistics->max_y = std::max(statistics->max_y, y);
+				}
+
+				if (++x == m_Width)
+				{
+					x = 0;
+					++y;
+				}
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void statistics_visitor::end_chunk(size_t)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void statistics_visitor::finish()
+		{
+			// Ids whose pixels all had zero coverage never contribute anything.
+			std::erase_if(m_Statistics, [](const auto& item) { return item.second.pixel_count == 0; });
+			m_Sink(m_Statistics);
+		}
+
+
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		id_collector_visitor::id_collector_visitor(const sink_fn& sink)
+			: m_Sink(sink)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_collector_visitor::begin_chunk(size_t, size_t)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		bool id_collector_visitor::wants_coverage(std::span<const float32_t> rank)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("collect ids");
+			accumulate_ids_in_range(rank, m_Ids);
+			return false;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_collector_visitor::visit(std::span<const float32_t>, std::span<const float32_t>)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_collector_visitor::end_chunk(size_t)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void id_collector_visitor::finish()
+		{
+			m_Sink(m_Ids);
+		}
+
+
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		mask_visitor::mask_visitor(const flat_id_set* requested, const sink_fn& sink)
+			: m_Requested(requested), m_Sink(sink)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void mask_visitor::begin_chunk(size_t chunk_idx, size_t chunk_num_elems)
+		{
+			m_ChunkIdx = chunk_idx;
+			m_Accumulator.reset(chunk_num_elems);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		bool mask_visitor::wants_coverage(std::span<const float32_t> rank)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("register ids");
+			return m_Accumulator.register_ids(rank, m_Requested);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void mask_visitor::visit(std::span<const float32_t> rank, std::span<const float32_t> coverage)
+		{
+			_CRYPTOMATTE_PROFILE_SCOPE("accumulate masks");
+			m_Accumulator.accumulate(rank, coverage);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void mask_visitor::end_chunk(size_t)
+		{
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t mask_visitor::num_outputs() const
+		{
+			return m_Accumulator.ids().size();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void mask_visitor::emit(size_t output_idx)
+		{
+			m_Sink(m_ChunkIdx, m_Accumulator.ids()[output_idx], m_Accumulator.mask(output_idx));
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t mask_visitor::memory_usage() const
+		{
+			return m_Accumulator.memory_usage();
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void mask_visitor::release_memory()
+		{
+			m_Accumulator.release_memory();
+		}
+
+	} // detail
+
+} // NAMESPACE_CRYPTOMATTE_API
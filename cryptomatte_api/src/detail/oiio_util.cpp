@@ -1,5 +1,15 @@
 #include "detail/oiio_util.h"
 
+#include <algorithm>
+#include <array>
+#include <format>
+#include <memory>
+#include <stdexcept>
+
+#include "detail/scoped_timer.h"
+
+#include <compressed/util.h>
+
 
 namespace NAMESPACE_CRYPTOMATTE_API
 {
@@ -72,6 +82,559 @@ namespace NAMESPACE_CRYPTOMATTE_API
 			return mismatched_names;
 		}
 
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		std::unordered_map<std::string, compressed::channel<float32_t>> read_channels(
+			OIIO::ImageInput& input,
+			const std::vector<std::string>& channel_names,
+			compressed::enums::codec codec,
+			uint8_t compression_level,
+			size_t block_size,
+			size_t chunk_size,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control
+		)
+		{
+			_CRYPTOMATTE_PROFILE_FUNCTION();
+
+			const auto& spec = input.spec();
+			const size_t width = static_cast<size_t>(spec.width);
+			const size_t height = static_cast<size_t>(spec.height);
+
+			std::vector<int> channel_indices;
+			for (const auto& name : channel_names)
+			{
+				int idx = spec.channelindex(name);
+				if (idx < 0)
+				{
+					throw std::invalid_argument(
+						std::format("Unable to read channel '{}' as it does not exist on the image", name)
+					);
+				}
+				channel_indices.push_back(idx);
+			}
+
+			// Group the channels into contiguous ranges of channel indices, each of these can be read with a single
+			// call to read_scanlines. This is usually just one range per cryptomatte.
+			std::vector<std::pair<int, int>> channel_ranges;
+			{
+				auto sorted_indices = channel_indices;
+				std::sort(sorted_indices.begin(), sorted_indices.end());
+				sorted_indices.erase(std::unique(sorted_indices.begin(), sorted_indices.end()), sorted_indices.end());
+				for (int idx : sorted_indices)
+				{
+					if (!channel_ranges.empty() && channel_ranges.back().second == idx)
+					{
+						++channel_ranges.back().second;
+					}
+					else
+					{
+						channel_ranges.push_back({ idx, idx + 1 });
+					}
+				}
+			}
+
+			std::vector<compressed::channel<float32_t>> channels;
+			for (size_t i = 0; i < channel_names.size(); ++i)
+			{
+				auto channel = compressed::channel<float32_t>::zeros(
+					width, height, codec, compression_level, block_size, chunk_size
+				);
+				channel.update_nthreads(1, block_size);
+				channels.push_back(std::move(channel));
+			}
+			if (channels.empty())
+			{
+				return {};
+			}
+
+			const size_t max_chunk_elems = chunk_size / sizeof(float32_t);
+			const size_t num_chunks = channels.front().num_chunks();
+			detail::progress_tracker tracker(control, num_chunks);
+
+			std::vector<compressed::util::default_init_vector<float32_t>> range_buffers(channel_ranges.size());
+			std::vector<compressed::util::default_init_vector<float32_t>> chunk_buffers(channels.size());
+			for (size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+			{
+				tracker.throw_if_cancelled();
+
+				// The chunks are not aligned to the scanlines so we read all the scanlines the chunk touches.
+				const size_t chunk_num_elems = channels.front().chunk_size(chunk_idx) / sizeof(float32_t);
+				const size_t elem_begin = chunk_idx * max_chunk_elems;
+				const size_t elem_end = elem_begin + chunk_num_elems;
+				const size_t y_begin = elem_begin / width;
+				const size_t y_end = (elem_end + width - 1) / width;
+				const size_t elem_offset = elem_begin - y_begin * width;
+
+				{
+					_CRYPTOMATTE_PROFILE_SCOPE("read scanlines");
+					for (size_t range_idx = 0; range_idx < channel_ranges.size(); ++range_idx)
+					{
+						auto [ch_begin, ch_end] = channel_ranges[range_idx];
+						auto& buffer = range_buffers[range_idx];
+						buffer.resize((y_end - y_begin) * width * static_cast<size_t>(ch_end - ch_begin));
+
+						bool success = input.read_scanlines(
+							0,
+							0,
+							spec.y + static_cast<int>(y_begin),
+							spec.y + static_cast<int>(y_end),
+							0,
+							ch_begin,
+							ch_end,
+							OIIO::TypeDesc::FLOAT,
+							buffer.data()
+						);
+						if (!success)
+						{
+							throw std::runtime_error(
+								std::format("Failed to read scanlines from image: {}", input.geterror())
+							);
+						}
+						tracker.add_bytes(buffer.size() * sizeof(float32_t));
+					}
+				}
+
+				// Deinterleave and compress the channels in parallel.
+				exec.parallel_for(channels.size(), 1, [&](size_t begin, size_t end)
+					{
+						_CRYPTOMATTE_PROFILE_SCOPE("compress channel chunks");
+						for (size_t i = begin; i < end; ++i)
+						{
+							auto range_it = std::find_if(channel_ranges.begin(), channel_ranges.end(), [&](const auto& range)
+								{
+									return range.first <= channel_indices[i] && channel_indices[i] < range.second;
+								});
+							const auto& buffer = range_buffers[std::distance(channel_ranges.begin(), range_it)];
+							const size_t stride = static_cast<size_t>(range_it->second - range_it->first);
+							const size_t channel_offset = static_cast<size_t>(channel_indices[i] - range_it->first);
+
+							auto& chunk_buffer = chunk_buffers[i];
+							chunk_buffer.resize(chunk_num_elems);
+							for (size_t idx = 0; idx < chunk_num_elems; ++idx)
+							{
+								chunk_buffer[idx] = buffer[(elem_offset + idx) * stride + channel_offset];
+							}
+							channels[i].set_chunk(std::span<float32_t>(chunk_buffer.data(), chunk_num_elems), chunk_idx);
+						}
+					});
+				tracker.finish_chunks(1);
+			}
+
+			std::unordered_map<std::string, compressed::channel<float32_t>> out;
+			for (size_t i = 0; i < channel_names.size(); ++i)
+			{
+				out[channel_names[i]] = std::move(channels[i]);
+			}
+			return out;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		scanline_interleaver::scanline_interleaver(
+			size_t num_channels,
+			size_t width,
+			size_t height,
+			size_t max_chunk_elems,
+			scanline_writer write
+		)
+			: m_NumChannels(num_channels),
+			m_Width(width),
+			m_NumElems(width * height),
+			m_MaxChunkElems(max_chunk_elems),
+			m_NumChunks((width * height + max_chunk_elems - 1) / max_chunk_elems),
+			m_Write(std::move(write))
+		{
+			m_Scanlines.resize((max_chunk_elems + width) * num_channels);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t scanline_interleaver::chunk_num_elems() const noexcept
+		{
+			if (m_ChunkIdx >= m_NumChunks)
+			{
+				return 0;
+			}
+			return std::min(m_MaxChunkElems, m_NumElems - m_ChunkIdx * m_MaxChunkElems);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		size_t scanline_interleaver::chunk_offset() const noexcept
+		{
+			return m_ChunkIdx * m_MaxChunkElems - m_YBegin * m_Width;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void scanline_interleaver::set(size_t channel_idx, std::span<const float32_t> chunk)
+		{
+			if (m_ChunkIdx >= m_NumChunks)
+			{
+				return;
+			}
+
+			const size_t offset = this->chunk_offset();
+			const size_t num_elems = std::min(chunk.size(), this->chunk_num_elems());
+			for (size_t idx = 0; idx < num_elems; ++idx)
+			{
+				m_Scanlines[(offset + idx) * m_NumChannels + channel_idx] = chunk[idx];
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void scanline_interleaver::clear()
+		{
+			if (m_ChunkIdx >= m_NumChunks)
+			{
+				return;
+			}
+
+			const auto begin = m_Scanlines.begin() + this->chunk_offset() * m_NumChannels;
+			std::fill(begin, begin + this->chunk_num_elems() * m_NumChannels, 0.0f);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void scanline_interleaver::finish_chunk()
+		{
+			if (m_ChunkIdx >= m_NumChunks)
+			{
+				return;
+			}
+
+			// Hand off all of the completed scanlines and move the incomplete one to the front.
+			const size_t elem_end = m_ChunkIdx * m_MaxChunkElems + this->chunk_num_elems();
+			const size_t y_end = elem_end / m_Width;
+			if (y_end > m_YBegin)
+			{
+				const size_t num_complete = (y_end - m_YBegin) * m_Width * m_NumChannels;
+				m_Write(m_YBegin, y_end, std::span<const float32_t>(m_Scanlines.data(), num_complete));
+
+				const size_t num_remaining = (elem_end - y_end * m_Width) * m_NumChannels;
+				std::copy(
+					m_Scanlines.begin() + num_complete,
+					m_Scanlines.begin() + num_complete + num_remaining,
+					m_Scanlines.begin()
+				);
+				m_YBegin = y_end;
+			}
+			++m_ChunkIdx;
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void stream_interleaved_scanlines(
+			std::span<const chunk_reader> channels,
+			size_t width,
+			size_t height,
+			size_t max_chunk_elems,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control,
+			const scanline_writer& write
+		)
+		{
+			_CRYPTOMATTE_PROFILE_FUNCTION();
+			if (channels.empty() || width == 0 || height == 0)
+			{
+				return;
+			}
+
+			scanline_interleaver interleaver(channels.size(), width, height, max_chunk_elems, write);
+			detail::progress_tracker tracker(control, interleaver.num_chunks());
+			while (interleaver.chunk_idx() < interleaver.num_chunks())
+			{
+				tracker.throw_if_cancelled();
+
+				const size_t chunk_idx = interleaver.chunk_idx();
+				const size_t chunk_num_elems = interleaver.chunk_num_elems();
+				exec.parallel_for(channels.size(), 1, [&](size_t begin, size_t end)
+					{
+						_CRYPTOMATTE_PROFILE_SCOPE("decompress and interleave");
+						compressed::util::default_init_vector<float32_t> chunk_buffer(chunk_num_elems);
+						for (size_t channel_idx = begin; channel_idx < end; ++channel_idx)
+						{
+							auto chunk = std::span<float32_t>(chunk_buffer.data(), chunk_num_elems);
+							channels[channel_idx](chunk, chunk_idx);
+							interleaver.set(channel_idx, chunk);
+						}
+					});
+				interleaver.finish_chunk();
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void stream_interleaved_scanlines(
+			std::span<const compressed::channel<float32_t>* const> channels,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control,
+			const scanline_writer& write
+		)
+		{
+			if (channels.empty())
+			{
+				return;
+			}
+
+			std::vector<chunk_reader> readers;
+			for (const auto* channel : channels)
+			{
+				readers.push_back([channel](std::span<float32_t> buffer, size_t chunk_idx)
+					{
+						channel->get_chunk(buffer, chunk_idx);
+					});
+			}
+
+			const auto& first_channel = *channels.front();
+			stream_interleaved_scanlines(
+				readers,
+				first_channel.width(),
+				first_channel.height(),
+				first_channel.chunk_size() / sizeof(float32_t),
+				exec,
+				control,
+				write
+			);
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void write_image(
+			const std::filesystem::path& file,
+			const OIIO::ImageSpec& spec,
+			std::span<const chunk_reader> channels,
+			size_t max_chunk_elems,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const task_control& control
+		)
+		{
+			_CRYPTOMATTE_PROFILE_FUNCTION();
+			auto out = OIIO::ImageOutput::create(file.string());
+			if (!out)
+			{
+				throw std::runtime_error(std::format("Could not create image output for '{}'", file.string()));
+			}
+			out->threads(static_cast<int>(exec.concurrency()));
+
+			if (!out->open(file.string(), spec))
+			{
+				throw std::runtime_error(std::format("Failed to open file '{}': {}", file.string(), out->geterror()));
+			}
+
+			stream_interleaved_scanlines(
+				channels,
+				static_cast<size_t>(spec.width),
+				static_cast<size_t>(spec.height),
+				max_chunk_elems,
+				exec,
+				control,
+				[&](size_t y_begin, size_t y_end, std::span<const float32_t> pixels)
+				{
+					_CRYPTOMATTE_PROFILE_SCOPE("write scanlines");
+					bool success = out->write_scanlines(
+						static_cast<int>(y_begin),
+						static_cast<int>(y_end),
+						0,
+						OIIO::TypeDesc::FLOAT,
+						pixels.data()
+					);
+					if (!success)
+					{
+						throw std::runtime_error(
+							std::format("Failed to write scanlines to '{}': {}", file.string(), out->geterror())
+						);
+					}
+				});
+
+			if (!out->close())
+			{
+				throw std::runtime_error(std::format("Failed to close file '{}': {}", file.string(), out->geterror()));
+			}
+		}
+
+		namespace
+		{
+
+			/// Create the output for the masks written to `file`, the exr compression is multithreaded internally 
+			/// which is the bulk of the work when writing.
+			std::unique_ptr<OIIO::ImageOutput> create_mask_output(const std::filesystem::path& file, NAMESPACE_CRYPTOMATTE_API::executor& exec)
+			{
+				auto out = OIIO::ImageOutput::create(file.string());
+				if (!out)
+				{
+					throw std::runtime_error(std::format("Could not create image output for '{}'", file.string()));
+				}
+				out->threads(static_cast<int>(exec.concurrency()));
+				return out;
+			}
+
+			/// Create the spec of a part holding the given mask channels in the format requested by `options`.
+			OIIO::ImageSpec make_mask_spec(size_t width, size_t height, std::vector<std::string> channel_names, const write_options& options)
+			{
+				OIIO::ImageSpec spec(
+					static_cast<int>(width),
+					static_cast<int>(height),
+					static_cast<int>(channel_names.size()),
+					options.format == mask_format::float16 ? OIIO::TypeDesc::HALF : OIIO::TypeDesc::FLOAT
+				);
+				spec.channelnames = std::move(channel_names);
+				spec.attribute("compression", options.compression);
+				return spec;
+			}
+
+			/// Write the scanlines as they come in, OIIO takes care of converting to the output format.
+			scanline_writer make_scanline_writer(OIIO::ImageOutput& out, const std::filesystem::path& file)
+			{
+				return [&out, &file](size_t y_begin, size_t y_end, std::span<const float32_t> pixels)
+					{
+						_CRYPTOMATTE_PROFILE_SCOPE("write scanlines");
+						bool success = out.write_scanlines(
+							static_cast<int>(y_begin),
+							static_cast<int>(y_end),
+							0,
+							OIIO::TypeDesc::FLOAT,
+							pixels.data()
+						);
+						if (!success)
+						{
+							throw std::runtime_error(
+								std::format("Failed to write scanlines to '{}': {}", file.string(), out.geterror())
+							);
+						}
+					};
+			}
+
+		} // anonymous namespace
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void write_channels(
+			const std::filesystem::path& file,
+			const std::vector<std::pair<std::string, const compressed::channel<float32_t>*>>& channels,
+			const write_options& options,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec
+		)
+		{
+			_CRYPTOMATTE_PROFILE_FUNCTION();
+			if (channels.empty())
+			{
+				throw std::invalid_argument(
+					std::format("Unable to write masks to '{}' as no masks were provided", file.string())
+				);
+			}
+
+			auto out = create_mask_output(file, exec);
+			const auto& first_channel = *channels.front().second;
+			auto write_scanlines = make_scanline_writer(*out, file);
+
+			if (options.layout == mask_layout::channels)
+			{
+				std::vector<std::string> channel_names;
+				std::vector<const compressed::channel<float32_t>*> channel_ptrs;
+				for (const auto& [name, channel] : channels)
+				{
+					channel_names.push_back(name);
+					channel_ptrs.push_back(channel);
+				}
+
+				auto spec = make_mask_spec(first_channel.width(), first_channel.height(), std::move(channel_names), options);
+				if (!out->open(file.string(), spec))
+				{
+					throw std::runtime_error(std::format("Failed to open file '{}': {}", file.string(), out->geterror()));
+				}
+				stream_interleaved_scanlines(channel_ptrs, exec, options.control, write_scanlines);
+			}
+			else
+			{
+				if (!out->supports("multiimage"))
+				{
+					throw std::runtime_error(
+						std::format("Unable to write masks as parts to '{}' as the format does not support multiple parts", file.string())
+					);
+				}
+
+				std::vector<OIIO::ImageSpec> specs;
+				for (const auto& [name, _] : channels)
+				{
+					auto spec = make_mask_spec(first_channel.width(), first_channel.height(), { "Y" }, options);
+					spec.attribute("oiio:subimagename", name);
+					specs.push_back(std::move(spec));
+				}
+
+				// All of the parts have to be declared up-front, after which we write them one by one.
+				if (!out->open(file.string(), static_cast<int>(specs.size()), specs.data()))
+				{
+					throw std::runtime_error(std::format("Failed to open file '{}': {}", file.string(), out->geterror()));
+				}
+				for (size_t i = 0; i < channels.size(); ++i)
+				{
+					if (i > 0 && !out->open(file.string(), specs[i], OIIO::ImageOutput::AppendSubimage))
+					{
+						throw std::runtime_error(
+							std::format("Failed to append part '{}' to '{}': {}", channels[i].first, file.string(), out->geterror())
+						);
+					}
+					std::array<const compressed::channel<float32_t>*, 1> channel_ptrs = { channels[i].second };
+					stream_interleaved_scanlines(channel_ptrs, exec, options.control, write_scanlines);
+				}
+			}
+
+			if (!out->close())
+			{
+				throw std::runtime_error(std::format("Failed to close file '{}': {}", file.string(), out->geterror()));
+			}
+		}
+
+		// -----------------------------------------------------------------------------------
+		// -----------------------------------------------------------------------------------
+		void write_channels_streamed(
+			const std::filesystem::path& file,
+			const std::vector<std::string>& names,
+			size_t width,
+			size_t height,
+			size_t max_chunk_elems,
+			const write_options& options,
+			NAMESPACE_CRYPTOMATTE_API::executor& exec,
+			const std::function<void(scanline_interleaver& interleaver)>& produce
+		)
+		{
+			_CRYPTOMATTE_PROFILE_FUNCTION();
+			if (names.empty())
+			{
+				throw std::invalid_argument(
+					std::format("Unable to write masks to '{}' as no masks were provided", file.string())
+				);
+			}
+
+			auto out = create_mask_output(file, exec);
+			if (!out->open(file.string(), make_mask_spec(width, height, names, options)))
+			{
+				throw std::runtime_error(std::format("Failed to open file '{}': {}", file.string(), out->geterror()));
+			}
+
+			scanline_interleaver interleaver(names.size(), width, height, max_chunk_elems, make_scanline_writer(*out, file));
+			produce(interleaver);
+			if (interleaver.chunk_idx() != interleaver.num_chunks())
+			{
+				throw std::runtime_error(
+					std::format(
+						"Unable to finish writing '{}' as only {} out of {} chunks were produced", 
+						file.string(), 
+						interleaver.chunk_idx(), 
+						interleaver.num_chunks()
+					)
+				);
+			}
+
+			if (!out->close())
+			{
+				throw std::runtime_error(std::format("Failed to close file '{}': {}", file.string(), out->geterror()));
+			}
+		}
+
 	} // namespace detail
 
 } // namespace NAMESPACE_CRYPTOMATTE_API
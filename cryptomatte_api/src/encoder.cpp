@@ -0,0 +1,196 @@
+#include "encoder.h"
+
+#include <format>
+#include <stdexcept>
+
+#include "metadata.h"
+#include "hash.h"
+#include "detail/detail.h"
+#include "detail/encoding_impl.h"
+#include "detail/flat_id_set.h"
+#include "detail/scoped_timer.h"
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace
+	{
+
+		/// Validate the parameters shared between all the `encode` overloads.
+		void validate_encode_parameters(size_t width, size_t height, const encode_options& options)
+		{
+			if (width == 0 || height == 0)
+			{
+				throw std::invalid_argument(
+					std::format("Unable to encode a cryptomatte with a size of {}x{}, both dimensions must be non-zero", width, height)
+				);
+			}
+			if (options.num_levels == 0)
+			{
+				throw std::invalid_argument("Unable to encode a cryptomatte with 0 levels, at least one level is required");
+			}
+			if (options.name.empty())
+			{
+				throw std::invalid_argument("Unable to encode a cryptomatte without a name");
+			}
+		}
+
+		/// Generate the metadata for an encoded cryptomatte, the key is derived from the name the same way the
+		/// reference implementation does it: the first 7 characters of the hex hash of the name.
+		NAMESPACE_CRYPTOMATTE_API::metadata make_encoded_metadata(const encode_options& options)
+		{
+			auto key = detail::uint32_t_to_hex_str(detail::murmurhash3_32(options.name)).substr(0, 7);
+			return NAMESPACE_CRYPTOMATTE_API::metadata(
+				options.name,
+				std::move(key),
+				"MurmurHash3_32",
+				"uint32_to_float32",
+				options.manifest
+			);
+		}
+
+	} // anonymous namespace
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	cryptomatte encode(
+		std::span<const sample> samples,
+		std::span<const size_t> offsets,
+		size_t width,
+		size_t height,
+		const encode_options& options /* = {} */
+	)
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		validate_encode_parameters(width, height, options);
+		if (offsets.size() != width * height + 1)
+		{
+			throw std::invalid_argument(
+				std::format(
+					"Unable to encode cryptomatte, expected {} offsets (one per pixel plus one) but instead got {}",
+					width * height + 1, offsets.size()
+				)
+			);
+		}
+		for (size_t i = 0; i + 1 < offsets.size(); ++i)
+		{
+			if (offsets[i] > offsets[i + 1])
+			{
+				throw std::invalid_argument(
+					std::format(
+						"Unable to encode cryptomatte, the sample offsets must be non-decreasing but the offset of pixel {} ({})"
+						" is greater than the one of pixel {} ({})",
+						i, offsets[i], i + 1, offsets[i + 1]
+					)
+				);
+			}
+		}
+		if (offsets.back() > samples.size())
+		{
+			throw std::invalid_argument(
+				std::format(
+					"Unable to encode cryptomatte, the last sample offset {} exceeds the number of samples {}",
+					offsets.back(), samples.size()
+				)
+			);
+		}
+
+		auto exec = detail::resolve_executor(options.exec);
+		auto channels = detail::encode_channels(
+			width,
+			height,
+			options,
+			[&](size_t pixel_idx, std::vector<sample>&)
+			{
+				return samples.subspan(offsets[pixel_idx], offsets[pixel_idx + 1] - offsets[pixel_idx]);
+			},
+			*exec
+		);
+		return cryptomatte(std::move(channels), make_encoded_metadata(options), options.coverage, options.exec);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	cryptomatte encode(
+		const std::vector<std::pair<uint32_t, std::span<const float32_t>>>& masks,
+		size_t width,
+		size_t height,
+		const encode_options& options /* = {} */
+	)
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		validate_encode_parameters(width, height, options);
+		for (const auto& [hash, mask] : masks)
+		{
+			if (mask.size() != width * height)
+			{
+				throw std::invalid_argument(
+					std::format(
+						"Unable to encode cryptomatte, the mask for id {} holds {} values while {} were expected ({}x{})",
+						detail::uint32_t_to_hex_str(hash), mask.size(), width * height, width, height
+					)
+				);
+			}
+		}
+
+		auto exec = detail::resolve_executor(options.exec);
+		auto channels = detail::encode_channels(
+			width,
+			height,
+			options,
+			[&](size_t pixel_idx, std::vector<sample>& scratch)
+			{
+				scratch.clear();
+				for (const auto& [hash, mask] : masks)
+				{
+					if (mask[pixel_idx] != 0.0f)
+					{
+						scratch.push_back({ hash, mask[pixel_idx] });
+					}
+				}
+				return std::span<const sample>(scratch);
+			},
+			*exec
+		);
+		return cryptomatte(std::move(channels), make_encoded_metadata(options), options.coverage, options.exec);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	cryptomatte encode(
+		const std::vector<std::pair<std::string, std::span<const float32_t>>>& masks,
+		size_t width,
+		size_t height,
+		const encode_options& options /* = {} */
+	)
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		std::vector<std::string> names;
+		names.reserve(masks.size());
+		for (const auto& [name, _] : masks)
+		{
+			names.push_back(name);
+		}
+		const auto hashes = hash_names(names);
+
+		// Masks sharing a name are passed on as separate masks of the same id which the encoder merges. The 
+		// manifest however must only hold every name once.
+		std::vector<std::pair<uint32_t, std::span<const float32_t>>> hashed_masks;
+		std::vector<std::pair<std::string, uint32_t>> mapping;
+		detail::flat_id_set seen(masks.size());
+		for (size_t i = 0; i < masks.size(); ++i)
+		{
+			hashed_masks.push_back({ hashes[i], masks[i].second });
+			if (seen.insert(hashes[i]))
+			{
+				mapping.push_back({ names[i], hashes[i] });
+			}
+		}
+
+		auto named_options = options;
+		named_options.manifest = NAMESPACE_CRYPTOMATTE_API::manifest(std::move(mapping));
+		return encode(hashed_masks, width, height, named_options);
+	}
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -0,0 +1,298 @@
+#include "executor.h"
+
+#include <atomic>
+#include <algorithm>
+#include <execution>
+#include <ranges>
+#include <stdexcept>
+#include <exception>
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	namespace
+	{
+
+		/// Split up `count` items into blocks of at least `grain_size` items, creating at most `max_blocks` blocks.
+		///
+		/// \returns A pair of the number of blocks and the number of items per block (the last one may be smaller).
+		std::pair<size_t, size_t> split_into_blocks(size_t count, size_t grain_size, size_t max_blocks)
+		{
+			grain_size = std::max<size_t>(grain_size, 1);
+			max_blocks = std::max<size_t>(max_blocks, 1);
+			size_t num_blocks = std::min((count + grain_size - 1) / grain_size, max_blocks);
+			size_t block_size = (count + num_blocks - 1) / num_blocks;
+			// Recompute as rounding up the block size may leave us with fewer blocks.
+			num_blocks = (count + block_size - 1) / block_size;
+			return { num_blocks, block_size };
+		}
+
+		// Generate a few more blocks than we have threads so that unevenly sized work (e.g. a chunk with many ids
+		// next to an empty one) still gets balanced across the threads.
+		constexpr size_t s_blocks_per_thread = 4;
+
+		std::mutex s_default_executor_mutex;
+		std::shared_ptr<executor> s_default_executor = nullptr;
+
+	} // anonymous namespace
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void std_executor::parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		auto [num_blocks, block_size] = split_into_blocks(count, grain_size, this->concurrency() * s_blocks_per_thread);
+		if (num_blocks == 1)
+		{
+			func(0, count);
+			return;
+		}
+
+		// Exceptions escaping a parallel algorithm call std::terminate so we have to catch and rethrow these
+		// ourselves.
+		std::mutex exception_mutex;
+		std::exception_ptr exception = nullptr;
+		auto block_iota = std::views::iota(size_t{ 0 }, num_blocks);
+		std::for_each(std::execution::par, block_iota.begin(), block_iota.end(), [&](size_t block_idx)
+			{
+				const size_t begin = block_idx * block_size;
+				const size_t end = std::min(begin + block_size, count);
+				try
+				{
+					func(begin, end);
+				}
+				catch (...)
+				{
+					std::lock_guard lock(exception_mutex);
+					if (!exception)
+					{
+						exception = std::current_exception();
+					}
+				}
+			});
+
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t std_executor::concurrency() const noexcept
+	{
+		return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void sequential_executor::parallel_for(size_t count, [[maybe_unused]] size_t grain_size, const std::function<void(size_t, size_t)>& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		func(0, count);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t sequential_executor::concurrency() const noexcept
+	{
+		return 1;
+	}
+
+
+	/// A single `parallel_for` invocation on the thread pool, the blocks are claimed by the workers (and the
+	/// calling thread) via an atomic counter.
+	struct thread_pool_executor::job
+	{
+		size_t count = 0;
+		size_t num_blocks = 0;
+		size_t block_size = 0;
+		const std::function<void(size_t, size_t)>* func = nullptr;
+
+		std::atomic<size_t> next_block = 0;
+		std::atomic<size_t> remaining = 0;
+
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr exception = nullptr;
+
+		bool exhausted() const noexcept
+		{
+			return next_block.load(std::memory_order_relaxed) >= num_blocks;
+		}
+
+		/// Claim and run a single block, returns false if there were no blocks left to claim.
+		bool run_one()
+		{
+			size_t block_idx = next_block.fetch_add(1);
+			if (block_idx >= num_blocks)
+			{
+				return false;
+			}
+
+			const size_t begin = block_idx * block_size;
+			const size_t end = std::min(begin + block_size, count);
+			try
+			{
+				(*func)(begin, end);
+			}
+			catch (...)
+			{
+				std::lock_guard lock(mutex);
+				if (!exception)
+				{
+					exception = std::current_exception();
+				}
+			}
+
+			if (remaining.fetch_sub(1) == 1)
+			{
+				std::lock_guard lock(mutex);
+				done.notify_all();
+			}
+			return true;
+		}
+	};
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	thread_pool_executor::thread_pool_executor(size_t num_threads)
+	{
+		if (num_threads == 0)
+		{
+			throw std::invalid_argument("Unable to construct thread_pool_executor with 0 threads");
+		}
+
+		m_NumThreads = num_threads;
+		m_Workers.reserve(num_threads - 1);
+		for (size_t i = 0; i < num_threads - 1; ++i)
+		{
+			m_Workers.emplace_back([this]() { this->worker_loop(); });
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	thread_pool_executor::~thread_pool_executor()
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Condition.notify_all();
+		for (auto& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void thread_pool_executor::parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		auto [num_blocks, block_size] = split_into_blocks(count, grain_size, m_NumThreads * s_blocks_per_thread);
+		if (num_blocks == 1 || m_Workers.empty())
+		{
+			func(0, count);
+			return;
+		}
+
+		auto current_job = std::make_shared<job>();
+		current_job->count = count;
+		current_job->num_blocks = num_blocks;
+		current_job->block_size = block_size;
+		current_job->func = &func;
+		current_job->remaining = num_blocks;
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Jobs.push_back(current_job);
+		}
+		m_Condition.notify_all();
+
+		// Participate in the work ourselves, this guarantees progress even if all the workers are busy (e.g. when
+		// this is a nested call from within a worker).
+		while (current_job->run_one()) {}
+
+		{
+			std::unique_lock lock(current_job->mutex);
+			current_job->done.wait(lock, [&]() { return current_job->remaining.load() == 0; });
+		}
+		{
+			std::lock_guard lock(m_Mutex);
+			std::erase(m_Jobs, current_job);
+		}
+
+		if (current_job->exception)
+		{
+			std::rethrow_exception(current_job->exception);
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t thread_pool_executor::concurrency() const noexcept
+	{
+		return m_NumThreads;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void thread_pool_executor::worker_loop()
+	{
+		while (true)
+		{
+			std::shared_ptr<job> current_job;
+			{
+				std::unique_lock lock(m_Mutex);
+				m_Condition.wait(lock, [&]()
+					{
+						// Drop any jobs that have all of their blocks claimed, the caller waits on them separately.
+						std::erase_if(m_Jobs, [](const auto& j) { return j->exhausted(); });
+						return m_Stop || !m_Jobs.empty();
+					});
+				if (m_Stop)
+				{
+					return;
+				}
+				current_job = m_Jobs.front();
+			}
+
+			while (current_job->run_one()) {}
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void set_default_executor(std::shared_ptr<executor> exec)
+	{
+		std::lock_guard lock(s_default_executor_mutex);
+		s_default_executor = std::move(exec);
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::shared_ptr<executor> get_default_executor()
+	{
+		std::lock_guard lock(s_default_executor_mutex);
+		if (!s_default_executor)
+		{
+			// Lazy init with a sensible default
+			s_default_executor = std::make_shared<std_executor>();
+		}
+		return s_default_executor;
+	}
+
+} // NAMESPACE_CRYPTOMATTE_API
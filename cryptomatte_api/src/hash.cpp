@@ -0,0 +1,53 @@
+#include "hash.h"
+
+#include <numeric>
+#include <algorithm>
+
+#include "detail/detail.h"
+#include "detail/scoped_timer.h"
+
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	uint32_t hash_name(std::string_view name) noexcept
+	{
+		return detail::to_float32_hash(detail::murmurhash3_32(name));
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<uint32_t> hash_names(const std::vector<std::string>& names)
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+
+		// The lanes of the batched hash only advance together over the blocks they have in common, so we hash
+		// the names ordered by length to keep the lanes of a batch as busy as possible.
+		std::vector<size_t> order(names.size());
+		std::iota(order.begin(), order.end(), size_t{ 0 });
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+			{
+				return names[a].size() < names[b].size();
+			});
+
+		std::vector<std::string_view> sorted_names;
+		sorted_names.reserve(names.size());
+		for (auto idx : order)
+		{
+			sorted_names.push_back(names[idx]);
+		}
+
+		std::vector<uint32_t> sorted_hashes(names.size());
+		detail::murmurhash3_32(sorted_names, sorted_hashes);
+
+		std::vector<uint32_t> out(names.size());
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			out[order[i]] = detail::to_float32_hash(sorted_hashes[i]);
+		}
+		return out;
+	}
+
+}
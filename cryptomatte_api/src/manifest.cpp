@@ -1,8 +1,15 @@
 #include "manifest.h"
 
 #include <format>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
 
+#include "hash.h"
 #include "detail/detail.h"
+#include "detail/scoped_timer.h"
+#include "detail/string_util.h"
 #include "logger.h"
 
 
@@ -29,6 +36,16 @@ namespace NAMESPACE_CRYPTOMATTE_API
 				);
 			}
 		}
+		this->build_index();
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	manifest::manifest(std::vector<std::pair<std::string, uint32_t>> mapping)
+	{
+		m_Mapping = std::move(mapping);
+		this->build_index();
 	}
 
 
@@ -106,16 +123,9 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	bool manifest::contains(std::string_view name)
+	bool manifest::contains(std::string_view name) const
 	{
-		for (const auto& [key, val] : m_Mapping)
-		{
-			if (key == name)
-			{
-				return true;
-			}
-		}
-		return false;
+		return this->find(name) != nullptr;
 	}
 
 
@@ -131,6 +141,18 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		return out;
 	}
 
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	json_ordered manifest::to_json() const
+	{
+		json_ordered out = json_ordered::object();
+		for (const auto& [name, hash] : m_Mapping)
+		{
+			out[name] = detail::uint32_t_to_hex_str(hash);
+		}
+		return out;
+	}
+
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
 	size_t manifest::size() const noexcept
@@ -138,4 +160,159 @@ namespace NAMESPACE_CRYPTOMATTE_API
 		return m_Mapping.size();
 	}
 
-} // NAMESPACE_CRYPTOMATTE_API
\ No newline at end of file
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<std::string> manifest::verify() const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		auto computed = hash_names(this->names());
+
+		std::vector<std::string> mismatched;
+		for (size_t i = 0; i < m_Mapping.size(); ++i)
+		{
+			if (m_Mapping[i].second != computed[i])
+			{
+				mismatched.push_back(m_Mapping[i].first);
+			}
+		}
+		return mismatched;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::optional<std::string_view> manifest::name(uint32_t hash) const noexcept
+	{
+		auto it = std::lower_bound(m_HashIndex.begin(), m_HashIndex.end(), hash, [&](uint32_t idx, uint32_t value)
+			{
+				return m_Mapping[idx].second < value;
+			});
+		if (it != m_HashIndex.end() && m_Mapping[*it].second == hash)
+		{
+			return std::string_view(m_Mapping[*it].first);
+		}
+		return std::nullopt;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<uint32_t> manifest::hashes_with_prefix(std::string_view prefix) const
+	{
+		std::vector<uint32_t> out;
+		for (auto idx : this->prefix_range(prefix))
+		{
+			out.push_back(m_Mapping[idx].second);
+		}
+		return out;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<uint32_t> manifest::hashes_matching(std::string_view pattern) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		std::vector<uint32_t> out;
+		this->for_each_match(pattern, [&](size_t idx)
+			{
+				out.push_back(m_Mapping[idx].second);
+			});
+		return out;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::vector<std::string_view> manifest::names_matching(std::string_view pattern) const
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		std::vector<std::string_view> out;
+		this->for_each_match(pattern, [&](size_t idx)
+			{
+				out.push_back(m_Mapping[idx].first);
+			});
+		return out;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void manifest::build_index()
+	{
+		_CRYPTOMATTE_PROFILE_FUNCTION();
+		if (m_Mapping.size() > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::length_error(
+				std::format("Unable to index a manifest with {} entries, at most 2^32 - 1 are supported", m_Mapping.size())
+			);
+		}
+
+		m_NameIndex.resize(m_Mapping.size());
+		std::iota(m_NameIndex.begin(), m_NameIndex.end(), uint32_t{ 0 });
+		m_HashIndex = m_NameIndex;
+
+		// Stable sorts so that duplicate names or hashes resolve to the first one in the manifest.
+		std::stable_sort(m_NameIndex.begin(), m_NameIndex.end(), [&](uint32_t a, uint32_t b)
+			{
+				return m_Mapping[a].first < m_Mapping[b].first;
+			});
+		std::stable_sort(m_HashIndex.begin(), m_HashIndex.end(), [&](uint32_t a, uint32_t b)
+			{
+				return m_Mapping[a].second < m_Mapping[b].second;
+			});
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	const std::pair<std::string, uint32_t>* manifest::find(std::string_view name) const noexcept
+	{
+		auto it = std::lower_bound(m_NameIndex.begin(), m_NameIndex.end(), name, [&](uint32_t idx, std::string_view value)
+			{
+				return std::string_view(m_Mapping[idx].first) < value;
+			});
+		if (it != m_NameIndex.end() && m_Mapping[*it].first == name)
+		{
+			return &m_Mapping[*it];
+		}
+		return nullptr;
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::span<const uint32_t> manifest::prefix_range(std::string_view prefix) const noexcept
+	{
+		// All names starting with the prefix sort directly after (or equal to) the prefix itself so they form a
+		// contiguous range starting at its lower bound.
+		auto begin = std::lower_bound(m_NameIndex.begin(), m_NameIndex.end(), prefix, [&](uint32_t idx, std::string_view value)
+			{
+				return std::string_view(m_Mapping[idx].first) < value;
+			});
+		auto end = std::find_if_not(begin, m_NameIndex.end(), [&](uint32_t idx)
+			{
+				return m_Mapping[idx].first.starts_with(prefix);
+			});
+		return std::span<const uint32_t>(begin, end);
+	}
+
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	void manifest::for_each_match(std::string_view pattern, const std::function<void(size_t idx)>& fn) const
+	{
+		const auto prefix = str::glob_literal_prefix(pattern);
+		const auto remainder = pattern.substr(prefix.size());
+		for (auto idx : this->prefix_range(prefix))
+		{
+			// The prefix is already known to match so only the rest of the name has to be matched.
+			if (str::glob_match(std::string_view(m_Mapping[idx].first).substr(prefix.size()), remainder))
+			{
+				fn(idx);
+			}
+		}
+	}
+
+} // NAMESPACE_CRYPTOMATTE_API
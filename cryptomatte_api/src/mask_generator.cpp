@@ -0,0 +1,151 @@
+#include "mask_generator.h"
+
+#include <format>
+#include <stdexcept>
+#include <unordered_set>
+#include <algorithm>
+
+#include "cryptomatte.h"
+#include "detail/decoding_impl.h"
+#include "detail/scoped_timer.h"
+
+namespace NAMESPACE_CRYPTOMATTE_API
+{
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	mask_generator::mask_generator(
+		const cryptomatte& matte,
+		std::vector<uint32_t> hashes,
+		size_t max_masks,
+		task_control control /* = {} */,
+		incremental_strategy strategy /* = incremental_strategy::single_pass */
+	)
+	{
+		if (max_masks == 0)
+		{
+			throw std::invalid_argument("Unable to create a mask_generator decoding 0 masks at once, max_masks must be at least 1");
+		}
+
+		m_Matte = &matte;
+		m_MaxMasks = max_masks;
+		m_Control = std::move(control);
+		m_Strategy = strategy;
+
+		// Duplicates would be decoded into the same mask, so only the first occurrence of every hash is kept.
+		std::unordered_set<uint32_t> seen;
+		m_Hashes.reserve(hashes.size());
+		for (auto hash : hashes)
+		{
+			if (seen.insert(hash).second)
+			{
+				m_Hashes.push_back(hash);
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	std::optional<std::pair<std::string, std::vector<float32_t>>> mask_generator::next()
+	{
+		if (m_Batch.empty() && m_NextBatch < m_Hashes.size())
+		{
+			const size_t batch_end = std::min(m_NextBatch + m_MaxMasks, m_Hashes.size());
+			std::vector<uint32_t> batch(m_Hashes.begin() + m_NextBatch, m_Hashes.begin() + batch_end);
+			const auto& manifest = m_Matte->metadata().manifest();
+
+			if (m_Strategy == incremental_strategy::single_pass)
+			{
+				if (!m_Decoded)
+				{
+					_CRYPTOMATTE_PROFILE_SCOPE("decode masks compressed");
+					m_Compressed = m_Matte->masks_compressed(m_Hashes, m_Control);
+					m_Decoded = true;
+				}
+
+				// Decompress the masks of the batch in parallel, releasing the compressed masks once they were 
+				// handed over so the memory usage shrinks as the generator advances.
+				_CRYPTOMATTE_PROFILE_SCOPE("decompress mask batch");
+				const size_t num_pixels = this->width() * this->height();
+				std::vector<std::pair<std::string, std::vector<float32_t>>> decompressed(batch.size());
+				for (size_t i = 0; i < batch.size(); ++i)
+				{
+					decompressed[i].first = detail::mask_name(batch[i], manifest);
+				}
+				detail::resolve_executor(m_Matte->executor())->parallel_for(batch.size(), 1, [&](size_t begin, size_t end)
+					{
+						for (size_t i = begin; i < end; ++i)
+						{
+							// The map is not modified while decompressing so it is safe to read from multiple threads.
+							auto it = m_Compressed.find(decompressed[i].first);
+							if (it != m_Compressed.end())
+							{
+								decompressed[i].second = it->second.get_decompressed();
+							}
+							else
+							{
+								decompressed[i].second = std::vector<float32_t>(num_pixels);
+							}
+						}
+					});
+				for (auto& [name, mask] : decompressed)
+				{
+					m_Compressed.erase(name);
+					m_Batch.emplace_back(std::move(name), std::move(mask));
+				}
+			}
+			else
+			{
+				_CRYPTOMATTE_PROFILE_SCOPE("decode mask batch");
+				auto masks = m_Matte->masks(batch, m_Control);
+
+				// The masks are returned mapped by their names so we re-establish the requested order here.
+				for (auto hash : batch)
+				{
+					auto name = detail::mask_name(hash, manifest);
+					auto it = masks.find(name);
+					auto mask = it != masks.end() ? std::move(it->second) : std::vector<float32_t>(this->width() * this->height());
+					m_Batch.emplace_back(std::move(name), std::move(mask));
+				}
+			}
+			m_NextBatch = batch_end;
+		}
+
+		if (m_Batch.empty())
+		{
+			return std::nullopt;
+		}
+		auto out = std::move(m_Batch.front());
+		m_Batch.pop_front();
+		return out;
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t mask_generator::size() const noexcept
+	{
+		return m_Hashes.size();
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t mask_generator::remaining() const noexcept
+	{
+		return m_Hashes.size() - m_NextBatch + m_Batch.size();
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t mask_generator::width() const
+	{
+		return m_Matte->width();
+	}
+
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	size_t mask_generator::height() const
+	{
+		return m_Matte->height();
+	}
+
+} // NAMESPACE_CRYPTOMATTE_API
@@ -246,6 +246,27 @@ namespace NAMESPACE_CRYPTOMATTE_API
 	}
 
 
+	// -----------------------------------------------------------------------------------
+	// -----------------------------------------------------------------------------------
+	json_ordered metadata::to_json() const
+	{
+		auto make_key = [&](const std::string& attribute)
+			{
+				return std::format("cryptomatte/{}/{}", m_Key, attribute);
+			};
+
+		json_ordered out = json_ordered::object();
+		out[make_key(metadata::attrib_name_identifier())] = m_Name;
+		out[make_key(metadata::attrib_hash_method_identifier())] = m_Hash;
+		out[make_key(metadata::attrib_conversion_method_identifier())] = m_Conversion;
+		if (m_Manifest)
+		{
+			out[make_key(metadata::attrib_manifest_identifier())] = m_Manifest.value().to_json().dump();
+		}
+		return out;
+	}
+
+
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
 	std::vector<std::string> metadata::channel_names(const std::vector<std::string>& channelnames) const
@@ -374,7 +395,7 @@ namespace NAMESPACE_CRYPTOMATTE_API
 
 	// -----------------------------------------------------------------------------------
 	// -----------------------------------------------------------------------------------
-	std::optional<manifest> metadata::manifest() const
+	const std::optional<manifest>& metadata::manifest() const
 	{
 		return m_Manifest;
 	}
@@ -5,7 +5,8 @@
 #include <pybind11/chrono.h>
 #include <pybind11/stl/filesystem.h>
 
-#include <py_img_util/image.h>
+#include "py_array_util.h"
+#include "gil_util.h"
 
 #include <cryptomatte/cryptomatte.h>
 
@@ -15,6 +16,57 @@ using namespace NAMESPACE_CRYPTOMATTE_API;
 
 void bind_cryptomatte(py::module_& m)
 {
+    py::enum_<coverage_precision>(m, "CoveragePrecision", R"doc(
+
+The in-memory storage precision of the coverage channels. The masks are always returned as float32.
+
+)doc")
+        .value("float32", coverage_precision::float32, "Store the coverage channels as-is (lossless).")
+        .value("float16", coverage_precision::float16, "Store the coverage channels as half-precision floats.")
+        .value("unorm16", coverage_precision::unorm16, "Store the coverage channels as normalized 16-bit integers, clamping to [0, 1].")
+        .export_values();
+
+    py::class_<id_statistics>(m, "IdStatistics", R"doc(
+
+The coverage statistics of a single id across the whole image, see `Cryptomatte.statistics`.
+
+)doc")
+        .def_readonly("pixel_count", &id_statistics::pixel_count, "The number of pixels on which the id has a non-zero coverage.")
+        .def_readonly("coverage_sum", &id_statistics::coverage_sum, "The sum of the coverage of the id across all pixels, i.e. its area in pixels.")
+        .def_readonly("min_x", &id_statistics::min_x, "The inclusive minimum x coordinate of the bounding box of the id.")
+        .def_readonly("min_y", &id_statistics::min_y, "The inclusive minimum y coordinate of the bounding box of the id.")
+        .def_readonly("max_x", &id_statistics::max_x, "The inclusive maximum x coordinate of the bounding box of the id.")
+        .def_readonly("max_y", &id_statistics::max_y, "The inclusive maximum y coordinate of the bounding box of the id.");
+
+    py::class_<mask_generator>(m, "MaskGenerator", R"doc(
+
+Iterator decoding the masks of a cryptomatte in a single pass, yielding (name, mask) tuples one at a time.
+See `Cryptomatte.iter_masks`.
+
+)doc")
+        .def(
+            "__iter__",
+            [](mask_generator& self) -> mask_generator& { return self; },
+            py::return_value_policy::reference_internal
+        )
+        .def(
+            "__next__",
+            [](mask_generator& self)
+            {
+                auto result = gil_util::without_gil([&]() { return self.next(); });
+                if (!result)
+                {
+                    throw py::stop_iteration();
+                }
+                auto& [name, mask] = result.value();
+                return py::make_tuple(
+                    name,
+                    py_array_util::to_py_array(std::move(mask), self.width(), self.height())
+                );
+            }
+        )
+        .def("__len__", &mask_generator::remaining, "The number of masks that have not been yielded yet.");
+
     py::class_<cryptomatte, std::shared_ptr<cryptomatte>> crypto_class(m, "Cryptomatte", R"doc(
 
 A cryptomatte file loaded from disk or memory storing the channels as compressed buffer
@@ -34,22 +86,24 @@ Construct an empty Cryptomatte object.
         .def(
             py::init(
                 [](
-                    std::unordered_map<std::string, py::array_t<float32_t>>& channels,
+                    std::unordered_map<std::string, py::array_t<float32_t, py::array::c_style | py::array::forcecast>>& channels,
                     size_t width,
                     size_t height,
                     metadata& metadata
                 )
                 {
-                    std::unordered_map<std::string, std::vector<float32_t>> converted_channels;
-                    for (auto& [key, channel] : channels)
+                    // C-contiguous float32 arrays are viewed directly without copying, these are kept alive by 
+                    // `channels` for the duration of the construction.
+                    std::unordered_map<std::string, std::span<const float32_t>> views;
+                    for (const auto& [key, channel] : channels)
                     {
-                        converted_channels[key] = py_img_util::from_py_array(
-                            py_img_util::tag::vector{},
-                            channel,
-                            width,
-                            height);
+                        views[key] = py_array_util::as_span<float32_t>(channel, width, height);
                     }
-                    return std::make_unique<cryptomatte>(converted_channels, width, height, metadata);
+                    // Compressing the channels is the expensive part, which is done in parallel with the GIL released.
+                    return gil_util::without_gil([&]()
+                        {
+                            return std::make_unique<cryptomatte>(views, width, height, metadata);
+                        });
                 }
             ),
             py::arg("channels"),
@@ -60,6 +114,8 @@ Construct an empty Cryptomatte object.
 Construct a Cryptomatte from raw float32 image arrays.
 
 :param channels: Mapping of channel names to float32 image arrays. Each array must be shaped (height, width).
+                 C-contiguous float32 arrays are read directly without being copied, other arrays are converted
+                 first. The arrays must not be modified from other threads during construction.
 :param width: Image width.
 :param height: Image height.
 :param metadata: Metadata used to validate and classify the provided channels.
@@ -74,14 +130,24 @@ Construct a Cryptomatte from raw float32 image arrays.
     crypto_class
         .def_static(
             "load",
-            &cryptomatte::load,
+            [](std::filesystem::path file, bool load_preview, coverage_precision coverage)
+            {
+                load_options options;
+                options.load_preview = load_preview;
+                options.coverage = coverage;
+                return cryptomatte::load(file, options);
+            },
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("file"),
             py::arg("load_preview") = false,
+            py::arg("coverage_precision") = coverage_precision::float32,
             R"doc(
 Load cryptomatte(s) from an EXR file.
 
 :param file: Path to an EXR file containing cryptomatte channels.
 :param load_preview: Whether to load the legacy preview channels (.r/.g/.b).
+:param coverage_precision: The in-memory storage precision of the coverage channels. Reduced precisions
+                           halve the memory footprint of the coverage channels at the cost of some accuracy.
 :returns: List of loaded Cryptomatte instances.
 )doc"
         );
@@ -132,12 +198,12 @@ Return whether preview (legacy .r/.g/.b) channels are available and loaded.
             "preview",
             [](cryptomatte& self)
             {
-                auto result = self.preview();
+                auto result = gil_util::without_gil([&]() { return self.preview(); });
                 std::vector<py::array_t<float32_t>> out;
                 for (auto& channel : result)
                 {
                     out.push_back(
-                        py_img_util::to_py_array(
+                        py_array_util::to_py_array(
                             std::move(channel),
                             self.width(),
                             self.height()
@@ -151,6 +217,148 @@ Return the preview (legacy) image channels as float32 numpy arrays. This list ma
 without `load_preview` enabled.
 
 :returns: List of numpy arrays representing preview channels, may be empty
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "ids_at",
+            [](const cryptomatte& self, size_t x, size_t y)
+            {
+                std::vector<std::tuple<uint32_t, std::string, float32_t>> out;
+                auto ids = gil_util::without_gil([&]() { return self.ids_at(x, y); });
+                for (auto& id : ids)
+                {
+                    out.emplace_back(id.hash, std::move(id.name), id.coverage);
+                }
+                return out;
+            },
+            py::arg("x"),
+            py::arg("y"),
+            R"doc(
+Retrieve all ids present on the given pixel ordered by descending coverage, only decompressing the chunks holding
+the pixel. Intended for interactive picking.
+
+:param x: The x coordinate of the pixel.
+:param y: The y coordinate of the pixel.
+
+:raises IndexError: If the pixel lies outside of the image.
+
+:returns: List of (hash, name, coverage) tuples, the name is the hash in hex form if it is not on the manifest.
+)doc"
+        )
+        .def(
+            "ids_at",
+            [](const cryptomatte& self, std::vector<std::pair<size_t, size_t>> points)
+            {
+                std::vector<std::vector<std::tuple<uint32_t, std::string, float32_t>>> out;
+                auto result = gil_util::without_gil([&]() { return self.ids_at(std::span<const std::pair<size_t, size_t>>(points)); });
+                for (auto& ids : result)
+                {
+                    auto& pixel_out = out.emplace_back();
+                    for (auto& id : ids)
+                    {
+                        pixel_out.emplace_back(id.hash, std::move(id.name), id.coverage);
+                    }
+                }
+                return out;
+            },
+            py::arg("points"),
+            R"doc(
+Retrieve all ids present on each of the given pixels ordered by descending coverage. Every chunk is only
+decoded once regardless of the order of the points.
+
+:param points: The (x, y) coordinates of the pixels.
+
+:raises IndexError: If any of the pixels lie outside of the image.
+
+:returns: One list of (hash, name, coverage) tuples per point.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "statistics",
+            [](const cryptomatte& self)
+            {
+                return self.statistics();
+            },
+            py::call_guard<py::gil_scoped_release>(),
+            R"doc(
+Compute the coverage statistics (pixel count, coverage sum and bounding box) of every id in a single pass over the
+levels without decoding any masks.
+
+:returns: The statistics of all ids present in the image mapped by their hash.
+)doc"
+        )
+        .def(
+            "statistics",
+            [](const cryptomatte& self, std::vector<uint32_t> hashes)
+            {
+                return self.statistics(std::move(hashes));
+            },
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("hashes"),
+            R"doc(
+Compute the coverage statistics (pixel count, coverage sum and bounding box) of the given ids.
+
+:param hashes: The hashes to compute the statistics for, hashes not present in the image are skipped.
+
+:returns: The statistics of the requested ids mapped by their hash.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "id_map",
+            [](cryptomatte& self)
+            {
+                auto result = gil_util::without_gil([&]() { return self.id_map(); });
+                return py::make_tuple(
+                    py_array_util::to_py_array(
+                        std::move(result.ids),
+                        self.width(),
+                        self.height()
+                    ),
+                    py_array_util::to_py_array(
+                        std::move(result.coverage),
+                        self.width(),
+                        self.height()
+                    )
+                );
+            },
+            R"doc(
+Compute the dominant (highest coverage) id of every pixel along with its coverage in a single pass over the levels.
+Pixels without any id hold an id and coverage of 0.
+
+:returns: Tuple of the ids as np.uint32 array and their coverage as np.float32 array.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "generate_preview",
+            [](cryptomatte& self)
+            {
+                auto result = gil_util::without_gil([&]() { return self.generate_preview(); });
+                std::vector<py::array_t<float32_t>> out;
+                for (auto& channel : result)
+                {
+                    out.push_back(
+                        py_array_util::to_py_array(
+                            std::move(channel),
+                            self.width(),
+                            self.height()
+                        )
+                    );
+                }
+                return out;
+            },
+            R"doc(
+Generate the id-colour preview from the rank and coverage channels, independent of the legacy preview channels.
+Each pixel is the coverage weighted blend of the colours of all ids on it.
+
+:returns: List of the red, green and blue channels as float32 numpy arrays.
 )doc"
         );
 
@@ -166,15 +374,15 @@ without `load_preview` enabled.
             {
                 if (std::holds_alternative<std::string>(name_or_hash))
                 {
-                    auto result = self.mask(std::get<std::string>(name_or_hash));
-                    return py_img_util::to_py_array(
+                    auto result = gil_util::without_gil([&]() { return self.mask(std::get<std::string>(name_or_hash)); });
+                    return py_array_util::to_py_array(
                         std::move(result),
                         self.width(),
                         self.height()
                     );
                 }
-                auto result = self.mask(std::get<uint32_t>(name_or_hash));
-                return py_img_util::to_py_array(
+                auto result = gil_util::without_gil([&]() { return self.mask(std::get<uint32_t>(name_or_hash)); });
+                return py_array_util::to_py_array(
                     std::move(result),
                     self.width(),
                     self.height()
@@ -186,6 +394,56 @@ Compute and return a decoded mask for the given object name.
 
 :param name: Name from the manifest.
 :returns: np.float32 array mask.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "mask_union",
+            [](cryptomatte& self, std::variant<std::vector<std::string>, std::vector<uint32_t>> names_or_hashes)
+            {
+                auto result = gil_util::without_gil([&]()
+                    {
+                        if (std::holds_alternative<std::vector<std::string>>(names_or_hashes))
+                        {
+                            return self.mask_union(std::get<std::vector<std::string>>(names_or_hashes));
+                        }
+                        return self.mask_union(std::get<std::vector<uint32_t>>(names_or_hashes));
+                    });
+                return py_array_util::to_py_array(
+                    std::move(result),
+                    self.width(),
+                    self.height()
+                );
+            },
+            py::arg("names_or_hashes"),
+            R"doc(
+Compute the combined (summed) mask of the given names or hashes in a single pass, this is considerably cheaper
+than extracting the masks individually and summing them.
+
+:param names_or_hashes: List of names from the manifest or list of hashes.
+:returns: np.float32 array mask.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "mask_by_name_unmanifested",
+            [](cryptomatte& self, std::string name)
+            {
+                auto result = gil_util::without_gil([&]() { return self.mask_by_name_unmanifested(name); });
+                return py_array_util::to_py_array(
+                    std::move(result),
+                    self.width(),
+                    self.height()
+                );
+            },
+            py::arg("name"),
+            R"doc(
+Compute and return a decoded mask for the given object name by hashing it, no manifest is required.
+
+:param name: Name of the object, does not need to be on the manifest.
+:returns: np.float32 array mask.
 )doc"
         );
 
@@ -197,30 +455,26 @@ Compute and return a decoded mask for the given object name.
             {
                 // This function essentially wraps 3 unique functions in cpp into a single one for ease of use and a more
                 // pythonic interface. We take an optional list of strings or integers and dispatch to the right function
-                // accordingly
-                std::unordered_map<std::string, std::vector<float32_t>> result_from_cpp;
-                if (names_or_hashes)
-                {
-                    auto& names_or_hashes_val = names_or_hashes.value();
-                    if (std::holds_alternative<std::vector<std::string>>(names_or_hashes_val))
-                    {
-                        result_from_cpp = self.masks(std::get<std::vector<std::string>>(names_or_hashes_val));
-                    }
-                    else
+                // accordingly. The decoding itself happens with the GIL released.
+                auto result_from_cpp = gil_util::without_gil([&]()
                     {
-                        result_from_cpp = self.masks(std::get<std::vector<uint32_t>>(names_or_hashes_val));
-                    }
-                }
-                else
-                {
-                    result_from_cpp = self.masks();
-                }
+                        if (!names_or_hashes)
+                        {
+                            return self.masks();
+                        }
+                        auto& names_or_hashes_val = names_or_hashes.value();
+                        if (std::holds_alternative<std::vector<std::string>>(names_or_hashes_val))
+                        {
+                            return self.masks(std::get<std::vector<std::string>>(names_or_hashes_val));
+                        }
+                        return self.masks(std::get<std::vector<uint32_t>>(names_or_hashes_val));
+                    });
 
                 // Now finally, convert from the cpp types into python numpy arrays (mapped by string)
                 std::unordered_map<std::string, py::array_t<float32_t>> out;
                 for (auto& [key, value] : result_from_cpp)
                 {
-                    out[key] = py_img_util::to_py_array(
+                    out[key] = py_array_util::to_py_array(
                         std::move(value),
                         self.width(),
                         self.height()
@@ -231,6 +485,83 @@ Compute and return a decoded mask for the given object name.
             py::arg("names_or_hashes") = py::none()
         );
 
+    crypto_class
+        .def(
+            "iter_masks",
+            [](cryptomatte& self, std::optional<std::variant<std::vector<std::string>, std::vector<uint32_t>>> names_or_hashes, size_t max_masks)
+            {
+                return gil_util::without_gil([&]()
+                    {
+                        if (!names_or_hashes)
+                        {
+                            return self.masks_incremental(max_masks);
+                        }
+                        auto& names_or_hashes_val = names_or_hashes.value();
+                        if (std::holds_alternative<std::vector<std::string>>(names_or_hashes_val))
+                        {
+                            return self.masks_incremental(std::get<std::vector<std::string>>(names_or_hashes_val), max_masks);
+                        }
+                        return self.masks_incremental(std::get<std::vector<uint32_t>>(names_or_hashes_val), max_masks);
+                    });
+            },
+            py::arg("names_or_hashes") = py::none(),
+            py::arg("max_masks") = 16,
+            // The generator references the cryptomatte, so it must be kept alive for as long as the generator is.
+            py::keep_alive<0, 1>(),
+            R"doc(
+Lazily decode the masks, yielding (name, mask) tuples while holding at most `max_masks` decoded masks at once.
+This keeps the memory usage bounded on images with many ids, e.g. when writing the masks to disk or feeding 
+them into a dataset loader one after another.
+
+:param names_or_hashes: Optional list of names from the manifest or list of hashes, the masks are yielded in 
+                        this order. If omitted all ids in the image are yielded in ascending order of their hash.
+:param max_masks: The maximum number of decoded masks held at once, the remaining masks are held compressed.
+:returns: MaskGenerator yielding (name, np.float32 array mask) tuples.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "ids",
+            [](cryptomatte& self)
+            {
+                return gil_util::without_gil([&]() { return self.ids(); });
+            },
+            R"doc(
+Collect the unique ids present in the image, only the rank channels are decoded for this.
+
+:returns: Sorted list of the hashes.
+)doc"
+        );
+
+    crypto_class
+        .def(
+            "masks_matching",
+            [](cryptomatte& self, std::string pattern)
+            {
+                auto result_from_cpp = gil_util::without_gil([&]() { return self.masks_matching(pattern); });
+                std::unordered_map<std::string, py::array_t<float32_t>> out;
+                for (auto& [key, value] : result_from_cpp)
+                {
+                    out[key] = py_array_util::to_py_array(
+                        std::move(value),
+                        self.width(),
+                        self.height()
+                    );
+                }
+                return out;
+            },
+            py::arg("pattern"),
+            R"doc(
+Compute and return the masks of all names on the manifest matching the glob pattern.
+
+'*' matches any sequence of characters (including '/') and '?' any single character, e.g. '*/char_*/body*'.
+
+:param pattern: The glob pattern to match the names against.
+:returns: Dict of name -> np.float32 array mask, empty if no name matches.
+)doc"
+        );
+
     //----------------------------------------------------------------------------//
     // Metadata and Levels                                                         //
     //----------------------------------------------------------------------------//
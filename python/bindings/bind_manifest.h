@@ -5,6 +5,7 @@
 #include <thirdparty/pybind11_json.hpp>
 
 #include <cryptomatte/manifest.h>
+#include <cryptomatte/hash.h>
 
 namespace py = pybind11;
 using namespace NAMESPACE_CRYPTOMATTE_API;
@@ -190,5 +191,79 @@ Retrieve the full name-to-hash mapping as float32 values.
 Retrieve the full name-to-hash mapping as hexadecimal strings.
 
 :returns: List of (name, hash) pairs with hash as 8-character hex strings.
+)doc");
+
+    manifest_cls
+        .def("name",
+            &manifest::name,
+            py::arg("hash"),
+            R"doc(
+Get the name associated with the given hash.
+
+:param hash: The uint32 hash to look up.
+:returns: The name or None if the hash is not on the manifest.
+)doc");
+
+    manifest_cls
+        .def("hashes_with_prefix",
+            &manifest::hashes_with_prefix,
+            py::arg("prefix"),
+            R"doc(
+Get the hashes of all names starting with the given prefix, e.g. '/crowd/char_01/'.
+
+:param prefix: The prefix to match.
+:returns: List of uint32 hashes ordered by their names.
+)doc");
+
+    manifest_cls
+        .def("hashes_matching",
+            &manifest::hashes_matching,
+            py::arg("pattern"),
+            R"doc(
+Get the hashes of all names matching the glob pattern. '*' matches any sequence of characters (including '/')
+and '?' any single character.
+
+:param pattern: The glob pattern, e.g. '*/char_*/body*'.
+:returns: List of uint32 hashes ordered by their names.
+)doc");
+
+    manifest_cls
+        .def("names_matching",
+            &manifest::names_matching,
+            py::arg("pattern"),
+            R"doc(
+Get all names matching the glob pattern, see hashes_matching for the syntax.
+
+:param pattern: The glob pattern, e.g. '*/char_*/body*'.
+:returns: List of the matching names in sorted order.
+)doc");
+
+    manifest_cls
+        .def("verify",
+            &manifest::verify,
+            R"doc(
+Verify the stored hashes against the MurmurHash3_32 ids of their names.
+
+:returns: The names whose stored hash does not match, an empty list if the manifest is consistent.
+)doc");
+
+    m.def("hash_name",
+        &hash_name,
+        py::arg("name"),
+        R"doc(
+Compute the cryptomatte id (MurmurHash3_32 with the uint32_to_float32 conversion) of a name.
+
+:param name: The object name, e.g. 'bunny'.
+:returns: The id as uint32.
+)doc");
+
+    m.def("hash_names",
+        &hash_names,
+        py::arg("names"),
+        R"doc(
+Compute the cryptomatte ids of many names at once, considerably faster than calling hash_name repeatedly.
+
+:param names: The object names.
+:returns: The ids as uint32 in the same order as names.
 )doc");
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include <utility>
+
+namespace py = pybind11;
+
+
+namespace gil_util
+{
+
+    /// \brief Invoke `fn` with the GIL released, re-acquiring it before returning the result.
+    ///
+    /// This allows other python threads to run while we are e.g. decoding masks. `fn` must not touch any python
+    /// objects and should return plain c++ types which are then converted into python objects with the GIL held.
+    template <typename Fn>
+    decltype(auto) without_gil(Fn&& fn)
+    {
+        py::gil_scoped_release release;
+        return std::forward<Fn>(fn)();
+    }
+
+} // gil_util
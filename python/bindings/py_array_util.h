@@ -0,0 +1,72 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <vector>
+#include <memory>
+#include <span>
+#include <format>
+
+namespace py = pybind11;
+
+
+namespace py_array_util
+{
+
+    /// \brief Hand over ownership of the given buffer to a 2D numpy array of shape (height, width) without copying.
+    ///
+    /// The vector is moved onto the heap and owned by a capsule which is attached to the array as its base,
+    /// numpy then frees the buffer once the array (and any views into it) are garbage collected. This avoids
+    /// copying every decoded mask once more after it has been computed.
+    ///
+    /// \param data   The buffer to hand over, must hold `width * height` elements. Will be consumed.
+    /// \param width  The width of the image.
+    /// \param height The height of the image.
+    template <typename T>
+    py::array_t<T> to_py_array(std::vector<T>&& data, size_t width, size_t height)
+    {
+        if (data.size() != width * height)
+        {
+            throw py::value_error("Unable to convert buffer to a numpy array as its size does not match width * height");
+        }
+
+        auto owned = std::make_unique<std::vector<T>>(std::move(data));
+        T* ptr = owned->data();
+        // Once the capsule is constructed it owns the buffer, so it must be released from the unique_ptr right away.
+        py::capsule owner(owned.get(), [](void* buffer)
+            {
+                delete static_cast<std::vector<T>*>(buffer);
+            });
+        owned.release();
+
+        return py::array_t<T>(
+            { static_cast<py::ssize_t>(height), static_cast<py::ssize_t>(width) },
+            { static_cast<py::ssize_t>(width * sizeof(T)), static_cast<py::ssize_t>(sizeof(T)) },
+            ptr,
+            owner
+        );
+    }
+
+    /// \brief Create a non-owning view over the buffer of a C-contiguous numpy array.
+    ///
+    /// Arrays taken as `py::array_t<T, py::array::c_style | py::array::forcecast>` are only copied by pybind11 if
+    /// they are not already C-contiguous arrays of type T, so in the common case this gives direct access to the
+    /// numpy buffer. The array must outlive the returned span.
+    ///
+    /// \param array  The array to view.
+    /// \param width  The expected width of the image.
+    /// \param height The expected height of the image.
+    template <typename T>
+    std::span<const T> as_span(const py::array_t<T, py::array::c_style | py::array::forcecast>& array, size_t width, size_t height)
+    {
+        if (static_cast<size_t>(array.size()) != width * height)
+        {
+            throw py::value_error(
+                std::format("Unable to view numpy array of size {} as an image of {}x{} pixels", array.size(), width, height)
+            );
+        }
+        return std::span<const T>(array.data(), static_cast<size_t>(array.size()));
+    }
+
+} // py_array_util
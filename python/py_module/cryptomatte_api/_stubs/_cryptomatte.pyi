@@ -1,10 +1,43 @@
-from typing import Dict, List, Union
+from typing import Dict, Iterator, List, Optional, Tuple, Union
+from enum import Enum
 import numpy as np
 from pathlib import Path
 
 from ._metadata import *
 
 
+class CoveragePrecision(Enum):
+    """
+    The in-memory storage precision of the coverage channels. The masks are always returned as float32.
+    """
+    float32 = 0
+    float16 = 1
+    unorm16 = 2
+
+
+class IdStatistics:
+    """
+    The coverage statistics of a single id across the whole image, see `Cryptomatte.statistics`.
+    """
+    pixel_count: int
+    coverage_sum: float
+    min_x: int
+    min_y: int
+    max_x: int
+    max_y: int
+
+
+class MaskGenerator:
+    """
+    Iterator decoding the masks of a cryptomatte in a single pass, yielding (name, mask) tuples one at a time.
+    See `Cryptomatte.iter_masks`.
+    """
+
+    def __iter__(self) -> Iterator[Tuple[str, np.ndarray]]: ...
+    def __next__(self) -> Tuple[str, np.ndarray]: ...
+    def __len__(self) -> int: ...
+
+
 class Cryptomatte:
     """
     A cryptomatte file loaded from disk or memory storing the channels as compressed buffer
@@ -15,7 +48,11 @@ class Cryptomatte:
     def __init__(self, channels: Dict[str, np.ndarray], width: int, height: int, metadata: Metadata) -> None: ...
 
     @staticmethod
-    def load(file: Union[str, Path], load_preview: bool = False) -> List["Cryptomatte"]: ...
+    def load(
+        file: Union[str, Path],
+        load_preview: bool = False,
+        coverage_precision: CoveragePrecision = CoveragePrecision.float32
+    ) -> List["Cryptomatte"]: ...
 
     def width(self) -> int: ...
     def height(self) -> int: ...
@@ -23,16 +60,34 @@ class Cryptomatte:
     def has_preview(self) -> bool: ...
     def preview(self) -> List[np.ndarray]: ...
     def extract_preview_compressed(self) -> Dict[str, ChannelFloat32]: ...
+    def generate_preview(self) -> List[np.ndarray]: ...
+    def ids_at(self, x: int, y: int) -> List[Tuple[int, str, float]]: ...
+    def ids_at(self, points: List[Tuple[int, int]]) -> List[List[Tuple[int, str, float]]]: ...
+    def id_map(self) -> Tuple[np.ndarray, np.ndarray]: ...
+    def statistics(self) -> Dict[int, IdStatistics]: ...
+    def statistics(self, hashes: List[int]) -> Dict[int, IdStatistics]: ...
 
     def mask(self, name: str) -> np.ndarray: ...
     def mask(self, hash: int) -> np.ndarray: ...
 
+    def mask_union(self, names: List[str]) -> np.ndarray: ...
+    def mask_union(self, hashes: List[int]) -> np.ndarray: ...
+
+    def mask_by_name_unmanifested(self, name: str) -> np.ndarray: ...
+
     def mask_compressed(self, name: str) -> ChannelFloat32: ...
     def mask_compressed(self, hash: int) -> ChannelFloat32: ...
 
     def masks(self, names: List[str]) -> Dict[str, np.ndarray]: ...
     def masks(self, hashes: List[int]) -> Dict[str, np.ndarray]: ...
     def masks(self) -> Dict[str, np.ndarray]: ...
+    def masks_matching(self, pattern: str) -> Dict[str, np.ndarray]: ...
+    def iter_masks(
+        self,
+        names_or_hashes: Optional[Union[List[str], List[int]]] = None,
+        max_masks: int = 16
+    ) -> MaskGenerator: ...
+    def ids(self) -> List[int]: ...
 
     def masks_compressed(self, names: List[str]) -> Dict[str, ChannelFloat32]: ...
     def masks_compressed(self, hashes: List[int]) -> Dict[str, ChannelFloat32]: ...
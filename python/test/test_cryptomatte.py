@@ -45,4 +45,46 @@ def test_load_cryptomatte_file():
 
     assert crypto_object.mask("Box001").shape == (180, 320)
     assert crypto_object.mask("Plane001").shape == (180, 320)
-    assert crypto_object.mask("Sphere001").shape == (180, 320)
\ No newline at end of file
+    assert crypto_object.mask("Sphere001").shape == (180, 320)
+
+
+def test_masks_are_not_copied():
+    cmattes = cryptomatte.Cryptomatte.load(os.path.join(_BASE_IMAGE_PATH_ABS, "arnold_one_crypto_sidecar_manif.exr"), False)
+    crypto_object = cmattes[0]
+
+    # The arrays take over the decoded buffers rather than copying them, so they do not own their data but are
+    # kept alive by their base.
+    mask = crypto_object.mask("Box001")
+    assert not mask.flags["OWNDATA"]
+    assert mask.base is not None
+    assert mask.flags["C_CONTIGUOUS"]
+    assert mask.flags["WRITEABLE"]
+
+    for mask in crypto_object.masks().values():
+        assert not mask.flags["OWNDATA"]
+        assert mask.shape == (180, 320)
+
+    del crypto_object, cmattes
+    # The buffer must outlive the cryptomatte it was decoded from.
+    assert mask.sum() >= 0.0
+
+
+def test_iter_masks():
+    cmattes = cryptomatte.Cryptomatte.load(os.path.join(_BASE_IMAGE_PATH_ABS, "arnold_one_crypto_sidecar_manif.exr"), False)
+    crypto_object = cmattes[0]
+    all_masks = crypto_object.masks()
+
+    generator = crypto_object.iter_masks(max_masks=1)
+    assert len(generator) == len(all_masks)
+    for name, mask in generator:
+        assert name in all_masks
+        assert (mask == all_masks[name]).all()
+    assert len(generator) == 0
+
+    names = [name for name, _ in crypto_object.iter_masks(["Sphere001", "Box001"])]
+    assert names == ["Sphere001", "Box001"]
+
+    # The generator keeps the cryptomatte alive.
+    generator = crypto_object.iter_masks()
+    del crypto_object, cmattes
+    assert len(list(generator)) == len(all_masks)
@@ -154,4 +154,28 @@ class TestMetadata(unittest.TestCase):
 ])
 def test_create_manifest_from_malformed_string(bad_json):
     with pytest.raises(RuntimeError):
-        cryptomatte_api.Manifest.from_str(bad_json)
\ No newline at end of file
+        cryptomatte_api.Manifest.from_str(bad_json)
+
+def test_manifest_verify():
+    manif = cryptomatte_api.Manifest.from_json({"bunny": "13851a76", "default": "42c9679f"})
+    assert manif.verify() == []
+    assert cryptomatte_api.hash_name("bunny") == 0x13851a76
+    assert cryptomatte_api.hash_names(["bunny", "default"]) == [0x13851a76, 0x42c9679f]
+
+    manif = cryptomatte_api.Manifest.from_json(create_test_json())
+    assert manif.verify() == list(create_test_json().keys())
+
+
+def test_manifest_pattern_queries():
+    manif = cryptomatte_api.Manifest.from_json({
+        "/crowd/char_01/body": "00000001",
+        "/crowd/char_01/head": "00000002",
+        "/crowd/char_02/body_geo": "00000003",
+        "/set/table": "00000004",
+    })
+    assert manif.hashes_matching("*/char_*/body*") == [1, 3]
+    assert manif.names_matching("/crowd/char_0?/head") == ["/crowd/char_01/head"]
+    assert manif.hashes_with_prefix("/crowd/char_01/") == [1, 2]
+    assert manif.hashes_matching("*/missing") == []
+    assert manif.name(4) == "/set/table"
+    assert manif.name(5) is None
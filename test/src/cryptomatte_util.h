@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <format>
+#include <bit>
+#include <array>
+#include <algorithm>
+
+#include "cryptomatte/cryptomatte.h"
+
+#include <compressed/channel.h>
+#include <compressed/enums.h>
+
+
+namespace test_util
+{
+
+	namespace cryptomatte
+	{
+
+		/// The hashes used by `make_synthetic`, these are all valid (non-NaN, non-denormal) float32 hashes.
+		inline const std::vector<uint32_t> s_synthetic_hashes = {
+			0x6d15e631, 0x4e9e0b32, 0x3ab5de01, 0x5e242a4e, 0x42c9679f
+		};
+
+		/// The names associated with `s_synthetic_hashes` as stored on the manifest.
+		inline const std::vector<std::string> s_synthetic_names = {
+			"box", "plane", "sphere", "torus", "default"
+		};
+
+
+		/// Generate the raw channels of a synthetic cryptomatte with the name 'crypto'.
+		///
+		/// The ids are laid out in 8x8 pixel blocks in a checkerboard-like fashion with the first level always
+		/// holding 75% coverage and the second level holding the neighbouring block id at 25% coverage. Any levels
+		/// past that are left empty (as renderers would usually pad these).
+		///
+		/// \param width The width of the cryptomatte
+		/// \param height The height of the cryptomatte
+		/// \param num_levels The number of rank-coverage pairs to generate, must be a multiple of 2.
+		inline std::unordered_map<std::string, std::vector<float32_t>> make_synthetic_channels(
+			size_t width,
+			size_t height,
+			size_t num_levels
+		)
+		{
+			const std::array<std::string, 4> extensions = { "r", "g", "b", "a" };
+			std::unordered_map<std::string, std::vector<float32_t>> channels;
+			for (size_t level = 0; level < num_levels; ++level)
+			{
+				auto rank_name = std::format("crypto{:02}.{}", level / 2, extensions[(level % 2) * 2]);
+				auto covr_name = std::format("crypto{:02}.{}", level / 2, extensions[(level % 2) * 2 + 1]);
+				auto& rank = channels[rank_name];
+				auto& covr = channels[covr_name];
+				rank.resize(width * height);
+				covr.resize(width * height);
+
+				if (level > 1)
+				{
+					continue;
+				}
+
+				for (size_t y = 0; y < height; ++y)
+				{
+					for (size_t x = 0; x < width; ++x)
+					{
+						size_t block = x / 8 + y / 8 + level;
+						uint32_t hash = s_synthetic_hashes[block % s_synthetic_hashes.size()];
+						rank[y * width + x] = std::bit_cast<float32_t>(hash);
+						covr[y * width + x] = level == 0 ? 0.75f : 0.25f;
+					}
+				}
+			}
+			return channels;
+		}
+
+		/// Compute the mask for the given hash by brute-force from the raw channels as generated by 
+		/// `make_synthetic_channels`, this serves as the reference for the decoding.
+		inline std::vector<float32_t> compute_reference_mask(
+			const std::unordered_map<std::string, std::vector<float32_t>>& channels,
+			uint32_t hash,
+			size_t num_levels
+		)
+		{
+			const std::array<std::string, 4> extensions = { "r", "g", "b", "a" };
+			std::vector<float32_t> out(channels.begin()->second.size());
+			for (size_t level = 0; level < num_levels; ++level)
+			{
+				const auto& rank = channels.at(std::format("crypto{:02}.{}", level / 2, extensions[(level % 2) * 2]));
+				const auto& covr = channels.at(std::format("crypto{:02}.{}", level / 2, extensions[(level % 2) * 2 + 1]));
+				for (size_t i = 0; i < out.size(); ++i)
+				{
+					if (std::bit_cast<uint32_t>(rank[i]) == hash)
+					{
+						out[i] += covr[i];
+					}
+				}
+			}
+			return out;
+		}
+
+		/// Compute the reference masks (see `compute_reference_mask`) of all the `s_synthetic_hashes`, in the
+		/// same order as the hashes.
+		inline std::vector<std::vector<float32_t>> compute_reference_masks(
+			const std::unordered_map<std::string, std::vector<float32_t>>& channels,
+			size_t num_levels
+		)
+		{
+			std::vector<std::vector<float32_t>> out;
+			for (auto hash : s_synthetic_hashes)
+			{
+				out.push_back(compute_reference_mask(channels, hash, num_levels));
+			}
+			return out;
+		}
+
+		/// Generate the metadata for the synthetic cryptomatte generated by `make_synthetic_channels`.
+		inline NAMESPACE_CRYPTOMATTE_API::metadata make_synthetic_metadata()
+		{
+			NAMESPACE_CRYPTOMATTE_API::json_ordered manifest_json;
+			for (size_t i = 0; i < s_synthetic_hashes.size(); ++i)
+			{
+				manifest_json[s_synthetic_names[i]] = std::format("{:08x}", s_synthetic_hashes[i]);
+			}
+
+			return NAMESPACE_CRYPTOMATTE_API::metadata(
+				"crypto",
+				"a1b2c3d",
+				"MurmurHash3_32",
+				"uint32_to_float32",
+				NAMESPACE_CRYPTOMATTE_API::manifest(manifest_json)
+			);
+		}
+
+		/// Generate a synthetic cryptomatte from the given raw channels (see `make_synthetic_channels`), compressing
+		/// the channels with the given `chunk_size`.
+		inline NAMESPACE_CRYPTOMATTE_API::cryptomatte make_synthetic(
+			const std::unordered_map<std::string, std::vector<float32_t>>& raw_channels,
+			size_t width,
+			size_t height,
+			size_t chunk_size = compressed::s_default_chunksize,
+			NAMESPACE_CRYPTOMATTE_API::coverage_precision coverage = NAMESPACE_CRYPTOMATTE_API::coverage_precision::float32
+		)
+		{
+			std::unordered_map<std::string, compressed::channel<float32_t>> channels;
+			for (auto& [name, data] : raw_channels)
+			{
+				channels[name] = compressed::channel<float32_t>(
+					std::span<const float32_t>(data),
+					width,
+					height,
+					compressed::enums::codec::lz4,
+					9,
+					std::min(compressed::s_default_blocksize, chunk_size),
+					chunk_size
+				);
+			}
+			return NAMESPACE_CRYPTOMATTE_API::cryptomatte(std::move(channels), make_synthetic_metadata(), coverage);
+		}
+
+		/// Generate a synthetic cryptomatte (see `make_synthetic_channels`), compressing the channels with the
+		/// given `chunk_size` so we can test the chunked decoding with multiple (and partial) chunks.
+		inline NAMESPACE_CRYPTOMATTE_API::cryptomatte make_synthetic(
+			size_t width,
+			size_t height,
+			size_t num_levels,
+			size_t chunk_size = compressed::s_default_chunksize,
+			NAMESPACE_CRYPTOMATTE_API::coverage_precision coverage = NAMESPACE_CRYPTOMATTE_API::coverage_precision::float32
+		)
+		{
+			return make_synthetic(make_synthetic_channels(width, height, num_levels), width, height, chunk_size, coverage);
+		}
+
+	} // cryptomatte
+
+} // test_util
@@ -0,0 +1,239 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/detail/coverage_channel.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	/// Check that the two masks match within the given absolute tolerance.
+	void check_masks_close(const std::vector<float32_t>& a, const std::vector<float32_t>& b, float32_t tolerance)
+	{
+		REQUIRE(a.size() == b.size());
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (std::abs(a[i] - b[i]) > tolerance)
+			{
+				REQUIRE_MESSAGE(std::abs(a[i] - b[i]) <= tolerance, "Failed vector index: " << i << " " << a[i] << " != " << b[i]);
+			}
+		}
+	}
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::float32_to_float16 exact values")
+{
+	CHECK(detail::float32_to_float16(0.0f) == 0x0000);
+	CHECK(detail::float32_to_float16(-0.0f) == 0x8000);
+	CHECK(detail::float32_to_float16(1.0f) == 0x3c00);
+	CHECK(detail::float32_to_float16(0.5f) == 0x3800);
+	CHECK(detail::float32_to_float16(-2.0f) == 0xc000);
+	CHECK(detail::float32_to_float16(65504.0f) == 0x7bff);
+	CHECK(detail::float32_to_float16(std::numeric_limits<float32_t>::infinity()) == 0x7c00);
+	CHECK(detail::float32_to_float16(1e10f) == 0x7c00);
+	// Smallest half denormal
+	CHECK(detail::float32_to_float16(5.9604645e-08f) == 0x0001);
+
+	CHECK(detail::float16_to_float32(0x0000) == 0.0f);
+	CHECK(detail::float16_to_float32(0x3c00) == 1.0f);
+	CHECK(detail::float16_to_float32(0x3800) == 0.5f);
+	CHECK(detail::float16_to_float32(0xc000) == -2.0f);
+	CHECK(detail::float16_to_float32(0x7bff) == 65504.0f);
+	CHECK(detail::float16_to_float32(0x0001) == 5.9604645e-08f);
+	CHECK(std::isinf(detail::float16_to_float32(0x7c00)));
+	CHECK(std::isnan(detail::float16_to_float32(0x7e00)));
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::float16 roundtrip all bit patterns")
+{
+	// Every non-NaN half must survive a roundtrip through float32 unchanged.
+	for (uint32_t bits = 0; bits <= 0xffff; ++bits)
+	{
+		auto half = static_cast<uint16_t>(bits);
+		float32_t value = detail::float16_to_float32(half);
+		if (std::isnan(value))
+		{
+			continue;
+		}
+		if (detail::float32_to_float16(value) != half)
+		{
+			REQUIRE_MESSAGE(detail::float32_to_float16(value) == half, "Failed half roundtrip: " << bits);
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::float32_to_unorm16 clamps and roundtrips")
+{
+	CHECK(detail::float32_to_unorm16(0.0f) == 0);
+	CHECK(detail::float32_to_unorm16(1.0f) == 65535);
+	CHECK(detail::float32_to_unorm16(-0.5f) == 0);
+	CHECK(detail::float32_to_unorm16(2.0f) == 65535);
+
+	for (float32_t value = 0.0f; value <= 1.0f; value += 0.001f)
+	{
+		auto roundtripped = detail::unorm16_to_float32(detail::float32_to_unorm16(value));
+		CHECK(std::abs(roundtripped - value) <= 0.5f / 65535.0f + 1e-7f);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::coverage_channel reduced precision matches float32")
+{
+	constexpr size_t width = 129;
+	constexpr size_t height = 67;
+	std::vector<float32_t> data(width * height);
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		data[i] = static_cast<float32_t>(i % 1000) / 999.0f;
+	}
+
+	for (auto precision : { coverage_precision::float32, coverage_precision::float16, coverage_precision::unorm16 })
+	{
+		// Use a small chunk size to have a partial chunk at the end.
+		auto channel = compressed::channel<float32_t>(
+			std::span<const float32_t>(data), width, height, compressed::enums::codec::lz4, 9, 1024, 4096
+		);
+		auto num_chunks = channel.num_chunks();
+		auto coverage = detail::coverage_channel(std::move(channel), precision);
+
+		CHECK(coverage.precision() == precision);
+		CHECK(coverage.num_chunks() == num_chunks);
+		CHECK(coverage.width() == width);
+		CHECK(coverage.height() == height);
+
+		float32_t tolerance = precision == coverage_precision::float32 ? 0.0f : 1e-3f;
+		check_masks_close(coverage.get_decompressed(), data, tolerance);
+
+		// Check the chunked access also lines up with the float32 chunk layout
+		std::vector<float32_t> chunk(4096 / sizeof(float32_t));
+		size_t offset = 0;
+		for (size_t chunk_idx = 0; chunk_idx < coverage.num_chunks(); ++chunk_idx)
+		{
+			size_t num_elems = coverage.chunk_elems(chunk_idx);
+			coverage.get_chunk(std::span<float32_t>(chunk.data(), num_elems), chunk_idx);
+			for (size_t i = 0; i < num_elems; ++i)
+			{
+				CHECK(std::abs(chunk[i] - data[offset + i]) <= tolerance);
+			}
+			offset += num_elems;
+		}
+		CHECK(offset == data.size());
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::coverage_channel from raw coverage matches the channel constructor")
+{
+	constexpr size_t width = 129;
+	constexpr size_t height = 67;
+	std::vector<float32_t> data(width * height);
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		data[i] = static_cast<float32_t>(i % 1000) / 999.0f;
+	}
+
+	compression_options compression;
+	compression.block_size = 1024;
+	compression.chunk_size = 4096;
+	for (auto precision : { coverage_precision::float32, coverage_precision::float16, coverage_precision::unorm16 })
+	{
+		auto reference = detail::coverage_channel(
+			compressed::channel<float32_t>(
+				std::span<const float32_t>(data), width, height, compressed::enums::codec::lz4, 9, 1024, 4096
+			),
+			precision
+		);
+		auto coverage = detail::coverage_channel(std::span<const float32_t>(data), width, height, precision, compression);
+
+		CHECK(coverage.precision() == precision);
+		REQUIRE(coverage.num_chunks() == reference.num_chunks());
+		for (size_t chunk_idx = 0; chunk_idx < coverage.num_chunks(); ++chunk_idx)
+		{
+			CHECK(coverage.chunk_elems(chunk_idx) == reference.chunk_elems(chunk_idx));
+		}
+		CHECK(coverage.get_decompressed() == reference.get_decompressed());
+	}
+
+	std::vector<float32_t> too_small(width * height - 1);
+	CHECK_THROWS_AS(
+		detail::coverage_channel(std::span<const float32_t>(too_small), width, height, coverage_precision::float16, compression),
+		std::invalid_argument
+	);
+}
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte reduced coverage precision synthetic masks")
+{
+	auto reference = test_util::cryptomatte::make_synthetic(97, 61, 4, 4096, coverage_precision::float32);
+	auto reference_masks = reference.masks();
+
+	for (auto precision : { coverage_precision::float16, coverage_precision::unorm16 })
+	{
+		auto crypto = test_util::cryptomatte::make_synthetic(97, 61, 4, 4096, precision);
+		CHECK(crypto.num_levels() == 4);
+
+		auto masks = crypto.masks();
+		auto masks_compressed = crypto.masks_compressed();
+		REQUIRE(masks.size() == reference_masks.size());
+		REQUIRE(masks_compressed.size() == reference_masks.size());
+		for (const auto& [name, reference_mask] : reference_masks)
+		{
+			check_masks_close(masks.at(name), reference_mask, 1e-3f);
+			check_masks_close(masks_compressed.at(name).get_decompressed(), reference_mask, 1e-3f);
+			check_masks_close(crypto.mask(name), reference_mask, 1e-3f);
+			check_masks_close(crypto.mask_compressed(name).get_decompressed(), reference_mask, 1e-3f);
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::load reduced coverage precision arnold_one_crypto_sidecar_manif.exr")
+{
+	auto reference = cryptomatte::load("images/arnold_one_crypto_sidecar_manif.exr", false);
+	REQUIRE(reference.size() == 1);
+	auto reference_masks = reference[0].masks();
+
+	for (auto precision : { coverage_precision::float16, coverage_precision::unorm16 })
+	{
+		load_options options;
+		options.coverage = precision;
+		auto cmattes = cryptomatte::load("images/arnold_one_crypto_sidecar_manif.exr", options);
+		REQUIRE(cmattes.size() == 1);
+		CHECK(cmattes[0].num_levels() == reference[0].num_levels());
+
+		auto masks = cmattes[0].masks();
+		REQUIRE(masks.size() == reference_masks.size());
+		for (const auto& [name, reference_mask] : reference_masks)
+		{
+			// Accumulating over 6 levels may add up the quantization error of each level.
+			check_masks_close(masks.at(name), reference_mask, 6e-3f);
+		}
+	}
+}
@@ -2,11 +2,14 @@
 
 #include <vector>
 #include <string>
+#include <filesystem>
 
 #include "util.h"
 #include "oiio_util.h"
+#include "cryptomatte_util.h"
 
 #include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/encoder.h"
 
 using namespace NAMESPACE_CRYPTOMATTE_API;
 
@@ -393,4 +396,245 @@ TEST_CASE("cryptomatte::mask_compressed check vray_single_crypto_in_multilayer.e
         auto& crypto_object = cmattes[0];
         iterate_manif_and_check_mask_compressed(crypto_object, "reference/vray_cpu/cryptomatte");
     }
-}
\ No newline at end of file
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::masks_matching")
+{
+	auto matte = test_util::cryptomatte::make_synthetic(97, 61, 2, 4096);
+
+	auto matching = matte.masks_matching("*e");
+	CHECK(matching == matte.masks(std::vector<std::string>{ "plane", "sphere" }));
+	CHECK(matte.masks_matching("t*").size() == 1);
+	CHECK(matte.masks_matching("*q*").empty());
+
+	auto matching_compressed = matte.masks_compressed_matching("?o*");
+	REQUIRE(matching_compressed.size() == 2);
+	auto reference = matte.masks(std::vector<std::string>{ "box", "torus" });
+	for (const auto& [name, channel] : matching_compressed)
+	{
+		CHECK(channel.get_decompressed() == reference.at(name));
+	}
+
+	metadata no_manifest("crypto", "a1b2c3d", "MurmurHash3_32", "uint32_to_float32");
+	cryptomatte unmanifested(test_util::cryptomatte::make_synthetic_channels(97, 61, 2), 97, 61, no_manifest);
+	CHECK_THROWS_AS(unmanifested.masks_matching("*"), std::invalid_argument);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::mask_union matches the sum of the masks")
+{
+	// Encode an image with many ids so we go through both the small and the large membership test.
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	std::vector<uint32_t> all_ids;
+	for (uint32_t i = 0; i < 48; ++i)
+	{
+		all_ids.push_back(0x3f000000u + i * 0x00010001u);
+	}
+	std::vector<sample> samples;
+	std::vector<size_t> offsets = { 0 };
+	for (size_t y = 0; y < height; ++y)
+	{
+		for (size_t x = 0; x < width; ++x)
+		{
+			for (size_t i = 0; i < (x + y) % 4; ++i)
+			{
+				samples.push_back({ all_ids[(x / 5 + y / 7 + i * 13) % all_ids.size()], 0.25f + 0.1f * static_cast<float32_t>(i) });
+			}
+			offsets.push_back(samples.size());
+		}
+	}
+	encode_options options;
+	options.num_levels = 3;
+	auto matte = encode(samples, offsets, width, height, options);
+
+	for (size_t num_ids : { 1, 3, 16, 30 })
+	{
+		std::vector<uint32_t> ids(all_ids.begin(), all_ids.begin() + num_ids);
+		// Duplicates and ids not in the image must not contribute.
+		ids.push_back(ids.front());
+		ids.push_back(0x12345678u);
+
+		std::vector<float32_t> expected(width * height);
+		for (const auto& [_, mask] : matte.masks(std::vector<uint32_t>(all_ids.begin(), all_ids.begin() + num_ids)))
+		{
+			for (size_t i = 0; i < mask.size(); ++i)
+			{
+				expected[i] += mask[i];
+			}
+		}
+
+		auto union_mask = matte.mask_union(ids);
+		auto union_compressed = matte.mask_union_compressed(ids).get_decompressed();
+		REQUIRE(union_mask.size() == expected.size());
+		REQUIRE(union_compressed.size() == expected.size());
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			if (union_mask[i] != doctest::Approx(expected[i]) || union_compressed[i] != doctest::Approx(expected[i]))
+			{
+				CHECK(union_mask[i] == doctest::Approx(expected[i]));
+				CHECK(union_compressed[i] == doctest::Approx(expected[i]));
+				break;
+			}
+		}
+	}
+
+	CHECK(matte.mask_union(std::vector<uint32_t>{}) == std::vector<float32_t>(width * height, 0.0f));
+	CHECK_THROWS_AS(matte.mask_union(std::vector<std::string>{ "box" }), std::invalid_argument);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::mask_union by name")
+{
+	auto matte = test_util::cryptomatte::make_synthetic(97, 61, 2, 4096);
+	auto masks = matte.masks(std::vector<std::string>{ "box", "sphere" });
+	auto union_mask = matte.mask_union(std::vector<std::string>{ "box", "sphere" });
+	REQUIRE(union_mask.size() == masks.at("box").size());
+	for (size_t i = 0; i < union_mask.size(); ++i)
+	{
+		CHECK(union_mask[i] == doctest::Approx(masks.at("box")[i] + masks.at("sphere")[i]));
+	}
+	CHECK_THROWS_AS(matte.mask_union(std::vector<std::string>{ "missing" }), std::invalid_argument);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte span constructor matches the vector constructor")
+{
+	constexpr size_t width = 97;
+	constexpr size_t height = 61;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+	// Include the legacy preview channels to also cover their (parallel) compression.
+	for (const auto& name : { "crypto.r", "crypto.g", "crypto.b" })
+	{
+		raw_channels[name] = std::vector<float32_t>(width * height, 0.5f);
+	}
+	const auto meta = test_util::cryptomatte::make_synthetic_metadata();
+
+	std::unordered_map<std::string, std::span<const float32_t>> spans;
+	for (const auto& [name, channel] : raw_channels)
+	{
+		spans[name] = std::span<const float32_t>(channel);
+	}
+	auto from_spans = cryptomatte(spans, width, height, meta);
+	auto from_vectors = cryptomatte(raw_channels, width, height, meta);
+
+	CHECK(from_spans.num_levels() == from_vectors.num_levels());
+	CHECK(from_spans.has_preview());
+	CHECK(from_spans.preview() == from_vectors.preview());
+	CHECK(from_spans.masks() == from_vectors.masks());
+
+	SUBCASE("mismatched channel sizes")
+	{
+		auto invalid = spans;
+		invalid.at("crypto00.r") = invalid.at("crypto00.r").subspan(1);
+		CHECK_THROWS_AS(cryptomatte(invalid, width, height, meta), std::invalid_argument);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte constructor compression options")
+{
+	constexpr size_t width = 97;
+	constexpr size_t height = 61;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+	const auto meta = test_util::cryptomatte::make_synthetic_metadata();
+	auto reference = cryptomatte(raw_channels, width, height, meta);
+
+	compression_options compression;
+	compression.compression_level = 1;
+	compression.block_size = 1024;
+	compression.chunk_size = 4096;
+	auto matte = cryptomatte(raw_channels, width, height, meta, coverage_precision::float32, nullptr, compression);
+
+	// The masks are compressed with the same settings as the channels.
+	auto mask = matte.mask_compressed(test_util::cryptomatte::s_synthetic_hashes[0]);
+	CHECK(mask.chunk_size() == compression.chunk_size);
+	CHECK(mask.num_chunks() > 1);
+	CHECK(matte.masks() == reference.masks());
+
+	SUBCASE("invalid options")
+	{
+		compression_options invalid_chunk;
+		invalid_chunk.chunk_size = 4095;
+		CHECK_THROWS_AS(
+			cryptomatte(raw_channels, width, height, meta, coverage_precision::float32, nullptr, invalid_chunk),
+			std::invalid_argument
+		);
+
+		compression_options invalid_block;
+		invalid_block.chunk_size = 4096;
+		invalid_block.block_size = 8192;
+		CHECK_THROWS_AS(
+			cryptomatte(raw_channels, width, height, meta, coverage_precision::float32, nullptr, invalid_block),
+			std::invalid_argument
+		);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte without levels")
+{
+	// Everything derived from the levels is empty, or refuses to be written.
+	auto check_empty = [](const cryptomatte& matte)
+		{
+			CHECK(matte.num_levels() == 0);
+			CHECK(matte.preview().empty());
+			CHECK(matte.generate_preview().empty());
+			CHECK(matte.generate_preview_compressed().empty());
+			CHECK(matte.ids().empty());
+			CHECK(matte.statistics().empty());
+			CHECK(matte.statistics({ 0x3ab5de01 }).empty());
+			auto map = matte.id_map();
+			CHECK(map.ids.empty());
+			CHECK(map.coverage.empty());
+			auto map_compressed = matte.id_map_compressed();
+			CHECK(map_compressed.ids.get_decompressed().empty());
+			CHECK_THROWS_AS(matte.ids_at(0, 0), std::out_of_range);
+			CHECK(matte.ids_at(std::span<const std::pair<size_t, size_t>>{}).empty());
+			CHECK(matte.mask(0x3ab5de01).empty());
+			CHECK(matte.mask_compressed(0x3ab5de01).get_decompressed().empty());
+			CHECK(matte.masks().empty());
+			CHECK(matte.masks(std::vector<uint32_t>{ 0x3ab5de01 }).empty());
+			CHECK(matte.masks_compressed().empty());
+			CHECK(matte.masks_compressed(std::vector<uint32_t>{ 0x3ab5de01 }).empty());
+			CHECK(matte.mask_union(std::vector<uint32_t>{ 0x3ab5de01 }).empty());
+			CHECK(matte.mask_union_compressed(std::vector<uint32_t>{ 0x3ab5de01 }).get_decompressed().empty());
+			CHECK_THROWS_AS(matte.write("unused.exr"), std::invalid_argument);
+			CHECK(!std::filesystem::exists("unused.exr"));
+		};
+
+	SUBCASE("Default constructed")
+	{
+		cryptomatte matte;
+		CHECK_FALSE(matte.has_preview());
+		check_empty(matte);
+	}
+
+	SUBCASE("Moved from")
+	{
+		auto matte = test_util::cryptomatte::make_synthetic(97, 61, 2, 1024);
+		cryptomatte moved = std::move(matte);
+		check_empty(matte);
+
+		// The moved-to cryptomatte must still be able to decode its channels.
+		CHECK(moved.num_levels() == 2);
+		CHECK(moved.masks().size() == test_util::cryptomatte::s_synthetic_hashes.size());
+
+		matte = std::move(moved);
+		CHECK(moved.preview().empty());
+		CHECK(matte.masks().size() == test_util::cryptomatte::s_synthetic_hashes.size());
+	}
+}
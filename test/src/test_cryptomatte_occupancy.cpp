@@ -0,0 +1,129 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <bit>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/detail/rank_occupancy.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	/// Generate a synthetic cryptomatte with 6 levels where only the first two are populated and the upper half
+	/// of the image is empty. With a chunk size of 4096 bytes this leaves a number of entirely empty chunks on the
+	/// populated levels too.
+	std::unordered_map<std::string, std::vector<float32_t>> make_sparse_channels(size_t width, size_t height)
+	{
+		auto channels = test_util::cryptomatte::make_synthetic_channels(width, height, 6);
+		for (auto& [name, data] : channels)
+		{
+			std::fill(data.begin(), data.begin() + width * (height / 2), 0.0f);
+		}
+		return channels;
+	}
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::compute_rank_occupancy")
+{
+	constexpr size_t width = 64;
+	constexpr size_t height = 64;
+	std::vector<float32_t> rank(width * height, 0.0f);
+	// Chunks are 256 elements (1024 bytes) so this only populates the 3rd chunk, -0.0f counts as empty.
+	rank[600] = std::bit_cast<float32_t>(uint32_t{ 0x3ab5de01 });
+	rank[1000] = -0.0f;
+
+	auto channel = compressed::channel<float32_t>(
+		std::span<const float32_t>(rank), width, height, compressed::enums::codec::lz4, 9, 1024, 1024
+	);
+	REQUIRE(channel.num_chunks() == 16);
+
+	for (const auto& occupancy : { detail::compute_rank_occupancy(channel), detail::compute_rank_occupancy(rank, channel) })
+	{
+		CHECK(occupancy.occupied);
+		REQUIRE(occupancy.chunks.size() == 16);
+		for (size_t chunk_idx = 0; chunk_idx < 16; ++chunk_idx)
+		{
+			CHECK(occupancy.chunk_occupied(chunk_idx) == (chunk_idx == 2));
+		}
+	}
+
+	std::vector<float32_t> empty(width * height, 0.0f);
+	auto empty_channel = compressed::channel<float32_t>(
+		std::span<const float32_t>(empty), width, height, compressed::enums::codec::lz4, 9, 1024, 1024
+	);
+	CHECK_FALSE(detail::compute_rank_occupancy(empty_channel).occupied);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte sparse levels and chunks decode correctly")
+{
+	constexpr size_t width = 97;
+	constexpr size_t height = 61;
+	auto raw_channels = make_sparse_channels(width, height);
+
+	// Construct from both the compressed and the uncompressed channels as they compute the occupancy separately.
+	std::vector<cryptomatte> mattes;
+	mattes.push_back(test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096));
+	mattes.push_back(cryptomatte(raw_channels, width, height, test_util::cryptomatte::make_synthetic_metadata()));
+
+	for (const auto& matte : mattes)
+	{
+		CHECK(matte.num_levels() == 6);
+
+		auto masks = matte.masks();
+		auto masks_compressed = matte.masks_compressed();
+		auto masks_by_name = matte.masks(test_util::cryptomatte::s_synthetic_names);
+		auto masks_compressed_by_name = matte.masks_compressed(test_util::cryptomatte::s_synthetic_names);
+		REQUIRE(masks.size() == test_util::cryptomatte::s_synthetic_names.size());
+		REQUIRE(masks_compressed.size() == test_util::cryptomatte::s_synthetic_names.size());
+
+		for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_names.size(); ++i)
+		{
+			const auto& name = test_util::cryptomatte::s_synthetic_names[i];
+			auto hash = test_util::cryptomatte::s_synthetic_hashes[i];
+			auto reference = test_util::cryptomatte::compute_reference_mask(raw_channels, hash, 6);
+
+			CHECK(matte.mask(hash) == reference);
+			CHECK(matte.mask_compressed(hash).get_decompressed() == reference);
+			CHECK(masks.at(name) == reference);
+			CHECK(masks_compressed.at(name).get_decompressed() == reference);
+			CHECK(masks_by_name.at(name) == reference);
+			CHECK(masks_compressed_by_name.at(name).get_decompressed() == reference);
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte empty first level does not skip later levels")
+{
+	constexpr size_t width = 64;
+	constexpr size_t height = 64;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+	// Clear the first level entirely, the remaining ids in the second level must still be decoded.
+	std::fill(raw_channels.at("crypto00.r").begin(), raw_channels.at("crypto00.r").end(), 0.0f);
+	std::fill(raw_channels.at("crypto00.g").begin(), raw_channels.at("crypto00.g").end(), 0.0f);
+
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+	auto masks = matte.masks();
+	for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_names.size(); ++i)
+	{
+		auto hash = test_util::cryptomatte::s_synthetic_hashes[i];
+		auto reference = test_util::cryptomatte::compute_reference_mask(raw_channels, hash, 4);
+		CHECK(masks.at(test_util::cryptomatte::s_synthetic_names[i]) == reference);
+	}
+}
@@ -0,0 +1,183 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <numeric>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/detail/bounded_queue.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::bounded_queue")
+{
+	detail::bounded_queue<size_t> queue(2);
+
+	// A slow consumer must still receive all the elements in order, with the producer blocking on the full queue.
+	std::vector<size_t> received;
+	std::thread consumer([&]()
+		{
+			while (auto value = queue.pop())
+			{
+				received.push_back(*value);
+			}
+		});
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		CHECK(queue.push(i));
+	}
+	queue.close();
+	consumer.join();
+
+	std::vector<size_t> expected(1000);
+	std::iota(expected.begin(), expected.end(), size_t{ 0 });
+	CHECK(received == expected);
+
+	// Pushing to a closed queue fails, popping from a closed and empty queue returns immediately.
+	CHECK_FALSE(queue.push(5));
+	CHECK_FALSE(queue.pop().has_value());
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte pipelined decoding matches the reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 6);
+	// Clear part of the image so some chunks don't hold any ids at all.
+	for (auto& [name, data] : raw_channels)
+	{
+		std::fill(data.begin(), data.begin() + width * (height / 3), 0.0f);
+	}
+
+	for (size_t chunk_size : { size_t{ 1024 }, size_t{ 4096 }, size_t{ 65536 } })
+	{
+		auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, chunk_size);
+		CHECK(matte.decode_strategy() == decode_strategy::channel_parallel);
+		matte.set_decode_strategy(decode_strategy::pipelined);
+		CHECK(matte.decode_strategy() == decode_strategy::pipelined);
+
+		auto masks = matte.masks();
+		auto masks_compressed = matte.masks_compressed();
+		auto masks_by_hash = matte.masks(test_util::cryptomatte::s_synthetic_hashes);
+		auto masks_compressed_by_hash = matte.masks_compressed(test_util::cryptomatte::s_synthetic_hashes);
+		REQUIRE(masks.size() == test_util::cryptomatte::s_synthetic_names.size());
+		REQUIRE(masks_compressed.size() == test_util::cryptomatte::s_synthetic_names.size());
+
+		for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_names.size(); ++i)
+		{
+			const auto& name = test_util::cryptomatte::s_synthetic_names[i];
+			auto hash = test_util::cryptomatte::s_synthetic_hashes[i];
+			auto reference = test_util::cryptomatte::compute_reference_mask(raw_channels, hash, 6);
+
+			CHECK(matte.mask(hash) == reference);
+			CHECK(matte.mask_compressed(hash).get_decompressed() == reference);
+			CHECK(masks.at(name) == reference);
+			CHECK(masks_compressed.at(name).get_decompressed() == reference);
+			CHECK(masks_by_hash.at(name) == reference);
+			CHECK(masks_compressed_by_hash.at(name).get_decompressed() == reference);
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte pipelined decoding of an empty cryptomatte")
+{
+	constexpr size_t width = 64;
+	constexpr size_t height = 64;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 2);
+	for (auto& [name, data] : raw_channels)
+	{
+		std::fill(data.begin(), data.end(), 0.0f);
+	}
+
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+	matte.set_decode_strategy(decode_strategy::pipelined);
+	CHECK(matte.masks().empty());
+	CHECK(matte.masks_compressed().empty());
+	CHECK(matte.mask(test_util::cryptomatte::s_synthetic_hashes[0]) == std::vector<float32_t>(width * height, 0.0f));
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte decoding within a memory budget matches the reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 6);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+	CHECK(matte.decode_memory_budget() == size_t{ 1 } << 30);
+
+	// A budget of zero only ever lets a single chunk in flight, the budget of two chunk masks lets in a couple.
+	for (size_t budget : { size_t{ 0 }, size_t{ 8192 } })
+	{
+		matte.set_decode_memory_budget(budget);
+		CHECK(matte.decode_memory_budget() == budget);
+
+		auto masks = matte.masks();
+		auto masks_compressed = matte.masks_compressed();
+		REQUIRE(masks.size() == test_util::cryptomatte::s_synthetic_names.size());
+		for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_names.size(); ++i)
+		{
+			const auto& name = test_util::cryptomatte::s_synthetic_names[i];
+			auto reference = test_util::cryptomatte::compute_reference_mask(raw_channels, test_util::cryptomatte::s_synthetic_hashes[i], 6);
+			CHECK(masks.at(name) == reference);
+			CHECK(masks_compressed.at(name).get_decompressed() == reference);
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte concurrent decoding of the same instance")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto matte = test_util::cryptomatte::make_synthetic(width, height, 4, 4096);
+
+	for (auto strategy : { decode_strategy::channel_parallel, decode_strategy::pipelined })
+	{
+		matte.set_decode_strategy(strategy);
+		auto reference_masks = matte.masks();
+		auto reference_preview = matte.generate_preview();
+
+		// Several decode calls running at the same time (as they would from python with the GIL released) must 
+		// neither race on the channels nor affect each other's results.
+		constexpr size_t num_threads = 4;
+		std::vector<std::unordered_map<std::string, std::vector<float32_t>>> masks(num_threads);
+		std::vector<std::vector<std::vector<float32_t>>> previews(num_threads);
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < num_threads; ++i)
+		{
+			threads.emplace_back([&, i]()
+				{
+					masks[i] = matte.masks();
+					previews[i] = matte.generate_preview();
+					matte.ids_at(i, i);
+				});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (size_t i = 0; i < num_threads; ++i)
+		{
+			CHECK(masks[i] == reference_masks);
+			CHECK(previews[i] == reference_preview);
+		}
+	}
+}
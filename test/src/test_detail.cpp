@@ -2,10 +2,23 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
 
 #include "util.h"
 
 #include "cryptomatte/detail/detail.h"
+#include "cryptomatte/detail/flat_id_set.h"
+#include "cryptomatte/detail/decoding_impl.h"
+#include "cryptomatte/detail/chunk_accumulator.h"
+#include "cryptomatte/detail/id_membership.h"
+#include "cryptomatte/detail/chunk_cache.h"
+#include "cryptomatte/detail/scoped_timer.h"
 
 using namespace NAMESPACE_CRYPTOMATTE_API;
 
@@ -56,4 +69,490 @@ TEST_CASE("detail::hex_str_to_uint32_t: Invalid characters in hex string")
 TEST_CASE("detail::hex_str_to_uint32_t: Max boundary value")
 {
 	CHECK(detail::hex_str_to_uint32_t("ffffffff") == std::numeric_limits<uint32_t>::max());
-}
\ No newline at end of file
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::murmurhash3_32: Known values")
+{
+	CHECK(detail::murmurhash3_32("") == 0u);
+	CHECK(detail::murmurhash3_32("", 1) == 0x514e28b7u);
+	CHECK(detail::murmurhash3_32("hello") == 0x248bfa47u);
+	// Exercises all of the tail lengths.
+	CHECK(detail::murmurhash3_32("The quick brown fox jumps over the lazy dog") == 0x2e4ff723u);
+	CHECK(detail::murmurhash3_32("a") == 0x3c2569b2u);
+	CHECK(detail::murmurhash3_32("ab") == 0x9bbfd75fu);
+	CHECK(detail::murmurhash3_32("abc") == 0xb3dd93fau);
+	CHECK(detail::murmurhash3_32("abcd") == 0x43ed676au);
+	// The example from the cryptomatte specification.
+	CHECK(detail::murmurhash3_32("bunny") == 0x13851a76u);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::murmurhash3_32: Batched matches scalar")
+{
+	// Mixed lengths covering all tails, names shorter than a block and a partially filled last batch.
+	std::vector<std::string> names;
+	for (size_t i = 0; i < 43; ++i)
+	{
+		names.push_back(std::string("The quick brown fox jumps over the lazy dog").substr(0, (i * 7) % 44));
+	}
+	std::vector<std::string_view> views(names.begin(), names.end());
+
+	for (uint32_t seed : { 0u, 0x9747b28cu })
+	{
+		std::vector<uint32_t> batched(views.size());
+		detail::murmurhash3_32(views, batched, seed);
+		for (size_t i = 0; i < views.size(); ++i)
+		{
+			CHECK(batched[i] == detail::murmurhash3_32(views[i], seed));
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::to_float32_hash")
+{
+	// Normal floats are left untouched.
+	CHECK(detail::to_float32_hash(0x13851a76u) == 0x13851a76u);
+	CHECK(detail::to_float32_hash(0xc2c9679fu) == 0xc2c9679fu);
+	// Zero exponents (zero/denormals) and all-ones exponents (inf/NaN) get their lowest exponent bit flipped.
+	CHECK(detail::to_float32_hash(0x00000000u) == 0x00800000u);
+	CHECK(detail::to_float32_hash(0x80123456u) == 0x80923456u);
+	CHECK(detail::to_float32_hash(0x7f800000u) == 0x7f000000u);
+	CHECK(detail::to_float32_hash(0xffc00001u) == 0xff400001u);
+	for (uint32_t hash : { 0x00000001u, 0x7f800001u, 0xff800000u, 0x807fffffu })
+	{
+		float32_t value = std::bit_cast<float32_t>(detail::to_float32_hash(hash));
+		CHECK(std::isnormal(value));
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::flat_id_set: Insert and contains")
+{
+	detail::flat_id_set ids(4);
+	CHECK(ids.empty());
+
+	CHECK(ids.insert(uint32_t{ 0xDEADBEEF }));
+	CHECK_FALSE(ids.insert(uint32_t{ 0xDEADBEEF }));
+	CHECK(ids.contains(uint32_t{ 0xDEADBEEF }));
+	CHECK(ids.contains(std::bit_cast<float32_t>(uint32_t{ 0xDEADBEEF })));
+	CHECK_FALSE(ids.contains(uint32_t{ 0xDEADBEEE }));
+
+	// Empty pixels are never inserted
+	CHECK_FALSE(ids.insert(0.0f));
+	CHECK_FALSE(ids.insert(-0.0f));
+	CHECK_FALSE(ids.contains(0.0f));
+	CHECK(ids.size() == 1);
+
+	// Force a couple of rehashes
+	for (uint32_t i = 1; i <= 1000; ++i)
+	{
+		ids.insert(i * 0x01000193u);
+	}
+	CHECK(ids.size() == 1001);
+	for (uint32_t i = 1; i <= 1000; ++i)
+	{
+		CHECK(ids.contains(i * 0x01000193u));
+	}
+	CHECK(ids.contains(uint32_t{ 0xDEADBEEF }));
+
+	ids.clear();
+	CHECK(ids.empty());
+	CHECK_FALSE(ids.contains(uint32_t{ 0xDEADBEEF }));
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::flat_id_map: Insert and find")
+{
+	detail::flat_id_map<uint32_t> slots(4);
+	CHECK(slots.empty());
+	CHECK(slots.find(uint32_t{ 0xDEADBEEF }) == nullptr);
+
+	auto [value, inserted] = slots.try_emplace(uint32_t{ 0xDEADBEEF }, 7);
+	CHECK(inserted);
+	CHECK(*value == 7);
+	auto [existing, inserted_again] = slots.try_emplace(uint32_t{ 0xDEADBEEF }, 9);
+	CHECK_FALSE(inserted_again);
+	CHECK(*existing == 7);
+
+	// Empty pixels are never found
+	CHECK(slots.find(0u) == nullptr);
+	CHECK(slots.find(0x80000000u) == nullptr);
+
+	// Force a couple of rehashes, the values have to move along with their ids.
+	for (uint32_t i = 1; i <= 1000; ++i)
+	{
+		slots.try_emplace(i * 0x01000193u, i);
+	}
+	CHECK(slots.size() == 1001);
+	for (uint32_t i = 1; i <= 1000; ++i)
+	{
+		const uint32_t* found = slots.find(i * 0x01000193u);
+		REQUIRE(found != nullptr);
+		CHECK(*found == i);
+	}
+	CHECK(*slots.find(uint32_t{ 0xDEADBEEF }) == 7);
+
+	slots.clear();
+	CHECK(slots.empty());
+	CHECK(slots.find(uint32_t{ 0xDEADBEEF }) == nullptr);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::accumulate_ids_in_range: Matches reference")
+{
+	// Generate a rank chunk with runs of ids, empty pixels and a large number of distinct ids.
+	std::vector<float32_t> rank_chunk;
+	uint32_t state = 0x12345678;
+	std::vector<uint32_t> expected;
+	for (size_t run = 0; run < 20000; ++run)
+	{
+		// xorshift32 as a cheap, deterministic pseudo-random generator
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		uint32_t id = (run % 7 == 0) ? 0 : state % 3000 + 1;
+		size_t run_length = state % 13 + 1;
+		rank_chunk.insert(rank_chunk.end(), run_length, std::bit_cast<float32_t>(id));
+		if (id != 0)
+		{
+			expected.push_back(id);
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+	expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+	detail::flat_id_set id_set;
+	detail::accumulate_ids_in_range(std::span<const float32_t>(rank_chunk), id_set);
+	std::vector<float32_t> ids;
+	id_set.append_to(ids);
+
+	std::vector<uint32_t> ids_as_uint;
+	for (auto id : ids)
+	{
+		ids_as_uint.push_back(std::bit_cast<uint32_t>(id));
+	}
+	std::sort(ids_as_uint.begin(), ids_as_uint.end());
+	CHECK(ids_as_uint == expected);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::accumulate_ids_in_range: Only considers the passed range")
+{
+	std::vector<float32_t> rank_chunk(100, 0.0f);
+	rank_chunk[10] = std::bit_cast<float32_t>(uint32_t{ 0x3ab5de01 });
+	// Simulates stale data at the end of a reused chunk buffer.
+	rank_chunk[90] = std::bit_cast<float32_t>(uint32_t{ 0x6d15e631 });
+
+	detail::flat_id_set ids;
+	detail::accumulate_ids_in_range(std::span<const float32_t>(rank_chunk.data(), 50), ids);
+	REQUIRE(ids.size() == 1);
+	CHECK(ids.contains(uint32_t{ 0x3ab5de01 }));
+
+	detail::flat_id_set empty_ids;
+	detail::accumulate_ids_in_range(std::span<const float32_t>(rank_chunk.data(), 10), empty_ids);
+	CHECK(empty_ids.empty());
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::chunk_accumulator: Accumulates across levels and chunks")
+{
+	const float32_t id_a = std::bit_cast<float32_t>(uint32_t{ 0x3ab5de01 });
+	const float32_t id_b = std::bit_cast<float32_t>(uint32_t{ 0x6d15e631 });
+	const float32_t id_c = std::bit_cast<float32_t>(uint32_t{ 0x1f2e3d4c });
+
+	detail::chunk_accumulator accumulator;
+
+	auto add_level = [&](std::vector<float32_t> rank, std::vector<float32_t> coverage, const detail::flat_id_set* requested)
+		{
+			if (!accumulator.register_ids(rank, requested))
+			{
+				return false;
+			}
+			accumulator.accumulate(rank, coverage);
+			return true;
+		};
+
+	// First chunk, two levels
+	accumulator.reset(4);
+	REQUIRE(add_level({ id_a, id_a, id_b, 0.0f }, { 0.5f, 1.0f, 0.25f, 1.0f }, nullptr));
+	REQUIRE(add_level({ id_b, id_c, id_a, -0.0f }, { 0.5f, 0.5f, 0.75f, 1.0f }, nullptr));
+
+	REQUIRE(accumulator.ids().size() == 3);
+	CHECK(std::bit_cast<uint32_t>(accumulator.ids()[0]) == std::bit_cast<uint32_t>(id_a));
+	CHECK(std::bit_cast<uint32_t>(accumulator.ids()[1]) == std::bit_cast<uint32_t>(id_b));
+	CHECK(std::bit_cast<uint32_t>(accumulator.ids()[2]) == std::bit_cast<uint32_t>(id_c));
+	CHECK(std::ranges::equal(accumulator.mask(0), std::vector<float32_t>{ 0.5f, 1.0f, 0.75f, 0.0f }));
+	CHECK(std::ranges::equal(accumulator.mask(1), std::vector<float32_t>{ 0.5f, 0.0f, 0.25f, 0.0f }));
+	CHECK(std::ranges::equal(accumulator.mask(2), std::vector<float32_t>{ 0.0f, 0.5f, 0.0f, 0.0f }));
+
+	// Second (smaller) chunk only requesting id_c, the masks of the previous chunk must not leak into this one.
+	detail::flat_id_set requested;
+	requested.insert(std::bit_cast<uint32_t>(id_c));
+	accumulator.reset(3);
+	CHECK_FALSE(add_level({ id_a, id_b, id_a }, { 1.0f, 1.0f, 1.0f }, &requested));
+	REQUIRE(add_level({ id_c, id_b, id_c }, { 0.25f, 1.0f, 0.5f }, &requested));
+
+	REQUIRE(accumulator.ids().size() == 1);
+	CHECK(accumulator.chunk_num_elems() == 3);
+	CHECK(std::ranges::equal(accumulator.mask(0), std::vector<float32_t>{ 0.25f, 0.0f, 0.5f }));
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::id_membership: Small and large sets match")
+{
+	std::vector<float32_t> rank_chunk;
+	for (uint32_t i = 0; i < 1000; ++i)
+	{
+		// Runs of ids with some empty pixels in between
+		uint32_t id = (i % 9 == 0) ? 0 : (i / 3) % 40 + 1;
+		rank_chunk.push_back(std::bit_cast<float32_t>(id));
+	}
+	rank_chunk.push_back(-0.0f);
+
+	for (size_t num_ids : { 1, 5, 16, 17, 30 })
+	{
+		// Every other id, with a duplicate and an empty id which must both be ignored.
+		std::vector<uint32_t> ids = { 0 };
+		for (uint32_t i = 0; i < num_ids; ++i)
+		{
+			ids.push_back(i * 2 + 1);
+		}
+		ids.push_back(1);
+		detail::id_membership membership(ids);
+		CHECK(membership.size() == num_ids);
+
+		std::vector<float32_t> weights(rank_chunk.size(), -1.0f);
+		CHECK(membership.match(rank_chunk, weights));
+		for (size_t i = 0; i < rank_chunk.size(); ++i)
+		{
+			uint32_t id = std::bit_cast<uint32_t>(rank_chunk[i]);
+			bool expected = id != 0 && id != 0x80000000u && id % 2 == 1 && id < num_ids * 2;
+			CHECK(weights[i] == (expected ? 1.0f : 0.0f));
+		}
+	}
+
+	detail::id_membership missing(std::vector<uint32_t>{ 12345 });
+	std::vector<float32_t> weights(rank_chunk.size());
+	CHECK_FALSE(missing.match(rank_chunk, weights));
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::chunk_cache")
+{
+	// Loads a chunk holding its own index as single rank value, counting the number of loads.
+	auto make_loader = [](size_t& num_loads) -> detail::chunk_cache::load_fn
+		{
+			return [&num_loads](size_t chunk_idx)
+				{
+					++num_loads;
+					detail::decoded_chunk chunk;
+					chunk.rank.resize(1);
+					chunk.rank[0].resize(1);
+					chunk.rank[0][0] = static_cast<float32_t>(chunk_idx);
+					return chunk;
+				};
+		};
+
+	SUBCASE("Evicts the least recently used chunk")
+	{
+		size_t num_loads = 0;
+		auto load = make_loader(num_loads);
+		detail::chunk_cache cache(2);
+		CHECK(cache.get(0, load)->rank[0][0] == 0.0f);
+		CHECK(cache.get(1, load)->rank[0][0] == 1.0f);
+		CHECK(cache.get(0, load)->rank[0][0] == 0.0f);
+		CHECK(num_loads == 2);
+
+		// Chunk 1 is now the least recently used and gets evicted.
+		CHECK(cache.get(2, load)->rank[0][0] == 2.0f);
+		CHECK(cache.size() == 2);
+		CHECK(num_loads == 3);
+		cache.get(0, load);
+		CHECK(num_loads == 3);
+		cache.get(1, load);
+		CHECK(num_loads == 4);
+	}
+
+	SUBCASE("Evicted chunks remain valid")
+	{
+		size_t num_loads = 0;
+		auto load = make_loader(num_loads);
+		detail::chunk_cache cache(1);
+		auto chunk = cache.get(5, load);
+		cache.get(6, load);
+		CHECK(chunk->rank[0][0] == 5.0f);
+		cache.clear();
+		CHECK(cache.size() == 0);
+		CHECK(chunk->rank[0][0] == 5.0f);
+	}
+
+	SUBCASE("Zero capacity disables caching")
+	{
+		size_t num_loads = 0;
+		auto load = make_loader(num_loads);
+		detail::chunk_cache cache(3);
+		cache.get(0, load);
+		cache.get(1, load);
+		cache.set_capacity(0);
+		CHECK(cache.size() == 0);
+		cache.get(0, load);
+		cache.get(0, load);
+		CHECK(num_loads == 4);
+		CHECK(cache.capacity() == 0);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::Instrumentor: per-thread recording")
+{
+	std::filesystem::path file = "test_data/profile.json";
+	std::filesystem::create_directories(file.parent_path());
+	auto read_file = [&]()
+		{
+			std::ifstream stream(file);
+			std::stringstream buffer;
+			buffer << stream.rdbuf();
+			return buffer.str();
+		};
+	auto count = [](const std::string& str, const std::string& sub)
+		{
+			size_t num = 0;
+			for (auto pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1))
+			{
+				++num;
+			}
+			return num;
+		};
+	auto& instrumentor = detail::Instrumentor::Get();
+
+	SUBCASE("Profiles of all threads are written at the end of the session")
+	{
+		instrumentor.BeginSession("test \"session\"", file.string());
+		CHECK(instrumentor.IsActive());
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < 4; ++i)
+		{
+			threads.emplace_back([]()
+				{
+					for (size_t j = 0; j < 10; ++j)
+					{
+						detail::InstrumentationTimer timer("scope");
+					}
+				});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		instrumentor.EndSession();
+		CHECK(!instrumentor.IsActive());
+
+		const auto json = read_file();
+		CHECK(json.starts_with("{\"traceEvents\":["));
+		CHECK(count(json, "\"name\":\"scope\"") == 40);
+		CHECK(count(json, "\"thread_name\"") == 4);
+		CHECK(json.find("test \\\"session\\\"") != std::string::npos);
+		CHECK(json.find("\"dropped_events\":0") != std::string::npos);
+	}
+
+	SUBCASE("Full buffers drop the oldest profiles")
+	{
+		instrumentor.SetBufferCapacity(8);
+		instrumentor.BeginSession("test", file.string());
+		for (size_t i = 0; i < 20; ++i)
+		{
+			detail::InstrumentationTimer timer("scope");
+		}
+		instrumentor.EndSession();
+		instrumentor.SetBufferCapacity(1 << 16);
+
+		const auto json = read_file();
+		CHECK(count(json, "\"name\":\"scope\"") == 8);
+		CHECK(json.find("\"dropped_events\":12") != std::string::npos);
+	}
+
+	SUBCASE("Unsampled sessions do not record anything")
+	{
+		std::filesystem::remove(file);
+		instrumentor.BeginSession("test", file.string(), 0.0);
+		CHECK(!instrumentor.IsActive());
+		{
+			detail::InstrumentationTimer timer("scope");
+		}
+		instrumentor.EndSession();
+		CHECK(!std::filesystem::exists(file));
+	}
+
+	SUBCASE("Profiles outside of a session are ignored")
+	{
+		{
+			detail::InstrumentationTimer timer("outside");
+		}
+		instrumentor.BeginSession("test", file.string());
+		instrumentor.EndSession();
+		CHECK(read_file().find("outside") == std::string::npos);
+	}
+
+	SUBCASE("Profiles started in a previous session are ignored")
+	{
+		instrumentor.BeginSession("previous", file.string());
+		{
+			detail::InstrumentationTimer timer("straddling");
+			instrumentor.BeginSession("test", file.string());
+		}
+		instrumentor.EndSession();
+		const auto json = read_file();
+		CHECK(json.find("\"test\"") != std::string::npos);
+		CHECK(json.find("straddling") == std::string::npos);
+	}
+
+	SUBCASE("Buffers of exited threads are reused")
+	{
+		auto record_sequentially = [&]()
+			{
+				instrumentor.BeginSession("test", file.string());
+				for (size_t i = 0; i < 8; ++i)
+				{
+					std::thread([]() { detail::InstrumentationTimer timer("scope"); }).join();
+				}
+				instrumentor.EndSession();
+			};
+
+		record_sequentially();
+		CHECK(count(read_file(), "\"name\":\"scope\"") == 8);
+		const size_t num_buffers = instrumentor.NumThreadBuffers();
+		for (size_t i = 0; i < 4; ++i)
+		{
+			record_sequentially();
+			CHECK(count(read_file(), "\"name\":\"scope\"") == 8);
+		}
+		CHECK(instrumentor.NumThreadBuffers() == num_buffers);
+	}
+
+	std::filesystem::remove_all("test_data");
+}
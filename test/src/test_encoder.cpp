@@ -0,0 +1,285 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <bit>
+#include <filesystem>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/encoder.h"
+#include "cryptomatte/hash.h"
+#include "cryptomatte/detail/detail.h"
+#include "cryptomatte/detail/encoding_impl.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	/// Generate per-pixel samples where every pixel is covered by up to 4 of the synthetic ids with the same id
+	/// occasionally split up into multiple samples.
+	void make_samples(size_t width, size_t height, std::vector<sample>& samples, std::vector<size_t>& offsets)
+	{
+		const auto& hashes = test_util::cryptomatte::s_synthetic_hashes;
+		offsets.push_back(0);
+		for (size_t y = 0; y < height; ++y)
+		{
+			for (size_t x = 0; x < width; ++x)
+			{
+				size_t num_samples = (x + y) % 5;
+				for (size_t i = 0; i < num_samples; ++i)
+				{
+					uint32_t hash = hashes[(x / 4 + y / 3 + i) % hashes.size()];
+					samples.push_back({ hash, static_cast<float32_t>(i + 1) * 0.1f });
+				}
+				// Split the first id into two samples every so often.
+				if (num_samples > 0 && x % 3 == 0)
+				{
+					samples.push_back({ hashes[(x / 4 + y / 3) % hashes.size()], 0.05f });
+				}
+				offsets.push_back(samples.size());
+			}
+		}
+	}
+
+	/// Compute the mask for `hash` by brute force from the samples, only keeping the `num_levels` ids with the
+	/// highest coverage per pixel.
+	std::vector<float32_t> reference_mask(
+		const std::vector<sample>& samples,
+		const std::vector<size_t>& offsets,
+		uint32_t hash,
+		size_t num_levels
+	)
+	{
+		std::vector<float32_t> out(offsets.size() - 1);
+		for (size_t pixel = 0; pixel + 1 < offsets.size(); ++pixel)
+		{
+			std::vector<std::pair<uint32_t, float32_t>> merged;
+			for (size_t i = offsets[pixel]; i < offsets[pixel + 1]; ++i)
+			{
+				auto it = std::find_if(merged.begin(), merged.end(), [&](const auto& item) { return item.first == samples[i].hash; });
+				if (it != merged.end())
+				{
+					it->second += samples[i].coverage;
+				}
+				else
+				{
+					merged.push_back({ samples[i].hash, samples[i].coverage });
+				}
+			}
+			std::stable_sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+			for (size_t level = 0; level < std::min(num_levels, merged.size()); ++level)
+			{
+				if (merged[level].first == hash)
+				{
+					out[pixel] = merged[level].second;
+				}
+			}
+		}
+		return out;
+	}
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::top_k_selector")
+{
+	detail::top_k_selector selector(2);
+
+	SUBCASE("Merges duplicate ids and sorts by coverage")
+	{
+		std::vector<sample> samples = { { 1, 0.2f }, { 2, 0.3f }, { 1, 0.2f }, { 3, 0.1f } };
+		auto selected = selector.select(samples);
+		REQUIRE(selected.size() == 2);
+		CHECK(selected[0].hash == 1);
+		CHECK(selected[0].coverage == doctest::Approx(0.4f));
+		CHECK(selected[1].hash == 2);
+		CHECK(selected[1].coverage == doctest::Approx(0.3f));
+	}
+
+	SUBCASE("Ties keep the order of first appearance")
+	{
+		std::vector<sample> samples = { { 5, 0.5f }, { 6, 0.5f }, { 7, 0.5f } };
+		auto selected = selector.select(samples);
+		REQUIRE(selected.size() == 2);
+		CHECK(selected[0].hash == 5);
+		CHECK(selected[1].hash == 6);
+	}
+
+	SUBCASE("Empty ids and zero coverage are dropped")
+	{
+		std::vector<sample> samples = { { 0, 1.0f }, { 0x80000000u, 1.0f }, { 4, 0.0f }, { 8, 0.25f } };
+		auto selected = selector.select(samples);
+		REQUIRE(selected.size() == 1);
+		CHECK(selected[0].hash == 8);
+		CHECK(selector.select({}).empty());
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("encode from samples round-trips through the decoder")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	std::vector<sample> samples;
+	std::vector<size_t> offsets;
+	make_samples(width, height, samples, offsets);
+
+	for (size_t num_levels : { 1, 2, 3, 6 })
+	{
+		encode_options options;
+		options.name = "CryptoAsset";
+		options.num_levels = num_levels;
+		options.exec = std::make_shared<thread_pool_executor>(3);
+		auto matte = encode(samples, offsets, width, height, options);
+
+		CHECK(matte.width() == width);
+		CHECK(matte.height() == height);
+		CHECK(matte.num_levels() == num_levels);
+		CHECK(matte.metadata().name() == "CryptoAsset");
+		CHECK(matte.metadata().key().size() == 7);
+		CHECK(!matte.metadata().manifest().has_value());
+
+		auto masks = matte.masks(test_util::cryptomatte::s_synthetic_hashes);
+		for (auto hash : test_util::cryptomatte::s_synthetic_hashes)
+		{
+			auto reference = reference_mask(samples, offsets, hash, num_levels);
+			auto decoded = masks.at(detail::uint32_t_to_hex_str(hash));
+			REQUIRE(decoded.size() == reference.size());
+			for (size_t i = 0; i < reference.size(); ++i)
+			{
+				if (decoded[i] != doctest::Approx(reference[i]))
+				{
+					REQUIRE_MESSAGE(decoded[i] == doctest::Approx(reference[i]), "Mismatch at pixel " << i);
+				}
+			}
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("encode from masks round-trips through the decoder")
+{
+	constexpr size_t width = 97;
+	constexpr size_t height = 61;
+	auto reference = test_util::cryptomatte::make_synthetic(width, height, 2);
+	auto reference_masks = reference.masks();
+
+	std::vector<std::pair<uint32_t, std::span<const float32_t>>> masks;
+	for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_names.size(); ++i)
+	{
+		masks.push_back({
+			test_util::cryptomatte::s_synthetic_hashes[i],
+			std::span<const float32_t>(reference_masks.at(test_util::cryptomatte::s_synthetic_names[i]))
+		});
+	}
+
+	encode_options options;
+	options.num_levels = 2;
+	options.manifest = reference.metadata().manifest();
+	auto matte = encode(masks, width, height, options);
+
+	CHECK(matte.metadata().manifest().has_value());
+	CHECK(matte.masks() == reference_masks);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("encode from named masks builds the manifest")
+{
+	constexpr size_t width = 3;
+	constexpr size_t height = 1;
+	std::vector<float32_t> bunny = { 0.75f, 1.0f, 0.0f };
+	std::vector<float32_t> teapot = { 0.25f, 0.0f, 0.0f };
+	std::vector<float32_t> bunny_rest = { 0.0f, 0.0f, 0.5f };
+
+	// Any manifest passed in is replaced by the one built from the names.
+	encode_options options;
+	options.manifest = manifest::from_str(R"({"unrelated": "42c9679f"})");
+	auto matte = encode(
+		{ { "bunny", bunny }, { "teapot", teapot }, { "bunny", bunny_rest } },
+		width,
+		height,
+		options
+	);
+
+	REQUIRE(matte.metadata().manifest().has_value());
+	const auto& manif = matte.metadata().manifest().value();
+	CHECK(manif.size() == 2);
+	CHECK(manif.hash("bunny") == hash_name("bunny"));
+	CHECK(manif.hash("teapot") == hash_name("teapot"));
+	CHECK_FALSE(manif.contains("unrelated"));
+	CHECK(manif.verify().empty());
+
+	// Masks sharing a name are summed.
+	CHECK(matte.mask("bunny") == std::vector<float32_t>{ 0.75f, 1.0f, 0.5f });
+	CHECK(matte.mask("teapot") == teapot);
+	CHECK(matte.mask(hash_name("bunny")) == matte.mask("bunny"));
+
+	std::vector<float32_t> too_small(2);
+	CHECK_THROWS_AS(encode({ { "bunny", too_small } }, width, height), std::invalid_argument);
+}
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("encode invalid arguments")
+{
+	std::vector<sample> samples = { { 1, 1.0f } };
+	std::vector<size_t> offsets = { 0, 1, 1, 1 };
+	CHECK_NOTHROW(encode(samples, offsets, 3, 1));
+	CHECK_THROWS_AS(encode(samples, offsets, 0, 1), std::invalid_argument);
+	CHECK_THROWS_AS(encode(samples, offsets, 2, 1), std::invalid_argument);
+
+	std::vector<size_t> decreasing = { 0, 1, 0, 1 };
+	CHECK_THROWS_AS(encode(samples, decreasing, 3, 1), std::invalid_argument);
+	std::vector<size_t> out_of_range = { 0, 1, 1, 2 };
+	CHECK_THROWS_AS(encode(samples, out_of_range, 3, 1), std::invalid_argument);
+
+	encode_options no_levels;
+	no_levels.num_levels = 0;
+	CHECK_THROWS_AS(encode(samples, offsets, 3, 1, no_levels), std::invalid_argument);
+
+	std::vector<float32_t> mask(2);
+	std::vector<std::pair<uint32_t, std::span<const float32_t>>> masks = { { 1, std::span<const float32_t>(mask) } };
+	CHECK_THROWS_AS(encode(masks, 3, 1), std::invalid_argument);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("encode and write round-trips through cryptomatte::load")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	std::vector<sample> samples;
+	std::vector<size_t> offsets;
+	make_samples(width, height, samples, offsets);
+
+	encode_options options;
+	options.num_levels = 3;
+	options.manifest = test_util::cryptomatte::make_synthetic_metadata().manifest();
+	auto matte = encode(samples, offsets, width, height, options);
+
+	std::filesystem::path file = "test_data/encoded.exr";
+	std::filesystem::create_directories(file.parent_path());
+	matte.write(file);
+
+	auto loaded = cryptomatte::load(file, false);
+	REQUIRE(loaded.size() == 1);
+	CHECK(loaded[0].metadata().name() == "CryptoObject");
+	CHECK(loaded[0].num_levels() == 3);
+	CHECK(loaded[0].masks() == matte.masks());
+
+	std::filesystem::remove_all("test_data");
+}
@@ -0,0 +1,228 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/executor.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	std::vector<std::shared_ptr<executor>> make_executors()
+	{
+		return {
+			std::make_shared<std_executor>(),
+			std::make_shared<sequential_executor>(),
+			std::make_shared<thread_pool_executor>(1),
+			std::make_shared<thread_pool_executor>(3),
+		};
+	}
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("executor::parallel_for covers the whole range exactly once")
+{
+	for (const auto& exec : make_executors())
+	{
+		for (size_t count : { 0, 1, 7, 1000, 100003 })
+		{
+			std::vector<std::atomic<int>> visited(count);
+			std::atomic<size_t> min_range = std::numeric_limits<size_t>::max();
+			std::atomic<size_t> num_ranges = 0;
+			exec->parallel_for(count, 64, [&](size_t begin, size_t end)
+				{
+					CHECK(begin < end);
+					if (end != count)
+					{
+						min_range = std::min(min_range.load(), end - begin);
+					}
+					++num_ranges;
+					for (size_t i = begin; i < end; ++i)
+					{
+						++visited[i];
+					}
+				});
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (visited[i] != 1)
+				{
+					REQUIRE_MESSAGE(visited[i] == 1, "Index " << i << " was visited " << visited[i] << " times");
+				}
+			}
+			if (num_ranges > 1)
+			{
+				CHECK(min_range >= 64);
+			}
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("executor::parallel_for propagates exceptions")
+{
+	for (const auto& exec : make_executors())
+	{
+		CHECK_THROWS_AS(
+			exec->parallel_for(1000, 1, [](size_t begin, size_t end)
+				{
+					if (begin <= 500 && 500 < end)
+					{
+						throw std::runtime_error("error");
+					}
+				}),
+			std::runtime_error
+		);
+
+		// The executor must still be usable after an exception
+		std::atomic<size_t> sum = 0;
+		exec->parallel_for(100, 1, [&](size_t begin, size_t end) { sum += end - begin; });
+		CHECK(sum == 100);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("executor::parallel_for nested calls")
+{
+	for (const auto& exec : make_executors())
+	{
+		std::atomic<size_t> sum = 0;
+		exec->parallel_for(16, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					exec->parallel_for(1000, 10, [&](size_t inner_begin, size_t inner_end)
+						{
+							sum += inner_end - inner_begin;
+						});
+				}
+			});
+		CHECK(sum == 16 * 1000);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("thread_pool_executor")
+{
+	CHECK_THROWS_AS(thread_pool_executor(0), std::invalid_argument);
+	CHECK(thread_pool_executor(1).concurrency() == 1);
+	CHECK(thread_pool_executor(5).concurrency() == 5);
+	CHECK(sequential_executor().concurrency() == 1);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("set_default_executor")
+{
+	auto previous = get_default_executor();
+	REQUIRE(previous);
+
+	auto exec = std::make_shared<sequential_executor>();
+	set_default_executor(exec);
+	CHECK(get_default_executor() == exec);
+
+	// Resetting falls back to a std_executor.
+	set_default_executor(nullptr);
+	CHECK(get_default_executor() != nullptr);
+	CHECK(dynamic_cast<std_executor*>(get_default_executor().get()) != nullptr);
+
+	set_default_executor(previous);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte decodes identically on all executors")
+{
+	constexpr size_t width = 97;
+	constexpr size_t height = 61;
+	auto reference = test_util::cryptomatte::make_synthetic(width, height, 4, 4096);
+	CHECK(reference.executor() == nullptr);
+	auto reference_masks = reference.masks();
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+
+	for (const auto& exec : make_executors())
+	{
+		auto matte = cryptomatte(
+			raw_channels, width, height, test_util::cryptomatte::make_synthetic_metadata(), coverage_precision::float32, exec
+		);
+		CHECK(matte.executor() == exec);
+
+		auto masks = matte.masks();
+		auto masks_compressed = matte.masks_compressed();
+		REQUIRE(masks.size() == reference_masks.size());
+		for (const auto& [name, reference_mask] : reference_masks)
+		{
+			CHECK(masks.at(name) == reference_mask);
+			CHECK(masks_compressed.at(name).get_decompressed() == reference_mask);
+			CHECK(matte.mask(name) == reference_mask);
+		}
+
+		// Also check swapping out the executor after construction.
+		reference.set_executor(exec);
+		CHECK(reference.executor() == exec);
+		CHECK(reference.masks(test_util::cryptomatte::s_synthetic_names) == reference_masks);
+		reference.set_executor(nullptr);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte channel-parallel decoding matches the reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 6);
+
+	// Small chunk sizes give us many chunks (and a partial last chunk) to spread across the workers.
+	for (size_t chunk_size : { size_t{ 1024 }, size_t{ 4096 }, size_t{ 65536 } })
+	{
+		for (const auto& exec : make_executors())
+		{
+			auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, chunk_size);
+			matte.set_executor(exec);
+
+			auto masks = matte.masks();
+			auto masks_compressed = matte.masks_compressed();
+			auto masks_by_hash = matte.masks(test_util::cryptomatte::s_synthetic_hashes);
+			auto masks_compressed_by_hash = matte.masks_compressed(test_util::cryptomatte::s_synthetic_hashes);
+			REQUIRE(masks.size() == test_util::cryptomatte::s_synthetic_names.size());
+			REQUIRE(masks_compressed.size() == test_util::cryptomatte::s_synthetic_names.size());
+
+			for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_names.size(); ++i)
+			{
+				const auto& name = test_util::cryptomatte::s_synthetic_names[i];
+				auto hash = test_util::cryptomatte::s_synthetic_hashes[i];
+				auto reference = test_util::cryptomatte::compute_reference_mask(raw_channels, hash, 6);
+
+				CHECK(matte.mask(hash) == reference);
+				CHECK(matte.mask_compressed(hash).get_decompressed() == reference);
+				CHECK(masks.at(name) == reference);
+				CHECK(masks_compressed.at(name).get_decompressed() == reference);
+				CHECK(masks_by_hash.at(name) == reference);
+				CHECK(masks_compressed_by_hash.at(name).get_decompressed() == reference);
+			}
+		}
+	}
+}
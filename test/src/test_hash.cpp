@@ -0,0 +1,80 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <format>
+
+#include "util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/encoder.h"
+#include "cryptomatte/hash.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("hash_name")
+{
+	// The examples from the cryptomatte specification
+	CHECK(hash_name("bunny") == 0x13851a76);
+	CHECK(hash_name("default") == 0x42c9679f);
+
+	// The 'uint32_to_float32' conversion never produces denormals, infinities or NaNs.
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		auto exponent = (hash_name(std::format("object_{}", i)) >> 23) & 0xff;
+		CHECK(exponent != 0);
+		CHECK(exponent != 0xff);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("hash_names matches hash_name")
+{
+	CHECK(hash_names({}).empty());
+
+	// Enough names of varying lengths to cover both the batched path and the remainder.
+	std::vector<std::string> names;
+	for (size_t i = 0; i < 37; ++i)
+	{
+		names.push_back(std::format("asset_{}_{}", i, std::string(i % 11, 'x')));
+	}
+	names.push_back("");
+
+	auto hashes = hash_names(names);
+	REQUIRE(hashes.size() == names.size());
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		CHECK(hashes[i] == hash_name(names[i]));
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::mask_by_name_unmanifested")
+{
+	constexpr size_t width = 4;
+	constexpr size_t height = 2;
+	const uint32_t bunny = hash_name("bunny");
+	const uint32_t teapot = hash_name("teapot");
+	std::vector<sample> samples = {
+		{ bunny, 1.0f },
+		{ bunny, 0.25f }, { teapot, 0.75f },
+		{ teapot, 1.0f },
+	};
+	std::vector<size_t> offsets = { 0, 1, 3, 4, 4, 4, 4, 4, 4 };
+
+	// No manifest is passed, so the name based overloads of `mask` are unavailable.
+	auto matte = encode(samples, offsets, width, height);
+	REQUIRE(!matte.metadata().manifest().has_value());
+	CHECK_THROWS_AS(matte.mask(std::string("bunny")), std::invalid_argument);
+
+	CHECK(matte.mask_by_name_unmanifested("bunny") == std::vector<float32_t>{ 1.0f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f });
+	CHECK(matte.mask_by_name_unmanifested("teapot") == std::vector<float32_t>{ 0.0f, 0.75f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f });
+	CHECK(matte.mask_by_name_unmanifested("missing") == std::vector<float32_t>(width * height, 0.0f));
+}
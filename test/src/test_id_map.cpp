@@ -0,0 +1,72 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <bit>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/detail/id_map_impl.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::accumulate_dominant_id")
+{
+	const float32_t id_a = std::bit_cast<float32_t>(uint32_t{ 0x3ab5de01 });
+	const float32_t id_b = std::bit_cast<float32_t>(uint32_t{ 0x6d15e631 });
+	std::vector<uint32_t> ids(5);
+	std::vector<float32_t> coverage(5);
+
+	std::vector<float32_t> rank_0 = { id_a, id_a, 0.0f, id_b, -0.0f };
+	std::vector<float32_t> covr_0 = { 0.5f, 0.25f, 1.0f, 0.5f, 1.0f };
+	detail::accumulate_dominant_id(rank_0, covr_0, ids, coverage);
+	std::vector<float32_t> rank_1 = { id_b, id_b, id_b, id_a, 0.0f };
+	std::vector<float32_t> covr_1 = { 0.5f, 0.75f, 0.5f, 0.25f, 0.0f };
+	detail::accumulate_dominant_id(rank_1, covr_1, ids, coverage);
+
+	// Ties keep the earlier level, empty ids are never taken.
+	CHECK(ids == std::vector<uint32_t>{ 0x3ab5de01, 0x6d15e631, 0x6d15e631, 0x6d15e631, 0 });
+	CHECK(coverage == std::vector<float32_t>{ 0.5f, 0.75f, 0.5f, 0.5f, 0.0f });
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::id_map matches reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	constexpr size_t num_levels = 4;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, num_levels);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+
+	// The reference: the argmax over the full masks of all ids.
+	std::vector<uint32_t> expected_ids(width * height);
+	std::vector<float32_t> expected_coverage(width * height);
+	auto reference_masks = test_util::cryptomatte::compute_reference_masks(raw_channels, num_levels);
+	for (size_t h = 0; h < reference_masks.size(); ++h)
+	{
+		for (size_t i = 0; i < reference_masks[h].size(); ++i)
+		{
+			if (reference_masks[h][i] > expected_coverage[i])
+			{
+				expected_ids[i] = test_util::cryptomatte::s_synthetic_hashes[h];
+				expected_coverage[i] = reference_masks[h][i];
+			}
+		}
+	}
+
+	auto map = matte.id_map();
+	CHECK(map.ids == expected_ids);
+	CHECK(map.coverage == expected_coverage);
+
+	auto map_compressed = matte.id_map_compressed();
+	CHECK(map_compressed.ids.get_decompressed() == expected_ids);
+	CHECK(map_compressed.coverage.get_decompressed() == expected_coverage);
+}
+
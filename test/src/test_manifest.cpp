@@ -2,10 +2,14 @@
 
 #include <vector>
 #include <string>
+#include <format>
+#include <algorithm>
 
 #include "util.h"
 
 #include "cryptomatte/manifest.h"
+#include "cryptomatte/hash.h"
+#include "cryptomatte/detail/string_util.h"
 
 using namespace NAMESPACE_CRYPTOMATTE_API;
 
@@ -284,4 +288,85 @@ TEST_CASE("manifest::load malformed sidecar manifest file")
 	CHECK(res == std::nullopt);
 
 	std::filesystem::remove_all("test_data");
-}
\ No newline at end of file
+}
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("manifest::verify")
+{
+	// The example manifest from the cryptomatte specification
+	auto manif = manifest::from_str(R"({"bunny": "13851a76", "default": "42c9679f"})");
+	CHECK(manif.verify().empty());
+
+	// Enough entries to go through the batched path with a corrupted entry in the middle of a batch.
+	std::vector<std::pair<std::string, uint32_t>> mapping;
+	for (size_t i = 0; i < 37; ++i)
+	{
+		auto name = std::format("asset_{}_{}", i, std::string(i % 11, 'x'));
+		mapping.push_back({ name, hash_name(name) });
+	}
+	mapping[13].second ^= 1;
+	manifest large(mapping);
+	CHECK(large.verify() == std::vector<std::string>{ mapping[13].first });
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("manifest name index queries")
+{
+	manifest manif(std::vector<std::pair<std::string, uint32_t>>{
+		{ "/crowd/char_02/body_geo", 3 },
+		{ "/crowd/char_01/body", 1 },
+		{ "/set/table", 4 },
+		{ "/crowd/char_01/head", 2 },
+		{ "/crowd/char_01/head", 5 },
+	});
+
+	// Duplicates resolve to the first entry like the linear lookups did.
+	CHECK(manif.contains("/set/table"));
+	CHECK_FALSE(manif.contains("/set"));
+	CHECK(manif.hash("/crowd/char_01/head") == 2);
+	CHECK(manif.name(3) == "/crowd/char_02/body_geo");
+	CHECK(manif.name(5) == "/crowd/char_01/head");
+	CHECK(!manif.name(6).has_value());
+
+	CHECK(manif.hashes_with_prefix("/crowd/char_01/") == std::vector<uint32_t>{ 1, 2, 5 });
+	CHECK(manif.hashes_with_prefix("/crowd/char_03") == std::vector<uint32_t>{});
+	CHECK(manif.hashes_with_prefix("").size() == 5);
+
+	CHECK(manif.hashes_matching("*/char_*/body*") == std::vector<uint32_t>{ 1, 3 });
+	CHECK(manif.hashes_matching("/crowd/char_0?/head") == std::vector<uint32_t>{ 2, 5 });
+	CHECK(manif.hashes_matching("/set/table") == std::vector<uint32_t>{ 4 });
+	CHECK(manif.hashes_matching("*/missing").empty());
+	CHECK(manif.names_matching("/s*") == std::vector<std::string_view>{ "/set/table" });
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("manifest::hashes_matching matches brute force on a large manifest")
+{
+	std::vector<std::pair<std::string, uint32_t>> mapping;
+	for (uint32_t i = 0; i < 20000; ++i)
+	{
+		mapping.push_back({ std::format("/crowd/group_{}/char_{}/{}", i % 7, i, i % 3 == 0 ? "body" : "cloth"), i });
+	}
+	manifest manif(mapping);
+
+	for (std::string_view pattern : { "*/char_*/body*", "/crowd/group_3/*", "/crowd/group_?/char_1?/*", "*" })
+	{
+		std::vector<uint32_t> expected;
+		for (const auto& [name, hash] : mapping)
+		{
+			if (str::glob_match(name, pattern))
+			{
+				expected.push_back(hash);
+			}
+		}
+		auto matched = manif.hashes_matching(pattern);
+		std::sort(expected.begin(), expected.end());
+		std::sort(matched.begin(), matched.end());
+		CHECK(matched == expected);
+	}
+}
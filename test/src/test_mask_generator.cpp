@@ -0,0 +1,144 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/mask_generator.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::ids matches the synthetic hashes")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	constexpr size_t num_levels = 4;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, num_levels);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+
+	std::vector<uint32_t> expected;
+	for (auto hash : test_util::cryptomatte::s_synthetic_hashes)
+	{
+		auto mask = test_util::cryptomatte::compute_reference_mask(raw_channels, hash, num_levels);
+		if (std::any_of(mask.begin(), mask.end(), [](float32_t value) { return value != 0.0f; }))
+		{
+			expected.push_back(hash);
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+	REQUIRE(!expected.empty());
+
+	CHECK(matte.ids() == expected);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::masks_incremental matches cryptomatte::masks")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	constexpr size_t num_levels = 4;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, num_levels);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+	auto reference = matte.masks();
+	const auto ids = matte.ids();
+
+	for (auto [strategy, max_masks] : std::vector<std::pair<incremental_strategy, size_t>>{
+		{ incremental_strategy::single_pass, 1 },
+		{ incremental_strategy::single_pass, 2 },
+		{ incremental_strategy::single_pass, 16 },
+		{ incremental_strategy::batched, 1 },
+		{ incremental_strategy::batched, 2 },
+		{ incremental_strategy::batched, 16 },
+	})
+	{
+		auto generator = matte.masks_incremental(max_masks, {}, strategy);
+		CHECK(generator.size() == reference.size());
+
+		std::vector<std::string> names;
+		while (auto mask = generator.next())
+		{
+			REQUIRE(reference.contains(mask->first));
+			CHECK(mask->second == reference.at(mask->first));
+			names.push_back(mask->first);
+			CHECK(generator.remaining() == generator.size() - names.size());
+		}
+		CHECK(names.size() == reference.size());
+		CHECK(generator.remaining() == 0);
+		// Exhausted generators keep returning nothing.
+		CHECK(!generator.next().has_value());
+
+		// The masks are returned in ascending order of their hashes.
+		REQUIRE(names.size() == ids.size());
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			auto it = std::find(
+				test_util::cryptomatte::s_synthetic_hashes.begin(), 
+				test_util::cryptomatte::s_synthetic_hashes.end(), 
+				ids[i]
+			);
+			REQUIRE(it != test_util::cryptomatte::s_synthetic_hashes.end());
+			auto idx = std::distance(test_util::cryptomatte::s_synthetic_hashes.begin(), it);
+			CHECK(names[i] == test_util::cryptomatte::s_synthetic_names[idx]);
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::masks_incremental by names and hashes")
+{
+	constexpr size_t width = 64;
+	constexpr size_t height = 48;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height);
+
+	SUBCASE("names are returned in the requested order without duplicates")
+	{
+		std::vector<std::string> requested = { "sphere", "box", "sphere" };
+		auto reference = matte.masks(std::vector<std::string>{ "sphere", "box" });
+		auto generator = matte.masks_incremental(requested, 1);
+		CHECK(generator.size() == 2);
+
+		auto first = generator.next();
+		REQUIRE(first.has_value());
+		CHECK(first->first == "sphere");
+		CHECK(first->second == reference.at("sphere"));
+
+		auto second = generator.next();
+		REQUIRE(second.has_value());
+		CHECK(second->first == "box");
+		CHECK(second->second == reference.at("box"));
+
+		CHECK(!generator.next().has_value());
+	}
+
+	SUBCASE("hashes not in the image yield empty masks")
+	{
+		for (auto strategy : { incremental_strategy::single_pass, incremental_strategy::batched })
+		{
+			auto generator = matte.masks_incremental(std::vector<uint32_t>{ 0x12345678 }, 16, {}, strategy);
+			auto mask = generator.next();
+			REQUIRE(mask.has_value());
+			CHECK(mask->second.size() == width * height);
+			CHECK(std::all_of(mask->second.begin(), mask->second.end(), [](float32_t value) { return value == 0.0f; }));
+		}
+	}
+
+	SUBCASE("invalid arguments")
+	{
+		CHECK_THROWS_AS(matte.masks_incremental(0), std::invalid_argument);
+		CHECK_THROWS_AS(matte.masks_incremental(std::vector<std::string>{ "not_on_manifest" }), std::invalid_argument);
+	}
+}
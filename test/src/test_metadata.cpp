@@ -4,6 +4,7 @@
 #include <string>
 
 #include "util.h"
+#include "cryptomatte_util.h"
 
 #include "cryptomatte/metadata.h"
 
@@ -201,4 +202,22 @@ TEST_CASE("metadata::from_json parses embedded manifest")
     REQUIRE(manif.has_value());
     CHECK(manif->contains("hero"));
     CHECK(manif->hash<std::string>("hero") == "00000001");
-}
\ No newline at end of file
+}
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("metadata::to_json round-trips through metadata::from_json")
+{
+    auto meta = test_util::cryptomatte::make_synthetic_metadata();
+    auto json = meta.to_json();
+    CHECK(json["cryptomatte/a1b2c3d/name"] == "crypto");
+    CHECK(json["cryptomatte/a1b2c3d/hash"] == "MurmurHash3_32");
+    CHECK(json["cryptomatte/a1b2c3d/conversion"] == "uint32_to_float32");
+
+    auto decoded = metadata::from_json(json, "");
+    REQUIRE(decoded.size() == 1);
+    CHECK(decoded[0].name() == meta.name());
+    CHECK(decoded[0].key() == meta.key());
+    REQUIRE(decoded[0].manifest().has_value());
+    CHECK(decoded[0].manifest()->mapping() == meta.manifest()->mapping());
+}
@@ -0,0 +1,115 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::ids_at matches reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	constexpr size_t num_levels = 4;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, num_levels);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+
+	auto reference_masks = test_util::cryptomatte::compute_reference_masks(raw_channels, num_levels);
+
+	// Points across multiple chunks in no particular order, including duplicates.
+	std::vector<std::pair<size_t, size_t>> points;
+	for (size_t i = 0; i < 400; ++i)
+	{
+		points.push_back({ (i * 37) % width, (i * 53) % height });
+	}
+	points.push_back(points.front());
+	points.push_back({ width - 1, height - 1 });
+
+	auto check_ids = [&](const std::vector<pixel_id>& ids, size_t x, size_t y)
+		{
+			const size_t pixel = y * width + x;
+			size_t num_expected = 0;
+			for (size_t i = 0; i < reference_masks.size(); ++i)
+			{
+				if (reference_masks[i][pixel] == 0.0f)
+				{
+					continue;
+				}
+				++num_expected;
+				auto it = std::find_if(ids.begin(), ids.end(), [&](const pixel_id& id) { return id.hash == test_util::cryptomatte::s_synthetic_hashes[i]; });
+				REQUIRE(it != ids.end());
+				CHECK(it->name == test_util::cryptomatte::s_synthetic_names[i]);
+				CHECK(it->coverage == doctest::Approx(reference_masks[i][pixel]));
+			}
+			CHECK(ids.size() == num_expected);
+			CHECK(std::is_sorted(ids.begin(), ids.end(), [](const pixel_id& a, const pixel_id& b) { return a.coverage > b.coverage; }));
+		};
+
+	SUBCASE("Batched")
+	{
+		auto result = matte.ids_at(std::span<const std::pair<size_t, size_t>>(points));
+		REQUIRE(result.size() == points.size());
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			check_ids(result[i], points[i].first, points[i].second);
+		}
+	}
+
+	SUBCASE("Single pixel with and without cache")
+	{
+		CHECK(matte.pick_cache_capacity() == 0);
+		for (size_t capacity : { 0, 1, 4 })
+		{
+			matte.set_pick_cache_capacity(capacity);
+			CHECK(matte.pick_cache_capacity() == capacity);
+			for (const auto& [x, y] : points)
+			{
+				check_ids(matte.ids_at(x, y), x, y);
+			}
+		}
+	}
+
+	SUBCASE("Pixels without ids on all levels")
+	{
+		// Clear the second level on the left of the image so that only some of the pixels of a chunk hold ids 
+		// on it.
+		for (const auto& name : { "crypto00.b", "crypto00.a" })
+		{
+			auto& channel = raw_channels.at(name);
+			for (size_t y = 0; y < height; ++y)
+			{
+				std::fill_n(channel.begin() + y * width, 40, 0.0f);
+			}
+		}
+		reference_masks = test_util::cryptomatte::compute_reference_masks(raw_channels, num_levels);
+		auto cleared = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+
+		for (size_t capacity : { 0, 1 })
+		{
+			cleared.set_pick_cache_capacity(capacity);
+			for (const auto& [x, y] : points)
+			{
+				check_ids(cleared.ids_at(x, y), x, y);
+			}
+			auto result = cleared.ids_at(std::span<const std::pair<size_t, size_t>>(points));
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				check_ids(result[i], points[i].first, points[i].second);
+			}
+		}
+	}
+
+	SUBCASE("Out of range")
+	{
+		CHECK_THROWS_AS(matte.ids_at(width, 0), std::out_of_range);
+		CHECK_THROWS_AS(matte.ids_at(0, height), std::out_of_range);
+	}
+}
@@ -0,0 +1,119 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <stop_token>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/detail/preview_impl.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	/// Compute the preview by brute force from the raw channels as the coverage weighted sum of the id colours.
+	std::vector<std::vector<float32_t>> reference_preview(
+		const std::unordered_map<std::string, std::vector<float32_t>>& channels,
+		size_t num_levels
+	)
+	{
+		std::vector<std::vector<float32_t>> out(3, std::vector<float32_t>(channels.begin()->second.size()));
+		auto masks = test_util::cryptomatte::compute_reference_masks(channels, num_levels);
+		for (size_t h = 0; h < masks.size(); ++h)
+		{
+			const auto& mask = masks[h];
+			auto color = detail::id_to_rgb(test_util::cryptomatte::s_synthetic_hashes[h]);
+			for (size_t i = 0; i < mask.size(); ++i)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					out[c][i] += color[c] * mask[i];
+				}
+			}
+		}
+		return out;
+	}
+
+	void check_preview(const std::vector<std::vector<float32_t>>& preview, const std::vector<std::vector<float32_t>>& reference)
+	{
+		REQUIRE(preview.size() == 3);
+		for (size_t c = 0; c < 3; ++c)
+		{
+			REQUIRE(preview[c].size() == reference[c].size());
+			for (size_t i = 0; i < reference[c].size(); ++i)
+			{
+				if (preview[c][i] != doctest::Approx(reference[c][i]))
+				{
+					REQUIRE_MESSAGE(preview[c][i] == doctest::Approx(reference[c][i]), "Mismatch at channel " << c << ", pixel " << i);
+				}
+			}
+		}
+	}
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::id_to_rgb")
+{
+	auto color = detail::id_to_rgb(0x13851a76u);
+	CHECK(color[0] == doctest::Approx(static_cast<float32_t>(0x051a76u) / static_cast<float32_t>(1u << 23)));
+	CHECK(color[1] == doctest::Approx(static_cast<float32_t>(0x851a7600u) / static_cast<float32_t>(0xffffffffu)));
+	CHECK(color[2] == doctest::Approx(static_cast<float32_t>(0x1a760000u) / static_cast<float32_t>(0xffffffffu)));
+
+	// Empty ids are black.
+	for (uint32_t id : { 0x00000000u, 0x80000000u })
+	{
+		auto empty = detail::id_to_rgb(id);
+		CHECK(empty[0] == 0.0f);
+		CHECK(empty[1] == 0.0f);
+		CHECK(empty[2] == 0.0f);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::generate_preview matches reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	for (size_t num_levels : { 2, 4 })
+	{
+		auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, num_levels);
+		auto reference = reference_preview(raw_channels, num_levels);
+
+		// Multiple (and partial) chunks
+		auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+		check_preview(matte.generate_preview(), reference);
+
+		std::vector<std::vector<float32_t>> decompressed;
+		for (const auto& channel : matte.generate_preview_compressed())
+		{
+			CHECK(channel.width() == width);
+			CHECK(channel.height() == height);
+			decompressed.push_back(channel.get_decompressed());
+		}
+		check_preview(decompressed, reference);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::generate_preview cancellation")
+{
+	auto matte = test_util::cryptomatte::make_synthetic(97, 61, 2, 1024);
+	std::stop_source source;
+	source.request_stop();
+	task_control control;
+	control.stop_token = source.get_token();
+	CHECK_THROWS_AS(matte.generate_preview(control), operation_cancelled);
+	CHECK_THROWS_AS(matte.generate_preview_compressed(control), operation_cancelled);
+}
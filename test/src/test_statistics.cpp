@@ -0,0 +1,94 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	/// Compute the statistics of an id by brute force from its reference mask.
+	id_statistics reference_statistics(const std::vector<float32_t>& mask, size_t width)
+	{
+		id_statistics out;
+		for (size_t i = 0; i < mask.size(); ++i)
+		{
+			if (mask[i] == 0.0f)
+			{
+				continue;
+			}
+			out.pixel_count += 1;
+			out.coverage_sum += mask[i];
+			out.min_x = std::min(out.min_x, i % width);
+			out.min_y = std::min(out.min_y, i / width);
+			out.max_x = std::max(out.max_x, i % width);
+			out.max_y = std::max(out.max_y, i / width);
+		}
+		return out;
+	}
+
+	void check_statistics(const id_statistics& statistics, const id_statistics& reference)
+	{
+		CHECK(statistics.pixel_count == reference.pixel_count);
+		CHECK(statistics.coverage_sum == doctest::Approx(reference.coverage_sum));
+		CHECK(statistics.min_x == reference.min_x);
+		CHECK(statistics.min_y == reference.min_y);
+		CHECK(statistics.max_x == reference.max_x);
+		CHECK(statistics.max_y == reference.max_y);
+	}
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::statistics matches reference")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	constexpr size_t num_levels = 4;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, num_levels);
+
+	std::unordered_map<uint32_t, id_statistics> reference;
+	for (auto hash : test_util::cryptomatte::s_synthetic_hashes)
+	{
+		auto mask = test_util::cryptomatte::compute_reference_mask(raw_channels, hash, num_levels);
+		auto statistics = reference_statistics(mask, width);
+		if (statistics.pixel_count > 0)
+		{
+			reference[hash] = statistics;
+		}
+	}
+	REQUIRE(!reference.empty());
+
+	// Small chunks so the statistics of the ids are spread across many chunks and workers.
+	for (size_t chunk_size : { size_t{ 4096 }, compressed::s_default_chunksize })
+	{
+		auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, chunk_size);
+
+		auto statistics = matte.statistics();
+		CHECK(statistics.size() == reference.size());
+		for (const auto& [hash, expected] : reference)
+		{
+			REQUIRE(statistics.contains(hash));
+			check_statistics(statistics.at(hash), expected);
+		}
+
+		// Only the requested ids which are present in the image are returned.
+		const uint32_t requested = reference.begin()->first;
+		auto requested_statistics = matte.statistics(std::vector<uint32_t>{ requested, 12345 });
+		REQUIRE(requested_statistics.size() == 1);
+		REQUIRE(requested_statistics.contains(requested));
+		check_statistics(requested_statistics.at(requested), reference.at(requested));
+
+		CHECK(matte.statistics(std::vector<uint32_t>{}).empty());
+	}
+}
@@ -128,4 +128,48 @@ TEST_CASE("str::casefold with numbers and symbols")
 	std::string input = "He110@WORLD!";
 	std::string result = str::casefold(input);
 	CHECK(result == "he110@world!");
-}
\ No newline at end of file
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("str::glob_match")
+{
+	CHECK(str::glob_match("", ""));
+	CHECK(str::glob_match("", "*"));
+	CHECK_FALSE(str::glob_match("", "?"));
+	CHECK(str::glob_match("bunny", "bunny"));
+	CHECK_FALSE(str::glob_match("bunny", "bunn"));
+	CHECK(str::glob_match("bunny", "b?nny"));
+	CHECK(str::glob_match("bunny", "*"));
+	CHECK(str::glob_match("bunny", "b*"));
+	CHECK(str::glob_match("bunny", "*y"));
+	CHECK(str::glob_match("bunny", "**n*y"));
+	CHECK_FALSE(str::glob_match("bunny", "*x*"));
+
+	// '*' crosses hierarchy separators.
+	CHECK(str::glob_match("/crowd/char_01/body_geo", "*/char_*/body*"));
+	CHECK(str::glob_match("/crowd/group/char_01/body", "*/char_*/body*"));
+	CHECK_FALSE(str::glob_match("/crowd/char_01/head_geo", "*/char_*/body*"));
+
+	// Requires backtracking over multiple candidate positions.
+	CHECK(str::glob_match("aaab_aab_ab", "*a?_ab"));
+	CHECK_FALSE(str::glob_match("aaab_aab_ac", "*a?_ab"));
+
+	// A '*' in the name does not turn the '*' of the pattern into a literal.
+	CHECK(str::glob_match("*xb", "*b"));
+	CHECK(str::glob_match("a*xb", "a*b"));
+	CHECK(str::glob_match("*", "*"));
+	CHECK_FALSE(str::glob_match("*xc", "*b"));
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("str::glob_literal_prefix")
+{
+	CHECK(str::glob_literal_prefix("/crowd/char_*/body") == "/crowd/char_");
+	CHECK(str::glob_literal_prefix("/crowd/ch?r") == "/crowd/ch");
+	CHECK(str::glob_literal_prefix("*/body") == "");
+	CHECK(str::glob_literal_prefix("bunny") == "bunny");
+}
@@ -0,0 +1,113 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <stop_token>
+
+#include "util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/task_control.h"
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+namespace
+{
+
+	std::vector<decode_strategy> s_strategies = { decode_strategy::channel_parallel, decode_strategy::pipelined };
+
+} // anonymous namespace
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte decoding reports progress")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+
+	for (auto strategy : s_strategies)
+	{
+		auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 1024);
+		matte.set_decode_strategy(strategy);
+		auto reference_masks = matte.masks();
+
+		std::vector<progress> reports;
+		task_control control;
+		control.on_progress = [&](const progress& p) { reports.push_back(p); };
+
+		CHECK(matte.masks(control) == reference_masks);
+		REQUIRE(!reports.empty());
+
+		size_t num_chunks = reports.front().chunks_total;
+		CHECK(num_chunks == (width * height * sizeof(float32_t) + 1023) / 1024);
+		CHECK(reports.size() == num_chunks);
+		for (size_t i = 1; i < reports.size(); ++i)
+		{
+			CHECK(reports[i].chunks_done >= reports[i - 1].chunks_done);
+			CHECK(reports[i].bytes_decompressed >= reports[i - 1].bytes_decompressed);
+			CHECK(reports[i].chunks_total == num_chunks);
+		}
+		CHECK(reports.back().chunks_done == num_chunks);
+		// Every chunk holds ids so at least the rank and coverage of the first level must have been decompressed.
+		CHECK(reports.back().bytes_decompressed >= 2 * width * height * sizeof(float32_t));
+
+		// The compressed overload reports the same number of chunks.
+		reports.clear();
+		matte.masks_compressed(test_util::cryptomatte::s_synthetic_names, control);
+		CHECK(reports.back().chunks_done == num_chunks);
+	}
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte decoding can be cancelled")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+
+	for (auto strategy : s_strategies)
+	{
+		auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 1024);
+		matte.set_decode_strategy(strategy);
+
+		// Cancelled before starting
+		{
+			std::stop_source source;
+			source.request_stop();
+			task_control control;
+			control.stop_token = source.get_token();
+			CHECK_THROWS_AS(matte.masks(control), operation_cancelled);
+			CHECK_THROWS_AS(matte.masks_compressed(control), operation_cancelled);
+		}
+
+		// Cancelled while running, the remaining chunks must be abandoned.
+		{
+			std::stop_source source;
+			size_t chunks_done = 0;
+			size_t chunks_total = 0;
+			task_control control;
+			control.stop_token = source.get_token();
+			control.on_progress = [&](const progress& p)
+				{
+					chunks_done = p.chunks_done;
+					chunks_total = p.chunks_total;
+					if (p.chunks_done >= 3)
+					{
+						source.request_stop();
+					}
+				};
+			CHECK_THROWS_AS(matte.masks_compressed(control), operation_cancelled);
+			CHECK(chunks_done < chunks_total);
+		}
+
+		// The cryptomatte is still usable after cancelling.
+		auto masks = matte.masks();
+		CHECK(masks.size() == test_util::cryptomatte::s_synthetic_names.size());
+	}
+}
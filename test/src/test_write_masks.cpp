@@ -0,0 +1,197 @@
+#include "doctest.h"
+
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <stop_token>
+
+#include "util.h"
+#include "oiio_util.h"
+#include "cryptomatte_util.h"
+
+#include "cryptomatte/cryptomatte.h"
+#include "cryptomatte/detail/oiio_util.h"
+
+#include <compressed/channel.h>
+
+using namespace NAMESPACE_CRYPTOMATTE_API;
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::stream_interleaved_scanlines")
+{
+	// The width deliberately doesn't divide the chunk size so scanlines straddle the chunk boundaries.
+	constexpr size_t width = 97;
+	constexpr size_t height = 53;
+	constexpr size_t chunk_size = 1024;
+
+	std::vector<std::vector<float32_t>> raw(3, std::vector<float32_t>(width * height));
+	for (size_t c = 0; c < raw.size(); ++c)
+	{
+		for (size_t i = 0; i < width * height; ++i)
+		{
+			raw[c][i] = static_cast<float32_t>(i * raw.size() + c);
+		}
+	}
+
+	std::vector<compressed::channel<float32_t>> channels;
+	std::vector<const compressed::channel<float32_t>*> channel_ptrs;
+	for (const auto& data : raw)
+	{
+		channels.push_back(compressed::channel<float32_t>(
+			std::span<const float32_t>(data), width, height, compressed::enums::codec::lz4, 9, chunk_size, chunk_size
+		));
+	}
+	for (const auto& channel : channels)
+	{
+		channel_ptrs.push_back(&channel);
+	}
+
+	auto exec = std::make_shared<thread_pool_executor>(3);
+	std::vector<float32_t> interleaved;
+	size_t next_y = 0;
+	detail::stream_interleaved_scanlines(channel_ptrs, *exec, {}, [&](size_t y_begin, size_t y_end, std::span<const float32_t> pixels)
+		{
+			CHECK(y_begin == next_y);
+			CHECK(y_begin < y_end);
+			CHECK(pixels.size() == (y_end - y_begin) * width * raw.size());
+			next_y = y_end;
+			interleaved.insert(interleaved.end(), pixels.begin(), pixels.end());
+		});
+
+	CHECK(next_y == height);
+	REQUIRE(interleaved.size() == width * height * raw.size());
+	for (size_t i = 0; i < interleaved.size(); ++i)
+	{
+		if (interleaved[i] != static_cast<float32_t>(i))
+		{
+			REQUIRE_MESSAGE(interleaved[i] == static_cast<float32_t>(i), "Mismatch at element " << i);
+		}
+	}
+
+	// Cancellation is checked before each chunk.
+	std::stop_source source;
+	source.request_stop();
+	task_control control;
+	control.stop_token = source.get_token();
+	CHECK_THROWS_AS(
+		detail::stream_interleaved_scanlines(channel_ptrs, *exec, control, [](size_t, size_t, std::span<const float32_t>) {}),
+		operation_cancelled
+	);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("detail::scanline_interleaver: Cleared chunks are empty")
+{
+	constexpr size_t width = 7;
+	constexpr size_t height = 5;
+	constexpr size_t max_chunk_elems = 8;
+	constexpr size_t num_channels = 2;
+
+	std::vector<float32_t> interleaved;
+	detail::scanline_interleaver interleaver(num_channels, width, height, max_chunk_elems,
+		[&](size_t y_begin, size_t y_end, std::span<const float32_t> pixels)
+		{
+			CHECK(y_begin * width * num_channels == interleaved.size());
+			CHECK(pixels.size() == (y_end - y_begin) * width * num_channels);
+			interleaved.insert(interleaved.end(), pixels.begin(), pixels.end());
+		});
+	REQUIRE(interleaver.num_chunks() == 5);
+
+	// Only fill some of the channels on some of the chunks, the rest is cleared.
+	std::vector<float32_t> expected(width * height * num_channels, 0.0f);
+	while (interleaver.chunk_idx() < interleaver.num_chunks())
+	{
+		const size_t chunk_idx = interleaver.chunk_idx();
+		const size_t chunk_num_elems = interleaver.chunk_num_elems();
+		CHECK(chunk_num_elems == (chunk_idx == 4 ? 3 : 8));
+		interleaver.clear();
+
+		const size_t channel_idx = chunk_idx % num_channels;
+		if (chunk_idx != 1)
+		{
+			std::vector<float32_t> chunk(chunk_num_elems);
+			for (size_t i = 0; i < chunk_num_elems; ++i)
+			{
+				const size_t pixel = chunk_idx * max_chunk_elems + i;
+				chunk[i] = static_cast<float32_t>(pixel + 1);
+				expected[pixel * num_channels + channel_idx] = chunk[i];
+			}
+			interleaver.set(channel_idx, chunk);
+		}
+		interleaver.finish_chunk();
+	}
+
+	CHECK(interleaver.chunk_num_elems() == 0);
+	CHECK(interleaved == expected);
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::write_masks round-trips the masks")
+{
+	constexpr size_t width = 211;
+	constexpr size_t height = 97;
+	auto raw_channels = test_util::cryptomatte::make_synthetic_channels(width, height, 4);
+	auto matte = test_util::cryptomatte::make_synthetic(raw_channels, width, height, 4096);
+
+	std::filesystem::path file = "test_data/write_masks.exr";
+	std::filesystem::create_directories(file.parent_path());
+
+	SUBCASE("channels")
+	{
+		write_options options;
+		options.layout = mask_layout::channels;
+		matte.write_masks(file, test_util::cryptomatte::s_synthetic_names, options);
+
+		auto read_channels = test_util::oiio::read<float32_t>(file);
+		REQUIRE(read_channels.size() == test_util::cryptomatte::s_synthetic_hashes.size());
+		for (size_t i = 0; i < read_channels.size(); ++i)
+		{
+			auto reference = test_util::cryptomatte::compute_reference_mask(
+				raw_channels, test_util::cryptomatte::s_synthetic_hashes[i], 4
+			);
+			CHECK(read_channels[i] == reference);
+		}
+	}
+
+	SUBCASE("parts")
+	{
+		write_options options;
+		options.layout = mask_layout::parts;
+		matte.write_masks(file, test_util::cryptomatte::s_synthetic_hashes, options);
+
+		for (size_t i = 0; i < test_util::cryptomatte::s_synthetic_hashes.size(); ++i)
+		{
+			auto reference = test_util::cryptomatte::compute_reference_mask(
+				raw_channels, test_util::cryptomatte::s_synthetic_hashes[i], 4
+			);
+			auto read_channels = test_util::oiio::read<float32_t>(file, static_cast<int>(i));
+			REQUIRE(read_channels.size() == 1);
+			CHECK(read_channels[0] == reference);
+		}
+	}
+
+	std::filesystem::remove_all("test_data");
+}
+
+
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+TEST_CASE("cryptomatte::write_masks invalid arguments")
+{
+	auto matte = test_util::cryptomatte::make_synthetic(32, 32, 2);
+	CHECK_THROWS_AS(matte.write_masks("unused.exr", std::vector<uint32_t>{}), std::invalid_argument);
+	CHECK_THROWS_AS(matte.write_masks("unused.exr", std::vector<std::string>{ "does_not_exist" }), std::invalid_argument);
+	for (auto layout : { mask_layout::channels, mask_layout::parts })
+	{
+		write_options options;
+		options.layout = layout;
+		CHECK_THROWS_AS(cryptomatte{}.write_masks("unused.exr", std::vector<uint32_t>{ 0x3ab5de01 }, options), std::invalid_argument);
+	}
+	CHECK(!std::filesystem::exists("unused.exr"));
+}